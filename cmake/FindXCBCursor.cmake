@@ -0,0 +1,57 @@
+# - Try to find libxcb-cursor
+# Once done this will define
+#
+#  XCBCURSOR_FOUND - system has libxcb-cursor
+#  LIBXCBCURSOR_LIBRARIES - Link these to use libxcb-cursor
+#  LIBXCBCURSOR_INCLUDE_DIR - the libxcb-cursor include dir
+#  LIBXCBCURSOR_DEFINITIONS - compiler switches required for using libxcb-cursor
+
+# Copyright (c) 2008, Helio Chissini de Castro, <helio@kde.org>
+# Copyright (c) 2007, Matthias Kretz, <kretz@kde.org>
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#
+# 1. Redistributions of source code must retain the copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+# 3. The name of the author may not be used to endorse or promote products 
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+# IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+# OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+# IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+# INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+# NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+# THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+IF (NOT WIN32)
+  IF (LIBXCBCURSOR_INCLUDE_DIR AND LIBXCBCURSOR_LIBRARIES)
+    # in cache already
+    SET(XCBCursor_FIND_QUIETLY TRUE)
+  ENDIF (LIBXCBCURSOR_INCLUDE_DIR AND LIBXCBCURSOR_LIBRARIES)
+
+  # use pkg-config to get the directories and then use these values
+  # in the FIND_PATH() and FIND_LIBRARY() calls
+  FIND_PACKAGE(PkgConfig)
+  PKG_CHECK_MODULES(PKG_XCBCURSOR QUIET xcb-cursor)
+
+  SET(LIBXCBCURSOR_DEFINITIONS ${PKG_XCBCURSOR_CFLAGS})
+
+  FIND_PATH(LIBXCBCURSOR_INCLUDE_DIR xcb/xcb_cursor.h ${PKG_XCBCURSOR_INCLUDE_DIRS})
+
+  FIND_LIBRARY(LIBXCBCURSOR_LIBRARIES NAMES xcb-cursor libxcb-cursor PATHS ${PKG_XCBCURSOR_LIBRARY_DIRS})
+
+  include(FindPackageHandleStandardArgs)
+  FIND_PACKAGE_HANDLE_STANDARD_ARGS(XCBCursor DEFAULT_MSG LIBXCBCURSOR_LIBRARIES LIBXCBCURSOR_INCLUDE_DIR)
+
+  MARK_AS_ADVANCED(LIBXCBCURSOR_INCLUDE_DIR LIBXCBCURSOR_LIBRARIES)
+ENDIF (NOT WIN32)
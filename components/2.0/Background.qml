@@ -27,15 +27,27 @@ import QtQuick 2.0
 FocusScope {
     id: container
 
-    property alias source: image.source
+    property url source
     property alias fillMode: image.fillMode
     property alias status: image.status
 
+    // the greeter decodes the image scaled to the screen, off the main
+    // thread, and caches the result; tiling and padding need it unscaled
+    readonly property bool __scaled: (fillMode == Image.Stretch || fillMode == Image.PreserveAspectFit ||
+                                      fillMode == Image.PreserveAspectCrop) &&
+                                     (source.toString().indexOf("file:") == 0 || source.toString().indexOf("qrc:") == 0)
 
     Image {
         id: image
         anchors.fill: parent
 
+        // wait for the size to be known instead of decoding at full size
+        source: !container.__scaled ? container.source
+              : container.width > 0 && container.height > 0 ? "image://sddm-background/" + encodeURIComponent(container.source)
+              : ""
+        sourceSize.width: container.__scaled ? container.width : 0
+        sourceSize.height: container.__scaled ? container.height : 0
+
         clip: true
         focus: true
         smooth: true
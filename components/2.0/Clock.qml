@@ -31,9 +31,14 @@ Column {
     property color color: "white"
     property alias timeFont: time.font
     property alias dateFont: date.font
+    property bool showSeconds: false
 
     Timer {
-        interval: 100; running: true; repeat: true;
+        // wake up when the shown time changes, not in between
+        interval: container.showSeconds
+                  ? 1000 - container.dateTime.getMilliseconds()
+                  : 60000 - container.dateTime.getSeconds() * 1000 - container.dateTime.getMilliseconds()
+        running: true; repeat: true;
         onTriggered: container.dateTime = new Date()
     }
 
@@ -43,7 +48,7 @@ Column {
 
         color: container.color
 
-        text : Qt.formatTime(container.dateTime, "hh:mm")
+        text : Qt.formatTime(container.dateTime, container.showSeconds ? "hh:mm:ss" : "hh:mm")
 
         font.pointSize: 72
     }
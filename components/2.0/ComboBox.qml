@@ -39,6 +39,8 @@ FocusScope {
     property font font
     property alias model: listView.model
     property int index: 0
+    // rows shown at once, the list scrolls beyond that
+    property int maxVisibleItems: 10
     property alias arrowColor: arrow.color
     property alias arrowIcon: arrowIcon.source
 
@@ -144,6 +146,33 @@ FocusScope {
             close(true)
         } else if (event.key === Qt.Key_Escape) {
             close(false)
+        } else if (event.text !== "" && event.text.trim() !== "") {
+            typeAhead(event.text)
+        }
+    }
+
+    // typed text is matched against the names of models with a
+    // search() method, such as userModel, without going over the rows
+    property string searchText: ""
+
+    Timer {
+        id: searchTimer
+        interval: 1000
+        onTriggered: container.searchText = ""
+    }
+
+    function typeAhead(text) {
+        if (!listView.model || typeof listView.model.search !== "function")
+            return
+
+        searchText += text
+        searchTimer.restart()
+
+        var names = listView.model.search(searchText, 1)
+        if (names.length > 0) {
+            var row = listView.model.indexOf(names[0])
+            if (row >= 0)
+                listView.currentIndex = row
         }
     }
 
@@ -191,7 +220,14 @@ FocusScope {
 
         ListView {
             id: listView
-            width: container.width; height: (container.height - 2*container.borderWidth) * count + container.borderWidth
+            // only the current item exists while closed, when open only the
+            // visible rows and another page of them get a delegate
+            width: container.width
+            height: dropDown.state === "visible" ? (container.height - 2*container.borderWidth) * Math.min(count, container.maxVisibleItems) + container.borderWidth : 0
+            cacheBuffer: (container.height - 2*container.borderWidth) * container.maxVisibleItems
+            clip: true
+            boundsBehavior: Flickable.StopAtBounds
+            highlightMoveDuration: 0
             delegate: myDelegate
             highlight: Rectangle {
                 anchors.horizontalCenter: parent ? parent.horizontalCenter : undefined;
@@ -211,7 +247,7 @@ FocusScope {
         states: [
             State {
                 name: "visible";
-                PropertyChanges { target: dropDown; height: (container.height - 2*container.borderWidth) * listView.count + container.borderWidth}
+                PropertyChanges { target: dropDown; height: (container.height - 2*container.borderWidth) * Math.min(listView.count, container.maxVisibleItems) + container.borderWidth}
             }
         ]
     }
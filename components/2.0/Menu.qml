@@ -31,6 +31,8 @@ Rectangle {
     width: 200; height: 0
 
     property int itemHeight: 30
+    // rows shown at once, the list scrolls beyond that
+    property int maxVisibleItems: 10
     property alias model: menuList.model
     property alias index: menuList.currentIndex
 
@@ -39,7 +41,7 @@ Rectangle {
     states: [
         State {
             name: "visible";
-            PropertyChanges { target: menu; height: itemHeight * menuList.count }
+            PropertyChanges { target: menu; height: itemHeight * Math.min(menuList.count, maxVisibleItems) }
         }
     ]
 
@@ -81,6 +83,9 @@ Rectangle {
         anchors.fill: parent
 
         clip: true
+        // delegates for the visible rows and another page of them
+        cacheBuffer: menu.itemHeight * menu.maxVisibleItems
+        boundsBehavior: Flickable.StopAtBounds
 
         delegate: listViewItem
         highlight: Rectangle { color: "lightsteelblue" }
@@ -80,6 +80,7 @@ FocusScope {
         Image {
             id: icon
             width: parent.width; height: 150
+            sourceSize.height: height
             clip: true
             smooth: true
             fillMode: Image.PreserveAspectCrop
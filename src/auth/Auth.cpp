@@ -22,101 +22,140 @@
 #include "Constants.h"
 #include "AuthMessages.h"
 #include "SafeDataStream.h"
-
+#include "LoggingCategories.h"
+#include "LoginId.h"
+#include "Metrics.h"
+#include "ProcessPolicy.h"
+#include "ProcessSupervisor.h"
+#include "Trace.h"
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QPointer>
 #include <QtCore/QProcess>
-#include <QtCore/QUuid>
-#include <QtNetwork/QLocalServer>
+#include <QtCore/QTimer>
 #include <QtNetwork/QLocalSocket>
 
 #include <QtQml/QtQml>
 
 #include <memory>
 
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
 #include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 
 namespace SDDM {
-    class Auth::SocketServer : public QLocalServer {
+    /**
+     * sddm-helper, started with its end of a connected socketpair.
+     *
+     * The helper finds its channel as the --fd argument, so there is no
+     * server to connect to and nothing else can pose as the helper.
+     */
+    class HelperProcess : public QProcess {
+    public:
+        explicit HelperProcess(QObject *parent = nullptr) : QProcess(parent) { }
+        ~HelperProcess() override { closeHelperEnd(); }
+
+        // creates the channel for the next start, returns our end of it
+        QLocalSocket *createChannel(QObject *parent);
+        void startHelper(QStringList arguments);
+
+    protected:
+        void setupChildProcess() override;
+
+    private:
+        void closeHelperEnd();
+
+        int m_helperFd { -1 };
+        ProcessPolicy m_policy;
+    };
+
+    class Auth::HelperPool : public QObject {
         Q_OBJECT
-    public slots:
-        void handleNewConnection();
     public:
-        static SocketServer *instance();
+        // a pre-started helper which waits to be assigned
+        struct Spare {
+            HelperProcess *process { nullptr };
+            QLocalSocket *socket { nullptr };
+        };
+
+        static HelperPool *instance();
+
+        void setPoolSize(int size);
+        bool takeSpare(Spare &spare);
 
-        QMap<qint64, Auth::Private*> helpers;
     private:
-        SocketServer();
+        HelperPool() = default;
+        void fillPool();
+        void removeSpare(HelperProcess *process);
+
+        int poolSize { 0 };
+        // in the order they were started
+        QList<Spare> spares;
     };
 
     class Auth::Private : public QObject {
         Q_OBJECT
     public:
         Private(Auth *parent);
-        ~Private();
         void setSocket(QLocalSocket *socket);
+        void adopt(const HelperPool::Spare &spare);
     public slots:
         void dataPending();
         void childExited(int exitCode, QProcess::ExitStatus exitStatus);
         void childError(QProcess::ProcessError error);
         void requestFinished();
     public:
+        void sendAuthenticated();
+
         AuthRequest *request { nullptr };
-        QProcess *child { nullptr };
+        HelperProcess *child { nullptr };
         QLocalSocket *socket { nullptr };
+        SafeDataChannel channel { };
         QString displayServerCmd;
         QString sessionPath { };
+        QString service { };
         QString user { };
         QString cookie { };
+        // of the login this helper runs, current while handling it
+        QString loginId { };
+        QList<QByteArray> credentials { };
         bool autologin { false };
         bool greeter { false };
+        bool holdSession { false };
+        // the helper waits for sendAuthenticated()
+        bool held { false };
         QProcessEnvironment environment { };
-        qint64 id { 0 };
-        static qint64 lastId;
+        // from start() until the helper said HELLO
+        QElapsedTimer spawnTimer;
     };
 
-    qint64 Auth::Private::lastId = 1;
-
-
+    // locale settings for the helpers, only parsed again when the file changes
+    struct LocaleCache {
+        QProcessEnvironment env;
+        bool valid { false };
+        qint64 modified { 0 };
+        quint64 inode { 0 };
+    };
+    Q_GLOBAL_STATIC(LocaleCache, s_localeCache)
 
-    Auth::SocketServer::SocketServer()
-            : QLocalServer() {
-        connect(this, &QLocalServer::newConnection, this, &Auth::SocketServer::handleNewConnection);
-    }
+    static QProcessEnvironment localeEnvironment() {
+        static const char localeConf[] = "/etc/locale.conf";
 
-    void Auth::SocketServer::handleNewConnection()  {
-        while (hasPendingConnections()) {
-            Msg m = Msg::MSG_UNKNOWN;
-            qint64 id;
-            QLocalSocket *socket = nextPendingConnection();
-            SafeDataStream str(socket);
-            str.receive();
-            str >> m >> id;
-            if (m == Msg::HELLO && id && SocketServer::instance()->helpers.contains(id)) {
-                helpers[id]->setSocket(socket);
-                if (socket->bytesAvailable() > 0)
-                    helpers[id]->dataPending();
-            }
-        }
-    }
+        struct stat st;
+        const bool exists = ::stat(localeConf, &st) == 0;
+        const qint64 modified = exists ? qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec : -1;
+        const quint64 inode = exists ? quint64(st.st_ino) : 0;
 
-    Auth::SocketServer* Auth::SocketServer::instance() {
-        static std::unique_ptr<Auth::SocketServer> self;
-        if (!self) {
-            self.reset(new SocketServer());
-            self->listen(QStringLiteral("sddm-auth%1").arg(QUuid::createUuid().toString().replace(QRegExp(QStringLiteral("[{}]")), QString())));
-        }
-        return self.get();
-    }
+        LocaleCache *cache = s_localeCache();
+        if (cache->valid && cache->modified == modified && cache->inode == inode)
+            return cache->env;
 
-
-    Auth::Private::Private(Auth *parent)
-            : QObject(parent)
-            , request(new AuthRequest(parent))
-            , child(new QProcess(this))
-            , id(lastId++) {
-        SocketServer::instance()->helpers[id] = this;
-        QProcessEnvironment env = child->processEnvironment();
+        QProcessEnvironment env;
         bool langEmpty = true;
-        QFile localeFile(QStringLiteral("/etc/locale.conf"));
+        QFile localeFile(QString::fromLatin1(localeConf));
         if (localeFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
             QTextStream in(&localeFile);
             while (!in.atEnd()) {
@@ -131,102 +170,295 @@ namespace SDDM {
         }
         if (langEmpty)
             env.insert(QStringLiteral("LANG"), QStringLiteral("C"));
-        child->setProcessEnvironment(env);
+
+        cache->env = env;
+        cache->valid = true;
+        cache->modified = modified;
+        cache->inode = inode;
+        return env;
+    }
+
+    // environment every sddm-helper is started with
+    static QProcessEnvironment helperEnvironment() {
+        QProcessEnvironment env = localeEnvironment();
+        // let the helper pick up the configuration resolved by the daemon
+        if (qEnvironmentVariableIsSet("SDDM_CONFIG_SNAPSHOT"))
+            env.insert(QStringLiteral("SDDM_CONFIG_SNAPSHOT"), qEnvironmentVariable("SDDM_CONFIG_SNAPSHOT"));
+        return env;
+    }
+
+    static QString customHelperPath;
+
+    static QString helperPath() {
+        if (!customHelperPath.isEmpty())
+            return customHelperPath;
+        return QStringLiteral("%1/sddm-helper").arg(QStringLiteral(LIBEXEC_INSTALL_DIR));
+    }
+
+    QLocalSocket *HelperProcess::createChannel(QObject *parent) {
+        int fds[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == -1) {
+            qCCritical(SDDM_AUTH) << "Auth: Failed to create the channel to sddm-helper:" << strerror(errno);
+            return nullptr;
+        }
+
+        QLocalSocket *socket = new QLocalSocket(parent);
+        if (!socket->setSocketDescriptor(fds[0], QLocalSocket::ConnectedState, QIODevice::ReadWrite)) {
+            qCCritical(SDDM_AUTH) << "Auth: Failed to set up the channel to sddm-helper:" << socket->errorString();
+            delete socket;
+            ::close(fds[0]);
+            ::close(fds[1]);
+            return nullptr;
+        }
+
+        closeHelperEnd();
+        m_helperFd = fds[1];
+        return socket;
+    }
+
+    void HelperProcess::startHelper(QStringList arguments) {
+        arguments.prepend(QString::number(m_helperFd));
+        arguments.prepend(QStringLiteral("--fd"));
+        m_policy = ProcessPolicy::forRole(ProcessPolicy::Role::Helper);
+        start(helperPath(), arguments);
+
+        // the helper has its copy, or it didn't start and our end sees
+        // the channel close
+        closeHelperEnd();
+    }
+
+    void HelperProcess::setupChildProcess() {
+        // only the helper's end survives the exec
+        if (m_helperFd != -1)
+            ::fcntl(m_helperFd, F_SETFD, 0);
+
+        m_policy.apply();
+    }
+
+    void HelperProcess::closeHelperEnd() {
+        if (m_helperFd != -1) {
+            ::close(m_helperFd);
+            m_helperFd = -1;
+        }
+    }
+
+    void Auth::HelperPool::setPoolSize(int size) {
+        poolSize = qMax(size, 0);
+        fillPool();
+    }
+
+    void Auth::HelperPool::fillPool() {
+        while (spares.size() < poolSize) {
+            HelperProcess *process = new HelperProcess(this);
+            QLocalSocket *socket = process->createChannel(this);
+            if (!socket) {
+                delete process;
+                return;
+            }
+
+            process->setProcessEnvironment(helperEnvironment());
+            // a spare that dies is not replaced right away, only when one is taken
+            connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, [this, process] {
+                removeSpare(process);
+            });
+            connect(socket, &QLocalSocket::disconnected, this, [this, process] {
+                removeSpare(process);
+            });
+
+            Spare spare;
+            spare.process = process;
+            spare.socket = socket;
+            spares.append(spare);
+
+            process->startHelper({ QStringLiteral("--pool") });
+        }
+    }
+
+    void Auth::HelperPool::removeSpare(HelperProcess *process) {
+        for (int i = 0; i < spares.size(); ++i) {
+            if (spares.at(i).process != process)
+                continue;
+
+            qCWarning(SDDM_AUTH) << "Auth: spare sddm-helper went away";
+            const Spare spare = spares.takeAt(i);
+            disconnect(spare.socket, nullptr, this, nullptr);
+            spare.socket->deleteLater();
+            disconnect(spare.process, nullptr, this, nullptr);
+            // a spare has nothing to clean up
+            ProcessSupervisor::of(spare.process)->release(0);
+            return;
+        }
+    }
+
+    bool Auth::HelperPool::takeSpare(Spare &spare) {
+        if (spares.isEmpty())
+            return false;
+
+        spare = spares.takeFirst();
+        disconnect(spare.socket, nullptr, this, nullptr);
+        disconnect(spare.process, nullptr, this, nullptr);
+
+        // start a replacement once we are back in the event loop
+        QTimer::singleShot(0, this, &HelperPool::fillPool);
+        return true;
+    }
+
+    Auth::HelperPool* Auth::HelperPool::instance() {
+        static std::unique_ptr<Auth::HelperPool> self;
+        if (!self)
+            self.reset(new HelperPool());
+        return self.get();
+    }
+
+
+    Auth::Private::Private(Auth *parent)
+            : QObject(parent)
+            , request(new AuthRequest(parent))
+            , child(new HelperProcess(this)) {
+        child->setProcessEnvironment(helperEnvironment());
         connect(child, QOverload<int,QProcess::ExitStatus>::of(&QProcess::finished), this, &Auth::Private::childExited);
         connect(child, &QProcess::errorOccurred, this, &Auth::Private::childError);
         connect(request, &AuthRequest::finished, this, &Auth::Private::requestFinished);
         connect(request, &AuthRequest::promptsChanged, parent, &Auth::requestChanged);
     }
 
-    Auth::Private::~Private()
-    {
-        SocketServer::instance()->helpers.remove(id);
-    }
-
-
     void Auth::Private::setSocket(QLocalSocket *socket) {
+        // the channel of an earlier run
+        if (this->socket) {
+            disconnect(this->socket, nullptr, this, nullptr);
+            this->socket->deleteLater();
+        }
+
+        socket->setParent(this);
         this->socket = socket;
+        SafeDataChannel fresh(socket);
+        channel.swap(fresh);
         connect(socket, &QLocalSocket::readyRead, this, &Auth::Private::dataPending);
+        // a spare may have written before it got assigned
+        if (channel.hasPendingData())
+            QMetaObject::invokeMethod(this, "dataPending", Qt::QueuedConnection);
+    }
+
+    void Auth::Private::adopt(const HelperPool::Spare &spare) {
+        // the spare replaces the process that would have been started
+        spare.process->setParent(this);
+        spare.process->setProcessChannelMode(child->processChannelMode());
+        delete child;
+        child = spare.process;
+        connect(child, QOverload<int,QProcess::ExitStatus>::of(&QProcess::finished), this, &Auth::Private::childExited);
+        connect(child, &QProcess::errorOccurred, this, &Auth::Private::childError);
+
+        setSocket(spare.socket);
+
+        SafeDataStream str(socket);
+        str << ASSIGN << sessionPath << user << autologin << displayServerCmd << greeter << service << loginId;
+        channel.send(str);
     }
 
     void Auth::Private::dataPending() {
         Auth *auth = qobject_cast<Auth*>(parent());
-        Msg m = MSG_UNKNOWN;
+        LoginId::Scope scope(loginId);
         SafeDataStream str(socket);
-        str.receive();
-        str >> m;
-        switch (m) {
-            case ERROR: {
-                QString message;
-                Error type = ERROR_NONE;
-                str >> message >> type;
-                Q_EMIT auth->error(message, type);
-                break;
-            }
-            case INFO: {
-                QString message;
-                Info type = INFO_NONE;
-                str >> message >> type;
-                Q_EMIT auth->info(message, type);
-                break;
-            }
-            case REQUEST: {
-                Request r;
-                str >> r;
-                request->setRequest(&r);
-                break;
-            }
-            case AUTHENTICATED: {
-                QString user;
-                str >> user;
-                if (!user.isEmpty()) {
-                    auth->setUser(user);
-                    Q_EMIT auth->authentication(user, true);
+        // handlers of the signals below may delete us
+        QPointer<Private> guard(this);
+        // handle every complete message, partial ones stay buffered until the rest arrives
+        while (guard && socket && channel.receive(str)) {
+            Msg m = MSG_UNKNOWN;
+            str >> m;
+            switch (m) {
+                case HELLO: {
+                    quint32 version = 0;
+                    str >> version;
+                    if (spawnTimer.isValid()) {
+                        Metrics::observe("helper_spawn_ms", spawnTimer.elapsed());
+                        spawnTimer.invalidate();
+                    }
+
+                    // the helper was updated underneath the running daemon
+                    if (version != HelperProtocolVersion) {
+                        qCWarning(SDDM_AUTH) << "Auth: sddm-helper speaks protocol version" << version << "instead of" << HelperProtocolVersion;
+                        child->kill();
+                        return;
+                    }
+                    break;
+                }
+                case ERROR: {
+                    QString message;
+                    Error type = ERROR_NONE;
+                    str >> message >> type;
+                    Q_EMIT auth->error(message, type);
+                    break;
+                }
+                case INFO: {
+                    QString message;
+                    Info type = INFO_NONE;
+                    str >> message >> type;
+                    Q_EMIT auth->info(message, type);
+                    break;
+                }
+                case REQUEST: {
+                    Request r;
+                    str >> r;
+                    request->setRequest(&r);
+                    break;
+                }
+                case AUTHENTICATED: {
+                    QString user;
+                    str >> user;
+                    if (!user.isEmpty()) {
+                        auth->setUser(user);
+                        // answer first, the helper opens the session meanwhile
+                        if (holdSession)
+                            held = true;
+                        else
+                            sendAuthenticated();
+                        Q_EMIT auth->authentication(user, true);
+                    }
+                    else {
+                        Q_EMIT auth->authentication(user, false);
+                    }
+                    break;
+                }
+                case SESSION_STATUS: {
+                    bool status;
+                    str >> status;
+                    Trace::mark("helper-session-status", user);
+                    Q_EMIT auth->sessionStarted(status);
                     str.reset();
-                    str << AUTHENTICATED << environment << cookie;
-                    str.send();
+                    str << SESSION_STATUS;
+                    channel.send(str);
+                    break;
                 }
-                else {
-                    Q_EMIT auth->authentication(user, false);
+                case DISPLAY_SERVER_STARTED: {
+                    QString displayName;
+                    str >> displayName;
+                    Q_EMIT auth->displayServerReady(displayName);
+                    str.reset();
+                    str << DISPLAY_SERVER_STARTED;
+                    channel.send(str);
+                    break;
+                }
+                default: {
+                    Q_EMIT auth->error(QStringLiteral("Auth: Unexpected value received: %1").arg(m), ERROR_INTERNAL);
                 }
-                break;
-            }
-            case SESSION_STATUS: {
-                bool status;
-                str >> status;
-                Q_EMIT auth->sessionStarted(status);
-                str.reset();
-                str << SESSION_STATUS;
-                str.send();
-                break;
-            }
-        case DISPLAY_SERVER_STARTED: {
-                QString displayName;
-                str >> displayName;
-                Q_EMIT auth->displayServerReady(displayName);
-                str.reset();
-                str << DISPLAY_SERVER_STARTED;
-                str.send();
-                break;
-            }
-            default: {
-                Q_EMIT auth->error(QStringLiteral("Auth: Unexpected value received: %1").arg(m), ERROR_INTERNAL);
             }
         }
     }
 
     void Auth::Private::childExited(int exitCode, QProcess::ExitStatus exitStatus) {
+        LoginId::Scope scope(loginId);
+        held = false;
         if (exitStatus != QProcess::NormalExit) {
-            qWarning("Auth: sddm-helper (%s) crashed (exit code %d)",
+            qCWarning(SDDM_AUTH, "Auth: sddm-helper (%s) crashed (exit code %d)",
                      qPrintable(child->arguments().join(QLatin1Char(' '))),
                      HelperExitStatus(exitStatus));
             Q_EMIT qobject_cast<Auth*>(parent())->error(child->errorString(), ERROR_INTERNAL);
         }
 
         if (exitCode == HELPER_SUCCESS)
-            qDebug() << "Auth: sddm-helper exited successfully";
+            qCDebug(SDDM_AUTH) << "Auth: sddm-helper exited successfully";
         else
-            qWarning("Auth: sddm-helper exited with %d", exitCode);
+            qCWarning(SDDM_AUTH, "Auth: sddm-helper exited with %d", exitCode);
 
         Q_EMIT qobject_cast<Auth*>(parent())->finished((Auth::HelperExitStatus)exitCode);
     }
@@ -236,12 +468,23 @@ namespace SDDM {
         Q_EMIT qobject_cast<Auth*>(parent())->error(child->errorString(), ERROR_INTERNAL);
     }
 
+    void Auth::Private::sendAuthenticated() {
+        SafeDataStream str(socket);
+        str << AUTHENTICATED << EnvironmentDelta(environment, child->processEnvironment()) << cookie;
+        channel.send(str);
+    }
+
     void Auth::Private::requestFinished() {
         SafeDataStream str(socket);
         Request r = request->request();
-        str << REQUEST << r;
-        str.send();
+        str << REQUEST << r << credentials;
+        channel.send(str);
         request->setRequest();
+
+        // the helper has them now
+        for (QByteArray &credential : credentials)
+            memset(credential.data(), 0, credential.length());
+        credentials.clear();
     }
 
 
@@ -260,7 +503,11 @@ namespace SDDM {
     }
 
     Auth::~Auth() {
-        stop();
+        // a helper that is still around ends on its own time
+        if (d->child->state() != QProcess::NotRunning) {
+            disconnect(d->child, nullptr, d, nullptr);
+            ProcessSupervisor::of(d->child)->release(d->greeter ? 10000 : 65000);
+        }
         delete d;
     }
 
@@ -287,6 +534,10 @@ namespace SDDM {
         return d->sessionPath;
     }
 
+    const QString &Auth::service() const {
+        return d->service;
+    }
+
     const QString &Auth::user() const {
         return d->user;
     }
@@ -318,6 +569,21 @@ namespace SDDM {
         }
     }
 
+    void Auth::setCredentials(const QList<QByteArray> &credentials) {
+        d->credentials = credentials;
+    }
+
+    void Auth::setHoldSession(bool on) {
+        d->holdSession = on;
+    }
+
+    void Auth::releaseSession() {
+        if (!d->held)
+            return;
+        d->held = false;
+        d->sendAuthenticated();
+    }
+
     void Auth::setUser(const QString &user) {
         if (user != d->user) {
             d->user = user;
@@ -355,6 +621,13 @@ namespace SDDM {
         }
     }
 
+    void Auth::setService(const QString &service) {
+        if (service != d->service) {
+            d->service = service;
+            Q_EMIT serviceChanged();
+        }
+    }
+
     void Auth::setVerbose(bool on) {
         if (on != verbose()) {
             if (on)
@@ -365,10 +638,34 @@ namespace SDDM {
         }
     }
 
+    void Auth::setPoolSize(int size) {
+        HelperPool::instance()->setPoolSize(size);
+    }
+
+    void Auth::setHelperPath(const QString &path) {
+        customHelperPath = path;
+    }
+
     void Auth::start() {
+        d->loginId = LoginId::current();
+
+        // hand the work to a helper which is already up
+        HelperPool::Spare spare;
+        if (!verbose() && HelperPool::instance()->takeSpare(spare)) {
+            Trace::mark("helper-adopted", d->user);
+            Metrics::increment("helpers_adopted");
+            d->adopt(spare);
+            return;
+        }
+
+        QLocalSocket *socket = d->child->createChannel(d);
+        if (!socket) {
+            Q_EMIT error(QStringLiteral("Auth: Failed to create the channel to sddm-helper"), ERROR_INTERNAL);
+            return;
+        }
+        d->setSocket(socket);
+
         QStringList args;
-        args << QStringLiteral("--socket") << SocketServer::instance()->fullServerName();
-        args << QStringLiteral("--id") << QStringLiteral("%1").arg(d->id);
         if (!d->sessionPath.isEmpty())
             args << QStringLiteral("--start") << d->sessionPath;
         if (!d->user.isEmpty())
@@ -379,15 +676,20 @@ namespace SDDM {
             args << QStringLiteral("--display-server") << d->displayServerCmd;
         if (d->greeter)
             args << QStringLiteral("--greeter");
-        d->child->start(QStringLiteral("%1/sddm-helper").arg(QStringLiteral(LIBEXEC_INSTALL_DIR)), args);
+        if (!d->service.isEmpty())
+            args << QStringLiteral("--service") << d->service;
+        if (!d->loginId.isEmpty())
+            args << QStringLiteral("--id") << d->loginId;
+        Trace::mark("helper-start", d->user);
+        Metrics::increment("helpers_started");
+        d->spawnTimer.start();
+        d->child->startHelper(args);
     }
 
     void Auth::stop() {
-        d->child->terminate();
-
-        // wait for finished
-        if (!d->child->waitForFinished(5000))
-            d->child->kill();
+        // finished() is emitted once the helper is gone, which first
+        // gives the session as long as the helper itself grants it
+        ProcessSupervisor::of(d->child)->stop(d->greeter ? 10000 : 65000);
     }
 }
 
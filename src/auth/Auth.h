@@ -96,6 +96,7 @@ namespace SDDM {
         const QString &cookie() const;
         const QString &user() const;
         const QString &session() const;
+        const QString &service() const;
         AuthRequest *request();
         /**
          * True if an authentication or session is in progress
@@ -148,6 +149,13 @@ namespace SDDM {
          */
         void setDisplayServerCommand(const QString &command);
 
+        /**
+         * Set the PAM service to authenticate with instead of the one
+         * picked for the kind of login, like sddm-fingerprint.
+         * @param service name of the service, empty for the default
+         */
+        void setService(const QString &service);
+
         /**
         * Set the session to be started after authenticating.
         * @param path Path of the session executable to be started
@@ -160,12 +168,47 @@ namespace SDDM {
          */
         void setCookie(const QString &cookie);
 
+        /**
+         * Secrets for prompts the auth stack hasn't asked for yet, like a
+         * one-time password or a smartcard PIN. They are sent along with the
+         * next answered request and the helper uses them for the following
+         * hidden prompts without asking again.
+         * @param credentials secrets in the order the prompts will come in
+         */
+        void setCredentials(const QList<QByteArray> &credentials);
+
+        /**
+         * Keep the helper waiting after a successful authentication,
+         * before it opens the session, until releaseSession() is called.
+         * @param on true to hold the session
+         */
+        void setHoldSession(bool on = true);
+
+        /**
+         * Keep a number of helpers started and connected, so that starting
+         * an authentication doesn't have to wait for a new process.
+         * @param size number of spare helpers, 0 disables the pool
+         */
+        static void setPoolSize(int size);
+
+        /**
+         * Start another helper binary than the installed sddm-helper,
+         * such as the sddm-helper-mock of the tests.
+         * @param path helper executable, empty for the installed one
+         */
+        static void setHelperPath(const QString &path);
+
     public Q_SLOTS:
         /**
         * Sets up the environment and starts the authentication
         */
         void start();
 
+        /**
+        * Lets a helper held by setHoldSession() open the session
+        */
+        void releaseSession();
+
         /**
          * Indicates that we do not need the process anymore.
          */
@@ -179,6 +222,7 @@ namespace SDDM {
         void userChanged();
         void displayServerCommandChanged();
         void sessionChanged();
+        void serviceChanged();
         void requestChanged();
 
         /**
@@ -230,9 +274,9 @@ namespace SDDM {
 
     private:
         class Private;
-        class SocketServer;
+        class HelperPool;
         friend Private;
-        friend SocketServer;
+        friend HelperPool;
         Private *d { nullptr };
     };
 }
@@ -22,7 +22,11 @@
 #define MESSAGES_H
 
 #include <QtCore/QDataStream>
+#include <QtCore/QPair>
 #include <QtCore/QProcessEnvironment>
+#include <QtCore/QVector>
+
+#include <utility>
 
 #include "Auth.h"
 
@@ -31,17 +35,33 @@ namespace SDDM {
     public:
         Prompt() { }
         Prompt(AuthPrompt::Type type, QString message, bool hidden)
-                : type(type), message(message), hidden(hidden) { }
+                : type(type), message(std::move(message)), hidden(hidden) { }
         Prompt(const Prompt &o)
                 : type(o.type), response(o.response), message(o.message), hidden(o.hidden) { }
+        // the response moves along, there is nothing left to wipe
+        Prompt(Prompt &&o) noexcept
+                : type(o.type), response(std::move(o.response)), message(std::move(o.message)), hidden(o.hidden) { }
         ~Prompt() {
             clear();
         }
         Prompt& operator=(const Prompt &o) {
-            type = o.type;
-            response = o.response;
-            message = o.message;
-            hidden = o.hidden;
+            if (this != &o) {
+                clear();
+                type = o.type;
+                response = o.response;
+                message = o.message;
+                hidden = o.hidden;
+            }
+            return *this;
+        }
+        Prompt& operator=(Prompt &&o) noexcept {
+            if (this != &o) {
+                clear();
+                type = o.type;
+                response = std::move(o.response);
+                message = std::move(o.message);
+                hidden = o.hidden;
+            }
             return *this;
         }
         bool operator==(const Prompt &o) const {
@@ -52,8 +72,10 @@ namespace SDDM {
         }
         void clear() {
             type = AuthPrompt::NONE;
-            // overwrite the whole thing with zeroes before clearing
-            memset(response.data(), 0, response.length());
+            // overwrite the whole thing with zeroes before clearing,
+            // a shared copy is wiped by whoever holds it last
+            if (response.isDetached())
+                memset(response.data(), 0, response.length());
             response.clear();
             message.clear();
             hidden = false;
@@ -69,11 +91,19 @@ namespace SDDM {
     public:
         Request() { }
         Request(QList<Prompt> prompts)
-                : prompts(prompts) { }
+                : prompts(std::move(prompts)) { }
+        // copies share the prompts until one of them changes
         Request(const Request &o)
                 : prompts(o.prompts) { }
+        Request(Request &&o) noexcept
+                : prompts(std::move(o.prompts)) { }
         Request& operator=(const Request &o) {
-            prompts = QList<Prompt>(o.prompts);
+            prompts = o.prompts;
+            return *this;
+        }
+        Request& operator=(Request &&o) noexcept {
+            prompts.swap(o.prompts);
+            o.prompts.clear();
             return *this;
         }
         bool operator==(const Request &o) const {
@@ -89,6 +119,48 @@ namespace SDDM {
         QList<Prompt> prompts { };
     };
 
+    /**
+    * Environment as the changes to another one both sides know, which is
+    * the environment sddm-helper was started with
+    *
+    * Keys and values are sent as length prefixed UTF-8. Reading checks
+    * every count against the data that is left, broken input only sets
+    * the stream status.
+    */
+    class EnvironmentDelta {
+    public:
+        EnvironmentDelta() { }
+        EnvironmentDelta(const QProcessEnvironment &env, const QProcessEnvironment &base) {
+            const QStringList keys = env.keys();
+            for (const QString &key : keys) {
+                const QString value = env.value(key);
+                if (!base.contains(key) || base.value(key) != value)
+                    set.append(qMakePair(key, value));
+            }
+            const QStringList baseKeys = base.keys();
+            for (const QString &key : baseKeys) {
+                if (!env.contains(key))
+                    unset.append(key);
+            }
+        }
+
+        QProcessEnvironment apply(const QProcessEnvironment &base) const {
+            QProcessEnvironment env = base;
+            for (const QString &key : unset)
+                env.remove(key);
+            for (const auto &entry : set)
+                env.insert(entry.first, entry.second);
+            return env;
+        }
+
+        QVector<QPair<QString, QString>> set { };
+        QStringList unset { };
+    };
+
+    // bump when the messages between the daemon and sddm-helper change,
+    // it is sent along with HELLO
+    const quint32 HelperProtocolVersion = 4;
+
     enum Msg {
         MSG_UNKNOWN = 0,
         HELLO = 1,
@@ -98,6 +170,7 @@ namespace SDDM {
         AUTHENTICATED,
         SESSION_STATUS,
         DISPLAY_SERVER_STARTED,
+        ASSIGN,
         MSG_LAST,
     };
 
@@ -167,6 +240,62 @@ namespace SDDM {
         return s;
     }
 
+    inline QDataStream& operator<<(QDataStream &s, const EnvironmentDelta &m) {
+        s << quint32(m.set.size());
+        for (const auto &entry : m.set)
+            s << entry.first.toUtf8() << entry.second.toUtf8();
+        s << quint32(m.unset.size());
+        for (const QString &key : m.unset)
+            s << key.toUtf8();
+        return s;
+    }
+
+    inline QDataStream& operator>>(QDataStream &s, EnvironmentDelta &m) {
+        // every entry takes at least a length of four bytes
+        auto readCount = [&s](quint32 fieldsPerEntry) -> int {
+            quint32 count = 0;
+            s >> count;
+            if (s.status() != QDataStream::Ok)
+                return -1;
+            if (s.device() && qint64(count) * 4 * fieldsPerEntry > s.device()->bytesAvailable()) {
+                s.setStatus(QDataStream::ReadCorruptData);
+                return -1;
+            }
+            return int(count);
+        };
+
+        EnvironmentDelta delta;
+        const int setCount = readCount(2);
+        if (setCount < 0)
+            return s;
+        delta.set.reserve(setCount);
+        for (int i = 0; i < setCount; i++) {
+            QByteArray key, value;
+            s >> key >> value;
+            if (s.status() != QDataStream::Ok)
+                return s;
+            if (key.isEmpty() || key.contains('=')) {
+                s.setStatus(QDataStream::ReadCorruptData);
+                return s;
+            }
+            delta.set.append(qMakePair(QString::fromUtf8(key), QString::fromUtf8(value)));
+        }
+
+        const int unsetCount = readCount(1);
+        if (unsetCount < 0)
+            return s;
+        for (int i = 0; i < unsetCount; i++) {
+            QByteArray key;
+            s >> key;
+            if (s.status() != QDataStream::Ok)
+                return s;
+            delta.unset.append(QString::fromUtf8(key));
+        }
+
+        m = delta;
+        return s;
+    }
+
     inline QDataStream& operator<<(QDataStream &s, const Prompt &m) {
         s << qint32(m.type) << m.message << m.hidden << m.response;
         return s;
@@ -178,10 +307,11 @@ namespace SDDM {
         bool hidden;
         QByteArray response;
         s >> type >> message >> hidden >> response;
+        m.clear();
         m.type = AuthPrompt::Type(type);
-        m.message = message;
+        m.message = std::move(message);
         m.hidden = hidden;
-        m.response = response;
+        m.response = std::move(response);
         return s;
     }
 
@@ -196,18 +326,19 @@ namespace SDDM {
 
     inline QDataStream& operator>>(QDataStream &s, Request &m) {
         QList<Prompt> prompts;
-        qint32 length;
+        qint32 length = 0;
         s >> length;
-        for (int i = 0; i < length; i++) {
-            Prompt p;
-            s >> p;
-            prompts << p;
+        for (int i = 0; i < length && s.status() == QDataStream::Ok; i++) {
+            prompts.append(Prompt());
+            s >> prompts.last();
         }
+        if (s.status() != QDataStream::Ok)
+            return s;
         if (prompts.length() != length) {
             s.setStatus(QDataStream::ReadCorruptData);
             return s;
         }
-        m.prompts = prompts;
+        m.prompts.swap(prompts);
         return s;
     }
 }
@@ -21,6 +21,7 @@
 #include "AuthPrompt.h"
 #include "Auth.h"
 #include "AuthMessages.h"
+#include "SecureBuffer.h"
 
 namespace SDDM {
     class AuthPrompt::Private : public Prompt {
@@ -40,6 +41,7 @@ namespace SDDM {
     }
 
     AuthPrompt::~AuthPrompt() {
+        SecureBuffer::wipe(d->response);
         delete d;
     }
 
@@ -61,6 +63,7 @@ namespace SDDM {
 
     void AuthPrompt::setResponse(const QByteArray &r) {
         if (r != d->response) {
+            SecureBuffer::wipe(d->response);
             d->response = r;
             Q_EMIT responseChanged();
         }
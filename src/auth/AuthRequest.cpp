@@ -96,6 +96,7 @@ namespace SDDM {
 
     Request AuthRequest::request() const {
         Request r;
+        r.prompts.reserve(d->prompts.size());
         for (const AuthPrompt* qap : qAsConst(d->prompts)) {
             Prompt p;
             p.hidden = qap->hidden();
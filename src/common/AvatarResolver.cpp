@@ -0,0 +1,235 @@
+/***************************************************************************
+* Copyright (c) 2013 Abdurrahman AVCI <abdurrahmanavci@gmail.com>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "AvatarResolver.h"
+
+#include "Configuration.h"
+#include "FsUid.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace SDDM {
+    static const quint32 AvatarCacheVersion = 3;
+
+    AvatarResolver::AvatarResolver(QObject *parent, const QString &cacheName) : QThread(parent) {
+        m_cachePath = QStringLiteral("%1/%2").arg(stateDirectory(), cacheName);
+        m_facesDir = mainConfig.Theme.FacesDir.get();
+
+        // without a boot id, homes are probed once per resolver
+        QFile bootId(QStringLiteral("/proc/sys/kernel/random/boot_id"));
+        if (bootId.open(QIODevice::ReadOnly))
+            m_bootId = bootId.readAll().trimmed();
+        if (m_bootId.isEmpty())
+            m_bootId = QByteArray::number(QDateTime::currentMSecsSinceEpoch());
+
+        loadCache();
+    }
+
+    AvatarResolver::~AvatarResolver() {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_quit = true;
+            m_queue.clear();
+            m_condition.wakeOne();
+        }
+        wait();
+
+        if (m_cacheChanged)
+            saveCache();
+    }
+
+    QString AvatarResolver::cachedIcon(const QString &name) const {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_cache.constFind(name);
+        if (it == m_cache.constEnd() || it->path.isEmpty())
+            return QString();
+        return QStringLiteral("file://%1").arg(it->path);
+    }
+
+    void AvatarResolver::setReader(const QString &user) {
+        QMutexLocker locker(&m_mutex);
+        m_reader = user.toLocal8Bit();
+    }
+
+    void AvatarResolver::resolve(const QString &name, const QString &homeDir) {
+        QMutexLocker locker(&m_mutex);
+        m_queue.enqueue({ name, homeDir });
+        m_condition.wakeOne();
+
+        if (!isRunning())
+            start(QThread::LowPriority);
+    }
+
+    void AvatarResolver::clear() {
+        QMutexLocker locker(&m_mutex);
+        m_queue.clear();
+    }
+
+    void AvatarResolver::run() {
+        forever {
+            Request request;
+            CacheEntry cached;
+            bool hasCached = false;
+
+            {
+                QMutexLocker locker(&m_mutex);
+                while (m_queue.isEmpty() && !m_quit) {
+                    // write the cache whenever we run out of work
+                    if (m_cacheChanged) {
+                        locker.unlock();
+                        saveCache();
+                        locker.relock();
+                        continue;
+                    }
+                    m_condition.wait(&m_mutex);
+                }
+                if (m_quit)
+                    return;
+
+                request = m_queue.dequeue();
+                auto it = m_cache.constFind(request.name);
+                if (it != m_cache.constEnd()) {
+                    cached = *it;
+                    hasCached = true;
+                }
+            }
+
+            const CacheEntry entry = lookup(request, hasCached ? &cached : nullptr);
+
+            {
+                QMutexLocker locker(&m_mutex);
+                if (!hasCached || entry.path != cached.path || entry.modified != cached.modified
+                        || entry.homeProbed != cached.homeProbed) {
+                    m_cache.insert(request.name, entry);
+                    m_cacheChanged = true;
+                }
+            }
+
+            if (!entry.path.isEmpty())
+                emit iconResolved(request.name, QStringLiteral("file://%1").arg(entry.path));
+        }
+    }
+
+    AvatarResolver::CacheEntry AvatarResolver::lookup(const Request &request, const CacheEntry *cached) const {
+        const QString userFace = QStringLiteral("%1/.face.icon").arg(request.homeDir);
+        const QString systemFace = QStringLiteral("%1/%2.face.icon").arg(m_facesDir).arg(request.name);
+        const QString accountsServiceFace = QStringLiteral("/var/lib/AccountsService/icons/%1").arg(request.name);
+
+        CacheEntry entry;
+
+        // the reader has to be able to open what we hand out
+        QByteArray reader;
+        {
+            QMutexLocker locker(&m_mutex);
+            reader = m_reader;
+        }
+        FsUidScope fsUid(reader.isEmpty() ? nullptr : reader.constData());
+        auto usable = [&fsUid](const QFileInfo &info) {
+            if (!info.exists())
+                return false;
+            return !fsUid.isActive()
+                || ::faccessat(AT_FDCWD, QFile::encodeName(info.filePath()).constData(), R_OK, AT_EACCESS) == 0;
+        };
+
+        // If the home is encrypted it takes a lot of time to open
+        // up the greeter, therefore we try the system avatar first
+        QFileInfo info(systemFace);
+        if (usable(info)) {
+            entry.path = systemFace;
+            entry.modified = info.lastModified().toMSecsSinceEpoch();
+            return entry;
+        }
+
+        // a face found in the home is checked for changes, one that wasn't
+        // there is looked for once per boot, homes may be slow to open
+        const bool probeHome = !cached || cached->path == userFace || cached->homeProbed != m_bootId;
+        if (probeHome) {
+            info.setFile(userFace);
+            if (usable(info)) {
+                entry.path = userFace;
+                entry.modified = info.lastModified().toMSecsSinceEpoch();
+                return entry;
+            }
+            entry.homeProbed = m_bootId;
+        } else {
+            entry.homeProbed = cached->homeProbed;
+        }
+
+        info.setFile(accountsServiceFace);
+        if (usable(info)) {
+            entry.path = accountsServiceFace;
+            entry.modified = info.lastModified().toMSecsSinceEpoch();
+        }
+
+        return entry;
+    }
+
+    void AvatarResolver::loadCache() {
+        QFile file(m_cachePath);
+        if (!file.open(QIODevice::ReadOnly))
+            return;
+
+        QDataStream in(&file);
+        quint32 version = 0;
+        in >> version;
+        if (version != AvatarCacheVersion) {
+            qDebug() << "Ignoring avatar cache with version" << version;
+            return;
+        }
+
+        quint32 count = 0;
+        in >> count;
+        for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+            QString name;
+            CacheEntry entry;
+            in >> name >> entry.path >> entry.modified >> entry.homeProbed;
+            if (in.status() == QDataStream::Ok)
+                m_cache.insert(name, entry);
+        }
+    }
+
+    void AvatarResolver::saveCache() {
+        QHash<QString, CacheEntry> cache;
+        {
+            QMutexLocker locker(&m_mutex);
+            cache = m_cache;
+            m_cacheChanged = false;
+        }
+
+        QSaveFile file(m_cachePath);
+        if (!file.open(QIODevice::WriteOnly)) {
+            qWarning() << "Failed to write avatar cache" << m_cachePath << file.errorString();
+            return;
+        }
+
+        QDataStream out(&file);
+        out << AvatarCacheVersion << quint32(cache.count());
+        for (auto it = cache.constBegin(); it != cache.constEnd(); ++it)
+            out << it.key() << it->path << it->modified << it->homeProbed;
+
+        file.commit();
+    }
+}
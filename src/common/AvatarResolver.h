@@ -0,0 +1,94 @@
+/***************************************************************************
+* Copyright (c) 2013 Abdurrahman AVCI <abdurrahmanavci@gmail.com>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_AVATARRESOLVER_H
+#define SDDM_AVATARRESOLVER_H
+
+#include <QHash>
+#include <QMutex>
+#include <QQueue>
+#include <QThread>
+#include <QWaitCondition>
+
+namespace SDDM {
+    /**
+     * Looks up user avatars off the GUI thread.
+     *
+     * Results are kept in a cache file in the sddm state directory.
+     * Slow or encrypted homes are only looked into once per boot for
+     * an avatar that wasn't there, one found there is checked for
+     * changes.
+     */
+    class AvatarResolver : public QThread {
+        Q_OBJECT
+        Q_DISABLE_COPY(AvatarResolver)
+    public:
+        // @p cacheName is the name of the cache in the state directory
+        explicit AvatarResolver(QObject *parent = nullptr, const QString &cacheName = QStringLiteral("avatars.cache"));
+        ~AvatarResolver();
+
+        // returns the icon url from the cache without touching the disk
+        QString cachedIcon(const QString &name) const;
+
+        // only hand out avatars @p user can read, looked up with the
+        // permissions of that user where the system allows it
+        void setReader(const QString &user);
+
+        void resolve(const QString &name, const QString &homeDir);
+        void clear();
+
+    signals:
+        void iconResolved(const QString &name, const QString &icon);
+
+    protected:
+        void run() override;
+
+    private:
+        struct CacheEntry {
+            QString path;
+            qint64 modified { 0 };
+            // boot id of the last look into the home that found nothing
+            QByteArray homeProbed;
+        };
+
+        struct Request {
+            QString name;
+            QString homeDir;
+        };
+
+        CacheEntry lookup(const Request &request, const CacheEntry *cached) const;
+
+        void loadCache();
+        void saveCache();
+
+        QString m_cachePath;
+        QString m_facesDir;
+        QByteArray m_reader;
+        QByteArray m_bootId;
+
+        mutable QMutex m_mutex;
+        QWaitCondition m_condition;
+        QQueue<Request> m_queue;
+        QHash<QString, CacheEntry> m_cache;
+        bool m_cacheChanged { false };
+        bool m_quit { false };
+    };
+}
+
+#endif // SDDM_AVATARRESOLVER_H
@@ -26,7 +26,15 @@
 #include <QtCore/QSettings>
 #include <QtCore/QMap>
 #include <QtCore/QBuffer>
+#include <QtCore/QDataStream>
 #include <QtCore/QFileInfo>
+#include <QtCore/QFileSystemWatcher>
+#include <QtCore/QSaveFile>
+
+#include <limits.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 QTextStream &operator>>(QTextStream &str, QStringList &list)  {
     list.clear();
@@ -127,6 +135,10 @@ namespace SDDM {
     {
     }
 
+    ConfigBase::~ConfigBase() {
+        delete m_watcher;
+    }
+
     bool ConfigBase::hasUnused() const {
         return m_unusedSections || m_unusedVariables;
     }
@@ -142,6 +154,21 @@ namespace SDDM {
 
     void ConfigBase::load()
     {
+        // the values were resolved by the daemon already
+        if (m_fromSnapshot)
+            return;
+        if (m_loadedGeneration == 0 && m_snapshotPath.isEmpty() && qEnvironmentVariableIsSet(CONFIG_SNAPSHOT_VARIABLE)) {
+            if (loadSnapshot(qEnvironmentVariable(CONFIG_SNAPSHOT_VARIABLE))) {
+                m_fromSnapshot = true;
+                return;
+            }
+        }
+
+        // nothing changed since the last load
+        if (m_watcher && m_loadedGeneration == m_generation)
+            return;
+        m_loadedGeneration = m_generation;
+
         //order of priority from least influence to most influence, is
         // * m_sysConfigDir (system settings /usr/lib/sddm/sddm.conf.d/) in alphabetical order
         // * m_configDir (user settings in /etc/sddm.conf.d/) in alphabetical order
@@ -177,56 +204,308 @@ namespace SDDM {
 
         files << m_path;
 
-        if (latestModificationTime <= m_fileModificationTime) {
+        // files may have been added or removed, keep watching the right ones
+        m_files = files;
+        if (m_watcher)
+            updateWatcher();
+
+        if (!m_watcher && latestModificationTime <= m_fileModificationTime) {
             return;
         }
         m_fileModificationTime = latestModificationTime;
 
+        QHash<ConfigEntryBase*, QString> values;
         for (const QString &filepath : qAsConst(files)) {
-            loadInternal(filepath);
+            loadInternal(filepath, values);
+        }
+
+        // only touch the entries that actually changed
+        for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
+            auto loaded = m_loadedValues.constFind(it.key());
+            if (loaded == m_loadedValues.constEnd() || loaded.value() != it.value())
+                it.key()->setValue(it.value());
         }
+        // entries which were removed from the files fall back to their defaults
+        for (auto it = m_loadedValues.constBegin(); it != m_loadedValues.constEnd(); ++it) {
+            if (!values.contains(it.key()))
+                it.key()->setDefault();
+        }
+        m_loadedValues = values;
+
+        if (!m_snapshotPath.isEmpty())
+            saveSnapshot();
     }
 
+    void ConfigBase::setWatched(bool watched) {
+        if (watched == (m_watcher != nullptr))
+            return;
+
+        if (!watched) {
+            delete m_watcher;
+            m_watcher = nullptr;
+            return;
+        }
 
-    void ConfigBase::loadInternal(const QString &filepath) {
-        QString currentSection = QStringLiteral(IMPLICIT_SECTION);
+        m_watcher = new QFileSystemWatcher();
+        auto changed = [this] { ++m_generation; };
+        QObject::connect(m_watcher, &QFileSystemWatcher::fileChanged, m_watcher, changed);
+        QObject::connect(m_watcher, &QFileSystemWatcher::directoryChanged, m_watcher, changed);
 
-        QFile in(filepath);
+        // anything could have changed before the watch was in place
+        ++m_generation;
+        updateWatcher();
+    }
 
-        if (!in.open(QIODevice::ReadOnly))
+    quint64 ConfigBase::generation() const {
+        return m_generation;
+    }
+
+    static const quint32 s_snapshotMagic = 0x53444443; // SDDC
+    static const qint32 s_snapshotVersion = 1;
+
+    void ConfigBase::setSnapshotPath(const QString &path) {
+        m_snapshotPath = path;
+        if (m_snapshotPath.isEmpty())
             return;
-        while (!in.atEnd()) {
-            QString line = QString::fromUtf8(in.readLine());
-            QStringRef lineRef = QStringRef(&line).trimmed();
-            // get rid of comments first
-            lineRef = lineRef.left(lineRef.indexOf(QLatin1Char('#'))).trimmed();
 
-            // In version 0.14.0, these sections were renamed
-            if (currentSection == QStringLiteral("XDisplay"))
-                currentSection = QStringLiteral("X11");
-            else if (currentSection == QStringLiteral("WaylandDisplay"))
-                currentSection = QStringLiteral("Wayland");
+        // the one taking snapshots has to read the files itself
+        if (m_fromSnapshot) {
+            m_fromSnapshot = false;
+            m_fileModificationTime = QDateTime();
+            load();
+            return;
+        }
+        saveSnapshot();
+    }
+
+    bool ConfigBase::saveSnapshot() const {
+        QByteArray data;
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_5_0);
+        out << s_snapshotMagic << s_snapshotVersion << m_path << m_unusedVariables;
+
+        // the raw values as read from the files, in the order they are applied
+        qint32 count = 0;
+        for (auto section = m_sections.constBegin(); section != m_sections.constEnd(); ++section) {
+            for (ConfigEntryBase *entry : section.value()->entries()) {
+                if (m_loadedValues.contains(entry))
+                    ++count;
+            }
+        }
+        out << count;
+        for (auto section = m_sections.constBegin(); section != m_sections.constEnd(); ++section) {
+            for (ConfigEntryBase *entry : section.value()->entries()) {
+                auto it = m_loadedValues.constFind(entry);
+                if (it != m_loadedValues.constEnd())
+                    out << section.key() << entry->name() << it.value();
+            }
+        }
+
+        QDir().mkpath(QFileInfo(m_snapshotPath).absolutePath());
+        QSaveFile file(m_snapshotPath);
+        if (!file.open(QIODevice::WriteOnly)) {
+            qWarning() << "Failed to write configuration snapshot" << m_snapshotPath;
+            return false;
+        }
+        // the greeter runs as an unprivileged user
+        file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner | QFileDevice::ReadGroup | QFileDevice::ReadOther);
+        file.write(data);
+        return file.commit();
+    }
+
+    bool ConfigBase::loadSnapshot(const QString &path) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly))
+            return false;
+
+        const qint64 size = file.size();
+        if (size <= 0 || size > INT_MAX)
+            return false;
+
+        uchar *mapped = file.map(0, size);
+        const QByteArray data = mapped ? QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), int(size)) : file.readAll();
+        QDataStream in(data);
+        in.setVersion(QDataStream::Qt_5_0);
+
+        quint32 magic = 0;
+        qint32 version = 0;
+        QString configPath;
+        bool unusedVariables = false;
+        qint32 count = 0;
+        in >> magic >> version >> configPath >> unusedVariables >> count;
+        // the snapshot is only meant for the configuration it was taken from
+        if (in.status() != QDataStream::Ok || magic != s_snapshotMagic || version != s_snapshotVersion || configPath != m_path) {
+            if (mapped)
+                file.unmap(mapped);
+            return false;
+        }
+
+        QHash<ConfigEntryBase*, QString> values;
+        for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+            QString section, name, value;
+            in >> section >> name >> value;
+            ConfigSection *s = m_sections.value(section);
+            ConfigEntryBase *entry = s ? s->entry(name) : nullptr;
+            if (entry)
+                values.insert(entry, value);
+        }
+        if (mapped)
+            file.unmap(mapped);
+        if (in.status() != QDataStream::Ok)
+            return false;
+
+        for (auto it = values.constBegin(); it != values.constEnd(); ++it)
+            it.key()->setValue(it.value());
+        m_loadedValues = values;
+        m_unusedVariables = unusedVariables;
+        return true;
+    }
+
+    void ConfigBase::updateWatcher() {
+        QStringList paths;
+        // the main file may not exist yet, watch its directory for it to appear
+        if (QFileInfo::exists(m_path))
+            paths << m_path;
+        else
+            paths << QFileInfo(m_path).absolutePath();
+        if (!m_sysConfigDir.isEmpty() && QFileInfo::exists(m_sysConfigDir))
+            paths << m_sysConfigDir;
+        if (!m_configDir.isEmpty() && QFileInfo::exists(m_configDir))
+            paths << m_configDir;
+        for (const QString &file : qAsConst(m_files)) {
+            if (file != m_path && QFileInfo::exists(file))
+                paths << file;
+        }
+
+        // files replaced by a rename are dropped by the watcher, so always re-add
+        const QStringList watched = m_watcher->files() + m_watcher->directories();
+        if (!watched.isEmpty())
+            m_watcher->removePaths(watched);
+        m_watcher->addPaths(paths);
+    }
+
+
+    static inline bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+    }
+
+    static inline void trim(const char *&begin, const char *&end) {
+        while (begin < end && isSpace(*begin))
+            ++begin;
+        while (end > begin && isSpace(end[-1]))
+            --end;
+    }
+
+    void scanIni(const QByteArray &data, const IniHandler &handler, const char *lineComments) {
+        const char *pos = data.constData();
+        const char *end = pos + data.size();
+
+        QByteArray section;
+
+        while (pos < end) {
+            const char *eol = static_cast<const char *>(memchr(pos, '\n', end - pos));
+            if (!eol)
+                eol = end;
+
+            const char *lineStart = pos;
+            const char *lineEnd = eol;
+            pos = eol + 1;
+
+            // get rid of comments first
+            if (!lineComments) {
+                if (const char *comment = static_cast<const char *>(memchr(lineStart, '#', lineEnd - lineStart)))
+                    lineEnd = comment;
+            }
+            trim(lineStart, lineEnd);
+            if (lineStart == lineEnd)
+                continue;
+            if (lineComments && strchr(lineComments, *lineStart))
+                continue;
 
             // value assignment
-            int separatorPosition = lineRef.indexOf(QLatin1Char('='));
-            if (separatorPosition >= 0) {
-                QString name = lineRef.left(separatorPosition).trimmed().toString();
-                QStringRef value = lineRef.mid(separatorPosition + 1).trimmed();
-
-                auto sectionIterator = m_sections.constFind(currentSection);
-                if (sectionIterator != m_sections.constEnd() && sectionIterator.value()->entry(name))
-                    sectionIterator.value()->entry(name)->setValue(value.toString());
-                else
-                    // if we don't have such member in the config, nag about it
-                    m_unusedVariables = true;
+            if (const char *separator = static_cast<const char *>(memchr(lineStart, '=', lineEnd - lineStart))) {
+                const char *nameEnd = separator;
+                const char *valueStart = separator + 1;
+                trim(lineStart, nameEnd);
+                trim(valueStart, lineEnd);
+                if (lineStart == nameEnd)
+                    continue;
+
+                handler(section, QByteArray::fromRawData(lineStart, int(nameEnd - lineStart)),
+                        QByteArray::fromRawData(valueStart, int(lineEnd - valueStart)));
             }
             // section start
-            else if (lineRef.startsWith(QLatin1Char('[')) && lineRef.endsWith(QLatin1Char(']')))
-                currentSection = lineRef.mid(1, lineRef.length() - 2).toString();
+            else if (*lineStart == '[' && lineEnd[-1] == ']' && lineEnd - lineStart >= 2) {
+                section = QByteArray::fromRawData(lineStart + 1, int(lineEnd - lineStart - 2));
+                handler(section, QByteArray(), QByteArray());
+            }
         }
     }
 
+    void ConfigBase::buildEntryTable() {
+        for (auto it = m_sections.constBegin(); it != m_sections.constEnd(); ++it) {
+            QHash<QByteArray, ConfigEntryBase*> &entries = m_entryTable[it.key().toUtf8()];
+            const auto &sectionEntries = it.value()->entries();
+            for (auto entry = sectionEntries.constBegin(); entry != sectionEntries.constEnd(); ++entry)
+                entries.insert(entry.key().toUtf8(), entry.value());
+        }
+
+        // In version 0.14.0, these sections were renamed
+        if (m_entryTable.contains(QByteArrayLiteral("X11")))
+            m_entryTable.insert(QByteArrayLiteral("XDisplay"), m_entryTable.value(QByteArrayLiteral("X11")));
+        if (m_entryTable.contains(QByteArrayLiteral("Wayland")))
+            m_entryTable.insert(QByteArrayLiteral("WaylandDisplay"), m_entryTable.value(QByteArrayLiteral("Wayland")));
+    }
+
+    void ConfigBase::loadInternal(const QString &filepath, QHash<ConfigEntryBase*, QString> &values) {
+        QFile in(filepath);
+
+        if (!in.open(QIODevice::ReadOnly))
+            return;
+
+        const qint64 size = in.size();
+        if (size <= 0 || size > INT_MAX)
+            return;
+
+        // the set of known entries is fixed once the config is constructed
+        if (m_entryTable.isEmpty())
+            buildEntryTable();
+
+        // work directly on the file contents, only known values are copied
+        uchar *mapped = in.map(0, size);
+        const QByteArray contents = mapped ? QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), int(size)) : in.readAll();
+
+        auto currentSection = m_entryTable.constFind(QByteArrayLiteral(IMPLICIT_SECTION));
+
+        scanIni(contents, [&](const QByteArray &section, const QByteArray &key, const QByteArray &value) {
+            // section start
+            if (key.isEmpty()) {
+                currentSection = m_entryTable.constFind(section);
+                return;
+            }
+
+            ConfigEntryBase *entry = nullptr;
+            if (currentSection != m_entryTable.constEnd())
+                entry = currentSection->value(key);
+            if (entry)
+                values.insert(entry, QString::fromUtf8(value));
+            else
+                // if we don't have such member in the config, nag about it
+                m_unusedVariables = true;
+        });
+
+        if (mapped)
+            in.unmap(mapped);
+    }
+
     void ConfigBase::save(const ConfigSection *section, const ConfigEntryBase *entry) {
+        // a single entry which is already in the file can be updated in place
+        if (section && entry && saveEntry(section, entry))
+            return;
+
+        // the full save works on the file, so write out anything pending first
+        flush();
+
         // to know if we should overwrite the config or not
         bool changed = false;
         // stores the order of the loaded sections
@@ -280,6 +559,7 @@ namespace SDDM {
         };
 
         // loading and checking phase
+        const QFileInfo info(m_path);
         QFile file(m_path);
         file.open(QIODevice::ReadOnly); // first just for reading
         while (!file.atEnd()) {
@@ -350,17 +630,176 @@ namespace SDDM {
 
         // rewrite the whole thing only if there are changes
         if (changed) {
-            file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+            QByteArray contents;
             for (const ConfigSection *s : sectionOrder)
-                file.write(sectionData.value(s));
+                contents.append(sectionData.value(s));
 
             if (sectionData.contains(nullptr)) {
-                file.write("\n");
-                file.write(UNUSED_SECTION_COMMENT);
-                file.write(sectionData.value(nullptr).trimmed());
-                file.write("\n");
+                contents.append("\n");
+                contents.append(UNUSED_SECTION_COMMENT);
+                contents.append(sectionData.value(nullptr).trimmed());
+                contents.append("\n");
+            }
+
+            // built from the file as it was just read
+            m_contents = contents;
+            m_contentsValid = true;
+            m_contentsSize = info.size();
+            m_contentsModified = info.lastModified();
+            m_dirty = true;
+            flush();
+        }
+    }
+
+    bool ConfigBase::contentsCurrent() const {
+        const QFileInfo info(m_path);
+        return m_contentsValid && info.size() == m_contentsSize && info.lastModified() == m_contentsModified;
+    }
+
+    void ConfigBase::refreshContents() {
+        // what was changed on disk meanwhile wins over the stale copy,
+        // the entries saved since are applied to the new contents
+        const auto pending = m_pendingEntries;
+        m_pendingEntries.clear();
+        m_dirty = false;
+
+        const QFileInfo info(m_path);
+        QFile file(m_path);
+        m_contents = file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+        m_contentsValid = true;
+        m_contentsSize = info.size();
+        m_contentsModified = info.lastModified();
+
+        for (const auto &saved : pending) {
+            if (!replaceEntry(saved.first, saved.second))
+                save(saved.first, saved.second);
+        }
+    }
+
+    bool ConfigBase::replaceEntry(const ConfigSection *section, const ConfigEntryBase *entry) {
+        const QByteArray sectionName = section->name().toUtf8();
+        const QByteArray name = entry->name().toUtf8();
+        QByteArray currentSection = QByteArrayLiteral(IMPLICIT_SECTION);
+
+        // start and end of the line of the entry
+        int start = -1;
+        int end = -1;
+
+        int pos = 0;
+        while (pos < m_contents.size()) {
+            int eol = m_contents.indexOf('\n', pos);
+            if (eol < 0)
+                eol = m_contents.size();
+
+            const QByteArray line = QByteArray::fromRawData(m_contents.constData() + pos, eol - pos);
+            const QByteArray trimmedLine = line.left(line.indexOf('#')).trimmed();
+
+            const int separatorPosition = trimmedLine.indexOf('=');
+            if (separatorPosition >= 0) {
+                if (currentSection == sectionName && trimmedLine.left(separatorPosition).trimmed() == name) {
+                    // the last one is what gets loaded, the full save handles all of them
+                    if (start >= 0)
+                        return false;
+                    start = pos;
+                    end = eol;
+                }
+            } else if (trimmedLine.startsWith('[') && trimmedLine.endsWith(']')) {
+                currentSection = trimmedLine.mid(1, trimmedLine.length() - 2);
             }
+
+            pos = eol + 1;
+        }
+
+        // adding entries is up to the full save, nothing to write out
+        // for one that keeps its default
+        if (start < 0)
+            return entry->matchesDefault();
+
+        const QByteArray line = m_contents.mid(start, end - start);
+        const int commentPosition = line.indexOf('#');
+        const QByteArray trimmedLine = line.left(commentPosition).trimmed();
+        const QByteArray value = entry->value().toUtf8();
+        if (trimmedLine.mid(trimmedLine.indexOf('=') + 1).trimmed() != value) {
+            QByteArray replacement = name + '=' + value;
+            if (commentPosition >= 0)
+                replacement += ' ' + line.mid(commentPosition).trimmed();
+            m_contents.replace(start, end - start, replacement);
+            m_pendingEntries.append(qMakePair(section, entry));
+            m_dirty = true;
         }
+        return true;
+    }
+
+    bool ConfigBase::saveEntry(const ConfigSection *section, const ConfigEntryBase *entry) {
+        // make sure we are working on what's on the disk
+        if (!contentsCurrent())
+            refreshContents();
+
+        if (!replaceEntry(section, entry))
+            return false;
+
+        if (m_batchDepth == 0)
+            flush();
+        return true;
+    }
+
+    void ConfigBase::flush() {
+        // never write a stale copy over changes made on disk
+        if (m_dirty && !contentsCurrent())
+            refreshContents();
+        if (!m_dirty)
+            return;
+        m_dirty = false;
+
+        // the new file is created by us, it gets the owner and mode of the old one
+        struct stat old;
+        const bool existed = ::stat(QFile::encodeName(m_path).constData(), &old) == 0;
+
+        // write to a temporary file and rename it, a crash never leaves a torn file behind;
+        // in a directory we can't create files in, write in place after all
+        QSaveFile file(m_path);
+        file.setDirectWriteFallback(true);
+        if (!file.open(QIODevice::WriteOnly)) {
+            qWarning() << "Failed to save configuration to" << m_path;
+            m_contentsValid = false;
+            return;
+        }
+        // before the rename, so the file never shows up with the wrong ones
+        if (existed) {
+            if (::fchown(file.handle(), old.st_uid, old.st_gid) != 0)
+                qWarning() << "Failed to keep the owner of" << m_path;
+            if (::fchmod(file.handle(), old.st_mode & 07777) != 0)
+                qWarning() << "Failed to keep the mode of" << m_path;
+        }
+        file.write(m_contents);
+        if (!file.commit()) {
+            qWarning() << "Failed to save configuration to" << m_path;
+            m_contentsValid = false;
+            return;
+        }
+
+        const QFileInfo info(m_path);
+        m_contentsValid = true;
+        m_contentsSize = info.size();
+        m_contentsModified = info.lastModified();
+        m_pendingEntries.clear();
+    }
+
+    void ConfigBase::beginBatch() {
+        ++m_batchDepth;
+    }
+
+    void ConfigBase::endBatch() {
+        if (m_batchDepth > 0 && --m_batchDepth == 0)
+            flush();
+    }
+
+    ConfigBatch::ConfigBatch(ConfigBase &config) : m_config(config) {
+        m_config.beginBatch();
+    }
+
+    ConfigBatch::~ConfigBatch() {
+        m_config.endBatch();
     }
 
     void ConfigBase::wipe() {
@@ -368,4 +807,18 @@ namespace SDDM {
             it->clear();
         }
     }
+
+    void ConfigBase::unload() {
+        wipe();
+        m_loadedValues = QHash<ConfigEntryBase*, QString>();
+        m_entryTable = QHash<QByteArray, QHash<QByteArray, ConfigEntryBase*>>();
+        m_files = QStringList();
+        m_fileModificationTime = QDateTime();
+        m_contents = QByteArray();
+        m_contentsValid = false;
+        m_pendingEntries.clear();
+        m_dirty = false;
+        m_loadedGeneration = 0;
+        m_fromSnapshot = false;
+    }
 }
@@ -27,21 +27,37 @@
 #include <QtCore/QDebug>
 #include <QtCore/QDateTime>
 #include <QtCore/QDir>
+#include <QtCore/QHash>
+#include <QtCore/QPair>
+#include <QtCore/QVector>
+
+#include <functional>
+
+class QFileSystemWatcher;
 
 #define IMPLICIT_SECTION "General"
 #define UNUSED_VARIABLE_COMMENT "# Unused variable"
 #define UNUSED_SECTION_COMMENT "### These sections and their variables were not used: ###\n"
+// children find the snapshot of the daemon's configuration here
+#define CONFIG_SNAPSHOT_VARIABLE "SDDM_CONFIG_SNAPSHOT"
 
 ///// convenience macros
 // efficient qstring initializer
 #define _S(x) QStringLiteral(x)
 
+// programs built with SDDM_CONFIG_DEFERRED call load() themselves, once
+// they need the values, instead of loading during static initialization
+#ifdef SDDM_CONFIG_DEFERRED
+#define CONFIG_INITIAL_LOAD()
+#else
+#define CONFIG_INITIAL_LOAD() load()
+#endif
 // config wrapper
 #define Config(name, file, dir, sysDir, ...) \
     class name : public SDDM::ConfigBase, public SDDM::ConfigSection { \
     public: \
         name() : SDDM::ConfigBase(file, dir, sysDir), SDDM::ConfigSection(this, QStringLiteral(IMPLICIT_SECTION)) { \
-            load(); \
+            CONFIG_INITIAL_LOAD(); \
         } \
         void save() { SDDM::ConfigBase::save(nullptr, nullptr); } \
         void save(SDDM::ConfigEntryBase *) const = delete; \
@@ -120,7 +136,12 @@ namespace SDDM {
             return m_value;
         }
 
-        void set(const T val) {
+        // no copy at all, only valid until the entry is changed or reloaded
+        const T &ref() const {
+            return m_value;
+        }
+
+        void set(const T &val) {
             m_value = val;
             m_isDefault = false;
         }
@@ -183,14 +204,72 @@ namespace SDDM {
         ConfigSection *m_parent;
     };
 
+    // saves the entries in its scope with a single write
+    class ConfigBatch {
+    public:
+        explicit ConfigBatch(ConfigBase &config);
+        ~ConfigBatch();
+    private:
+        Q_DISABLE_COPY(ConfigBatch)
+        ConfigBase &m_config;
+    };
+
+    // value of an entry captured once, so loops see a consistent value
+    // without going through the entry for every iteration
+    template <class T>
+    class FrozenEntry {
+    public:
+        explicit FrozenEntry(const ConfigEntry<T> &entry) : m_value(entry.ref()) { }
+
+        const T &get() const {
+            return m_value;
+        }
+
+        operator const T &() const {
+            return m_value;
+        }
+    private:
+        const T m_value;
+    };
+
+    template <class T>
+    inline FrozenEntry<T> freeze(const ConfigEntry<T> &entry) {
+        return FrozenEntry<T>(entry);
+    }
+
+    /**
+     * Walks through INI data without copying it. The handler is called with
+     * an empty key when a section starts and for every assignment, with
+     * the section, key and value trimmed and pointing into the data.
+     *
+     * A '#' starts a comment anywhere on a line, as in sddm.conf. For
+     * QSettings style files, lineComments lists the characters that only
+     * start a comment at the beginning of a line instead.
+     */
+    using IniHandler = std::function<void(const QByteArray &section, const QByteArray &key, const QByteArray &value)>;
+    void scanIni(const QByteArray &data, const IniHandler &handler, const char *lineComments = nullptr);
+
     // Base has to be separate from the Config itself - order of initialization
     class ConfigBase {
     public:
         ConfigBase(const QString &configPath, const QString &configDir=QString(), const QString &sysConfigDir=QString());
+        ~ConfigBase();
 
         void load();
+        // watch the configuration files instead of checking them on every load()
+        void setWatched(bool watched);
+        // incremented whenever a watched file or directory changes
+        quint64 generation() const;
+        // keep a binary snapshot of the merged configuration at this path
+        void setSnapshotPath(const QString &path);
         void save(const ConfigSection *section = nullptr, const ConfigEntryBase *entry = nullptr);
+        // entry saves in between are written to disk at once by endBatch()
+        void beginBatch();
+        void endBatch();
         void wipe();
+        // back to the defaults and to before the first load(), frees
+        // everything kept around for reloading
+        void unload();
         bool hasUnused() const;
         QString toConfigFull() const;
     protected:
@@ -204,8 +283,36 @@ namespace SDDM {
         friend class ConfigSection;
     private:
         QDateTime dirLatestModifiedTime(const QString &directory);
-        void loadInternal(const QString &filepath);
+        void buildEntryTable();
+        void loadInternal(const QString &filepath, QHash<ConfigEntryBase*, QString> &values);
+        void updateWatcher();
+        bool loadSnapshot(const QString &path);
+        bool saveSnapshot() const;
+        bool contentsCurrent() const;
+        void refreshContents();
+        bool replaceEntry(const ConfigSection *section, const ConfigEntryBase *entry);
+        bool saveEntry(const ConfigSection *section, const ConfigEntryBase *entry);
+        void flush();
         QDateTime m_fileModificationTime;
+        QStringList m_files;
+        // raw values applied by the last load, used to only apply changes
+        QHash<ConfigEntryBase*, QString> m_loadedValues;
+        // section name -> entry name -> entry, for lookups on raw file data
+        QHash<QByteArray, QHash<QByteArray, ConfigEntryBase*>> m_entryTable;
+        QFileSystemWatcher *m_watcher { nullptr };
+        quint64 m_generation { 1 };
+        quint64 m_loadedGeneration { 0 };
+        QString m_snapshotPath;
+        bool m_fromSnapshot { false };
+        // last known contents of m_path, for single entry saves
+        QByteArray m_contents;
+        bool m_contentsValid { false };
+        qint64 m_contentsSize { 0 };
+        QDateTime m_contentsModified;
+        bool m_dirty { false };
+        // entries changed in m_contents since the last flush
+        QVector<QPair<const ConfigSection *, const ConfigEntryBase *>> m_pendingEntries;
+        int m_batchDepth { 0 };
     };
 }
 
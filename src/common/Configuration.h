@@ -46,8 +46,37 @@ namespace SDDM {
                                                                                                    "If property is set to none, numlock won't be changed\n"
                                                                                                    "NOTE: Currently ignored if autologin is enabled."));
         Entry(InputMethod,         QString,     QStringLiteral("qtvirtualkeyboard"),                   _S("Input method module"));
+        Entry(InputMethodOnDemand, bool,        false,                                          _S("Only load the virtual keyboard when no hardware keyboard is connected\n"
+                                                                                                   "or the theme asks for it with VirtualKeyboard=true in its metadata"));
         Entry(Namespaces,          QStringList, QStringList(),                                  _S("Comma-separated list of Linux namespaces for user session to enter"));
         Entry(GreeterEnvironment,  QStringList, QStringList(),                                  _S("Comma-separated list of environment variables to be set"));
+        Entry(GreeterAuthentication,bool,       true,                                           _S("Run the auth and account stacks of the sddm-greeter PAM service for the greeter.\n"
+                                                                                                   "Its session stack runs either way, which registers the greeter with logind"));
+        Entry(SessionLog,          QString,     _S("file"),                                     _S("Where the output of user sessions goes.\n"
+                                                                                                   "Can be file for the SessionLogFile of the session type, or journal"));
+        Entry(HelperPoolSize,      int,         0,                                              _S("Number of authentication helpers to keep started ahead of a login.\n"
+                                                                                                   "Set to 0 to start a helper only when it's needed"));
+        Entry(AuthServices,        QStringList, QStringList(),                                  _S("Comma-separated list of PAM services tried along with sddm on each login,\n"
+                                                                                                   "such as sddm-fingerprint. The first one to succeed logs the user in.\n"
+                                                                                                   "Only sddm gets the password, a service asking for a secret is cancelled"));
+        Entry(KeepGreeter,         bool,        false,                                          _S("Keep the greeter running during a user session and show it again at logout.\n"
+                                                                                                   "Only used when the greeter has its own display server (x11-user, wayland)"));
+        Entry(SessionHandoff,      bool,        false,                                      _S("Start a session which brings its own display server on the VT of the greeter,\n"
+                                                                                                   "once the greeter has exited, instead of on a VT of its own"));
+        Entry(GreeterStopDelay,    int,         5000,                                           _S("Milliseconds to keep the greeter after a user session has started.\n"
+                                                                                                   "It lets the session cover the greeter before it goes away"));
+        Entry(EarlySeat0,          bool,        false,                                          _S("Start the display of seat0 right away instead of waiting for logind to list it.\n"
+                                                                                                   "It is stopped again should logind report that seat0 can't do graphics"));
+        Entry(DisplayStartLimit,   int,         0,                                              _S("Number of displays brought up at the same time, across all seats.\n"
+                                                                                                   "Set to 0 to start all of them at once"));
+        Entry(DisplayRetryDelay,   int,         2000,                                           _S("Milliseconds to wait before restarting a display that failed.\n"
+                                                                                                   "The delay doubles with each consecutive failure"));
+        Entry(DisplayRetryMaxDelay,int,         60000,                                          _S("Upper limit of the restart delay in milliseconds"));
+        Entry(DisplayFailureBudget,int,         3,                                              _S("Number of consecutive display failures after which a seat gives up.\n"
+                                                                                                   "Set to 0 to retry forever"));
+        Entry(LogRules,            QStringList, QStringList(),                                  _S("Comma-separated list of logging rules, such as sddm.pam.debug=false\n"
+                                                                                                   "Categories: sddm.daemon.socket, sddm.daemon.display, sddm.auth, sddm.pam,\n"
+                                                                                                   "sddm.greeter, sddm.greeter.models, sddm.trace and default for everything else"));
         //  Name   Entries (but it's a regular class again)
         Section(Theme,
             Entry(ThemeDir,            QString,     _S(DATA_INSTALL_DIR "/themes"),             _S("Theme directory path"));
@@ -57,7 +86,22 @@ namespace SDDM {
             Entry(CursorTheme,         QString,     QString(),                                  _S("Cursor theme used in the greeter"));
             Entry(CursorSize,          QString,     QString(),                                  _S("Cursor size used in the greeter"));
             Entry(Font,                QString,     QString(),                                  _S("Font used in the greeter"));
+            Entry(FontDirs,            QStringList, QStringList(),                              _S("Comma-separated list of font directories the greeter is limited to.\n"
+                                                                                                   "Their fontconfig cache is kept in the state directory, see sddm --update-font-cache.\n"
+                                                                                                   "Leave empty to use the fonts configured for the system"));
             Entry(EnableAvatars,       bool,        true,                                       _S("Enable display of custom user avatars"));
+            Entry(SharedEngine,        bool,        false,                                      _S("Use a single QML engine for the greeter windows on all screens"));
+            Entry(StagedStartup,       bool,        false,                                      _S("Show the greeter on the primary screen first and fill in\n"
+                                                                                                   "the session list and the other screens after its first frame"));
+            Entry(IdleTimeout,         int,         0,                                          _S("Seconds without input after which the greeter saves power.\n"
+                                                                                                   "The cursor stops blinking and themes can stop their animations, 0 disables"));
+            Entry(SceneGraphBackend,   QString,     _S("opengl"),                               _S("Qt Quick scene graph backend of the greeter: \"auto\", \"opengl\" or \"software\".\n"
+                                                                                                   "With \"auto\" the software renderer is used when OpenGL is not accelerated,\n"
+                                                                                                   "themes with shader effects don't render with it"));
+            Entry(SwapInterval,        int,         1,                                          _S("Number of vertical blanks to wait for between frames,\n"
+                                                                                                   "2 halves the frame rate of animations"));
+            Entry(Prefetch,            bool,        false,                                      _S("Read the files of the greeter into the page cache while the display server starts"));
+            Entry(PrefetchPaths,       QStringList, QStringList(),                              _S("Comma-separated list of further files and directories to read ahead"));
             Entry(DisableAvatarsThreshold,int,      7,                                          _S("Number of users to use as threshold\n"
                                                                                                    "above which avatars are disabled\n"
                                                                                                    "unless explicitly enabled with EnableAvatars"));
@@ -67,21 +111,30 @@ namespace SDDM {
         Section(X11,
             Entry(ServerPath,          QString,     _S("/usr/bin/X"),                           _S("Path to X server binary"));
             Entry(ServerArguments,     QString,     _S("-nolisten tcp"),                        _S("Arguments passed to the X server invocation"));
+            Entry(ServerTimeout,       int,         30,                                         _S("Number of seconds to wait for the X server to report its display number"));
             Entry(XephyrPath,          QString,     _S("/usr/bin/Xephyr"),                      _S("Path to Xephyr binary"));
             Entry(XauthPath,           QString,     _S("/usr/bin/xauth"),                       _S("Path to xauth binary"));
             Entry(SessionDir,          QString,     _S("/usr/share/xsessions"),                 _S("Directory containing available X sessions"));
             Entry(SessionCommand,      QString,     _S(SESSION_COMMAND),                        _S("Path to a script to execute when starting the desktop session"));
 	    Entry(SessionLogFile,      QString,     _S(".local/share/sddm/xorg-session.log"),   _S("Path to the user session log file"));
 	    Entry(UserAuthFile,        QString,     _S(".Xauthority"),                          _S("Path to the Xauthority file"));
+            Entry(UserAuthInRuntimeDir,bool,        false,                                      _S("Keep the Xauthority file of the session in $XDG_RUNTIME_DIR instead of the home directory"));
             Entry(DisplayCommand,      QString,     _S(DATA_INSTALL_DIR "/scripts/Xsetup"),     _S("Path to a script to execute when starting the display server"));
             Entry(DisplayStopCommand,  QString,     _S(DATA_INSTALL_DIR "/scripts/Xstop"),      _S("Path to a script to execute when stopping the display server"));
+            Entry(WaitForDisplayCommand,bool,       true,                                       _S("Wait for the display setup script to finish before starting the greeter"));
             Entry(EnableHiDPI,         bool,        false,                                      _S("Enable Qt's automatic high-DPI scaling"));
+            Entry(ReuseServer,         bool,        false,                                      _S("Keep the X server when a session ends and only start the greeter again.\n"
+                                                                                                   "The server is reset with a new cookie instead of being restarted"));
         );
 
         Section(Wayland,
             Entry(CompositorCommand,   QString,     _S("weston --shell=fullscreen-shell.so"),   _S("Path of the Wayland compositor to execute when starting the greeter"));
+            Entry(PersistentCompositor,bool,        false,                                      _S("Keep the compositor of the greeter running when the greeter fails\n"
+                                                                                                   "and start the greeter again in it"));
             Entry(SessionDir,          QString,     _S("/usr/share/wayland-sessions"),          _S("Directory containing available Wayland sessions"));
             Entry(SessionCommand,      QString,     _S(WAYLAND_SESSION_COMMAND),                _S("Path to a script to execute when starting the desktop session"));
+            Entry(CacheLoginEnvironment,bool,       false,                                      _S("Remember the environment the user's login profile sets up and start the\n"
+                                                                                                   "session with it directly, until the shell or a profile file changes"));
 	    Entry(SessionLogFile,      QString,     _S(".local/share/sddm/wayland-session.log"),_S("Path to the user session log file"));
             Entry(EnableHiDPI,         bool,        false,                                      _S("Enable Qt's automatic high-DPI scaling"));
         );
@@ -97,6 +150,13 @@ namespace SDDM {
             Entry(RememberLastSession, bool,        true,                                       _S("Remember the session of the last successfully logged in user"));
 
             Entry(ReuseSession,        bool,        true,                                       _S("When logging in as the same user twice, restore the original session, rather than create a new one"));
+            Entry(CacheUserList,       bool,        false,                                      _S("Keep a snapshot of the user list in the state directory.\n"
+                                                                                                   "The greeter shows it right away and checks it against\n"
+                                                                                                   "the user database in the background"));
+            Entry(UseAccountsService,  bool,        false,                                      _S("Get the user list from AccountsService instead of the user database.\n"
+                                                                                                   "Falls back to the user database if AccountsService is not available"));
+            Entry(SharedUserList,      bool,        false,                                      _S("Let the daemon enumerate the users and look up their avatars once,\n"
+                                                                                                   "the greeters of all seats get the list from it"));
         );
 
         Section(Autologin,
@@ -104,9 +164,34 @@ namespace SDDM {
             Entry(Session,             QString,     QString(),                                  _S("Name of session file for autologin session (if empty try last logged in)"));
             Entry(Relogin,             bool,        false,                                      _S("Whether sddm should automatically log back into sessions when they exit"));
         );
+
+        Section(Scheduling,
+            Entry(GreeterNice,         int,         0,                                          _S("Nice level of the greeter, from -20 to 19"));
+            Entry(GreeterIOClass,      QString,     QString(),                                  _S("IO scheduling class of the greeter: \"realtime\", \"best-effort\" or \"idle\",\n"
+                                                                                                   "optionally followed by a colon and a level from 0 (highest) to 7"));
+            Entry(GreeterPolicy,       QString,     QString(),                                  _S("CPU scheduling policy of the greeter: \"other\", \"batch\" or \"idle\""));
+            Entry(GreeterCgroup,       QString,     QString(),                                  _S("cgroup of the greeter, relative to the one of sddm, created if needed;\n"
+                                                                                                   "only for a greeter without a login session, as in test mode"));
+            Entry(HelperNice,          int,         0,                                          _S("Nice level of sddm-helper, from -20 to 19"));
+            Entry(HelperIOClass,       QString,     QString(),                                  _S("IO scheduling class of sddm-helper: \"realtime\", \"best-effort\" or \"idle\",\n"
+                                                                                                   "optionally followed by a colon and a level from 0 (highest) to 7"));
+            Entry(HelperPolicy,        QString,     QString(),                                  _S("CPU scheduling policy of sddm-helper: \"other\", \"batch\" or \"idle\""));
+            Entry(HelperCgroup,        QString,     QString(),                                  _S("cgroup of sddm-helper, relative to the one of sddm, created if needed"));
+            Entry(DisplayServerNice,   int,         0,                                          _S("Nice level of the X server, from -20 to 19"));
+            Entry(DisplayServerIOClass,QString,     QString(),                                  _S("IO scheduling class of the X server: \"realtime\", \"best-effort\" or \"idle\",\n"
+                                                                                                   "optionally followed by a colon and a level from 0 (highest) to 7"));
+            Entry(DisplayServerPolicy, QString,     QString(),                                  _S("CPU scheduling policy of the X server: \"other\", \"batch\" or \"idle\""));
+            Entry(DisplayServerCgroup, QString,     QString(),                                  _S("cgroup of the X server, relative to the one of sddm, created if needed"));
+        );
     );
 
-    Config(StateConfig, []()->QString{auto tmp = getpwnam("sddm"); return tmp ? QString::fromLocal8Bit(tmp->pw_dir) : QStringLiteral(STATE_DIR);}().append(QStringLiteral("/state.conf")), QString(), QString(),
+    // home directory of the sddm user, where the state is kept
+    inline QString stateDirectory() {
+        auto tmp = getpwnam("sddm");
+        return tmp ? QString::fromLocal8Bit(tmp->pw_dir) : QStringLiteral(STATE_DIR);
+    }
+
+    Config(StateConfig, stateDirectory().append(QStringLiteral("/state.conf")), QString(), QString(),
         Section(Last,
             Entry(Session,         QString,     QString(),                                      _S("Name of the session for the last logged-in user.\n"
                                                                                                    "This session will be preselected when the login screen appears."));
@@ -0,0 +1,138 @@
+/***************************************************************************
+* Copyright (c) 2015 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "DesktopEntry.h"
+
+#include <QFile>
+
+#include <limits.h>
+#include <string.h>
+
+namespace SDDM {
+    static inline bool isBlank(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    DesktopEntry::DesktopEntry(const QString &fileName, const QByteArray &group) {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly))
+            return;
+
+        m_valid = true;
+
+        const qint64 size = file.size();
+        if (size <= 0 || size > INT_MAX)
+            return;
+
+        // map the file if possible, this avoids copying it
+        if (uchar *data = file.map(0, size)) {
+            m_hasGroup = parse(reinterpret_cast<const char *>(data), int(size), group, m_values);
+            file.unmap(data);
+        } else {
+            const QByteArray data = file.readAll();
+            m_hasGroup = parse(data.constData(), data.size(), group, m_values);
+        }
+    }
+
+    bool DesktopEntry::isValid() const {
+        return m_valid;
+    }
+
+    bool DesktopEntry::hasGroup() const {
+        return m_hasGroup;
+    }
+
+    bool DesktopEntry::contains(const QByteArray &key) const {
+        return m_values.contains(key);
+    }
+
+    QString DesktopEntry::value(const QByteArray &key, const QString &defaultValue) const {
+        auto it = m_values.constFind(key);
+        if (it == m_values.constEnd())
+            return defaultValue;
+        return QString::fromUtf8(*it);
+    }
+
+    bool DesktopEntry::boolValue(const QByteArray &key, bool defaultValue) const {
+        auto it = m_values.constFind(key);
+        if (it == m_values.constEnd())
+            return defaultValue;
+        return it->compare("true", Qt::CaseInsensitive) == 0;
+    }
+
+    bool DesktopEntry::parse(const char *data, int size, const QByteArray &group, QHash<QByteArray, QByteArray> &values) {
+        const char *pos = data;
+        const char *end = data + size;
+        bool inGroup = false;
+
+        while (pos < end) {
+            const char *eol = static_cast<const char *>(memchr(pos, '\n', end - pos));
+            if (!eol)
+                eol = end;
+
+            const char *lineStart = pos;
+            const char *lineEnd = eol;
+            pos = eol + 1;
+
+            while (lineStart < lineEnd && isBlank(*lineStart))
+                ++lineStart;
+            while (lineEnd > lineStart && isBlank(lineEnd[-1]))
+                --lineEnd;
+
+            if (lineStart == lineEnd || *lineStart == '#')
+                continue;
+
+            if (*lineStart == '[') {
+                // the group we are interested in is over, skip the rest
+                if (inGroup)
+                    return true;
+
+                // the group name ends before the last ] before the start of a comment
+                const char *comment = static_cast<const char *>(memchr(lineStart, '#', lineEnd - lineStart));
+                const char *close = (comment ? comment : lineEnd) - 1;
+                while (close > lineStart && *close != ']')
+                    --close;
+                if (close > lineStart) {
+                    const int length = int(close - lineStart - 1);
+                    inGroup = length == group.size() && memcmp(lineStart + 1, group.constData(), length) == 0;
+                }
+                continue;
+            }
+
+            if (!inGroup)
+                continue;
+
+            const char *equals = static_cast<const char *>(memchr(lineStart, '=', lineEnd - lineStart));
+            if (!equals)
+                continue;
+
+            const char *keyEnd = equals;
+            while (keyEnd > lineStart && isBlank(keyEnd[-1]))
+                --keyEnd;
+            const char *valueStart = equals + 1;
+            while (valueStart < lineEnd && isBlank(*valueStart))
+                ++valueStart;
+
+            values.insert(QByteArray(lineStart, int(keyEnd - lineStart)),
+                          QByteArray(valueStart, int(lineEnd - valueStart)));
+        }
+
+        return inGroup;
+    }
+}
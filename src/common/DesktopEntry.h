@@ -0,0 +1,55 @@
+/***************************************************************************
+* Copyright (c) 2015 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_DESKTOPENTRY_H
+#define SDDM_DESKTOPENTRY_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+
+namespace SDDM {
+    /**
+     * Reads the key/value pairs of a single group of a desktop entry
+     * style file in one pass, stopping at the end of that group.
+     */
+    class DesktopEntry {
+    public:
+        explicit DesktopEntry(const QString &fileName, const QByteArray &group = QByteArrayLiteral("Desktop Entry"));
+
+        // whether the file could be read
+        bool isValid() const;
+        // whether the group was present
+        bool hasGroup() const;
+
+        bool contains(const QByteArray &key) const;
+        QString value(const QByteArray &key, const QString &defaultValue = QString()) const;
+        bool boolValue(const QByteArray &key, bool defaultValue = false) const;
+
+        // tokenises a buffer, returns false if the group is not present
+        static bool parse(const char *data, int size, const QByteArray &group, QHash<QByteArray, QByteArray> &values);
+
+    private:
+        bool m_valid { false };
+        bool m_hasGroup { false };
+        QHash<QByteArray, QByteArray> m_values;
+    };
+}
+
+#endif // SDDM_DESKTOPENTRY_H
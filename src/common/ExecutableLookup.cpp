@@ -0,0 +1,118 @@
+/***************************************************************************
+* Copyright (c) 2015 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QHash>
+#include <QProcessEnvironment>
+#include <QVector>
+
+#include "ExecutableLookup.h"
+
+namespace SDDM {
+    namespace ExecutableLookup {
+        // directories are checked for changes at most this often
+        static const qint64 ValidationInterval = 1000;
+
+        struct PathDirectory {
+            QString path;
+            qint64 modified { -1 };
+        };
+
+        class LookupCache {
+        public:
+            LookupCache() {
+                // split PATH only once
+                const QString envPath = QProcessEnvironment::systemEnvironment().value(QStringLiteral("PATH"));
+                const QStringList pathList = envPath.split(QLatin1Char(':'), Qt::SkipEmptyParts);
+                for (const QString &path : pathList) {
+                    PathDirectory directory;
+                    directory.path = path;
+                    directories.append(directory);
+                }
+            }
+
+            void validate() {
+                if (timer.isValid() && !timer.hasExpired(ValidationInterval))
+                    return;
+                timer.start();
+
+                // installing or removing a binary changes the directory mtime
+                bool changed = false;
+                for (PathDirectory &directory : directories) {
+                    const QFileInfo info(directory.path);
+                    const qint64 modified = info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1;
+                    if (modified != directory.modified) {
+                        directory.modified = modified;
+                        changed = true;
+                    }
+                }
+                if (changed)
+                    resolved.clear();
+            }
+
+            QString lookup(const QString &name) {
+                validate();
+
+                auto it = resolved.constFind(name);
+                if (it != resolved.constEnd())
+                    return *it;
+
+                QString result;
+                for (const PathDirectory &directory : qAsConst(directories)) {
+                    if (directory.modified < 0)
+                        continue;
+                    const QFileInfo info(QDir(directory.path), name);
+                    if (info.exists() && info.isExecutable() && !info.isDir()) {
+                        result = info.absoluteFilePath();
+                        break;
+                    }
+                }
+
+                // negative results are remembered too
+                resolved.insert(name, result);
+                return result;
+            }
+
+            QVector<PathDirectory> directories;
+            QHash<QString, QString> resolved;
+            QElapsedTimer timer;
+        };
+
+        Q_GLOBAL_STATIC(LookupCache, s_cache)
+
+        QString find(const QString &name) {
+            if (name.isEmpty())
+                return QString();
+
+            const QFileInfo info(name);
+            if (info.isAbsolute())
+                return info.exists() && info.isExecutable() ? name : QString();
+
+            return s_cache->lookup(name);
+        }
+
+        bool canExecute(const QString &tryExec) {
+            if (tryExec.isEmpty())
+                return true;
+            return !find(tryExec).isEmpty();
+        }
+    }
+}
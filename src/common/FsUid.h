@@ -0,0 +1,81 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_FSUID_H
+#define SDDM_FSUID_H
+
+#include <QtGlobal>
+
+#include <pwd.h>
+#include <unistd.h>
+#ifdef Q_OS_LINUX
+#include <sys/fsuid.h>
+#endif
+
+namespace SDDM {
+    /**
+     * Switches the file system uid and gid of the calling thread to the
+     * ones of a user while it is in scope, so that files are opened with
+     * the permissions of that user. Other threads keep theirs, unlike
+     * with setresuid() and friends.
+     *
+     * Only Linux has setfsuid(), isActive() is false elsewhere and when
+     * the user doesn't exist.
+     */
+    class FsUidScope {
+    public:
+        explicit FsUidScope(const char *user) {
+#ifdef Q_OS_LINUX
+            struct passwd pwd, *result = nullptr;
+            char buffer[4096];
+            if (!user || ::getpwnam_r(user, &pwd, buffer, sizeof(buffer), &result) != 0 || !result)
+                return;
+            ::setfsgid(pwd.pw_gid);
+            ::setfsuid(pwd.pw_uid);
+            // these return the previous value and don't report failures
+            m_active = int(::setfsuid(pwd.pw_uid)) == int(pwd.pw_uid)
+                    && int(::setfsgid(pwd.pw_gid)) == int(pwd.pw_gid);
+            m_switched = true;
+#else
+            Q_UNUSED(user)
+#endif
+        }
+
+        ~FsUidScope() {
+#ifdef Q_OS_LINUX
+            if (!m_switched)
+                return;
+            ::setfsuid(::geteuid());
+            ::setfsgid(::getegid());
+#endif
+        }
+
+        bool isActive() const {
+            return m_active;
+        }
+
+    private:
+        Q_DISABLE_COPY(FsUidScope)
+
+        bool m_active { false };
+        bool m_switched { false };
+    };
+}
+
+#endif // SDDM_FSUID_H
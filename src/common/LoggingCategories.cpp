@@ -0,0 +1,41 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "LoggingCategories.h"
+
+#include "Configuration.h"
+
+Q_LOGGING_CATEGORY(SDDM_DAEMON_SOCKET, "sddm.daemon.socket")
+Q_LOGGING_CATEGORY(SDDM_DAEMON_DISPLAY, "sddm.daemon.display")
+Q_LOGGING_CATEGORY(SDDM_AUTH, "sddm.auth")
+Q_LOGGING_CATEGORY(SDDM_PAM, "sddm.pam")
+Q_LOGGING_CATEGORY(SDDM_GREETER, "sddm.greeter")
+Q_LOGGING_CATEGORY(SDDM_GREETER_MODELS, "sddm.greeter.models")
+// latency milestones, see Trace.h
+Q_LOGGING_CATEGORY(SDDM_TRACE, "sddm.trace", QtInfoMsg)
+
+namespace SDDM {
+    void applyLogRules() {
+        const QStringList rules = mainConfig.LogRules.get();
+        if (rules.isEmpty())
+            return;
+
+        QLoggingCategory::setFilterRules(rules.join(QLatin1Char('\n')));
+    }
+}
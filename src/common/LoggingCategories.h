@@ -0,0 +1,43 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_LOGGINGCATEGORIES_H
+#define SDDM_LOGGINGCATEGORIES_H
+
+#include <QLoggingCategory>
+
+// Per subsystem categories, their levels are set through
+// General.LogRules, e.g. "sddm.pam.debug=false"
+Q_DECLARE_LOGGING_CATEGORY(SDDM_DAEMON_SOCKET)
+Q_DECLARE_LOGGING_CATEGORY(SDDM_DAEMON_DISPLAY)
+Q_DECLARE_LOGGING_CATEGORY(SDDM_AUTH)
+Q_DECLARE_LOGGING_CATEGORY(SDDM_PAM)
+Q_DECLARE_LOGGING_CATEGORY(SDDM_GREETER)
+Q_DECLARE_LOGGING_CATEGORY(SDDM_GREETER_MODELS)
+Q_DECLARE_LOGGING_CATEGORY(SDDM_TRACE)
+
+namespace SDDM {
+    /**
+     * Applies General.LogRules, in QLoggingCategory::setFilterRules()
+     * syntax, on top of Qt's own QT_LOGGING_RULES.
+     */
+    void applyLogRules();
+}
+
+#endif // SDDM_LOGGINGCATEGORIES_H
@@ -0,0 +1,52 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "LoginId.h"
+
+#include <QRandomGenerator>
+
+namespace SDDM {
+    namespace LoginId {
+        static QString &currentId() {
+            static thread_local QString id;
+            return id;
+        }
+
+        QString generate() {
+            return QStringLiteral("%1").arg(QRandomGenerator::system()->generate64(), 16, 16, QLatin1Char('0'));
+        }
+
+        QString current() {
+            return currentId();
+        }
+
+        void set(const QString &id) {
+            currentId() = id;
+        }
+
+        Scope::Scope(const QString &id)
+                : m_previous(currentId()) {
+            currentId() = id;
+        }
+
+        Scope::~Scope() {
+            currentId() = m_previous;
+        }
+    }
+}
@@ -0,0 +1,56 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_LOGINID_H
+#define SDDM_LOGINID_H
+
+#include <QString>
+
+namespace SDDM {
+    /**
+     * Correlation id of the login attempt being handled, so that its
+     * messages can be found across the greeter, the daemon and the
+     * helper, e.g. with journalctl SDDM_LOGIN_ID=<id>.
+     *
+     * The greeter sends it along with Login, the daemon hands it to
+     * sddm-helper as --id. The message handler and Trace::mark() attach
+     * the current one, as the SDDM_LOGIN_ID journald field or in front
+     * of the message in the log file.
+     */
+    namespace LoginId {
+        // a new random id
+        QString generate();
+
+        // the id of this thread, empty outside of a login
+        QString current();
+        void set(const QString &id);
+
+        // makes @p id current until it goes out of scope
+        class Scope {
+        public:
+            explicit Scope(const QString &id);
+            ~Scope();
+
+        private:
+            QString m_previous;
+        };
+    }
+}
+
+#endif // SDDM_LOGINID_H
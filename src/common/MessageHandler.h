@@ -22,12 +22,19 @@
 #define SDDM_MESSAGEHANDLER_H
 
 #include "Constants.h"
+#include "LoginId.h"
 
 #include <QDateTime>
 #include <QStandardPaths>
 #include <QFile>
 #include <QDir>
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
 #include <stdio.h>
 
 #ifdef HAVE_JOURNALD
@@ -37,7 +44,7 @@
 
 namespace SDDM {
 #ifdef HAVE_JOURNALD
-    static void journaldLogger(QtMsgType type, const QMessageLogContext &context, const QString &msg) {
+    static void journaldLogger(QtMsgType type, const QMessageLogContext &context, const QString &msg, const QString &loginId) {
         int priority = LOG_INFO;
         switch (type) {
             case QtDebugMsg:
@@ -62,20 +69,24 @@ namespace SDDM {
         char lineBuffer[32];
         snprintf(lineBuffer, sizeof(lineBuffer), "CODE_LINE=%d", context.line);
 
-        sd_journal_print_with_location(priority, fileBuffer, lineBuffer,
-                                       context.function ? context.function : "unknown",
-                                       "%s", qPrintable(msg));
+        const char *function = context.function ? context.function : "unknown";
+        if (loginId.isEmpty()) {
+            sd_journal_print_with_location(priority, fileBuffer, lineBuffer, function,
+                                           "%s", qPrintable(msg));
+        } else {
+            sd_journal_send_with_location(fileBuffer, lineBuffer, function,
+                                          "MESSAGE=%s", qPrintable(msg),
+                                          "PRIORITY=%i", priority,
+                                          "SDDM_LOGIN_ID=%s", qPrintable(loginId),
+                                          NULL);
+        }
     }
 #endif
 
-    static void standardLogger(QtMsgType type, const QString &msg) {
-        static QFile file(QStringLiteral(LOG_FILE));
-
-        // try to open file only if it's not already open
-        if (!file.isOpen()) {
-            if (!file.open(QFile::Append | QFile::WriteOnly))
-                file.open(QFile::Truncate | QFile::WriteOnly);
-        }
+    static void openLogFile(QFile &file) {
+        file.setFileName(QStringLiteral(LOG_FILE));
+        if (!file.open(QFile::Append | QFile::WriteOnly))
+            file.open(QFile::Truncate | QFile::WriteOnly);
 
         // If we can't open the file, create it in a writable location
         // It will look spmething like ~/.local/share/$appname/sddm.log
@@ -86,12 +97,14 @@ namespace SDDM {
             if (!file.open(QFile::Append | QFile::WriteOnly))
                 file.open(QFile::Truncate | QFile::WriteOnly);
         }
+    }
 
+    static QByteArray formatMessage(QtMsgType type, qint64 time, const QString &msg) {
         // create timestamp
-        QString timestamp = QDateTime::currentDateTime().toString(QStringLiteral("hh:mm:ss.zzz"));
+        QString timestamp = QDateTime::fromMSecsSinceEpoch(time).toString(QStringLiteral("hh:mm:ss.zzz"));
 
         // set log priority
-	QString logPriority = QStringLiteral("(II)");
+        QString logPriority = QStringLiteral("(II)");
         switch (type) {
             case QtDebugMsg:
             break;
@@ -102,48 +115,211 @@ namespace SDDM {
             case QtFatalMsg:
                 logPriority = QStringLiteral("(EE)");
             break;
-	    default:
-	    break;
+            default:
+            break;
         }
 
         // prepare log message
         QString logMessage = QStringLiteral("[%1] %2 %3\n").arg(timestamp).arg(logPriority).arg(msg);
+        return logMessage.toLocal8Bit();
+    }
 
-        // log message
-        if (file.isOpen()) {
-            file.write(logMessage.toLocal8Bit());
-            file.flush();
-        } else {
-            printf("%s", qPrintable(logMessage));
-            fflush(stdout);
+    /**
+     * Takes log messages off the calling thread.
+     *
+     * Callers only copy the message into a queue, timestamps are
+     * formatted and the file or journald are written by a background
+     * thread, one write and flush per batch. Fatal messages and
+     * messages from a forked child, where the thread doesn't exist,
+     * are written synchronously.
+     */
+    class LogWriter {
+    public:
+        struct Entry {
+            QtMsgType type;
+            qint64 time;
+            // copies, the greeter logs QML messages with temporary ones
+            QByteArray file;
+            int line;
+            QByteArray function;
+            QString prefix;
+            QString message;
+            // of the login the message was logged for, see LoginId
+            QString loginId;
+        };
+
+        static LogWriter *instance() {
+            static LogWriter writer;
+            return destroyed() ? nullptr : &writer;
         }
-    }
 
-    static void messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &prefix, const QString &msg) {
-        // copy message to edit it
-        QString logMessage = msg;
+        // set while this thread writes, so a message logged by the
+        // writing code itself doesn't wait on its own locks
+        static bool &writing() {
+            static thread_local bool value = false;
+            return value;
+        }
 
-#ifdef HAVE_JOURNALD
-        // don't log to journald if running interactively, this is likely
-        // the case when running sddm in test mode
-        static bool isInteractive = isatty(STDIN_FILENO);
-        if (!isInteractive) {
-            // log to journald
-            journaldLogger(type, context, logMessage);
-        } else {
-            // prepend program name
-            logMessage = prefix + msg;
+        void post(Entry &&entry) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            // about to abort or no thread to hand it to, write it out
+            // now together with whatever is still queued
+            if (entry.type == QtFatalMsg || !m_thread) {
+                std::vector<Entry> batch;
+                batch.swap(m_queue);
+                batch.push_back(std::move(entry));
+                write(batch);
+                return;
+            }
+
+            const bool wake = m_queue.empty();
+            m_queue.push_back(std::move(entry));
+            lock.unlock();
 
-            // log to file or stdout
-            standardLogger(type, logMessage);
+            if (wake)
+                m_condition.notify_one();
         }
-#else
-        // prepend program name
-        logMessage = prefix + msg;
 
-        // log to file or stdout
-        standardLogger(type, logMessage);
+    private:
+        LogWriter() {
+            pthread_atfork(&LogWriter::prepareFork, &LogWriter::parentFork, &LogWriter::childFork);
+            m_thread = new std::thread(&LogWriter::run, this);
+        }
+
+        ~LogWriter() {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_quit = true;
+            }
+            m_condition.notify_one();
+
+            if (m_thread) {
+                m_thread->join();
+                delete m_thread;
+            }
+            destroyed() = true;
+        }
+
+        static bool &destroyed() {
+            static bool value = false;
+            return value;
+        }
+
+        void run() {
+            std::vector<Entry> batch;
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            for (;;) {
+                m_condition.wait(lock, [this] { return m_quit || !m_queue.empty(); });
+                if (m_queue.empty())
+                    return;
+
+                batch.swap(m_queue);
+                lock.unlock();
+
+                write(batch);
+                batch.clear();
+
+                lock.lock();
+            }
+        }
+
+        // no lock may be held by the writer thread while forking, the
+        // child continues without that thread; nothing is left to lock
+        // for a fork during exit, once the writer is gone
+        static void prepareFork() {
+            LogWriter *writer = instance();
+            if (!writer)
+                return;
+            writer->m_mutex.lock();
+            writer->m_writeMutex.lock();
+        }
+
+        static void parentFork() {
+            LogWriter *writer = instance();
+            if (!writer)
+                return;
+            writer->m_writeMutex.unlock();
+            writer->m_mutex.unlock();
+        }
+
+        static void childFork() {
+            LogWriter *writer = instance();
+            if (!writer)
+                return;
+            // the parent's writer thread still writes what was queued,
+            // the child would write it a second time with its first message
+            writer->m_queue.clear();
+            writer->m_thread = nullptr;
+            writer->m_writeMutex.unlock();
+            writer->m_mutex.unlock();
+        }
+
+        void write(const std::vector<Entry> &batch) {
+            std::lock_guard<std::mutex> lock(m_writeMutex);
+            writing() = true;
+            QByteArray buffer;
+
+            for (const Entry &entry : batch) {
+#ifdef HAVE_JOURNALD
+                // don't log to journald if running interactively, this is likely
+                // the case when running sddm in test mode
+                static bool isInteractive = isatty(STDIN_FILENO);
+                if (!isInteractive) {
+                    QMessageLogContext context(entry.file.isNull() ? nullptr : entry.file.constData(), entry.line,
+                                               entry.function.isNull() ? nullptr : entry.function.constData(), nullptr);
+                    journaldLogger(entry.type, context, entry.message, entry.loginId);
+                    continue;
+                }
 #endif
+                if (entry.loginId.isEmpty())
+                    buffer += formatMessage(entry.type, entry.time, entry.prefix + entry.message);
+                else
+                    buffer += formatMessage(entry.type, entry.time, entry.prefix + QLatin1Char('[') + entry.loginId + QStringLiteral("] ") + entry.message);
+            }
+
+            if (!buffer.isEmpty()) {
+                if (!m_file.isOpen())
+                    openLogFile(m_file);
+
+                // log message
+                if (m_file.isOpen()) {
+                    m_file.write(buffer);
+                    m_file.flush();
+                } else {
+                    fwrite(buffer.constData(), 1, buffer.size(), stdout);
+                    fflush(stdout);
+                }
+            }
+
+            writing() = false;
+        }
+
+        std::mutex m_mutex;
+        std::mutex m_writeMutex;
+        std::condition_variable m_condition;
+        std::vector<Entry> m_queue;
+        std::thread *m_thread { nullptr };
+        bool m_quit { false };
+        QFile m_file;
+    };
+
+    static void messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &prefix, const QString &msg) {
+        LogWriter *writer = LogWriter::instance();
+
+        // logging during exit, after the writer is gone, or from the
+        // writer itself
+        if (!writer || LogWriter::writing()) {
+            fprintf(stderr, "%s%s\n", qPrintable(prefix), qPrintable(msg));
+            return;
+        }
+
+        // the file and function aren't always literals, they are copied
+        // before this returns
+        writer->post({ type, QDateTime::currentMSecsSinceEpoch(),
+                       QByteArray(context.file), context.line, QByteArray(context.function),
+                       prefix, msg, LoginId::current() });
     }
 
     void DaemonMessageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg) {
@@ -23,6 +23,12 @@
 #include <QFlags>
 
 namespace SDDM {
+    // every message is sent as a frame: its length as a big endian quint32 and the data.
+    // bump the version when messages change, it is sent along with Connect;
+    // the daemon only talks to greeters of its own version
+    const quint32 ProtocolVersion = 1;
+    const quint32 MaximumFrameLength = 1024 * 1024;
+
     enum class GreeterMessages {
         Connect = 0,
         Login,
@@ -30,7 +36,13 @@ namespace SDDM {
         Reboot,
         Suspend,
         Hibernate,
-        HybridSleep
+        HybridSleep,
+        // asks for the users of the daemon's directory and the updates
+        ListUsers,
+        // every screen has its first frame, the greeter can be shown
+        Ready,
+        // how long frames and typing into password fields took lately
+        FrameStats
     };
 
     enum class DaemonMessages {
@@ -39,6 +51,19 @@ namespace SDDM {
         LoginSucceeded,
         LoginFailed,
         InformationMessage,
+        // a greeter kept running during a session is shown again
+        Reset,
+        // users of the directory that were added or changed, in batches
+        Users,
+        UsersRemoved,
+        // all the users have been sent once
+        UsersListed,
+        // the action, whether it went through and the error otherwise
+        PowerActionFinished,
+        // the path of the theme to load in place and its config snapshot
+        ReloadTheme,
+        // the sessions of the daemon's catalog, all of them every time
+        Sessions,
     };
 
     enum Capability {
@@ -0,0 +1,102 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "Metrics.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+
+namespace SDDM {
+    namespace Metrics {
+        static const quint64 Bounds[] = { 1, 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 30000 };
+        static const int BucketCount = sizeof(Bounds) / sizeof(Bounds[0]) + 1;
+
+        struct Histogram {
+            quint64 count { 0 };
+            quint64 sum { 0 };
+            QList<quint64> buckets;
+        };
+
+        struct Registry {
+            QMutex mutex;
+            QHash<QString, quint64> counters;
+            QHash<QString, Histogram> histograms;
+        };
+        Q_GLOBAL_STATIC(Registry, s_registry)
+
+        void increment(const char *counter, quint64 value) {
+            Registry *registry = s_registry();
+            QMutexLocker lock(&registry->mutex);
+            registry->counters[QLatin1String(counter)] += value;
+        }
+
+        void observe(const char *histogram, qint64 msecs) {
+            const quint64 value = quint64(qMax<qint64>(msecs, 0));
+
+            int bucket = 0;
+            while (bucket < BucketCount - 1 && value > Bounds[bucket])
+                ++bucket;
+
+            Registry *registry = s_registry();
+            QMutexLocker lock(&registry->mutex);
+            Histogram &h = registry->histograms[QLatin1String(histogram)];
+            if (h.buckets.isEmpty()) {
+                h.buckets.reserve(BucketCount);
+                for (int i = 0; i < BucketCount; ++i)
+                    h.buckets << 0;
+            }
+            ++h.count;
+            h.sum += value;
+            ++h.buckets[bucket];
+        }
+
+        QList<quint64> bucketBounds() {
+            QList<quint64> bounds;
+            for (quint64 bound : Bounds)
+                bounds << bound;
+            return bounds;
+        }
+
+        QVariantMap counters() {
+            Registry *registry = s_registry();
+            QMutexLocker lock(&registry->mutex);
+
+            QVariantMap result;
+            for (auto it = registry->counters.constBegin(); it != registry->counters.constEnd(); ++it)
+                result.insert(it.key(), QVariant::fromValue(it.value()));
+            return result;
+        }
+
+        QVariantMap histograms() {
+            Registry *registry = s_registry();
+            QMutexLocker lock(&registry->mutex);
+
+            QVariantMap result;
+            for (auto it = registry->histograms.constBegin(); it != registry->histograms.constEnd(); ++it) {
+                QVariantMap histogram;
+                histogram.insert(QStringLiteral("count"), QVariant::fromValue(it->count));
+                histogram.insert(QStringLiteral("sum"), QVariant::fromValue(it->sum));
+                histogram.insert(QStringLiteral("buckets"), QVariant::fromValue(it->buckets));
+                result.insert(it.key(), histogram);
+            }
+            return result;
+        }
+    }
+}
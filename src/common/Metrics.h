@@ -0,0 +1,51 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_METRICS_H
+#define SDDM_METRICS_H
+
+#include <QList>
+#include <QVariantMap>
+
+namespace SDDM {
+    namespace Metrics {
+        /**
+         * Adds @p value to @p counter, e.g. "login_attempts". Counters
+         * start at 0 and only grow while the daemon runs.
+         */
+        void increment(const char *counter, quint64 value = 1);
+
+        /**
+         * Records a duration in milliseconds in @p histogram, e.g.
+         * "auth_duration_ms".
+         */
+        void observe(const char *histogram, qint64 msecs);
+
+        // upper bounds in milliseconds of all histogram buckets but
+        // the last one, which takes everything above
+        QList<quint64> bucketBounds();
+
+        // name to count
+        QVariantMap counters();
+        // name to a map of "count", "sum" and "buckets" (at)
+        QVariantMap histograms();
+    }
+}
+
+#endif // SDDM_METRICS_H
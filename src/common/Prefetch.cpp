@@ -0,0 +1,165 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "Prefetch.h"
+
+#include "Configuration.h"
+#include "FsUid.h"
+
+#include <QDebug>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QThreadPool>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace SDDM {
+    namespace Prefetch {
+        // the first files are the ones needed first, stop after that much
+        static const qint64 MaximumBytes = 256 * 1024 * 1024;
+
+        QString listPath() {
+            return QStringLiteral("%1/prefetch.list").arg(stateDirectory());
+        }
+
+        static QStringList readList() {
+            QStringList list;
+            QFile file(listPath());
+            if (!file.open(QIODevice::ReadOnly))
+                return list;
+            while (!file.atEnd()) {
+                const QString line = QString::fromLocal8Bit(file.readLine()).trimmed();
+                if (line.startsWith(QLatin1Char('/')))
+                    list << line;
+            }
+            return list;
+        }
+
+        static bool isRegularFile(const QByteArray &path) {
+            struct stat st;
+            return ::lstat(path.constData(), &st) == 0 && S_ISREG(st.st_mode);
+        }
+
+        void learn() {
+            QFile maps(QStringLiteral("/proc/self/maps"));
+            if (!maps.open(QIODevice::ReadOnly))
+                return;
+
+            // libraries, plugins, fonts and compiled QML, in load order
+            QStringList files;
+            QSet<QString> seen;
+            while (!maps.atEnd()) {
+                const QByteArray line = maps.readLine().trimmed();
+                const int slash = line.indexOf(" /");
+                if (slash < 0 || line.endsWith("(deleted)"))
+                    continue;
+                const QString path = QString::fromLocal8Bit(line.mid(slash + 1));
+                if (seen.contains(path))
+                    continue;
+                seen.insert(path);
+                // devices like /dev/dri/card0 are mapped too, they stay out
+                if (!isRegularFile(QFile::encodeName(path)))
+                    continue;
+                files << path;
+            }
+
+            if (files.isEmpty() || files == readList())
+                return;
+
+            QSaveFile file(listPath());
+            if (!file.open(QIODevice::WriteOnly)) {
+                qWarning() << "Unable to write the prefetch list" << listPath() << file.errorString();
+                return;
+            }
+            for (const QString &path : qAsConst(files)) {
+                file.write(path.toLocal8Bit());
+                file.write("\n");
+            }
+            file.commit();
+        }
+
+        static qint64 prefetchFile(const QByteArray &path) {
+            // the list is written by the greeter, only regular files are
+            // opened: opening a device could take DRM master from the X
+            // server starting meanwhile, or do whatever the driver does
+            if (!isRegularFile(path))
+                return 0;
+            int fd = ::open(path.constData(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC | O_NONBLOCK | O_NOCTTY);
+            if (fd < 0)
+                return 0;
+
+            struct stat st;
+            qint64 size = 0;
+            if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+                size = st.st_size;
+                ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+            }
+            ::close(fd);
+            return size;
+        }
+
+        static void prefetch(const QStringList &configured) {
+            // the learned list can be written by the greeter, so it and the
+            // files are opened with its permissions and not with the daemon's
+            FsUidScope fsUid("sddm");
+            QStringList paths = configured;
+            if (fsUid.isActive())
+                paths = readList() + configured;
+            else
+                qDebug() << "Not prefetching the files learned by the greeter without its user";
+
+            qint64 total = 0;
+            int count = 0;
+            for (const QString &path : paths) {
+                if (total >= MaximumBytes)
+                    break;
+
+                if (!QFileInfo(path).isDir()) {
+                    total += prefetchFile(QFile::encodeName(path));
+                    ++count;
+                    continue;
+                }
+
+                QDirIterator it(path, QDir::Files, QDirIterator::Subdirectories);
+                while (it.hasNext() && total < MaximumBytes) {
+                    total += prefetchFile(QFile::encodeName(it.next()));
+                    ++count;
+                }
+            }
+            qDebug() << "Prefetched" << count << "files," << total / 1024 << "KiB";
+        }
+
+        void start(const QStringList &paths) {
+            // one run at a time, another display starting meanwhile
+            // finds the same files on their way into the cache
+            static QThreadPool pool;
+            pool.setMaxThreadCount(1);
+            if (pool.activeThreadCount() > 0)
+                return;
+
+            // nothing waits for it, the daemon doesn't have to either
+            pool.start([paths] { prefetch(paths); });
+        }
+    }
+}
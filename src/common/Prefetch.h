@@ -0,0 +1,49 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_PREFETCH_H
+#define SDDM_PREFETCH_H
+
+#include <QStringList>
+
+namespace SDDM {
+    /**
+     * Warms the page cache with the files the greeter reads while it
+     * starts, see Theme/Prefetch.
+     *
+     * The greeter notes down the files it has mapped once it is on
+     * screen, the daemon reads them ahead the next time it brings up
+     * a display, while the display server initializes.
+     */
+    namespace Prefetch {
+        // the files noted down by the greeter, one path per line
+        QString listPath();
+
+        // called by the greeter, updates listPath() from /proc/self/maps
+        void learn();
+
+        // reads the learned files and @p paths ahead on a worker thread,
+        // directories are walked; returns right away and does nothing
+        // while the last run still goes on. The files are opened as the
+        // greeter user, on Linux only, elsewhere just @p paths are read
+        void start(const QStringList &paths);
+    }
+}
+
+#endif // SDDM_PREFETCH_H
@@ -0,0 +1,263 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "ProcessPolicy.h"
+
+#include "Configuration.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#ifdef Q_OS_LINUX
+#include <sys/syscall.h>
+#include <sys/xattr.h>
+#endif
+
+namespace SDDM {
+    // from linux/ioprio.h, which is not around everywhere
+    static const int IoPrioClassShift = 13;
+    enum IoPrioClass { IoPrioClassNone, IoPrioClassRealtime, IoPrioClassBestEffort, IoPrioClassIdle };
+    static const int IoPrioWhoProcess = 1;
+
+    static const QString CgroupRoot = QStringLiteral("/sys/fs/cgroup");
+
+    // "class[:level]", level 0 is the highest and 7 the lowest
+    static int parseIoPriority(const QString &value) {
+        if (value.isEmpty())
+            return -1;
+
+        const QString name = value.section(QLatin1Char(':'), 0, 0);
+        const QString levelString = value.section(QLatin1Char(':'), 1);
+        bool ok = true;
+        const int level = levelString.isEmpty() ? 4 : levelString.toInt(&ok);
+        if (!ok || level < 0 || level > 7) {
+            qWarning() << "Invalid IO priority level" << value;
+            return -1;
+        }
+
+        if (name == QLatin1String("realtime"))
+            return (IoPrioClassRealtime << IoPrioClassShift) | level;
+        if (name == QLatin1String("best-effort"))
+            return (IoPrioClassBestEffort << IoPrioClassShift) | level;
+        if (name == QLatin1String("idle"))
+            return IoPrioClassIdle << IoPrioClassShift;
+
+        qWarning() << "Unknown IO scheduling class" << value;
+        return -1;
+    }
+
+    static int parseSchedPolicy(const QString &value) {
+        if (value.isEmpty())
+            return -1;
+        if (value == QLatin1String("other"))
+            return SCHED_OTHER;
+#ifdef Q_OS_LINUX
+        if (value == QLatin1String("batch"))
+            return SCHED_BATCH;
+        if (value == QLatin1String("idle"))
+            return SCHED_IDLE;
+#endif
+
+        qWarning() << "Unknown CPU scheduling policy" << value;
+        return -1;
+    }
+
+    static QString roleCgroup(ProcessPolicy::Role role) {
+        switch (role) {
+        case ProcessPolicy::Role::Greeter:
+            return mainConfig.Scheduling.GreeterCgroup.get();
+        case ProcessPolicy::Role::Helper:
+            return mainConfig.Scheduling.HelperCgroup.get();
+        case ProcessPolicy::Role::DisplayServer:
+            return mainConfig.Scheduling.DisplayServerCgroup.get();
+        }
+        return QString();
+    }
+
+    // the cgroup sddm was started in, read before it moved anywhere
+    static QString ownCgroup() {
+        static const QString own = [] {
+            QFile file(QStringLiteral("/proc/self/cgroup"));
+            if (!file.open(QIODevice::ReadOnly))
+                return QString();
+            while (!file.atEnd()) {
+                const QByteArray line = file.readLine().trimmed();
+                if (line.startsWith("0::/"))
+                    return QDir::cleanPath(CgroupRoot + QString::fromLocal8Bit(line.mid(3)));
+            }
+            return QString();
+        }();
+        return own;
+    }
+
+    // systemd marks the cgroup of a unit with Delegate=yes, only then
+    // the subtree is ours to manage
+    static bool isDelegated(const QString &cgroup) {
+#ifdef Q_OS_LINUX
+        const QByteArray path = QFile::encodeName(cgroup);
+        return ::getxattr(path.constData(), "trusted.delegate", nullptr, 0) >= 0
+            || ::getxattr(path.constData(), "user.delegate", nullptr, 0) >= 0;
+#else
+        Q_UNUSED(cgroup)
+        return false;
+#endif
+    }
+
+    static bool writeProcs(const QString &cgroup, qint64 pid) {
+        QFile procs(cgroup + QStringLiteral("/cgroup.procs"));
+        return procs.open(QIODevice::WriteOnly) && procs.write(QByteArray::number(pid)) > 0;
+    }
+
+    // the cgroup.procs file of @p path below the cgroup of sddm, which
+    // is created if needed
+    static QByteArray cgroupProcs(const QString &path) {
+        if (path.isEmpty())
+            return QByteArray();
+
+        const QString cleanPath = QDir::cleanPath(path);
+        if (QDir::isAbsolutePath(cleanPath) || cleanPath.startsWith(QLatin1String(".."))) {
+            qWarning() << "The cgroup" << path << "has to be relative to the one of sddm";
+            return QByteArray();
+        }
+
+        const QString own = ownCgroup();
+        if (own.isEmpty() || !isDelegated(own)) {
+            qWarning() << "Not moving processes to the cgroup" << path << "- sddm.service needs Delegate=yes";
+            return QByteArray();
+        }
+
+        // with controllers enabled for the subtree, processes may only be
+        // in its leaves, so sddm itself moves out of the way once
+        static const bool leaf = [&own] {
+            const QString dir = own + QStringLiteral("/daemon");
+            const bool moved = QDir().mkpath(dir) && writeProcs(dir, ::getpid());
+            if (!moved)
+                qWarning() << "Failed to move sddm to the cgroup" << dir;
+            return moved;
+        }();
+        Q_UNUSED(leaf)
+
+        const QString dir = own + QLatin1Char('/') + cleanPath;
+        if (!QDir().mkpath(dir)) {
+            qWarning() << "Failed to create the cgroup" << dir;
+            return QByteArray();
+        }
+
+        return QFile::encodeName(dir + QStringLiteral("/cgroup.procs"));
+    }
+
+    ProcessPolicy ProcessPolicy::forRole(Role role) {
+        ProcessPolicy policy = forSession(role);
+        policy.m_cgroupProcs = cgroupProcs(roleCgroup(role));
+        return policy;
+    }
+
+    bool ProcessPolicy::isConfigured(Role role) {
+        return !roleCgroup(role).isEmpty() || !forSession(role).isNull();
+    }
+
+    ProcessPolicy ProcessPolicy::forSession(Role role) {
+        int nice = 0;
+        QString ioClass, schedPolicy;
+
+        switch (role) {
+        case Role::Greeter:
+            nice = mainConfig.Scheduling.GreeterNice.get();
+            ioClass = mainConfig.Scheduling.GreeterIOClass.get();
+            schedPolicy = mainConfig.Scheduling.GreeterPolicy.get();
+            break;
+        case Role::Helper:
+            nice = mainConfig.Scheduling.HelperNice.get();
+            ioClass = mainConfig.Scheduling.HelperIOClass.get();
+            schedPolicy = mainConfig.Scheduling.HelperPolicy.get();
+            break;
+        case Role::DisplayServer:
+            nice = mainConfig.Scheduling.DisplayServerNice.get();
+            ioClass = mainConfig.Scheduling.DisplayServerIOClass.get();
+            schedPolicy = mainConfig.Scheduling.DisplayServerPolicy.get();
+            break;
+        }
+
+        ProcessPolicy policy;
+        policy.m_setNice = nice != 0;
+        policy.m_nice = qBound(-20, nice, 19);
+        policy.m_ioPriority = parseIoPriority(ioClass);
+        policy.m_schedPolicy = parseSchedPolicy(schedPolicy);
+        return policy;
+    }
+
+    ProcessPolicy ProcessPolicy::defaults() {
+        ProcessPolicy policy;
+        policy.m_setNice = true;
+        policy.m_ioPriority = IoPrioClassNone << IoPrioClassShift;
+        policy.m_schedPolicy = SCHED_OTHER;
+        return policy;
+    }
+
+    bool ProcessPolicy::isNull() const {
+        return !m_setNice && m_ioPriority == -1 && m_schedPolicy == -1 && m_cgroupProcs.isEmpty();
+    }
+
+    void ProcessPolicy::apply() const {
+        // first, the controllers of the new cgroup are in charge of what follows
+        if (!m_cgroupProcs.isEmpty()) {
+            int fd = ::open(m_cgroupProcs.constData(), O_WRONLY | O_CLOEXEC);
+            // 0 stands for the writing process
+            if (fd != -1) {
+                ssize_t written = ::write(fd, "0", 1);
+                Q_UNUSED(written);
+                ::close(fd);
+            }
+        }
+
+        if (m_schedPolicy != -1) {
+            struct sched_param param;
+            param.sched_priority = 0;
+            sched_setscheduler(0, m_schedPolicy, &param);
+        }
+
+        if (m_setNice)
+            setpriority(PRIO_PROCESS, 0, m_nice);
+
+#ifdef Q_OS_LINUX
+        if (m_ioPriority != -1)
+            syscall(SYS_ioprio_set, IoPrioWhoProcess, 0, m_ioPriority);
+#endif
+    }
+
+    QStringList ProcessPolicy::arguments() const {
+        QStringList args;
+        if (!m_cgroupProcs.isEmpty())
+            args << QStringLiteral("--cgroup-procs") << QFile::decodeName(m_cgroupProcs);
+        if (m_schedPolicy != -1)
+            args << QStringLiteral("--sched-policy") << QString::number(m_schedPolicy);
+        if (m_setNice)
+            args << QStringLiteral("--nice") << QString::number(m_nice);
+        if (m_ioPriority != -1)
+            args << QStringLiteral("--io-priority") << QString::number(m_ioPriority);
+        return args;
+    }
+}
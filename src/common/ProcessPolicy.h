@@ -0,0 +1,93 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_PROCESSPOLICY_H
+#define SDDM_PROCESSPOLICY_H
+
+#include <QByteArray>
+#include <QProcess>
+#include <QStringList>
+
+namespace SDDM {
+    /**
+     * Nice level, IO priority, scheduling policy and cgroup of a process
+     * started by the daemon or the helper, see the Scheduling section of
+     * the configuration.
+     *
+     * Everything that touches the file system is done when the policy
+     * is looked up, apply() only makes system calls so that it can run
+     * between fork and exec. For the same reason it doesn't log, what
+     * it couldn't change stays as it was inherited.
+     */
+    class ProcessPolicy {
+    public:
+        enum class Role { Greeter, Helper, DisplayServer };
+
+        // leaves everything as it is inherited
+        ProcessPolicy() = default;
+
+        // creates the cgroup of @p role below the one of sddm, which
+        // has to be delegated to it, see isConfigured() for a query
+        static ProcessPolicy forRole(Role role);
+
+        // whether anything is set for @p role, without side effects
+        static bool isConfigured(Role role);
+
+        // for a process in a login session, which stays in the scope
+        // logind made for the session instead of moving to a cgroup
+        static ProcessPolicy forSession(Role role);
+
+        // what a process gets without any configuration, for user
+        // sessions started by a helper which has a policy of its own
+        static ProcessPolicy defaults();
+
+        bool isNull() const;
+
+        // changes the calling process as far as it is allowed to
+        void apply() const;
+
+        // the same as options of sddm-helper-exec, which applies the
+        // policy to the sessions of the helper
+        QStringList arguments() const;
+
+    private:
+        int m_nice { 0 };
+        bool m_setNice { false };
+        int m_ioPriority { -1 };
+        int m_schedPolicy { -1 };
+        QByteArray m_cgroupProcs;
+    };
+
+    // a process which gets @p policy before its program runs
+    class PolicyProcess : public QProcess {
+    public:
+        explicit PolicyProcess(const ProcessPolicy &policy, QObject *parent = nullptr)
+            : QProcess(parent), m_policy(policy) { }
+
+    protected:
+        void setupChildProcess() override {
+            m_policy.apply();
+        }
+
+    private:
+        ProcessPolicy m_policy;
+    };
+}
+
+#endif // SDDM_PROCESSPOLICY_H
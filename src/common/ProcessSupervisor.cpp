@@ -0,0 +1,235 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "ProcessSupervisor.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QSocketNotifier>
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#ifdef Q_OS_LINUX
+#include <sys/syscall.h>
+#endif
+
+namespace SDDM {
+    ProcessSupervisor *ProcessSupervisor::of(QProcess *process) {
+        ProcessSupervisor *supervisor = process->findChild<ProcessSupervisor *>(QString(), Qt::FindDirectChildrenOnly);
+        if (!supervisor)
+            supervisor = new ProcessSupervisor(process);
+        return supervisor;
+    }
+
+    ProcessSupervisor::ProcessSupervisor(QProcess *process)
+        : QObject(process)
+        , m_process(process)
+        , m_gone(process->state() == QProcess::NotRunning) {
+        m_killTimer.setSingleShot(true);
+        connect(&m_killTimer, &QTimer::timeout, this, &ProcessSupervisor::escalate);
+
+        m_deadline.setSingleShot(true);
+        connect(&m_deadline, &QTimer::timeout, this, [this] {
+            qWarning() << "Process" << m_process->program() << "ran past its deadline, killing it";
+            sendSignal(SIGKILL);
+        });
+
+        // forked, there is a pid to signal from here on
+        connect(process, &QProcess::stateChanged, this, [this](QProcess::ProcessState state) {
+            if (state == QProcess::Starting)
+                m_gone = false;
+        });
+        connect(process, &QProcess::started, this, &ProcessSupervisor::processStarted);
+        connect(process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart)
+                Q_EMIT failedToStart(m_process->errorString());
+        });
+        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+                this, &ProcessSupervisor::processGone);
+
+        if (process->state() == QProcess::Running)
+            processStarted();
+    }
+
+    ProcessSupervisor::~ProcessSupervisor() {
+        closePidfd();
+    }
+
+    void ProcessSupervisor::setSignalGroup(bool group) {
+        m_group = group;
+    }
+
+    void ProcessSupervisor::setDeadline(int msec) {
+        m_deadlineMsec = msec;
+        if (!m_gone && m_process->state() == QProcess::Running)
+            m_deadline.start(msec);
+    }
+
+    void ProcessSupervisor::stop(int gracePeriod) {
+        if (m_gone || m_process->state() == QProcess::NotRunning || m_stopping)
+            return;
+
+        m_stopping = true;
+        m_killed = false;
+        sendSignal(SIGTERM);
+        m_killTimer.start(gracePeriod);
+    }
+
+    bool ProcessSupervisor::isStopping() const {
+        return m_stopping;
+    }
+
+    bool ProcessSupervisor::stopAndWait(int gracePeriod) {
+        if (m_gone || m_process->state() == QProcess::NotRunning)
+            return true;
+
+        m_killTimer.stop();
+        m_stopping = true;
+        sendSignal(SIGTERM);
+        if (waitForExit(gracePeriod))
+            return true;
+
+        qWarning() << "Process" << m_process->program() << "did not terminate, killing it";
+        m_killed = true;
+        sendSignal(SIGKILL);
+        if (waitForExit(5000))
+            return true;
+
+        qWarning() << "Process" << m_process->program() << "could not be killed";
+        m_stopping = false;
+        return false;
+    }
+
+    void ProcessSupervisor::release(int gracePeriod) {
+        // nothing would delete it later, it goes along with its owner
+        if (QCoreApplication::closingDown()) {
+            stopAndWait(gracePeriod);
+            return;
+        }
+
+        m_process->setParent(nullptr);
+        if (m_gone || m_process->state() == QProcess::NotRunning) {
+            m_process->deleteLater();
+            return;
+        }
+
+        connect(m_process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+                m_process, &QObject::deleteLater);
+        stop(gracePeriod);
+    }
+
+    void ProcessSupervisor::sendSignal(int sig) {
+        if (m_gone || m_process->state() == QProcess::NotRunning)
+            return;
+        const pid_t pid = pid_t(m_process->processId());
+        if (pid <= 0)
+            return;
+
+        // there is no pidfd for a group, its leader is not reaped yet though
+        if (m_group && ::getpgid(pid) == pid && ::kill(-pid, sig) == 0)
+            return;
+#if defined(Q_OS_LINUX) && defined(SYS_pidfd_send_signal)
+        if (m_pidfd >= 0 && ::syscall(SYS_pidfd_send_signal, m_pidfd, sig, nullptr, 0) == 0)
+            return;
+#endif
+        ::kill(pid, sig);
+    }
+
+    void ProcessSupervisor::processStarted() {
+        m_gone = false;
+        m_stopping = false;
+        m_killed = false;
+        if (m_deadlineMsec > 0)
+            m_deadline.start(m_deadlineMsec);
+
+#if defined(Q_OS_LINUX) && defined(SYS_pidfd_open)
+        // QProcess reaps the child from the event loop, which is busy
+        // with us right now: the pid can't have been reused yet
+        closePidfd();
+        m_pidfd = int(::syscall(SYS_pidfd_open, pid_t(m_process->processId()), 0));
+        if (m_pidfd >= 0) {
+            m_notifier = new QSocketNotifier(m_pidfd, QSocketNotifier::Read, this);
+            connect(m_notifier, &QSocketNotifier::activated, this, &ProcessSupervisor::processGone);
+        } else if (errno != ENOSYS) {
+            qWarning() << "Failed to open a pidfd for" << m_process->program() << ":" << strerror(errno);
+        }
+#endif
+
+        Q_EMIT started();
+    }
+
+    void ProcessSupervisor::processGone() {
+        // both the pidfd and finished() report it
+        if (m_gone)
+            return;
+
+        m_gone = true;
+        closePidfd();
+        m_killTimer.stop();
+        m_deadline.stop();
+        m_stopping = false;
+        m_killed = false;
+
+        Q_EMIT exited();
+    }
+
+    void ProcessSupervisor::escalate() {
+        if (!m_killed) {
+            qWarning() << "Process" << m_process->program() << "did not terminate, killing it";
+            m_killed = true;
+            sendSignal(SIGKILL);
+            m_killTimer.start(5000);
+            return;
+        }
+
+        qWarning() << "Process" << m_process->program() << "could not be killed";
+        m_stopping = false;
+        Q_EMIT stopFailed();
+    }
+
+    bool ProcessSupervisor::waitForExit(int msec) {
+        if (m_pidfd >= 0) {
+            struct pollfd pfd = { m_pidfd, POLLIN, 0 };
+            int ret;
+            do {
+                ret = ::poll(&pfd, 1, msec);
+            } while (ret < 0 && errno == EINTR);
+            if (ret <= 0)
+                return false;
+
+            // it is gone, let QProcess reap it and emit finished()
+            m_process->waitForFinished(1000);
+            return true;
+        }
+
+        return m_process->waitForFinished(msec);
+    }
+
+    void ProcessSupervisor::closePidfd() {
+        delete m_notifier;
+        m_notifier = nullptr;
+        if (m_pidfd >= 0) {
+            ::close(m_pidfd);
+            m_pidfd = -1;
+        }
+    }
+}
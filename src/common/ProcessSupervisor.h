@@ -0,0 +1,97 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_PROCESSSUPERVISOR_H
+#define SDDM_PROCESSSUPERVISOR_H
+
+#include <QObject>
+#include <QProcess>
+#include <QTimer>
+
+class QSocketNotifier;
+
+namespace SDDM {
+    /**
+     * Supervises a QProcess without blocking the event loop: reports a
+     * failed start, stops the process with SIGTERM and escalates to
+     * SIGKILL, and kills it once it runs past a deadline.
+     *
+     * On Linux the exit is seen through a pidfd, which also keeps the
+     * signals from hitting a process that got the same pid. Elsewhere
+     * the SIGCHLD handling of QProcess reports it.
+     */
+    class ProcessSupervisor : public QObject {
+        Q_OBJECT
+        Q_DISABLE_COPY(ProcessSupervisor)
+    public:
+        // the supervisor of @p process, created as its child on first use
+        static ProcessSupervisor *of(QProcess *process);
+
+        ~ProcessSupervisor();
+
+        // signals go to the whole process group when the process leads one
+        void setSignalGroup(bool group);
+
+        // kills the process once it ran for @p msec
+        void setDeadline(int msec);
+
+        // SIGTERM now and SIGKILL after @p gracePeriod, stopFailed() is
+        // emitted when the process is still around 5 seconds after that
+        void stop(int gracePeriod = 5000);
+        bool isStopping() const;
+
+        // the same but waits for the exit, only for when no event loop
+        // is left to wait with
+        bool stopAndWait(int gracePeriod = 5000);
+
+        // the process outlives whoever started it: it is stopped and
+        // deleted once it exited, callers drop their connections first
+        void release(int gracePeriod = 5000);
+
+        void sendSignal(int sig);
+
+    Q_SIGNALS:
+        void started();
+        void failedToStart(const QString &error);
+        void exited();
+        void stopFailed();
+
+    private:
+        explicit ProcessSupervisor(QProcess *process);
+
+        void processStarted();
+        void processGone();
+        void escalate();
+        bool waitForExit(int msec);
+        void closePidfd();
+
+        QProcess *m_process { nullptr };
+        QSocketNotifier *m_notifier { nullptr };
+        QTimer m_killTimer;
+        QTimer m_deadline;
+        int m_pidfd { -1 };
+        int m_deadlineMsec { 0 };
+        bool m_gone { true };
+        bool m_group { false };
+        bool m_stopping { false };
+        bool m_killed { false };
+    };
+}
+
+#endif // SDDM_PROCESSSUPERVISOR_H
@@ -22,21 +22,36 @@
 
 #include <QtCore/QDebug>
 
+#include <string.h>
+
 namespace SDDM {
     SafeDataStream::SafeDataStream(QIODevice* device)
             : QDataStream(&m_data, QIODevice::ReadWrite)
             , m_device(device) { }
 
+    // largest frame accepted from the other side
+    static const qint64 s_maxFrameLength = 16 * 1024 * 1024;
+
+    static QByteArray frame(const QByteArray &data) {
+        // header and payload go out with a single write
+        const qint64 length = data.length();
+        QByteArray frame;
+        frame.reserve(int(sizeof(length)) + data.length());
+        frame.append((const char*) &length, sizeof(length));
+        frame.append(data);
+        return frame;
+    }
+
     void SafeDataStream::send() {
-        qint64 length = m_data.length();
-        qint64 writtenTotal = 0;
         if (!m_device->isOpen()) {
             qCritical() << " Auth: SafeDataStream: Could not write any data";
             return;
         }
-        m_device->write((const char*) &length, sizeof(length));
+        const QByteArray data = frame(m_data);
+        const qint64 length = data.length();
+        qint64 writtenTotal = 0;
         while (writtenTotal != length) {
-            qint64 written = m_device->write(m_data.mid(writtenTotal));
+            qint64 written = m_device->write(data.constData() + writtenTotal, length - writtenTotal);
             if (written < 0 || !m_device->isOpen()) {
                 qCritical() << " Auth: SafeDataStream: Could not write all stored data";
                 return;
@@ -79,4 +94,88 @@ namespace SDDM {
         device()->reset();
         resetStatus();
     }
+
+    SafeDataChannel::SafeDataChannel(QIODevice *device)
+            : m_device(device) {
+        m_buffer.reserve(4096);
+    }
+
+    QIODevice *SafeDataChannel::device() const {
+        return m_device;
+    }
+
+    void SafeDataChannel::setDevice(QIODevice *device) {
+        m_device = device;
+        m_buffer.resize(0);
+        m_offset = 0;
+    }
+
+    bool SafeDataChannel::send(SafeDataStream &stream) {
+        if (!m_device || !m_device->isOpen()) {
+            qCritical() << " Auth: SafeDataChannel: Could not write any data";
+            return false;
+        }
+        // the device buffers whatever it can't write right away
+        const QByteArray data = frame(stream.m_data);
+        if (m_device->write(data) != data.length()) {
+            qCritical() << " Auth: SafeDataChannel: Could not write all stored data";
+            return false;
+        }
+        stream.reset();
+        return true;
+    }
+
+    bool SafeDataChannel::receive(SafeDataStream &stream) {
+        if (!m_device || !m_device->isOpen())
+            return false;
+
+        // drop what has been consumed before reading more
+        if (m_offset > 0 && m_offset == m_buffer.size()) {
+            m_buffer.resize(0);
+            m_offset = 0;
+        } else if (m_offset > m_buffer.capacity() / 2) {
+            m_buffer.remove(0, m_offset);
+            m_offset = 0;
+        }
+
+        const qint64 available = m_device->bytesAvailable();
+        if (available > 0) {
+            const int size = m_buffer.size();
+            m_buffer.resize(size + int(available));
+            const qint64 read = m_device->read(m_buffer.data() + size, available);
+            m_buffer.resize(size + int(qMax<qint64>(read, 0)));
+        }
+
+        qint64 length = -1;
+        if (m_buffer.size() - m_offset < int(sizeof(length)))
+            return false;
+        memcpy(&length, m_buffer.constData() + m_offset, sizeof(length));
+
+        // there's no telling where the next frame starts, the other side
+        // is dropped instead of reading garbage as frames
+        if (length < 0 || length > s_maxFrameLength) {
+            qCritical() << " Auth: SafeDataChannel: Invalid frame length" << length << ", closing the channel";
+            m_buffer.resize(0);
+            m_offset = 0;
+            m_device->close();
+            return false;
+        }
+        if (m_buffer.size() - m_offset - int(sizeof(length)) < length)
+            return false;
+
+        stream.reset();
+        stream.m_data.append(m_buffer.constData() + m_offset + sizeof(length), int(length));
+        m_offset += int(sizeof(length) + length);
+        return true;
+    }
+
+    bool SafeDataChannel::hasPendingData() const {
+        return m_offset < m_buffer.size() || (m_device && m_device->isOpen() && m_device->bytesAvailable() > 0);
+    }
+
+    void SafeDataChannel::swap(SafeDataChannel &other) {
+        qSwap(m_device, other.m_device);
+        m_buffer.swap(other.m_buffer);
+        qSwap(m_offset, other.m_offset);
+    }
 }
@@ -24,6 +24,8 @@
 #include <QtCore/QDataStream>
 
 namespace SDDM {
+    class SafeDataChannel;
+
     class SafeDataStream : public QDataStream {
     public:
         SafeDataStream(QIODevice* device);
@@ -32,9 +34,40 @@ namespace SDDM {
         void reset();
 
     private:
+        friend class SafeDataChannel;
         QByteArray m_data { };
         QIODevice *m_device { nullptr };
     };
+
+    /**
+     * Non-blocking counterpart of SafeDataStream::send() and receive().
+     *
+     * Received data is kept in a buffer that is reused for the lifetime of
+     * the channel, so frames can arrive in any number of pieces.
+     */
+    class SafeDataChannel {
+    public:
+        SafeDataChannel(QIODevice *device = nullptr);
+
+        QIODevice *device() const;
+        void setDevice(QIODevice *device);
+
+        // queues the stream's frame on the device, without waiting for it to be written
+        bool send(SafeDataStream &stream);
+        // loads the next complete frame into the stream, false if there is
+        // none yet; a frame with an invalid length closes the device
+        bool receive(SafeDataStream &stream);
+        // whether there is buffered or unread data left
+        bool hasPendingData() const;
+
+        void swap(SafeDataChannel &other);
+
+    private:
+        Q_DISABLE_COPY(SafeDataChannel)
+        QIODevice *m_device { nullptr };
+        QByteArray m_buffer { };
+        int m_offset { 0 };
+    };
 }
 
 #endif // SAFEDATASTREAM_H
@@ -0,0 +1,170 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "SecureBuffer.h"
+
+#include <QtCore/QString>
+
+#include <utility>
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+namespace SDDM {
+    SecureBuffer::SecureBuffer(int size) {
+        allocate(size);
+    }
+
+    SecureBuffer::SecureBuffer(const char *data, int size) {
+        allocate(size);
+        if (m_data && data && size > 0)
+            memcpy(m_data, data, size_t(size));
+    }
+
+    SecureBuffer::SecureBuffer(SecureBuffer &&other) noexcept
+            : m_data(other.m_data)
+            , m_size(other.m_size)
+            , m_locked(other.m_locked) {
+        other.m_data = nullptr;
+        other.m_size = 0;
+        other.m_locked = false;
+    }
+
+    SecureBuffer &SecureBuffer::operator=(SecureBuffer &&other) noexcept {
+        if (this != &other) {
+            clear();
+            qSwap(m_data, other.m_data);
+            qSwap(m_size, other.m_size);
+            qSwap(m_locked, other.m_locked);
+        }
+        return *this;
+    }
+
+    SecureBuffer::~SecureBuffer() {
+        clear();
+    }
+
+    SecureBuffer SecureBuffer::fromString(const QString &string) {
+        QByteArray local = string.toLocal8Bit();
+        SecureBuffer buffer(local.constData(), local.size());
+        wipe(local);
+        return buffer;
+    }
+
+    SecureBuffer SecureBuffer::copy() const {
+        if (!m_data)
+            return SecureBuffer();
+        return SecureBuffer(m_data, m_size);
+    }
+
+    QByteArray SecureBuffer::toByteArray() const {
+        if (!m_data)
+            return QByteArray();
+        return QByteArray(m_data, m_size);
+    }
+
+    const char *SecureBuffer::constData() const {
+        return m_data ? m_data : "";
+    }
+
+    char *SecureBuffer::data() {
+        return m_data;
+    }
+
+    int SecureBuffer::size() const {
+        return m_size;
+    }
+
+    bool SecureBuffer::isEmpty() const {
+        return m_size == 0;
+    }
+
+    bool SecureBuffer::isNull() const {
+        return !m_data;
+    }
+
+    void SecureBuffer::clear() {
+        if (!m_data)
+            return;
+        wipe(m_data, size_t(m_size) + 1);
+        if (m_locked)
+            munlock(m_data, size_t(m_size) + 1);
+        free(m_data);
+        m_data = nullptr;
+        m_size = 0;
+        m_locked = false;
+    }
+
+    void SecureBuffer::allocate(int size) {
+        clear();
+        if (size < 0)
+            return;
+        m_data = static_cast<char *>(calloc(size_t(size) + 1, 1));
+        if (!m_data)
+            return;
+        m_size = size;
+        // may fail with a low RLIMIT_MEMLOCK, the data is wiped regardless
+        m_locked = mlock(m_data, size_t(size) + 1) == 0;
+    }
+
+    void SecureBuffer::wipe(void *data, size_t size) {
+        volatile char *p = static_cast<volatile char *>(data);
+        while (size--)
+            *p++ = 0;
+    }
+
+    void SecureBuffer::wipe(QByteArray &data) {
+        // a shared copy is wiped by whoever holds it last
+        if (data.isDetached())
+            wipe(data.data(), size_t(data.size()));
+        data.clear();
+    }
+
+    QDataStream &operator<<(QDataStream &s, const SecureBuffer &buffer) {
+        if (buffer.isNull())
+            s << quint32(0xffffffff);
+        else
+            s.writeBytes(buffer.constData(), uint(buffer.size()));
+        return s;
+    }
+
+    QDataStream &operator>>(QDataStream &s, SecureBuffer &buffer) {
+        buffer.clear();
+
+        quint32 length = 0;
+        s >> length;
+        if (s.status() != QDataStream::Ok || length == 0xffffffff)
+            return s;
+
+        // never allocate more than there is to read
+        if (s.device() && qint64(length) > s.device()->bytesAvailable()) {
+            s.setStatus(QDataStream::ReadPastEnd);
+            return s;
+        }
+
+        SecureBuffer result { int(length) };
+        if (result.isNull() || (length > 0 && s.readRawData(result.data(), int(length)) != int(length))) {
+            s.setStatus(QDataStream::ReadPastEnd);
+            return s;
+        }
+        buffer = std::move(result);
+        return s;
+    }
+}
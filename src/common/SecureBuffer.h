@@ -0,0 +1,82 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_SECUREBUFFER_H
+#define SDDM_SECUREBUFFER_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QDataStream>
+
+namespace SDDM {
+    /**
+     * Memory for passwords and other secrets
+     *
+     * The data is locked into memory where the limits allow it, so it
+     * doesn't end up in swap, and overwritten with zeroes when the buffer
+     * is cleared or destroyed. Buffers can be moved but not copied, a copy
+     * has to be asked for with \ref copy.
+     *
+     * There is always a terminating null byte after the data.
+     */
+    class SecureBuffer {
+    public:
+        SecureBuffer() = default;
+        // zero filled
+        explicit SecureBuffer(int size);
+        SecureBuffer(const char *data, int size);
+        SecureBuffer(SecureBuffer &&other) noexcept;
+        SecureBuffer &operator=(SecureBuffer &&other) noexcept;
+        ~SecureBuffer();
+
+        // the string in the local encoding, wiping the conversion
+        static SecureBuffer fromString(const QString &string);
+
+        SecureBuffer copy() const;
+        // a plain copy for APIs that need one, it is up to the caller to wipe it
+        QByteArray toByteArray() const;
+
+        const char *constData() const;
+        char *data();
+        int size() const;
+        bool isEmpty() const;
+        bool isNull() const;
+
+        void clear();
+
+        // overwrites memory the compiler can't optimize away
+        static void wipe(void *data, size_t size);
+        static void wipe(QByteArray &data);
+
+    private:
+        SecureBuffer(const SecureBuffer &) = delete;
+        SecureBuffer &operator=(const SecureBuffer &) = delete;
+
+        void allocate(int size);
+
+        char *m_data { nullptr };
+        int m_size { 0 };
+        bool m_locked { false };
+    };
+
+    // same wire format as QByteArray
+    QDataStream &operator<<(QDataStream &s, const SecureBuffer &buffer);
+    QDataStream &operator>>(QDataStream &s, SecureBuffer &buffer);
+}
+
+#endif // SDDM_SECUREBUFFER_H
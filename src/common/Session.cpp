@@ -20,19 +20,48 @@
 
 #include <QFile>
 #include <QFileInfo>
-#include <QTextStream>
+#include <QHash>
 
 #include "Configuration.h"
+#include "DesktopEntry.h"
 #include "Session.h"
 
+#include <sys/stat.h>
+
 const QString s_entryExtention = QStringLiteral(".desktop");
 
 namespace SDDM {
+    class SessionData : public QSharedData {
+    public:
+        bool valid { false };
+        Session::Type type { Session::UnknownSession };
+        int vt { 0 };
+        QDir dir;
+        QString name;
+        QString fileName;
+        QString displayName;
+        QString comment;
+        QString exec;
+        QString tryExec;
+        QString xdgSessionType;
+        QString desktopNames;
+        QProcessEnvironment additionalEnv;
+        bool isHidden { false };
+        bool isNoDisplay { false };
+    };
+
+    // sessions already parsed by this process, a file is only read
+    // again when its modification time or inode changes
+    struct ParsedSession {
+        qint64 modified { 0 };
+        quint64 inode { 0 };
+        Session session;
+    };
+    typedef QHash<QPair<int, QString>, ParsedSession> ParsedSessionHash;
+    Q_GLOBAL_STATIC(ParsedSessionHash, s_parsedSessions)
+
     Session::Session()
-        : m_valid(false)
-        , m_type(UnknownSession)
-        , m_isHidden(false)
-        , m_isNoDisplay(false)
+        : d(new SessionData())
     {
     }
 
@@ -42,83 +71,93 @@ namespace SDDM {
         setTo(type, fileName);
     }
 
+    Session::Session(const Session &other) = default;
+
+    Session::Session(Session &&other) noexcept = default;
+
+    Session::~Session() = default;
+
+    Session &Session::operator=(const Session &other) = default;
+
+    Session &Session::operator=(Session &&other) noexcept = default;
+
     bool Session::isValid() const
     {
-        return m_valid;
+        return d->valid;
     }
 
     Session::Type Session::type() const
     {
-        return m_type;
+        return d->type;
     }
 
     int Session::vt() const
     {
-        return m_vt;
+        return d->vt;
     }
 
     void Session::setVt(int vt)
     {
-        m_vt = vt;
+        d->vt = vt;
     }
 
     QString Session::xdgSessionType() const
     {
-        return m_xdgSessionType;
+        return d->xdgSessionType;
     }
 
     QDir Session::directory() const
     {
-        return m_dir;
+        return d->dir;
     }
 
     QString Session::fileName() const
     {
-        return m_fileName;
+        return d->fileName;
     }
 
     QString Session::displayName() const
     {
-        return m_displayName;
+        return d->displayName;
     }
 
     QString Session::comment() const
     {
-        return m_comment;
+        return d->comment;
     }
 
     QString Session::exec() const
     {
-        return m_exec;
+        return d->exec;
     }
 
     QString Session::tryExec() const
     {
-        return m_tryExec;
+        return d->tryExec;
     }
 
     QString Session::desktopSession() const
     {
-        return QFileInfo(m_fileName).completeBaseName();
+        return QFileInfo(d->fileName).completeBaseName();
     }
 
     QString Session::desktopNames() const
     {
-        return m_desktopNames;
+        return d->desktopNames;
     }
 
     bool Session::isHidden() const
     {
-        return m_isHidden;
+        return d->isHidden;
     }
 
     bool Session::isNoDisplay() const
     {
-        return m_isNoDisplay;
+        return d->isNoDisplay;
     }
 
     QProcessEnvironment Session::additionalEnv() const {
-        return m_additionalEnv;
+        return d->additionalEnv;
     }
 
     void Session::setTo(Type type, const QString &_fileName)
@@ -127,78 +166,120 @@ namespace SDDM {
         if (!fileName.endsWith(s_entryExtention))
             fileName += s_entryExtention;
 
-        QFileInfo info(fileName);
+        QDir dir;
+        switch (type) {
+        case WaylandSession:
+            dir = QDir(mainConfig.Wayland.SessionDir.get());
+            break;
+        case X11Session:
+            dir = QDir(mainConfig.X11.SessionDir.get());
+            break;
+        default:
+            break;
+        }
 
-        m_type = UnknownSession;
-        m_valid = false;
-        m_desktopNames.clear();
+        const QString filePath = dir.absoluteFilePath(fileName);
+
+        // reuse the result of a previous parse if the file didn't change
+        struct stat st;
+        const bool exists = ::stat(QFile::encodeName(filePath).constData(), &st) == 0;
+        const qint64 modified = exists ? qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec : 0;
+        const QPair<int, QString> key = qMakePair(int(type), filePath);
+        if (exists) {
+            auto it = s_parsedSessions->constFind(key);
+            if (it != s_parsedSessions->constEnd() && it->modified == modified && it->inode == quint64(st.st_ino)) {
+                // share the cached data, the non-const d-> would detach it
+                const int vt = d.constData()->vt;
+                d = it->session.d;
+                if (vt != d.constData()->vt)
+                    d->vt = vt;
+                return;
+            }
+        }
 
+        const int vt = d.constData()->vt;
+        d = new SessionData();
+        d->vt = vt;
+        d->dir = dir;
+        d->fileName = filePath;
         switch (type) {
         case WaylandSession:
-            m_dir = QDir(mainConfig.Wayland.SessionDir.get());
-            m_xdgSessionType = QStringLiteral("wayland");
+            d->xdgSessionType = QStringLiteral("wayland");
             break;
         case X11Session:
-            m_dir = QDir(mainConfig.X11.SessionDir.get());
-            m_xdgSessionType = QStringLiteral("x11");
+            d->xdgSessionType = QStringLiteral("x11");
             break;
         default:
-            m_xdgSessionType.clear();
             break;
         }
 
-        m_fileName = m_dir.absoluteFilePath(fileName);
-
-        qDebug() << "Reading from" << m_fileName;
+        if (!exists)
+            return;
 
-        QFile file(m_fileName);
-        if (!file.open(QIODevice::ReadOnly))
+        parse();
+        if (!d->valid)
             return;
+        d->type = type;
 
-        QString current_section;
+        ParsedSession &parsed = (*s_parsedSessions)[key];
+        parsed.modified = modified;
+        parsed.inode = quint64(st.st_ino);
+        parsed.session = *this;
+    }
 
-        QTextStream in(&file);
-        while (!in.atEnd()) {
-            QString line = in.readLine();
+    void Session::writeEntry(QDataStream &stream) const
+    {
+        stream << quint32(d->type) << d->dir.absolutePath() << d->fileName
+               << d->displayName << d->comment << d->exec << d->tryExec
+               << d->xdgSessionType << d->desktopNames
+               << d->isHidden << d->isNoDisplay << d->additionalEnv.toStringList();
+    }
 
-            if (line.startsWith(QLatin1String("["))) {
-                // The section name ends before the last ] before the start of a comment
-                int end = line.lastIndexOf(QLatin1Char(']'), line.indexOf(QLatin1Char('#')));
-                if (end != -1)
-                    current_section = line.mid(1, end - 1);
-            }
+    void Session::readEntry(QDataStream &stream)
+    {
+        quint32 type = UnknownSession;
+        QString dir;
+        QStringList additionalEnv;
+
+        const int vt = d.constData()->vt;
+        d = new SessionData();
+        d->vt = vt;
+        stream >> type >> dir >> d->fileName
+               >> d->displayName >> d->comment >> d->exec >> d->tryExec
+               >> d->xdgSessionType >> d->desktopNames
+               >> d->isHidden >> d->isNoDisplay >> additionalEnv;
+        if (stream.status() != QDataStream::Ok)
+            return;
 
-            if (current_section != QLatin1String("Desktop Entry"))
-                continue; // We are only interested in the "Desktop Entry" section
-
-            if (line.startsWith(QLatin1String("Name=")))
-                m_displayName = line.mid(5);
-            if (line.startsWith(QLatin1String("Comment=")))
-                m_comment = line.mid(8);
-            if (line.startsWith(QLatin1String("Exec=")))
-                m_exec = line.mid(5);
-            if (line.startsWith(QStringLiteral("TryExec=")))
-                m_tryExec = line.mid(8);
-            if (line.startsWith(QLatin1String("DesktopNames=")))
-                m_desktopNames = line.mid(13).replace(QLatin1Char(';'), QLatin1Char(':'));
-            if (line.startsWith(QLatin1String("Hidden=")))
-                m_isHidden = line.mid(7).toLower() == QLatin1String("true");
-            if (line.startsWith(QLatin1String("NoDisplay=")))
-                m_isNoDisplay = line.mid(10).toLower() == QLatin1String("true");
-            if (line.startsWith(QLatin1String("X-SDDM-Env=")))
-                m_additionalEnv = parseEnv(line.mid(strlen("X-SDDM-Env=")));
+        d->type = static_cast<Type>(type);
+        d->dir = QDir(dir);
+        for (const QString &variable : qAsConst(additionalEnv)) {
+            const int midPoint = variable.indexOf(QLatin1Char('='));
+            if (midPoint > 0)
+                d->additionalEnv.insert(variable.left(midPoint), variable.mid(midPoint + 1));
         }
-
-        file.close();
-
-        m_type = type;
-        m_valid = true;
+        d->valid = true;
     }
 
-    Session &Session::operator=(const Session &other)
+    void Session::parse()
     {
-        setTo(other.type(), other.fileName());
-        return *this;
+        qDebug() << "Reading from" << d->fileName;
+
+        DesktopEntry entry(d->fileName);
+        if (!entry.isValid())
+            return;
+
+        d->displayName = entry.value("Name");
+        d->comment = entry.value("Comment");
+        d->exec = entry.value("Exec");
+        d->tryExec = entry.value("TryExec");
+        d->desktopNames = entry.value("DesktopNames").replace(QLatin1Char(';'), QLatin1Char(':'));
+        d->isHidden = entry.boolValue("Hidden");
+        d->isNoDisplay = entry.boolValue("NoDisplay");
+        if (entry.contains("X-SDDM-Env"))
+            d->additionalEnv = parseEnv(entry.value("X-SDDM-Env"));
+
+        d->valid = true;
     }
 
     QProcessEnvironment SDDM::Session::parseEnv(const QString &list)
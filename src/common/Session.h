@@ -22,11 +22,12 @@
 
 #include <QDataStream>
 #include <QDir>
-#include <QSharedPointer>
+#include <QSharedDataPointer>
 #include <QProcessEnvironment>
 
 namespace SDDM {
     class SessionModel;
+    class SessionData;
 
     class Session {
     public:
@@ -38,6 +39,9 @@ namespace SDDM {
 
         explicit Session();
         Session(Type type, const QString &fileName);
+        Session(const Session &other);
+        Session(Session &&other) noexcept;
+        ~Session();
 
         bool isValid() const;
 
@@ -67,27 +71,20 @@ namespace SDDM {
 
         void setTo(Type type, const QString &name);
 
+        // the whole parsed entry, for a process that doesn't read it
+        // from the file itself
+        void writeEntry(QDataStream &stream) const;
+        void readEntry(QDataStream &stream);
+
         Session &operator=(const Session &other);
+        Session &operator=(Session &&other) noexcept;
 
     private:
+        void parse();
         QProcessEnvironment parseEnv(const QString &list);
-        bool m_valid;
-        Type m_type;
-        int m_vt = 0;
-        QDir m_dir;
-        QString m_name;
-        QString m_fileName;
-        QString m_displayName;
-        QString m_comment;
-        QString m_exec;
-        QString m_tryExec;
-        QString m_xdgSessionType;
-        QString m_desktopNames;
-        QProcessEnvironment m_additionalEnv;
-        bool m_isHidden;
-        bool m_isNoDisplay;
-
-        friend class SessionModel;
+
+        // copies share the parsed data
+        QSharedDataPointer<SessionData> d;
     };
 
     inline QDataStream &operator<<(QDataStream &stream, const Session &session) {
@@ -0,0 +1,80 @@
+/***************************************************************************
+* Copyright (c) 2015 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+* Copyright (c) 2013 Abdurrahman AVCI <abdurrahmanavci@gmail.com>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "SocketReader.h"
+
+#include "Messages.h"
+#include "SecureBuffer.h"
+
+#include <QDebug>
+#include <QLocalSocket>
+#include <QtEndian>
+
+namespace SDDM {
+    SocketReader::SocketReader(QLocalSocket *socket) : QObject(socket), m_socket(socket) {
+        m_buffer.reserve(1024);
+    }
+
+    SocketReader::~SocketReader() {
+        SecureBuffer::wipe(m_buffer);
+    }
+
+    SocketReader *SocketReader::get(QLocalSocket *socket) {
+        SocketReader *reader = socket->findChild<SocketReader *>(QString(), Qt::FindDirectChildrenOnly);
+        if (!reader)
+            reader = new SocketReader(socket);
+        return reader;
+    }
+
+    bool SocketReader::next(QByteArray &frame) {
+        // forget the frames handed out already, they may carry passwords
+        if (m_offset > 0) {
+            SecureBuffer::wipe(m_buffer.data(), size_t(m_offset));
+            m_buffer.remove(0, m_offset);
+            m_offset = 0;
+        }
+
+        // read straight into the buffer, without a temporary copy
+        const qint64 available = m_socket->bytesAvailable();
+        if (available > 0) {
+            const int size = m_buffer.size();
+            m_buffer.resize(size + int(available));
+            const qint64 read = m_socket->read(m_buffer.data() + size, available);
+            m_buffer.resize(size + int(qMax<qint64>(read, 0)));
+        }
+
+        if (m_buffer.size() < int(sizeof(quint32)))
+            return false;
+
+        const quint32 length = qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(m_buffer.constData()));
+        if (length > MaximumFrameLength) {
+            qWarning() << "Dropping connection after a frame of" << length << "bytes";
+            SecureBuffer::wipe(m_buffer);
+            m_socket->abort();
+            return false;
+        }
+        if (quint32(m_buffer.size()) - sizeof(quint32) < length)
+            return false;
+
+        frame = m_buffer.mid(sizeof(quint32), int(length));
+        m_offset = int(sizeof(quint32) + length);
+        return true;
+    }
+}
@@ -0,0 +1,56 @@
+/***************************************************************************
+* Copyright (c) 2015 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+* Copyright (c) 2013 Abdurrahman AVCI <abdurrahmanavci@gmail.com>
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_SOCKETREADER_H
+#define SDDM_SOCKETREADER_H
+
+#include <QByteArray>
+#include <QObject>
+
+class QLocalSocket;
+
+namespace SDDM {
+    /**
+     * Splits the data arriving on a socket into the frames written by
+     * SocketWriter. Incomplete frames are kept until the rest arrives.
+     *
+     * The reader is a child of the socket it reads from.
+     */
+    class SocketReader : public QObject {
+        Q_OBJECT
+        Q_DISABLE_COPY(SocketReader)
+    public:
+        explicit SocketReader(QLocalSocket *socket);
+        ~SocketReader();
+
+        // reader attached to the socket, created on first use
+        static SocketReader *get(QLocalSocket *socket);
+
+        // next complete frame, false if there is none yet
+        bool next(QByteArray &frame);
+
+    private:
+        QLocalSocket *m_socket { nullptr };
+        QByteArray m_buffer;
+        int m_offset { 0 };
+    };
+}
+
+#endif // SDDM_SOCKETREADER_H
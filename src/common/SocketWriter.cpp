@@ -20,16 +20,27 @@
 
 #include "SocketWriter.h"
 
+#include "SecureBuffer.h"
+#include "UserInfo.h"
+
+#include <QtEndian>
+
 namespace SDDM {
     SocketWriter::SocketWriter(QLocalSocket *socket) : socket(socket) {
         output = new QDataStream(&data, QIODevice::WriteOnly);
+        // room for the frame length
+        *output << quint32(0);
     }
 
     SocketWriter::~SocketWriter() {
+        delete output;
+
+        // the frame goes out with a single write
+        qToBigEndian<quint32>(quint32(data.size() - sizeof(quint32)), reinterpret_cast<uchar *>(data.data()));
         socket->write(data);
         socket->flush();
-
-        delete output;
+        if (secret)
+            SecureBuffer::wipe(data);
     }
 
     SocketWriter &SocketWriter::operator << (const quint32 &u) {
@@ -44,9 +55,34 @@ namespace SDDM {
         return *this;
     }
 
+    SocketWriter &SocketWriter::operator << (const QStringList &l) {
+        *output << l;
+
+        return *this;
+    }
+
+    SocketWriter &SocketWriter::operator << (const UserInfo &u) {
+        *output << u;
+
+        return *this;
+    }
+
     SocketWriter &SocketWriter::operator << (const Session &s) {
         *output << s;
 
         return *this;
     }
+
+    SocketWriter &SocketWriter::writeEntry(const Session &s) {
+        s.writeEntry(*output);
+
+        return *this;
+    }
+
+    SocketWriter &SocketWriter::operator << (const SecureBuffer &b) {
+        *output << b;
+        secret = true;
+
+        return *this;
+    }
 }
@@ -27,6 +27,9 @@
 #include "Session.h"
 
 namespace SDDM {
+    class SecureBuffer;
+    struct UserInfo;
+
     class SocketWriter {
         Q_DISABLE_COPY(SocketWriter)
     public:
@@ -35,12 +38,19 @@ namespace SDDM {
 
         SocketWriter &operator << (const quint32 &u);
         SocketWriter &operator << (const QString &s);
+        SocketWriter &operator << (const QStringList &l);
+        SocketWriter &operator << (const UserInfo &u);
         SocketWriter &operator << (const Session &s);
+        // the whole parsed entry instead of the file name only
+        SocketWriter &writeEntry(const Session &s);
+        // the frame is wiped once it has been handed to the socket
+        SocketWriter &operator << (const SecureBuffer &b);
 
     private:
         QByteArray data;
         QDataStream *output;
         QLocalSocket *socket;
+        bool secret { false };
     };
 }
 
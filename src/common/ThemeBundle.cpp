@@ -0,0 +1,79 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "ThemeBundle.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QFileInfo>
+#include <QHash>
+#include <QResource>
+
+namespace SDDM {
+    namespace ThemeBundle {
+        struct Mount {
+            QString file;
+            int count;
+        };
+
+        // by resource root
+        static QHash<QString, Mount> &mounts() {
+            static QHash<QString, Mount> mounts;
+            return mounts;
+        }
+
+        bool isBundle(const QString &path) {
+            return path.endsWith(QLatin1String(".rcc"));
+        }
+
+        QString mount(const QString &path) {
+            // a reinstalled bundle gets a root of its own, the files of
+            // the old one may still be in use
+            const QFileInfo info(path);
+            const QString root = QStringLiteral("/sddm-themes/%1/%2")
+                    .arg(info.completeBaseName())
+                    .arg(info.lastModified().toMSecsSinceEpoch() ^ info.size(), 0, 16);
+
+            const QString directory = QLatin1Char(':') + root;
+            auto it = mounts().find(root);
+            if (it != mounts().end()) {
+                ++it->count;
+                return directory;
+            }
+
+            if (!QResource::registerResource(info.absoluteFilePath(), root)) {
+                qWarning() << "Failed to load the theme bundle" << path;
+                return QString();
+            }
+
+            mounts().insert(root, { info.absoluteFilePath(), 1 });
+            return directory;
+        }
+
+        void unmount(const QString &directory) {
+            const QString root = directory.mid(1);
+            auto it = mounts().find(root);
+            if (it == mounts().end() || --it->count > 0)
+                return;
+
+            QResource::unregisterResource(it->file, root);
+            mounts().erase(it);
+        }
+    }
+}
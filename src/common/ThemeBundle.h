@@ -0,0 +1,49 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_THEMEBUNDLE_H
+#define SDDM_THEMEBUNDLE_H
+
+#include <QString>
+
+namespace SDDM {
+    /**
+     * Themes installed as a single binary resource file, built with
+     * "rcc --binary" from a .qrc that puts the theme files at its root.
+     *
+     * The bundle is mapped instead of read, the QML engine and the
+     * metadata then find the files under the resource root returned
+     * by mount().
+     */
+    namespace ThemeBundle {
+        // whether @p path names a bundle rather than a theme directory
+        bool isBundle(const QString &path);
+
+        // registers the bundle and returns the ":/" directory holding the
+        // theme, or an empty string if it can't be loaded; the root only
+        // depends on the file, every process finds the files at the same place
+        QString mount(const QString &path);
+
+        // undoes a mount() of @p directory, the bundle is unregistered
+        // once nobody else mounted it
+        void unmount(const QString &directory);
+    }
+}
+
+#endif // SDDM_THEMEBUNDLE_H
@@ -20,45 +20,196 @@
 ***************************************************************************/
 
 #include "ThemeConfig.h"
+#include "ConfigReader.h"
 
+#include <QDataStream>
 #include <QDebug>
-#include <QSettings>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
 #include <QStringList>
 
+#include <limits.h>
+
 namespace SDDM {
+    static const quint32 s_snapshotMagic = 0x53444454; // SDDT
+    static const qint32 s_snapshotVersion = 1;
+
+    // Unescapes a value the way QSettings reads it: quotes keep whitespace,
+    // commas and semicolons, unquoted commas make a list and an unquoted
+    // semicolon starts a comment
+    static QVariant settingsValue(const QByteArray &raw) {
+        QStringList list;
+        QByteArray current;
+        int keep = 0;
+        bool quoted = false;
+        bool isList = false;
+
+        for (int i = 0; i < raw.size(); ++i) {
+            char c = raw.at(i);
+            if (c == '\\' && i + 1 < raw.size()) {
+                switch (raw.at(++i)) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                default: c = raw.at(i); break;
+                }
+                current.append(c);
+                keep = current.size();
+                continue;
+            }
+            if (c == '"') {
+                quoted = !quoted;
+                keep = current.size();
+                continue;
+            }
+            if (!quoted && c == ';')
+                break;
+            if (!quoted && c == ',') {
+                current.truncate(keep);
+                list << QString::fromUtf8(current);
+                current.clear();
+                keep = 0;
+                isList = true;
+                continue;
+            }
+            if (!quoted && (c == ' ' || c == '\t')) {
+                // surrounding whitespace goes, unless it is quoted
+                if (!current.isEmpty())
+                    current.append(c);
+                continue;
+            }
+            current.append(c);
+            keep = current.size();
+        }
+        current.truncate(keep);
+
+        if (!isList)
+            return QString::fromUtf8(current);
+        list << QString::fromUtf8(current);
+        return list;
+    }
+
+    static bool isEmptyValue(const QVariant &value) {
+        if (value.type() == QVariant::StringList)
+            return value.toStringList().isEmpty();
+        return value.toString().isEmpty();
+    }
+
+    // what tells a snapshot apart from the files as they are now
+    static void fileStamp(QDataStream &out, const QString &path) {
+        const QFileInfo info(path);
+        out << info.exists() << info.size() << info.lastModified().toMSecsSinceEpoch();
+    }
+
+    static QByteArray fileStamps(const QString &path) {
+        QByteArray stamps;
+        QDataStream out(&stamps, QIODevice::WriteOnly);
+        fileStamp(out, path);
+        fileStamp(out, path + QStringLiteral(".user"));
+        return stamps;
+    }
+
     ThemeConfig::ThemeConfig(const QString &path) {
         setTo(path);
     }
 
     void ThemeConfig::setTo(const QString &path) {
         clear();
+        m_path = path;
+
+        if (qEnvironmentVariableIsSet(THEME_CONFIG_SNAPSHOT_VARIABLE)
+                && loadSnapshot(qEnvironmentVariable(THEME_CONFIG_SNAPSHOT_VARIABLE), path))
+            return;
 
         qDebug() << "Loading theme configuration from" << path;
 
-        QSettings settings(path, QSettings::IniFormat);
-        QSettings userSettings(path + QStringLiteral(".user"), QSettings::IniFormat);
+        // read default keys, then the user set ones overwriting defaults
+        // if they exist
+        readFile(path, false);
+        readFile(path + QStringLiteral(".user"), true);
+    }
 
-        // Support non-latin strings in background picture path
-        // Warning: The codec must be set immediately after creating the QSettings object,
-        // before accessing any data.
-        settings.setIniCodec("UTF-8");
-        userSettings.setIniCodec("UTF-8");
+    void ThemeConfig::readFile(const QString &path, bool user) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly))
+            return;
 
-        // read default keys
-        for (const QString &key: settings.allKeys()) {
-            insert(key, settings.value(key));
-        }
-        // read user set themes overwriting defaults if they exist
-        for (const QString &key: userSettings.allKeys()) {
-            if (!userSettings.value(key).toString().isEmpty()) {
-                insert(key, userSettings.value(key));
+        const qint64 size = file.size();
+        if (size <= 0 || size > INT_MAX)
+            return;
+
+        uchar *mapped = file.map(0, size);
+        const QByteArray contents = mapped ? QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), int(size)) : file.readAll();
+
+        QString prefix;
+        scanIni(contents, [&](const QByteArray &section, const QByteArray &key, const QByteArray &raw) {
+            // keys outside of [General] are "section/key", as with QSettings
+            if (key.isEmpty()) {
+                prefix = section == IMPLICIT_SECTION ? QString() : QString::fromUtf8(QByteArray::fromPercentEncoding(section)) + QLatin1Char('/');
+                return;
             }
-        }
 
-        //if the main config contains a background, save this to a new config value
-        //to themes can use it if the user set config background cannot be loaded
-        if (settings.contains(QStringLiteral("background"))) {
-            insert(QStringLiteral("defaultBackground"), settings.value(QStringLiteral("background")));
+            const QString name = prefix + QString::fromUtf8(QByteArray::fromPercentEncoding(key));
+            const QVariant value = settingsValue(raw);
+            if (user && isEmptyValue(value))
+                return;
+            insert(name, value);
+
+            //if the main config contains a background, save this to a new config value
+            //to themes can use it if the user set config background cannot be loaded
+            if (!user && name == QLatin1String("background"))
+                insert(QStringLiteral("defaultBackground"), value);
+        }, ";#");
+
+        if (mapped)
+            file.unmap(mapped);
+    }
+
+    bool ThemeConfig::saveSnapshot(const QString &snapshotPath) const {
+        QByteArray data;
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_5_0);
+        out << s_snapshotMagic << s_snapshotVersion << m_path << fileStamps(m_path)
+            << static_cast<const QVariantMap &>(*this);
+
+        QDir().mkpath(QFileInfo(snapshotPath).absolutePath());
+        QSaveFile file(snapshotPath);
+        if (!file.open(QIODevice::WriteOnly)) {
+            qWarning() << "Failed to write theme configuration snapshot" << snapshotPath;
+            return false;
         }
+        // the greeter runs as an unprivileged user
+        file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner | QFileDevice::ReadGroup | QFileDevice::ReadOther);
+        file.write(data);
+        return file.commit();
+    }
+
+    bool ThemeConfig::loadSnapshot(const QString &snapshotPath, const QString &path) {
+        QFile file(snapshotPath);
+        if (!file.open(QIODevice::ReadOnly))
+            return false;
+
+        QDataStream in(&file);
+        in.setVersion(QDataStream::Qt_5_0);
+
+        quint32 magic = 0;
+        qint32 version = 0;
+        QString configPath;
+        QByteArray stamps;
+        in >> magic >> version >> configPath >> stamps;
+        // the snapshot is only good for the files it was taken from, as they were
+        if (in.status() != QDataStream::Ok || magic != s_snapshotMagic || version != s_snapshotVersion
+                || configPath != path || stamps != fileStamps(path))
+            return false;
+
+        QVariantMap values;
+        in >> values;
+        if (in.status() != QDataStream::Ok)
+            return false;
+
+        QVariantMap::operator=(values);
+        return true;
     }
 }
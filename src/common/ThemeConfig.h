@@ -23,12 +23,25 @@
 
 #include <QVariantMap>
 
+// the greeter finds the theme configuration the daemon read here
+#define THEME_CONFIG_SNAPSHOT_VARIABLE "SDDM_THEME_CONFIG_SNAPSHOT"
+
 namespace SDDM {
     class ThemeConfig : public QVariantMap {
     public:
         explicit ThemeConfig(const QString &path);
 
         void setTo(const QString &path);
+
+        // Saves the configuration for setTo() in another process, which
+        // uses it as long as the files it came from are unchanged
+        bool saveSnapshot(const QString &snapshotPath) const;
+
+    private:
+        bool loadSnapshot(const QString &snapshotPath, const QString &path);
+        void readFile(const QString &path, bool user);
+
+        QString m_path;
     };
 }
 
@@ -0,0 +1,198 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "ThemeIndex.h"
+
+#include "Constants.h"
+#include "DesktopEntry.h"
+#include "ThemeBundle.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+namespace SDDM {
+    static const quint32 s_cacheMagic = 0x53444449; // SDDI
+    static const qint32 s_cacheVersion = 3;
+
+    static QDataStream &operator<<(QDataStream &out, const ThemeInfo &info) {
+        return out << info.name << info.path << info.mainScript << info.configFile
+                   << info.translationsDirectory << info.qtVersion << info.valid;
+    }
+
+    static QDataStream &operator>>(QDataStream &in, ThemeInfo &info) {
+        return in >> info.name >> info.path >> info.mainScript >> info.configFile
+                  >> info.translationsDirectory >> info.qtVersion >> info.valid;
+    }
+
+    ThemeIndex::ThemeIndex(const QString &themeDir, const QString &cachePath)
+        : m_themeDir(themeDir)
+        , m_cachePath(cachePath.isEmpty() ? defaultCachePath() : cachePath) {
+        refresh();
+    }
+
+    QString ThemeIndex::defaultCachePath() {
+        return QStringLiteral(STATE_DIR "/themes.cache");
+    }
+
+    const QString &ThemeIndex::themeDir() const {
+        return m_themeDir;
+    }
+
+    const QVector<ThemeInfo> &ThemeIndex::themes() const {
+        return m_themes;
+    }
+
+    const ThemeInfo *ThemeIndex::find(const QString &name) const {
+        auto it = m_byName.constFind(name);
+        if (it == m_byName.constEnd())
+            return nullptr;
+        return &m_themes.at(it.value());
+    }
+
+    QByteArray ThemeIndex::stamp(QStringList &names) const {
+        // a theme is added or removed with the directory, its metadata
+        // and main script change on their own; a bundle is replaced as
+        // a whole
+        QDir dir(m_themeDir);
+        names = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+        names += dir.entryList({ QStringLiteral("*.rcc") }, QDir::Files, QDir::Name);
+
+        QByteArray stamp;
+        QDataStream out(&stamp, QIODevice::WriteOnly);
+        out << m_themeDir << QFileInfo(m_themeDir).lastModified().toMSecsSinceEpoch();
+        for (const QString &name : qAsConst(names)) {
+            if (ThemeBundle::isBundle(name)) {
+                const QFileInfo bundle(dir.filePath(name));
+                out << name << bundle.size() << bundle.lastModified().toMSecsSinceEpoch();
+                continue;
+            }
+
+            const QFileInfo metadata(dir.filePath(name + QStringLiteral("/metadata.desktop")));
+            out << name << metadata.size() << metadata.lastModified().toMSecsSinceEpoch();
+
+            // the one the metadata named when the index was built
+            const ThemeInfo *theme = find(name);
+            const QFileInfo mainScript(dir.filePath(name + QLatin1Char('/') + (theme ? theme->mainScript : QStringLiteral("Main.qml"))));
+            out << mainScript.exists() << mainScript.lastModified().toMSecsSinceEpoch();
+        }
+        return stamp;
+    }
+
+    void ThemeIndex::refresh() {
+        // the stamp depends on the main scripts of the index it stands for
+        if (m_stamp.isEmpty())
+            loadCache();
+
+        QStringList names;
+        if (stamp(names) == m_stamp)
+            return;
+
+        rebuild(names);
+        m_stamp = stamp(names);
+        saveCache(m_stamp);
+    }
+
+    void ThemeIndex::rebuild(const QStringList &names) {
+        m_themes.clear();
+        m_byName.clear();
+
+        const QDir dir(m_themeDir);
+        for (const QString &name : names) {
+            ThemeInfo info;
+            info.path = dir.absoluteFilePath(name);
+
+            // a bundle is read through its resource root, it takes the
+            // place of a directory of the same name
+            QString root = info.path;
+            const bool bundle = ThemeBundle::isBundle(name);
+            if (bundle) {
+                info.name = QFileInfo(name).completeBaseName();
+                root = ThemeBundle::mount(info.path);
+            } else {
+                info.name = name;
+            }
+
+            DesktopEntry entry(root + QStringLiteral("/metadata.desktop"), QByteArrayLiteral("SddmGreeterTheme"));
+            info.mainScript = entry.value("MainScript", QStringLiteral("Main.qml"));
+            info.configFile = entry.value("ConfigFile", QStringLiteral("theme.conf"));
+            info.translationsDirectory = entry.value("TranslationsDirectory", QStringLiteral("."));
+            info.qtVersion = entry.value("QtVersion");
+            info.valid = !root.isEmpty() && QFile::exists(root + QLatin1Char('/') + info.mainScript);
+
+            // only the summary is kept, the greeter maps the bundle itself
+            if (bundle && !root.isEmpty())
+                ThemeBundle::unmount(root);
+
+            auto it = m_byName.constFind(info.name);
+            if (it != m_byName.constEnd()) {
+                m_themes[it.value()] = info;
+                continue;
+            }
+            m_byName.insert(info.name, m_themes.size());
+            m_themes.append(info);
+        }
+    }
+
+    bool ThemeIndex::loadCache() {
+        QFile file(m_cachePath);
+        if (!file.open(QIODevice::ReadOnly))
+            return false;
+
+        QDataStream in(&file);
+        in.setVersion(QDataStream::Qt_5_0);
+
+        quint32 magic = 0;
+        qint32 version = 0;
+        QByteArray cachedStamp;
+        in >> magic >> version >> cachedStamp;
+        if (in.status() != QDataStream::Ok || magic != s_cacheMagic || version != s_cacheVersion)
+            return false;
+
+        QVector<ThemeInfo> themes;
+        in >> themes;
+        if (in.status() != QDataStream::Ok)
+            return false;
+
+        m_stamp = cachedStamp;
+        m_themes = themes;
+        m_byName.clear();
+        for (int i = 0; i < m_themes.size(); ++i)
+            m_byName.insert(m_themes.at(i).name, i);
+        return true;
+    }
+
+    void ThemeIndex::saveCache(const QByteArray &stamp) const {
+        QSaveFile file(m_cachePath);
+        // only whoever may write the cache keeps it, everybody else
+        // just reads the themes
+        if (!file.open(QIODevice::WriteOnly))
+            return;
+        file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner | QFileDevice::ReadGroup | QFileDevice::ReadOther);
+
+        QDataStream out(&file);
+        out.setVersion(QDataStream::Qt_5_0);
+        out << s_cacheMagic << s_cacheVersion << stamp << m_themes;
+        if (!file.commit())
+            qWarning() << "Failed to write the theme index" << m_cachePath;
+    }
+}
@@ -0,0 +1,76 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_THEMEINDEX_H
+#define SDDM_THEMEINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace SDDM {
+    struct ThemeInfo {
+        QString name;
+        QString path;
+        QString mainScript;
+        QString configFile;
+        QString translationsDirectory;
+        QString qtVersion;
+        // the main script is there
+        bool valid { false };
+    };
+
+    /**
+     * Metadata of every theme in a directory. The summary is kept in a
+     * binary cache and only read again from the themes once the directory,
+     * one of their metadata files or main scripts changed.
+     *
+     * A theme bundle, "<name>.rcc", wins over a theme directory of the
+     * same name; its path is the bundle file.
+     */
+    class ThemeIndex {
+    public:
+        explicit ThemeIndex(const QString &themeDir, const QString &cachePath = QString());
+
+        // brings the index up to date with the directory
+        void refresh();
+
+        const QString &themeDir() const;
+
+        const QVector<ThemeInfo> &themes() const;
+        const ThemeInfo *find(const QString &name) const;
+
+        static QString defaultCachePath();
+
+    private:
+        QByteArray stamp(QStringList &names) const;
+        bool loadCache();
+        void saveCache(const QByteArray &stamp) const;
+        void rebuild(const QStringList &names);
+
+        QString m_themeDir;
+        QString m_cachePath;
+        QByteArray m_stamp;
+        QVector<ThemeInfo> m_themes;
+        QHash<QString, int> m_byName;
+    };
+}
+
+#endif // SDDM_THEMEINDEX_H
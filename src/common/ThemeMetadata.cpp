@@ -20,7 +20,7 @@
 
 #include "ThemeMetadata.h"
 
-#include <QSettings>
+#include "DesktopEntry.h"
 
 namespace SDDM {
     class ThemeMetadataPrivate {
@@ -28,6 +28,7 @@ namespace SDDM {
         QString mainScript { QStringLiteral("Main.qml") };
         QString configFile;
         QString translationsDirectory { QStringLiteral(".") };
+        bool virtualKeyboard { false };
     };
 
     ThemeMetadata::ThemeMetadata(const QString &path, QObject *parent) : QObject(parent), d(new ThemeMetadataPrivate()) {
@@ -50,11 +51,16 @@ namespace SDDM {
         return d->translationsDirectory;
     }
 
+    bool ThemeMetadata::virtualKeyboard() const {
+        return d->virtualKeyboard;
+    }
+
     void ThemeMetadata::setTo(const QString &path) {
-        QSettings settings(path, QSettings::IniFormat);
+        DesktopEntry entry(path, QByteArrayLiteral("SddmGreeterTheme"));
         // read values
-        d->mainScript = settings.value(QStringLiteral("SddmGreeterTheme/MainScript"), QStringLiteral("Main.qml")).toString();
-        d->configFile = settings.value(QStringLiteral("SddmGreeterTheme/ConfigFile"), QStringLiteral("theme.conf")).toString();
-        d->translationsDirectory = settings.value(QStringLiteral("SddmGreeterTheme/TranslationsDirectory"), QStringLiteral(".")).toString();
+        d->mainScript = entry.value("MainScript", QStringLiteral("Main.qml"));
+        d->configFile = entry.value("ConfigFile", QStringLiteral("theme.conf"));
+        d->translationsDirectory = entry.value("TranslationsDirectory", QStringLiteral("."));
+        d->virtualKeyboard = entry.value("VirtualKeyboard", QString()).compare(QLatin1String("true"), Qt::CaseInsensitive) == 0;
     }
 }
@@ -36,6 +36,8 @@ namespace SDDM {
         const QString &mainScript() const;
         const QString &configFile() const;
         const QString &translationsDirectory() const;
+        // the theme shows the on-screen keyboard, see InputMethodOnDemand
+        bool virtualKeyboard() const;
 
         void setTo(const QString &path);
 
@@ -0,0 +1,64 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "Trace.h"
+
+#include "LoggingCategories.h"
+#include "LoginId.h"
+
+#include <time.h>
+
+#ifdef HAVE_JOURNALD
+#include <systemd/sd-journal.h>
+#include <unistd.h>
+#endif
+
+namespace SDDM {
+    namespace Trace {
+        void mark(const char *milestone, const QString &detail) {
+            if (!SDDM_TRACE().isInfoEnabled())
+                return;
+
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            const long long usec = (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+
+#ifdef HAVE_JOURNALD
+            // same rule as the message handler, interactive runs log to
+            // the terminal or file
+            static bool isInteractive = isatty(STDIN_FILENO);
+            if (!isInteractive) {
+                const QByteArray detailUtf8 = detail.toUtf8();
+                const QByteArray loginId = LoginId::current().toUtf8();
+                sd_journal_send("MESSAGE=Trace: %s %s", milestone, detailUtf8.constData(),
+                                "PRIORITY=%i", LOG_INFO,
+                                "SDDM_TRACE=%s", milestone,
+                                "SDDM_TRACE_DETAIL=%s", detailUtf8.constData(),
+                                "SDDM_TRACE_MONOTONIC_USEC=%lld", usec,
+                                // empty outside of a login
+                                "SDDM_LOGIN_ID=%s", loginId.constData(),
+                                NULL);
+                return;
+            }
+#endif
+
+            qCInfo(SDDM_TRACE).nospace() << "Trace: " << milestone << " " << detail << " at " << usec << "us";
+        }
+    }
+}
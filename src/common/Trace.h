@@ -0,0 +1,42 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_TRACE_H
+#define SDDM_TRACE_H
+
+#include <QString>
+
+namespace SDDM {
+    namespace Trace {
+        /**
+         * Records that @p milestone, e.g. "x11-ready", was reached, with
+         * the CLOCK_MONOTONIC time in microseconds. That clock is shared
+         * by all processes, so the marks of the daemon, helper and
+         * greeter line up.
+         *
+         * With journald the mark is sent as SDDM_TRACE, SDDM_TRACE_DETAIL
+         * and SDDM_TRACE_MONOTONIC_USEC fields, along with SDDM_LOGIN_ID,
+         * otherwise it is logged.
+         * It is disabled along with the sddm.trace category.
+         */
+        void mark(const char *milestone, const QString &detail = QString());
+    }
+}
+
+#endif // SDDM_TRACE_H
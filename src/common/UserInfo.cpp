@@ -0,0 +1,99 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "UserInfo.h"
+
+#include "Configuration.h"
+
+#include <QStringList>
+
+#include <pwd.h>
+#include <string.h>
+
+namespace SDDM {
+    UserInfo::UserInfo(const struct passwd *pw) :
+        name(QString::fromLocal8Bit(pw->pw_name)),
+        realName(QString::fromLocal8Bit(pw->pw_gecos).split(QLatin1Char(',')).first()),
+        homeDir(QString::fromLocal8Bit(pw->pw_dir)),
+        uid(int(pw->pw_uid)),
+        gid(int(pw->pw_gid)),
+        // if shadow is used pw_passwd will be 'x' nevertheless, so this
+        // will always be true
+        needsPassword(strcmp(pw->pw_passwd, "") != 0) {
+    }
+
+    QDataStream &operator<<(QDataStream &stream, const UserInfo &user) {
+        stream << user.name << user.realName << user.homeDir << qint32(user.uid) << qint32(user.gid)
+               << user.needsPassword << user.icon;
+        return stream;
+    }
+
+    QDataStream &operator>>(QDataStream &stream, UserInfo &user) {
+        qint32 uid = 0, gid = 0;
+        stream >> user.name >> user.realName >> user.homeDir >> uid >> gid >> user.needsPassword >> user.icon;
+        user.uid = uid;
+        user.gid = gid;
+        return stream;
+    }
+
+    // passwd entries are compared in their local encoding, which
+    // avoids converting each name and shell of the database
+    static QSet<QByteArray> toByteSet(const QStringList &list) {
+        QSet<QByteArray> set;
+        set.reserve(list.count());
+        for (const QString &item : list)
+            set.insert(item.toLocal8Bit());
+        return set;
+    }
+
+    static inline QByteArray rawBytes(const char *str) {
+        return str ? QByteArray::fromRawData(str, int(qstrlen(str))) : QByteArray();
+    }
+
+    UserFilter::UserFilter()
+        : m_minimumUid(mainConfig.Users.MinimumUid.ref())
+        , m_maximumUid(mainConfig.Users.MaximumUid.ref())
+        , m_hideUsers(toByteSet(mainConfig.Users.HideUsers.ref()))
+        , m_hideShells(toByteSet(mainConfig.Users.HideShells.ref())) {
+    }
+
+    bool UserFilter::accepts(const QByteArray &name, int uid, const QByteArray &shell) const {
+        // skip entries with uids smaller than minimum uid
+        if (uid < m_minimumUid)
+            return false;
+
+        // skip entries with uids greater than maximum uid
+        if (uid > m_maximumUid)
+            return false;
+
+        // skip entries with user names in the hide users list
+        if (!m_hideUsers.isEmpty() && m_hideUsers.contains(name))
+            return false;
+
+        // skip entries with shells in the hide shells list
+        if (!m_hideShells.isEmpty() && m_hideShells.contains(shell))
+            return false;
+
+        return true;
+    }
+
+    bool UserFilter::accepts(const struct passwd *pw) const {
+        return accepts(rawBytes(pw->pw_name), int(pw->pw_uid), rawBytes(pw->pw_shell));
+    }
+}
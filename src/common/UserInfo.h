@@ -0,0 +1,72 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_USERINFO_H
+#define SDDM_USERINFO_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QMetaType>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+struct passwd;
+
+namespace SDDM {
+    /**
+     * A user as listed by the greeters, as the daemon sends it to them.
+     * The icon is an url, empty if the user has no avatar of their own.
+     */
+    struct UserInfo {
+        UserInfo() = default;
+        explicit UserInfo(const struct passwd *pw);
+
+        QString name;
+        QString realName;
+        QString homeDir;
+        int uid { 0 };
+        int gid { 0 };
+        bool needsPassword { false };
+        QString icon;
+    };
+
+    QDataStream &operator<<(QDataStream &stream, const UserInfo &user);
+    QDataStream &operator>>(QDataStream &stream, UserInfo &user);
+
+    // users that should be listed according to the configuration
+    class UserFilter {
+    public:
+        UserFilter();
+
+        bool accepts(const QByteArray &name, int uid, const QByteArray &shell) const;
+        bool accepts(const struct passwd *pw) const;
+
+    private:
+        int m_minimumUid { 0 };
+        int m_maximumUid { 0 };
+        QSet<QByteArray> m_hideUsers;
+        QSet<QByteArray> m_hideShells;
+    };
+}
+
+Q_DECLARE_TYPEINFO(SDDM::UserInfo, Q_MOVABLE_TYPE);
+Q_DECLARE_METATYPE(QVector<SDDM::UserInfo>)
+
+#endif // SDDM_USERINFO_H
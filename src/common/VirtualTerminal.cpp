@@ -18,6 +18,7 @@
 ***************************************************************************/
 
 #include <QDebug>
+#include <QHash>
 #include <QString>
 
 #include "VirtualTerminal.h"
@@ -37,16 +38,41 @@
 
 namespace SDDM {
     namespace VirtualTerminal {
-        static void onAcquireDisplay(int signal) {
-            int fd = open("/dev/tty0", O_RDWR | O_NOCTTY);
-            ioctl(fd, VT_RELDISP, VT_ACKACQ);
+        // VT master, opened once and kept for the lifetime of the process
+        static volatile int s_masterFd = -1;
+
+        // VTs handed out by setUpNewVt(), kept open so that VT_OPENQRY
+        // doesn't return them again, to us or anybody else
+        static QHash<int, int> s_reserved;
+
+        static int masterFd() {
+            if (s_masterFd < 0) {
+                s_masterFd = open("/dev/tty0", O_RDWR | O_NOCTTY | O_CLOEXEC);
+                if (s_masterFd < 0)
+                    qCritical() << "Failed to open VT master:" << strerror(errno);
+            }
+            return s_masterFd;
+        }
+
+        static void releaseDisplay(int how) {
+            // only the fd that is already there is safe to use from a signal
+            // handler, fall back to opening the master for a moment
+            int fd = s_masterFd;
+            if (fd >= 0) {
+                ioctl(fd, VT_RELDISP, how);
+                return;
+            }
+            fd = open("/dev/tty0", O_RDWR | O_NOCTTY);
+            ioctl(fd, VT_RELDISP, how);
             close(fd);
         }
 
+        static void onAcquireDisplay(int signal) {
+            releaseDisplay(VT_ACKACQ);
+        }
+
         static void onReleaseDisplay(int signal) {
-            int fd = open("/dev/tty0", O_RDWR | O_NOCTTY);
-            ioctl(fd, VT_RELDISP, 1);
-            close(fd);
+            releaseDisplay(1);
         }
 
         static bool handleVtSwitches(int fd) {
@@ -117,15 +143,9 @@ out:
         }
 
         int fetchAvailableVt() {
-            // open VT master
-            int fd = open("/dev/tty0", O_RDWR | O_NOCTTY);
-            if (fd < 0) {
-                qCritical() << "Failed to open VT master:" << strerror(errno);
+            int fd = masterFd();
+            if (fd < 0)
                 return -1;
-            }
-            auto closeFd = qScopeGuard([fd] {
-                close(fd);
-            });
 
             vt_stat vtState = { 0 };
             if (ioctl(fd, VT_GETSTATE, &vtState) < 0) {
@@ -143,15 +163,9 @@ out:
         }
 
         int setUpNewVt() {
-            // open VT master
-            int fd = open("/dev/tty0", O_RDWR | O_NOCTTY);
-            if (fd < 0) {
-                qCritical() << "Failed to open VT master:" << strerror(errno);
+            int fd = masterFd();
+            if (fd < 0)
                 return -1;
-            }
-            auto closeFd = qScopeGuard([fd] {
-                close(fd);
-            });
 
             int vt = 0;
             if (ioctl(fd, VT_OPENQRY, &vt) < 0) {
@@ -171,18 +185,35 @@ out:
                 return vtState.v_active;
             }
 
+            // an open VT is not free anymore, which keeps another display
+            // from getting the same one before its user got around to open it
+            const QByteArray tty = QByteArrayLiteral("/dev/tty") + QByteArray::number(vt);
+            const int vtFd = open(tty.constData(), O_RDWR | O_NOCTTY | O_CLOEXEC);
+            if (vtFd >= 0)
+                s_reserved.insert(vt, vtFd);
+            else
+                qWarning("Failed to reserve %s: %s", tty.constData(), strerror(errno));
+
             return vt;
         }
 
+        void releaseVt(int vt) {
+            auto it = s_reserved.find(vt);
+            if (it == s_reserved.end())
+                return;
+            close(it.value());
+            s_reserved.erase(it);
+        }
+
         void jumpToVt(int vt, bool vt_auto) {
             qDebug() << "Jumping to VT" << vt;
 
             int fd;
 
-            int activeVtFd = open("/dev/tty0", O_RDWR | O_NOCTTY);
+            int activeVtFd = masterFd();
 
             QString ttyString = QStringLiteral("/dev/tty%1").arg(vt);
-            int vtFd = open(qPrintable(ttyString), O_RDWR | O_NOCTTY);
+            int vtFd = open(qPrintable(ttyString), O_RDWR | O_NOCTTY | O_CLOEXEC);
             if (vtFd != -1) {
                 fd = vtFd;
 
@@ -198,12 +229,19 @@ out:
                 // combination of states (KD_GRAPHICS with VT_AUTO) that we
                 // cannot switch from, so make sure things are in a way that
                 // will make VT_ACTIVATE work without hanging VT_WAITACTIVE
-                fixVtMode(activeVtFd, vt_auto);
+                if (activeVtFd >= 0)
+                    fixVtMode(activeVtFd, vt_auto);
             } else {
                 qWarning("Failed to open %s: %s", qPrintable(ttyString), strerror(errno));
                 qDebug("Using /dev/tty0 instead of %s!", qPrintable(ttyString));
                 fd = activeVtFd;
             }
+            auto closeFd = qScopeGuard([vtFd] {
+                if (vtFd != -1)
+                    close(vtFd);
+            });
+            if (fd < 0)
+                return;
 
             // If vt_auto is true, the controlling process is already gone, so there is no
             // process which could send the VT_RELDISP 1 ioctl to release the vt.
@@ -211,6 +249,11 @@ out:
             if (!vt_auto)
                 handleVtSwitches(fd);
 
+            // already there, nothing to wait for
+            vt_stat vtState = { 0 };
+            if (ioctl(fd, VT_GETSTATE, &vtState) == 0 && vtState.v_active == vt)
+                return;
+
             do {
                 errno = 0;
 
@@ -226,9 +269,6 @@ out:
                     qWarning("Couldn't finalize jump to VT %d: %s", vt, strerror(errno));
 
             } while (errno == EINTR);
-            close(activeVtFd);
-            if (vtFd != -1)
-                close(vtFd);
         }
     }
 }
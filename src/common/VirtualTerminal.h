@@ -23,7 +23,10 @@
 namespace SDDM {
     namespace VirtualTerminal {
         int fetchAvailableVt();
+        // the new VT stays reserved until releaseVt(), take care of
+        // calling it from the main thread only
         int setUpNewVt();
+        void releaseVt(int vt);
         void jumpToVt(int vt, bool vt_auto);
     }
 }
@@ -41,6 +41,10 @@ namespace SDDM {
             return fetchAvailableVt();
         }
 
+        void releaseVt(int vt) {
+            // nothing is reserved by setUpNewVt()
+        }
+
         void jumpToVt(int vt, bool vt_auto) {
             int fd = -1;
 
@@ -20,7 +20,9 @@
 
 #include <QDebug>
 #include <QDir>
+#include <QFile>
 #include <QUuid>
+#include <QVector>
 
 #include "Configuration.h"
 #include "Constants.h"
@@ -28,6 +30,12 @@
 
 #include <random>
 
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 namespace SDDM {
 
 XAuth::XAuth()
@@ -74,6 +82,11 @@ void XAuth::setup()
     m_authPath = QStringLiteral("%1/%2").arg(m_authDir).arg(QUuid::createUuid().toString(QUuid::WithoutBraces));
     qDebug() << "Xauthority path:" << m_authPath;
 
+    newCookie();
+}
+
+void XAuth::newCookie()
+{
     // Generate cookie
     std::random_device rd;
     std::mt19937 gen(rd());
@@ -98,11 +111,162 @@ bool XAuth::addCookie(const QString &display)
     return XAuth::addCookieToFile(display, m_authPath, m_cookie);
 }
 
+// an Xauthority record, see Xau(3)
+struct XAuthEntry {
+    quint16 family = 0;
+    QByteArray address;
+    QByteArray number;
+    QByteArray name;
+    QByteArray data;
+};
+
+// families as defined by X.h and Xauth.h
+static const quint16 FamilyLocal = 256;
+static const quint16 FamilyWild = 65535;
+
+static void appendField(QByteArray &out, const QByteArray &field)
+{
+    out.append(char((field.size() >> 8) & 0xff));
+    out.append(char(field.size() & 0xff));
+    out.append(field);
+}
+
+static bool readField(const QByteArray &in, int &pos, QByteArray &field)
+{
+    if (pos + 2 > in.size())
+        return false;
+    const int length = (uchar(in.at(pos)) << 8) | uchar(in.at(pos + 1));
+    pos += 2;
+    if (pos + length > in.size())
+        return false;
+    field = in.mid(pos, length);
+    pos += length;
+    return true;
+}
+
+static bool readEntries(const QString &fileName, QVector<XAuthEntry> &entries)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return !file.exists();
+
+    const QByteArray contents = file.readAll();
+    int pos = 0;
+    while (pos < contents.size()) {
+        XAuthEntry entry;
+        if (pos + 2 > contents.size())
+            return false;
+        entry.family = quint16((uchar(contents.at(pos)) << 8) | uchar(contents.at(pos + 1)));
+        pos += 2;
+        if (!readField(contents, pos, entry.address) || !readField(contents, pos, entry.number)
+                || !readField(contents, pos, entry.name) || !readField(contents, pos, entry.data))
+            return false;
+        entries.append(entry);
+    }
+    return true;
+}
+
+static bool writeEntries(const QString &fileName, const QVector<XAuthEntry> &entries)
+{
+    QByteArray contents;
+    for (const XAuthEntry &entry : entries) {
+        contents.append(char((entry.family >> 8) & 0xff));
+        contents.append(char(entry.family & 0xff));
+        appendField(contents, entry.address);
+        appendField(contents, entry.number);
+        appendField(contents, entry.name);
+        appendField(contents, entry.data);
+    }
+
+    // write next to the file and rename it over, readers never see a partial file
+    const QByteArray path = QFile::encodeName(fileName);
+    const QByteArray tempPath = path + "-n";
+    ::unlink(tempPath.constData());
+    int fd = ::open(tempPath.constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        qWarning() << "Failed to create" << tempPath << strerror(errno);
+        return false;
+    }
+
+    // keep the owner of a file that is replaced, this matters when running as root
+    struct stat st;
+    if (::stat(path.constData(), &st) == 0 && geteuid() == 0) {
+        if (::fchown(fd, st.st_uid, st.st_gid) != 0)
+            qWarning() << "Failed to change the owner of" << tempPath << strerror(errno);
+    }
+
+    qint64 written = 0;
+    while (written < contents.size()) {
+        ssize_t result = ::write(fd, contents.constData() + written, contents.size() - written);
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result < 0) {
+            qWarning() << "Failed to write" << tempPath << strerror(errno);
+            ::close(fd);
+            ::unlink(tempPath.constData());
+            return false;
+        }
+        written += result;
+    }
+    ::close(fd);
+
+    if (::rename(tempPath.constData(), path.constData()) != 0) {
+        qWarning() << "Failed to rename" << tempPath << "to" << path << strerror(errno);
+        ::unlink(tempPath.constData());
+        return false;
+    }
+    return true;
+}
+
 bool XAuth::addCookieToFile(const QString &display, const QString &fileName,
                             const QString &cookie)
 {
     qDebug() << "Adding cookie to" << fileName;
 
+    // only local displays, like the ones we start, are handled here
+    const int colon = display.lastIndexOf(QLatin1Char(':'));
+    if (colon != 0)
+        return addCookieWithXauth(display, fileName, cookie);
+    QString number = display.mid(1);
+    const int dot = number.indexOf(QLatin1Char('.'));
+    if (dot >= 0)
+        number.truncate(dot);
+    bool ok = false;
+    number.toUInt(&ok);
+    if (!ok)
+        return addCookieWithXauth(display, fileName, cookie);
+
+    char hostName[256] = { 0 };
+    if (::gethostname(hostName, sizeof(hostName) - 1) != 0)
+        return addCookieWithXauth(display, fileName, cookie);
+
+    QVector<XAuthEntry> entries;
+    if (!readEntries(fileName, entries)) {
+        qWarning() << "Unable to parse" << fileName << ", falling back to xauth";
+        return addCookieWithXauth(display, fileName, cookie);
+    }
+
+    XAuthEntry entry;
+    entry.family = FamilyLocal;
+    entry.address = QByteArray(hostName);
+    entry.number = number.toLatin1();
+    entry.name = QByteArrayLiteral("MIT-MAGIC-COOKIE-1");
+    entry.data = QByteArray::fromHex(cookie.toLatin1());
+
+    // same as "xauth remove", drop whatever was there for this display
+    for (int i = entries.size() - 1; i >= 0; --i) {
+        const XAuthEntry &e = entries.at(i);
+        if ((e.family == FamilyLocal || e.family == FamilyWild) && e.address == entry.address && e.number == entry.number)
+            entries.remove(i);
+    }
+    entries.append(entry);
+
+    return writeEntries(fileName, entries);
+}
+
+bool XAuth::addCookieWithXauth(const QString &display, const QString &fileName,
+                               const QString &cookie)
+{
     // Touch file
     QFile file_handler(fileName);
     file_handler.open(QIODevice::Append);
@@ -38,12 +38,18 @@ public:
 
     void setup();
     bool addCookie(const QString &display);
+    // replaces the cookie, addCookie() writes the new one
+    void newCookie();
 
     static bool addCookieToFile(const QString &display,
                                 const QString &fileName,
                                 const QString &cookie);
 
 private:
+    static bool addCookieWithXauth(const QString &display,
+                                   const QString &fileName,
+                                   const QString &cookie);
+
     bool m_setup = false;
     QString m_authDir;
     QString m_authPath;
@@ -0,0 +1,164 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "XcbCursor.h"
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QPointer>
+
+#include <thread>
+
+#ifdef HAVE_XCB_CURSOR
+#include <xcb/xcb.h>
+#include <xcb/xcb_cursor.h>
+
+#include <stdlib.h>
+#include <string.h>
+#endif
+
+namespace SDDM {
+    namespace XcbCursor {
+#ifdef HAVE_XCB_CURSOR
+        static xcb_screen_t *screenOf(xcb_connection_t *connection, int number) {
+            xcb_screen_iterator_t it = xcb_setup_roots_iterator(xcb_get_setup(connection));
+            for (; it.rem; --number, xcb_screen_next(&it)) {
+                if (number == 0)
+                    return it.data;
+            }
+            return nullptr;
+        }
+
+        // libxcb-cursor only takes the theme and size from the environment
+        // or the X resources. The environment is shared with every other
+        // thread of the process, so hand them over in RESOURCE_MANAGER
+        // instead, under a server grab so no other client ever sees them.
+        static bool createContext(xcb_connection_t *connection, xcb_screen_t *screen,
+                                  const QString &theme, const QString &size,
+                                  xcb_cursor_context_t **context) {
+            QByteArray extra;
+            if (!theme.isEmpty())
+                extra += "\nXcursor.theme:\t" + theme.toLocal8Bit();
+            if (!size.isEmpty())
+                extra += "\nXcursor.size:\t" + size.toLocal8Bit();
+            if (extra.isEmpty())
+                return xcb_cursor_context_new(connection, screen, context) >= 0;
+
+            xcb_grab_server(connection);
+
+            xcb_get_property_reply_t *old = xcb_get_property_reply(connection,
+                xcb_get_property(connection, 0, screen->root, XCB_ATOM_RESOURCE_MANAGER,
+                                 XCB_GET_PROPERTY_TYPE_ANY, 0, UINT32_MAX / 4), nullptr);
+            const bool hadResources = old && old->type != XCB_NONE;
+            QByteArray resources;
+            if (hadResources)
+                resources = QByteArray(static_cast<const char *>(xcb_get_property_value(old)),
+                                       xcb_get_property_value_length(old));
+            // later entries win
+            resources += extra + '\n';
+            xcb_change_property(connection, XCB_PROP_MODE_REPLACE, screen->root, XCB_ATOM_RESOURCE_MANAGER,
+                                XCB_ATOM_STRING, 8, resources.size(), resources.constData());
+
+            const bool success = xcb_cursor_context_new(connection, screen, context) >= 0;
+
+            if (hadResources)
+                xcb_change_property(connection, XCB_PROP_MODE_REPLACE, screen->root, XCB_ATOM_RESOURCE_MANAGER,
+                                    old->type, old->format, xcb_get_property_value_length(old) / (old->format / 8),
+                                    xcb_get_property_value(old));
+            else
+                xcb_delete_property(connection, screen->root, XCB_ATOM_RESOURCE_MANAGER);
+            free(old);
+
+            xcb_ungrab_server(connection);
+            xcb_flush(connection);
+            return success;
+        }
+
+        static bool setRootCursorSync(const QString &display, const QString &cookie,
+                                      const QString &theme, const QString &size) {
+            static char authName[] = "MIT-MAGIC-COOKIE-1";
+            QByteArray authData = QByteArray::fromHex(cookie.toLatin1());
+
+            xcb_auth_info_t auth;
+            auth.namelen = strlen(authName);
+            auth.name = authName;
+            auth.datalen = authData.size();
+            auth.data = authData.data();
+
+            int screenNumber = 0;
+            xcb_connection_t *connection = xcb_connect_to_display_with_auth_info(qPrintable(display), &auth, &screenNumber);
+            if (xcb_connection_has_error(connection)) {
+                qWarning() << "Failed to connect to" << display << "to set the root cursor";
+                xcb_disconnect(connection);
+                return false;
+            }
+
+            bool success = false;
+            xcb_screen_t *screen = screenOf(connection, screenNumber);
+            xcb_cursor_context_t *context = nullptr;
+            if (screen && createContext(connection, screen, theme, size, &context)) {
+                xcb_cursor_t cursor = xcb_cursor_load_cursor(context, "left_ptr");
+                if (cursor != XCB_CURSOR_NONE) {
+                    uint32_t value = cursor;
+                    xcb_generic_error_t *error = xcb_request_check(connection,
+                        xcb_change_window_attributes_checked(connection, screen->root, XCB_CW_CURSOR, &value));
+                    success = !error;
+                    free(error);
+                    xcb_free_cursor(connection, cursor);
+                }
+                xcb_cursor_context_free(context);
+            }
+
+            xcb_disconnect(connection);
+
+            if (!success)
+                qWarning() << "Failed to set the root cursor on" << display;
+            return success;
+        }
+#endif
+
+        void setRootCursor(const QString &display, const QString &cookie,
+                           const QString &theme, const QString &size,
+                           QObject *receiver, const std::function<void(bool)> &done) {
+            QPointer<QObject> guard(receiver);
+            auto report = [guard, done] (bool success) {
+                QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, done, success] {
+                    if (guard)
+                        done(success);
+                }, Qt::QueuedConnection);
+            };
+
+#ifdef HAVE_XCB_CURSOR
+            // connecting blocks for as long as the server doesn't answer,
+            // and a wedged server must not hold up the caller's event loop
+            // or its exit, so use a thread nobody waits for
+            std::thread([display, cookie, theme, size, report] {
+                report(setRootCursorSync(display, cookie, theme, size));
+            }).detach();
+#else
+            Q_UNUSED(display)
+            Q_UNUSED(cookie)
+            Q_UNUSED(theme)
+            Q_UNUSED(size)
+            report(false);
+#endif
+        }
+    }
+}
@@ -0,0 +1,48 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_XCBCURSOR_H
+#define SDDM_XCBCURSOR_H
+
+#include <QString>
+
+#include <functional>
+
+class QObject;
+
+namespace SDDM {
+    namespace XcbCursor {
+        /**
+         * Sets the left_ptr cursor of @p theme on the root window of
+         * @p display, authenticating with the hex encoded MIT-MAGIC-COOKIE-1
+         * @p cookie. This is what "xsetroot -cursor_name left_ptr" does.
+         *
+         * The work happens on a separate thread. @p done is called from
+         * the event loop once it is over, unless @p receiver is gone by
+         * then. It gets false if setting the cursor wasn't possible,
+         * including when SDDM was built without xcb-cursor, so the caller
+         * can fall back to xsetroot.
+         */
+        void setRootCursor(const QString &display, const QString &cookie,
+                           const QString &theme, const QString &size,
+                           QObject *receiver, const std::function<void(bool)> &done);
+    }
+}
+
+#endif // SDDM_XCBCURSOR_H
@@ -19,30 +19,57 @@
 
 #include "DaemonApp.h"
 
+#include "Auth.h"
 #include "Configuration.h"
 #include "Constants.h"
 #include "DisplayManager.h"
+#include "GreeterFonts.h"
+#include "LoggingCategories.h"
+#include "LogindStateCache.h"
+#include "Metrics.h"
 #include "PowerManager.h"
 #include "SeatManager.h"
+#include "SessionCatalog.h"
 #include "SignalHandler.h"
+#include "SystemdNotify.h"
+#include "ThemeIndex.h"
+#include "Trace.h"
+#include "UserDirectory.h"
 
 #include "MessageHandler.h"
 
-#include <QDBusConnectionInterface>
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
 #include <QHostInfo>
+#include <QThread>
 #include <QTimer>
 
 #include <iostream>
+#include <memory>
 
 namespace SDDM {
     DaemonApp *DaemonApp::self = nullptr;
 
+    // in test mode, in milliseconds
+    static const int StallCheckInterval = 50;
+
     DaemonApp::DaemonApp(int &argc, char **argv) : QCoreApplication(argc, argv) {
         // point instance to this
         self = this;
 
         qInstallMessageHandler(SDDM::DaemonMessageHandler);
+        applyLogRules();
+        Trace::mark("daemon-start");
+
+        // before any child process gets to inherit the socket
+        SystemdNotify::initialize();
+        connect(this, &QCoreApplication::aboutToQuit, this, [] { SystemdNotify::stopping(); });
 
         // log message
         qDebug() << "Initializing...";
@@ -50,33 +77,76 @@ namespace SDDM {
         // set testing parameter
         m_testing = (arguments().indexOf(QStringLiteral("--test-mode")) != -1);
 
-        bool consoleKitServiceActivatable = false;
-        QDBusReply<QStringList> activatableNamesReply = QDBusConnection::systemBus().interface()->activatableServiceNames();
-        if (activatableNamesReply.isValid()) {
-            consoleKitServiceActivatable = activatableNamesReply.value().contains(QStringLiteral("org.freedesktop.ConsoleKit"));
+        // stand-ins for the greeter and helper, to drive logins in tests
+        if (m_testing) {
+            const QStringList args = arguments();
+            int pos = args.indexOf(QStringLiteral("--greeter"));
+            if (pos >= 0 && pos < args.count() - 1)
+                m_greeterPath = args.at(pos + 1);
+            pos = args.indexOf(QStringLiteral("--helper"));
+            if (pos >= 0 && pos < args.count() - 1)
+                Auth::setHelperPath(args.at(pos + 1));
+
+            // how late a short timer fires is how long the event loop
+            // was busy, for load tests such as sddm-load-generator
+            auto *stallTimer = new QTimer(this);
+            auto stallClock = std::make_shared<QElapsedTimer>();
+            stallTimer->setInterval(StallCheckInterval);
+            connect(stallTimer, &QTimer::timeout, this, [stallClock] {
+                Metrics::observe("event_loop_stall_ms", qMax<qint64>(0, stallClock->restart() - StallCheckInterval));
+            });
+            stallClock->start();
+            stallTimer->start();
         }
 
-        // If ConsoleKit isn't started by the OS init system (FreeBSD, for instance),
-        // we start it ourselves during the sddm startup
-        if (consoleKitServiceActivatable) {
-            QDBusReply<bool> registeredReply = QDBusConnection::systemBus().interface()->isServiceRegistered(QStringLiteral("org.freedesktop.ConsoleKit"));
-            if (registeredReply.isValid() && registeredReply.value() == false) {
-                QDBusConnection::systemBus().interface()->startService(QStringLiteral("org.freedesktop.ConsoleKit"));
-            }
-        }
+        // only reparse the configuration when one of its files changed
+        mainConfig.setWatched(true);
+        // helpers and greeters read the resolved configuration from here
+        mainConfig.setSnapshotPath(QStringLiteral(RUNTIME_DIR "/sddm.conf.snapshot"));
+        qputenv(CONFIG_SNAPSHOT_VARIABLE, QByteArrayLiteral(RUNTIME_DIR "/sddm.conf.snapshot"));
+
+        // D-Bus clients and logind keep getting answers while this
+        // thread waits for a process, the objects on the bus thread are
+        // only reached through queued connections
+        m_busThread = new QThread(this);
+        m_busThread->setObjectName(QStringLiteral("sddm-bus"));
+        connect(this, &QCoreApplication::aboutToQuit, this, [this] {
+            m_busThread->quit();
+            m_busThread->wait();
+        });
 
         // create display manager
-        m_displayManager = new DisplayManager(this);
+        m_displayManager = new DisplayManager();
+        m_displayManager->moveToThread(m_busThread);
+        connect(m_busThread, &QThread::finished, m_displayManager, &QObject::deleteLater);
+
+        // create the logind mirror, filled once the seats listen to it
+        m_logindState = new LogindStateCache();
+        m_logindState->moveToThread(m_busThread);
+        connect(m_busThread, &QThread::finished, m_logindState, &QObject::deleteLater);
+
+        m_busThread->start();
 
         // create power manager
         m_powerManager = new PowerManager(this);
 
+        // walk the user database while the first display comes up
+        if (mainConfig.Users.SharedUserList.get()) {
+            m_userDirectory = new UserDirectory(this);
+            m_userDirectory->start();
+        }
+
+        // read the session files once for autologin and all the greeters
+        m_sessionCatalog = new SessionCatalog(this);
+        m_sessionCatalog->start();
+
         // create seat manager
         m_seatManager = new SeatManager(this);
 
         // connect with display manager
         connect(m_seatManager, &SeatManager::seatCreated, m_displayManager, &DisplayManager::AddSeat);
         connect(m_seatManager, &SeatManager::seatRemoved, m_displayManager, &DisplayManager::RemoveSeat);
+        connect(m_seatManager, &SeatManager::seatRestartStateChanged, m_displayManager, &DisplayManager::updateSeatRestartState);
 
         // create signal handler
         m_signalHandler = new SignalHandler(this);
@@ -87,14 +157,94 @@ namespace SDDM {
         // log message
         qDebug() << "Starting...";
 
-        // initialize seats only after signals are connected
+        // the greeter font set changed, its cache is rebuilt while the
+        // first greeter makes do with scanning the few directories
+        if (GreeterFonts::writeConfig())
+            GreeterFonts::updateCache(false);
+
+        // have helpers ready before the first greeter asks for one
+        Auth::setPoolSize(mainConfig.HelperPoolSize.get());
+
+        // optimistically bring up seat0 before anything else is known
+        m_seatManager->createEarlySeat();
+
+        // initialize seats only after signals are connected, and once
+        // it's known which session manager runs, see initializeSeats()
+        if (m_testing) {
+            initializeSeats();
+            return;
+        }
+
+        // nothing waits for the bus here, the power manager looks
+        // for its backends meanwhile
+        QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(busCall(QStringLiteral("NameHasOwner"), { QStringLiteral("org.freedesktop.login1") }), this);
+        connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, watcher] {
+            watcher->deleteLater();
+            QDBusPendingReply<bool> reply = *watcher;
+            if (reply.isValid() && reply.value())
+                initializeSeats();
+            else
+                activateConsoleKit();
+        });
+    }
+
+    DaemonApp::~DaemonApp() = default;
+
+    QDBusPendingCall DaemonApp::busCall(const QString &method, const QVariantList &arguments) {
+        QDBusMessage message = QDBusMessage::createMethodCall(QStringLiteral("org.freedesktop.DBus"), QStringLiteral("/org/freedesktop/DBus"),
+                                                              QStringLiteral("org.freedesktop.DBus"), method);
+        message.setArguments(arguments);
+        return QDBusConnection::systemBus().asyncCall(message);
+    }
+
+    void DaemonApp::activateConsoleKit() {
+        const QString consoleKit = QStringLiteral("org.freedesktop.ConsoleKit");
+
+        // If ConsoleKit isn't started by the OS init system (FreeBSD, for instance),
+        // we start it ourselves during the sddm startup
+        QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(busCall(QStringLiteral("ListActivatableNames")), this);
+        connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, watcher, consoleKit] {
+            watcher->deleteLater();
+            QDBusPendingReply<QStringList> activatable = *watcher;
+            if (!activatable.isValid() || !activatable.value().contains(consoleKit)) {
+                initializeSeats();
+                return;
+            }
+
+            QDBusPendingCallWatcher *registered = new QDBusPendingCallWatcher(busCall(QStringLiteral("NameHasOwner"), { consoleKit }), this);
+            connect(registered, &QDBusPendingCallWatcher::finished, this, [this, registered, consoleKit] {
+                registered->deleteLater();
+                QDBusPendingReply<bool> reply = *registered;
+                if (!reply.isValid() || reply.value()) {
+                    initializeSeats();
+                    return;
+                }
+
+                // the seats need ConsoleKit, so they wait for it to be up
+                QDBusPendingCallWatcher *started = new QDBusPendingCallWatcher(busCall(QStringLiteral("StartServiceByName"), { consoleKit, 0u }), this);
+                connect(started, &QDBusPendingCallWatcher::finished, this, [this, started] {
+                    started->deleteLater();
+                    if (started->isError())
+                        qWarning() << "Failed to start ConsoleKit:" << started->error().message();
+                    initializeSeats();
+                });
+            });
+        });
+    }
+
+    void DaemonApp::initializeSeats() {
         m_seatManager->initialize();
+        QMetaObject::invokeMethod(m_logindState, &LogindStateCache::initialize, Qt::QueuedConnection);
     }
 
     bool DaemonApp::testing() const {
         return m_testing;
     }
 
+    QString DaemonApp::greeterPath() const {
+        return m_greeterPath;
+    }
+
 
     QString DaemonApp::hostName() const {
         return QHostInfo::localHostName();
@@ -104,6 +254,10 @@ namespace SDDM {
         return m_displayManager;
     }
 
+    LogindStateCache *DaemonApp::logindState() const {
+        return m_logindState;
+    }
+
     PowerManager *DaemonApp::powerManager() const {
         return m_powerManager;
     }
@@ -112,10 +266,58 @@ namespace SDDM {
         return m_seatManager;
     }
 
+    SessionCatalog *DaemonApp::sessionCatalog() const {
+        return m_sessionCatalog;
+    }
+
     SignalHandler *DaemonApp::signalHandler() const {
         return m_signalHandler;
     }
 
+    UserDirectory *DaemonApp::userDirectory() const {
+        return m_userDirectory;
+    }
+
+    const ThemeIndex *DaemonApp::themeIndex() {
+        const QString themeDir = mainConfig.Theme.ThemeDir.get();
+        if (!m_themeIndex || m_themeIndex->themeDir() != themeDir) {
+            m_themeIndex.reset(new ThemeIndex(themeDir));
+            watchThemes();
+        } else if (m_themesChanged) {
+            m_themeIndex->refresh();
+            watchThemes();
+        }
+        m_themesChanged = false;
+        return m_themeIndex.get();
+    }
+
+    void DaemonApp::watchThemes() {
+        if (!m_themeWatcher) {
+            m_themeWatcher = new QFileSystemWatcher(this);
+            connect(m_themeWatcher, &QFileSystemWatcher::directoryChanged, this, [this] { m_themesChanged = true; });
+            connect(m_themeWatcher, &QFileSystemWatcher::fileChanged, this, [this] { m_themesChanged = true; });
+        }
+
+        // the directory for themes coming and going, each theme for its
+        // metadata and main script
+        QStringList paths { m_themeIndex->themeDir() };
+        for (const ThemeInfo &theme : m_themeIndex->themes()) {
+            paths << theme.path;
+            if (QFileInfo(theme.path).isDir()) {
+                paths << theme.path + QStringLiteral("/metadata.desktop");
+                paths << theme.path + QLatin1Char('/') + theme.mainScript;
+            }
+        }
+
+        const QStringList watched = m_themeWatcher->files() + m_themeWatcher->directories();
+        if (!watched.isEmpty())
+            m_themeWatcher->removePaths(watched);
+        for (const QString &path : qAsConst(paths)) {
+            if (QFileInfo::exists(path))
+                m_themeWatcher->addPath(path);
+        }
+    }
+
     int DaemonApp::newSessionId() {
         return m_lastSessionId++;
     }
@@ -131,7 +333,11 @@ int main(int argc, char **argv) {
         std::cout << "Usage: sddm [options]\n"
                   << "Options: \n"
                   << "  --test-mode         Start daemon in test mode" << std::endl
-                  << "  --example-config    Print the complete current configuration to stdout" << std::endl;
+                  << "  --greeter PATH      Greeter to start in test mode" << std::endl
+                  << "  --helper PATH       Helper to start in test mode" << std::endl
+                  << "  --example-config    Print the complete current configuration to stdout" << std::endl
+                  << "  --list-themes       Print the installed themes and whether they can be used" << std::endl
+                  << "  --update-font-cache Rebuild the fontconfig cache of the greeter, see Theme/FontDirs" << std::endl;
 
         return EXIT_FAILURE;
     }
@@ -143,6 +349,29 @@ int main(int argc, char **argv) {
         return EXIT_SUCCESS;
     }
 
+    // name, state, Qt version and path of every theme, tab separated
+    if (arguments.contains(QStringLiteral("--list-themes"))) {
+        const SDDM::ThemeIndex index(SDDM::mainConfig.Theme.ThemeDir.get());
+        QTextStream out(stdout);
+        for (const SDDM::ThemeInfo &theme : index.themes()) {
+            out << theme.name << '\t' << (theme.valid ? "valid" : "invalid") << '\t'
+                << (theme.qtVersion.isEmpty() ? QStringLiteral("5") : theme.qtVersion) << '\t' << theme.path << '\n';
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // after font packages changed, for the greeter's own cache
+    if (arguments.contains(QStringLiteral("--update-font-cache"))) {
+        if (SDDM::GreeterFonts::configFile().isEmpty()) {
+            std::cerr << "Theme/FontDirs is not set, the greeter uses the system font cache" << std::endl;
+            return EXIT_FAILURE;
+        }
+        // QProcess wants an application instance
+        QCoreApplication app(argc, argv);
+        SDDM::GreeterFonts::writeConfig();
+        return SDDM::GreeterFonts::updateCache(true) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     // create application
     SDDM::DaemonApp app(argc, argv);
 
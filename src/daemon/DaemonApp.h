@@ -21,21 +21,33 @@
 #define SDDM_DAEMONAPP_H
 
 #include <QCoreApplication>
+#include <QDBusPendingCall>
+#include <QVariantList>
+
+#include <memory>
+
+class QFileSystemWatcher;
+class QThread;
 
 #define daemonApp DaemonApp::instance()
 
 namespace SDDM {
     class Configuration;
     class DisplayManager;
+    class LogindStateCache;
     class PowerManager;
     class SeatManager;
+    class SessionCatalog;
     class SignalHandler;
+    class ThemeIndex;
+    class UserDirectory;
 
     class DaemonApp : public QCoreApplication {
         Q_OBJECT
         Q_DISABLE_COPY(DaemonApp)
     public:
         explicit DaemonApp(int &argc, char **argv);
+        ~DaemonApp();
 
         static DaemonApp *instance() { return self; }
 
@@ -43,11 +55,20 @@ namespace SDDM {
         bool testing() const;
         bool first { true };
 
+        // given with --greeter in test mode, empty for the installed one
+        QString greeterPath() const;
+
         QString hostName() const;
         DisplayManager *displayManager() const;
+        LogindStateCache *logindState() const;
         PowerManager *powerManager() const;
         SeatManager *seatManager() const;
+        SessionCatalog *sessionCatalog() const;
         SignalHandler *signalHandler() const;
+        // null unless the greeters share the user list
+        UserDirectory *userDirectory() const;
+        // the themes of Theme/ThemeDir, read again once they changed
+        const ThemeIndex *themeIndex();
 
     public slots:
         int newSessionId();
@@ -55,13 +76,27 @@ namespace SDDM {
     private:
         static DaemonApp *self;
 
+        static QDBusPendingCall busCall(const QString &method, const QVariantList &arguments = QVariantList());
+        void activateConsoleKit();
+        void initializeSeats();
+        void watchThemes();
+
         int m_lastSessionId { 0 };
 
         bool m_testing { false };
+        QString m_greeterPath;
+        // runs the D-Bus services and the logind mirror
+        QThread *m_busThread { nullptr };
         DisplayManager *m_displayManager { nullptr };
+        LogindStateCache *m_logindState { nullptr };
         PowerManager *m_powerManager { nullptr };
         SeatManager *m_seatManager { nullptr };
+        SessionCatalog *m_sessionCatalog { nullptr };
         SignalHandler *m_signalHandler { nullptr };
+        UserDirectory *m_userDirectory { nullptr };
+        std::unique_ptr<ThemeIndex> m_themeIndex;
+        QFileSystemWatcher *m_themeWatcher { nullptr };
+        bool m_themesChanged { false };
     };
 }
 
@@ -24,11 +24,21 @@
 #include "Configuration.h"
 #include "DaemonApp.h"
 #include "DisplayManager.h"
+#include "LogindStateCache.h"
+#include "LoggingCategories.h"
+#include "LoginId.h"
+#include "Metrics.h"
+#include "PowerManager.h"
+#include "Prefetch.h"
 #include "XorgDisplayServer.h"
 #include "XorgUserDisplayServer.h"
 #include "Seat.h"
+#include "SessionCatalog.h"
+#include "ThemeIndex.h"
 #include "SocketServer.h"
+#include "SystemdNotify.h"
 #include "Greeter.h"
+#include "Trace.h"
 #include "Utils.h"
 
 #include <QDebug>
@@ -36,6 +46,8 @@
 #include <QTimer>
 #include <QLocalSocket>
 
+#include <memory>
+
 #include <pwd.h>
 #include <unistd.h>
 #include <sys/time.h>
@@ -45,14 +57,12 @@
 #include <QDBusReply>
 
 #include "Login1Manager.h"
-#include "Login1Session.h"
 #include "VirtualTerminal.h"
 #include "WaylandDisplayServer.h"
 
 
 namespace SDDM {
     Display::Display(Seat *parent) : QObject(parent),
-        m_auth(new Auth(this)),
         m_seat(parent),
         m_socketServer(new SocketServer(this)),
         m_greeter(new Greeter(this)) {
@@ -68,7 +78,7 @@ namespace SDDM {
             m_terminalId = VirtualTerminal::fetchAvailableVt();
         } else {
             if (displayServerType != QLatin1String("x11")) {
-                qWarning("\"%s\" is an invalid value for General.DisplayServer: fall back to \"x11\"",
+                qCWarning(SDDM_DAEMON_DISPLAY, "\"%s\" is an invalid value for General.DisplayServer: fall back to \"x11\"",
                      qPrintable(displayServerType));
             }
             m_terminalId = VirtualTerminal::setUpNewVt();
@@ -90,24 +100,38 @@ namespace SDDM {
             break;
         }
 
-        qDebug("Using VT %d", m_terminalId);
+        qCDebug(SDDM_DAEMON_DISPLAY, "Using VT %d", m_terminalId);
 
         // respond to authentication requests
-        m_auth->setVerbose(true);
-        connect(m_auth, &Auth::requestChanged, this, &Display::slotRequestChanged);
-        connect(m_auth, &Auth::authentication, this, &Display::slotAuthenticationFinished);
-        connect(m_auth, &Auth::sessionStarted, this, &Display::slotSessionStarted);
-        connect(m_auth, &Auth::finished, this, &Display::slotHelperFinished);
-        connect(m_auth, &Auth::info, this, &Display::slotAuthInfo);
-        connect(m_auth, &Auth::error, this, &Display::slotAuthError);
+        m_auth = createAuth();
 
         // restart display after display server ended
         connect(m_displayServer, &DisplayServer::started, this, &Display::displayServerStarted);
-        connect(m_displayServer, &DisplayServer::stopped, this, &Display::stop);
+        connect(m_displayServer, &DisplayServer::setupFinished, this, &Display::displaySetupFinished);
+        connect(m_displayServer, &DisplayServer::stopped, this, &Display::displayServerStopped);
+        connect(m_displayServer, &DisplayServer::failed, this, &Display::startFailed);
 
         // connect login signal
+        connect(m_socketServer, &SocketServer::connected, this, [this] {
+            if (!m_greeterTimer.isValid())
+                return;
+            Metrics::observe("greeter_start_ms", m_greeterTimer.elapsed());
+            m_greeterTimer.invalidate();
+        });
+        connect(m_socketServer, &SocketServer::greeterReady, this, [this] {
+            m_greeterReady = true;
+            daemonApp->powerManager()->releaseSleep(this);
+        });
+        connect(m_socketServer, &SocketServer::frameStats, this, &Display::recordFrameStats);
         connect(m_socketServer, &SocketServer::login, this, &Display::login);
 
+        // a greeter still starting up would only come on screen after resume,
+        // one kept running across a session has been ready since it started
+        connect(daemonApp->powerManager(), &PowerManager::preparingForSleep, this, [this] {
+            if (m_started && !m_greeterReady && m_greeter->isRunning())
+                daemonApp->powerManager()->holdSleep(this);
+        });
+
         // connect login result signals
         connect(this, &Display::loginFailed, m_socketServer, &SocketServer::loginFailed);
         connect(this, &Display::loginSucceeded, m_socketServer, &SocketServer::loginSucceeded);
@@ -120,7 +144,11 @@ namespace SDDM {
 
     Display::~Display() {
         disconnect(m_auth, &Auth::finished, this, &Display::slotHelperFinished);
+        cancelConcurrentAuths();
         stop();
+
+        VirtualTerminal::releaseVt(m_sessionTerminalId);
+        VirtualTerminal::releaseVt(m_terminalId);
     }
 
     Display::DisplayServerType Display::displayServerType() const
@@ -150,32 +178,65 @@ namespace SDDM {
     }
 
     bool Display::start() {
-        return m_started || m_displayServer->start();
+        if (m_started)
+            return true;
+
+        // the helper brings up the display server of the session itself,
+        // so PAM doesn't have to wait for ours and its setup
+        if (m_displayServerType != X11DisplayServerType && autologinDue()) {
+            daemonApp->first = false;
+            Trace::mark("autologin-early", name());
+            m_autologinStarted = attemptAutologin();
+            if (!m_autologinStarted)
+                qCWarning(SDDM_DAEMON_DISPLAY) << "Autologin failed!";
+        }
+
+        // the display server takes a while, have the greeter files ready
+        if (mainConfig.Theme.Prefetch.get() && !m_autologinStarted) {
+            QStringList paths { QStringLiteral(BIN_INSTALL_DIR "/sddm-greeter") };
+            const QString theme = findGreeterTheme();
+            if (!theme.isEmpty())
+                paths << theme;
+            paths << QStringLiteral(IMPORTS_INSTALL_DIR "/SddmComponents");
+            paths << mainConfig.Theme.PrefetchPaths.get();
+            Prefetch::start(paths);
+        }
+
+        return m_displayServer->start();
     }
 
-    bool Display::attemptAutologin() {
-        Session::Type sessionType = Session::X11Session;
+    bool Display::autologinDue() const {
+        return (daemonApp->first || mainConfig.Autologin.Relogin.get()) &&
+            !mainConfig.Autologin.User.get().isEmpty();
+    }
 
-        // determine session type
+    bool Display::attemptAutologin() {
+        // determine session
         QString autologinSession = mainConfig.Autologin.Session.get();
         // not configured: try last successful logged in
         if (autologinSession.isEmpty()) {
             autologinSession = stateConfig.Last.Session.get();
         }
-        if (findSessionEntry(mainConfig.Wayland.SessionDir.get(), autologinSession)) {
-            sessionType = Session::WaylandSession;
-        } else if (findSessionEntry(mainConfig.X11.SessionDir.get(), autologinSession)) {
-            sessionType = Session::X11Session;
-        } else {
-            qCritical() << "Unable to find autologin session entry" << autologinSession;
+
+        // Wayland sessions win over X11 ones of the same name
+        bool runnable = false;
+        daemonApp->sessionCatalog()->recheck();
+        const Session session = daemonApp->sessionCatalog()->find(autologinSession, &runnable);
+        if (!session.isValid()) {
+            qCCritical(SDDM_DAEMON_DISPLAY) << "Unable to find autologin session entry" << autologinSession;
             return false;
         }
 
-        Session session;
-        session.setTo(sessionType, autologinSession);
+        // same check done for the sessions the greeters list
+        if (!runnable) {
+            qCCritical(SDDM_DAEMON_DISPLAY) << "Autologin session" << autologinSession << "cannot be started, TryExec"
+                        << session.tryExec() << "not found";
+            return false;
+        }
 
+        LoginId::Scope scope(LoginId::generate());
         m_auth->setAutologin(true);
-        startAuth(mainConfig.Autologin.User.get(), QString(), session);
+        startAuth(mainConfig.Autologin.User.get(), SecureBuffer(), session);
 
         return true;
     }
@@ -185,14 +246,39 @@ namespace SDDM {
         if (m_started)
             return;
 
-        // setup display
+        if (m_recycling) {
+            qCDebug(SDDM_DAEMON_DISPLAY) << "Display server reset for the next greeter";
+            m_recycling = false;
+            m_stopping = false;
+        }
+
+        Trace::mark("display-server-started", name());
+        SystemdNotify::status(QStringLiteral("Setting up display %1").arg(name()));
+
+        // setup display, displaySetupFinished() continues once the
+        // steps the greeter depends on are done
         m_displayServer->setupDisplay();
+    }
+
+    void Display::displaySetupFinished() {
+        // check flag
+        if (m_started)
+            return;
 
         // log message
-        qDebug() << "Display server started.";
+        qCDebug(SDDM_DAEMON_DISPLAY) << "Display server started.";
+        Trace::mark("display-setup-finished", name());
 
-        if ((daemonApp->first || mainConfig.Autologin.Relogin.get()) &&
-            !mainConfig.Autologin.User.get().isEmpty()) {
+        // already logging in, see start()
+        if (m_autologinStarted) {
+            m_autologinStarted = false;
+            m_started = true;
+            SystemdNotify::ready(QStringLiteral("Logging in automatically on display %1").arg(name()));
+            emit started();
+            return;
+        }
+
+        if (autologinDue() && m_displayServerType == X11DisplayServerType) {
             // reset first flag
             daemonApp->first = false;
 
@@ -201,9 +287,11 @@ namespace SDDM {
 
             bool success = attemptAutologin();
             if (success) {
+                SystemdNotify::ready(QStringLiteral("Logging in automatically on display %1").arg(name()));
+                emit started();
                 return;
             } else {
-                qWarning() << "Autologin failed!";
+                qCWarning(SDDM_DAEMON_DISPLAY) << "Autologin failed!";
             }
         }
 
@@ -215,7 +303,13 @@ namespace SDDM {
             struct passwd *pw = getpwnam("sddm");
             if (pw) {
                 if (chown(qPrintable(m_socketServer->socketAddress()), pw->pw_uid, pw->pw_gid) == -1) {
-                    qWarning() << "Failed to change owner of the socket";
+                    qCWarning(SDDM_DAEMON_DISPLAY) << "Failed to change owner of the socket, stopping the display";
+
+                    // the greeter couldn't connect, this display stops
+                    // before it was up and the seat retries it
+                    m_socketServer->stop();
+                    m_stopping = true;
+                    m_displayServer->stop();
                     return;
                 }
             }
@@ -227,7 +321,10 @@ namespace SDDM {
         m_greeter->setSocket(m_socketServer->socketAddress());
         m_greeter->setTheme(findGreeterTheme());
 
-        // start greeter
+        // start greeter, it counts as up once it connects to the socket
+        Trace::mark("greeter-start", name());
+        m_greeterTimer.start();
+        m_greeterReady = false;
         m_greeter->start();
 
         // reset first flag
@@ -235,9 +332,17 @@ namespace SDDM {
 
         // set flags
         m_started = true;
+
+        emit started();
     }
 
     void Display::stop() {
+        // the rest is already down, don't wait for the reset
+        if (m_recycling) {
+            m_displayServer->stop();
+            return;
+        }
+
         // check flag
         if (!m_started)
             return;
@@ -245,26 +350,44 @@ namespace SDDM {
         // stop the greeter
         m_greeter->stop();
 
+        cancelConcurrentAuths();
         m_auth->stop();
 
+        // drop a pending session lookup
+        ++m_sessionLookup;
+        m_sessionLookupPending = false;
+
         // stop socket server
         m_socketServer->stop();
 
-        // stop display server
-        m_displayServer->blockSignals(true);
-        m_displayServer->stop();
-        m_displayServer->blockSignals(false);
-
         // reset flag
         m_started = false;
+        m_autologinStarted = false;
+        m_stopping = true;
+        m_greeterKept = false;
+
+        // stop display server, this doesn't wait for it to exit;
+        // displayServerStopped() emits stopped() once the VT is free
+        m_displayServer->stop();
+    }
+
+    void Display::displayServerStopped() {
+        // display server ended on its own, tear down the rest
+        if (m_started)
+            stop();
+
+        if (!m_stopping)
+            return;
+        m_stopping = false;
+        m_recycling = false;
 
         // emit signal
         emit stopped();
     }
 
     void Display::login(QLocalSocket *socket,
-                        const QString &user, const QString &password,
-                        const Session &session) {
+                        const QString &user, const SecureBuffer &password,
+                        const Session &session, const std::vector<SecureBuffer> &credentials) {
         m_socket = socket;
 
         //the SDDM user has special privileges that skip password checking so that we can load the greeter
@@ -274,7 +397,15 @@ namespace SDDM {
         }
 
         // authenticate
-        startAuth(user, password, session);
+        Trace::mark("login-request", user);
+        Metrics::increment("login_attempts");
+        m_authTimer.start();
+        if ((!authActive() || defaultAuthFailed()) && !m_sessionLookupPending) {
+            m_credentials.clear();
+            for (const SecureBuffer &credential : credentials)
+                m_credentials.push_back(credential.copy());
+        }
+        startAuth(user, password.copy(), session);
     }
 
     QString Display::findGreeterTheme() const {
@@ -285,87 +416,146 @@ namespace SDDM {
         if (themeName.isEmpty())
             return QString();
 
-        QDir dir(mainConfig.Theme.ThemeDir.get());
+        const ThemeInfo *theme = daemonApp->themeIndex()->find(themeName);
 
         // return the default theme if it exists
-        if (dir.exists(themeName))
-            return dir.absoluteFilePath(themeName);
+        if (theme && theme->valid)
+            return theme->path;
 
         // otherwise use the embedded theme
-        qWarning() << "The configured theme" << themeName << "doesn't exist, using the embedded theme instead";
+        if (theme)
+            qCWarning(SDDM_DAEMON_DISPLAY) << "The configured theme" << themeName << "is missing its main script" << theme->mainScript << "- using the embedded theme instead";
+        else
+            qCWarning(SDDM_DAEMON_DISPLAY) << "The configured theme" << themeName << "doesn't exist, using the embedded theme instead";
         return QString();
     }
 
-    bool Display::findSessionEntry(const QDir &dir, const QString &name) const {
-        // Given an absolute path: Check that it matches dir
-        const QFileInfo fileInfo(name);
-        if (fileInfo.isAbsolute() && fileInfo.absolutePath() != dir.absolutePath())
-            return false;
-
-        QString fileName = name;
-
-        // append extension
-        const QString extension = QStringLiteral(".desktop");
-        if (!fileName.endsWith(extension))
-            fileName += extension;
-
-        return dir.exists(fileName);
-    }
-
-    void Display::startAuth(const QString &user, const QString &password, const Session &session) {
+    void Display::startAuth(const QString &user, SecureBuffer password, const Session &session) {
+
+        // the password was wrong while another service, like a finger
+        // print reader, still waits: the password is tried again with
+        // the default service only, unless the user or session changed
+        if (defaultAuthFailed() && !m_sessionLookupPending) {
+            if (user == m_attempt.user && session.fileName() == m_sessionName) {
+                qCDebug(SDDM_DAEMON_DISPLAY) << "Trying the password again while the other services wait";
+                m_passPhrase = std::move(password);
+                renewDefaultAuth();
+                setUpAuth(m_auth, QString());
+                m_authenticating.insert(m_auth);
+                m_authTimer.start();
+                m_auth->start();
+                return;
+            }
+            cancelConcurrentAuths();
+            renewDefaultAuth();
+        }
 
-        if (m_auth->isActive()) {
-            qWarning() << "Existing authentication ongoing, aborting";
+        if (authActive() || m_sessionLookupPending) {
+            qCWarning(SDDM_DAEMON_DISPLAY) << "Existing authentication ongoing, aborting";
             return;
         }
 
-        m_passPhrase = password;
+        m_passPhrase = std::move(password);
 
         // sanity check
         if (!session.isValid()) {
-            qCritical() << "Invalid session" << session.fileName();
+            qCCritical(SDDM_DAEMON_DISPLAY) << "Invalid session" << session.fileName();
             return;
         }
         if (session.xdgSessionType().isEmpty()) {
-            qCritical() << "Failed to find XDG session type for session" << session.fileName();
+            qCCritical(SDDM_DAEMON_DISPLAY) << "Failed to find XDG session type for session" << session.fileName();
             return;
         }
         if (session.exec().isEmpty()) {
-            qCritical() << "Failed to find command for session" << session.fileName();
+            qCCritical(SDDM_DAEMON_DISPLAY) << "Failed to find command for session" << session.fileName();
             return;
         }
 
         m_reuseSessionId = QString();
 
         if (Logind::isAvailable() && mainConfig.Users.ReuseSession.get()) {
-            OrgFreedesktopLogin1ManagerInterface manager(Logind::serviceName(), Logind::managerPath(), QDBusConnection::systemBus());
-            auto reply = manager.ListSessions();
-            reply.waitForFinished();
-
-            const auto info = reply.value();
-            for(const SessionInfo &s : reply.value()) {
-                if (s.userName == user) {
-                    OrgFreedesktopLogin1SessionInterface session(Logind::serviceName(), s.sessionPath.path(), QDBusConnection::systemBus());
-                    if (session.service() == QLatin1String("sddm") && session.state() == QLatin1String("online")) {
-                        m_reuseSessionId = s.sessionId;
-                        break;
-                    }
-                }
-            }
+            findReusableSession(user, session);
+            return;
         }
 
+        startAuthSession(user, session);
+    }
+
+    void Display::findReusableSession(const QString &user, const Session &session) {
+        LogindStateCache *logind = daemonApp->logindState();
+        const int lookup = ++m_sessionLookup;
+        m_sessionLookupPending = true;
+        const QString loginId = LoginId::current();
+
+        if (logind->isReady()) {
+            // the states are read from logind, it doesn't signal them
+            logind->findSession(user, QStringLiteral("sddm"), QStringLiteral("online"), this,
+                                [this, lookup, user, session, loginId](const QString &id) {
+                LoginId::Scope scope(loginId);
+
+                // the display was stopped or another login took over
+                if (lookup != m_sessionLookup)
+                    return;
+                m_sessionLookupPending = false;
+
+                m_reuseSessionId = id;
+                startAuthSession(user, session);
+            });
+            return;
+        }
+
+        // the daemon just started, wait for the initial session list
+        auto connection = std::make_shared<QMetaObject::Connection>();
+        *connection = connect(logind, &LogindStateCache::ready, this, [this, lookup, connection, user, session, loginId] {
+            disconnect(*connection);
+            LoginId::Scope scope(loginId);
+
+            // the display was stopped or another login took over
+            if (lookup != m_sessionLookup)
+                return;
+            m_sessionLookupPending = false;
+
+            findReusableSession(user, session);
+        });
+
+        // the cache is filled on the bus thread, it may have become
+        // ready in between; the bump drops a ready() already queued
+        if (logind->isReady()) {
+            disconnect(*connection);
+            ++m_sessionLookup;
+            m_sessionLookupPending = false;
+            findReusableSession(user, session);
+        }
+    }
+
+    void Display::startAuthSession(const QString &user, const Session &session) {
         // save session desktop file name, we'll use it to set the
         // last session later, in slotAuthenticationFinished()
         m_sessionName = session.fileName();
 
+        // a VT set up for an earlier attempt that didn't get a session
+        VirtualTerminal::releaseVt(m_sessionTerminalId);
+        m_sessionTerminalId = 0;
+
         int terminalNewSession = m_terminalId;
-        if ((session.type() == Session::WaylandSession && m_displayServerType == X11DisplayServerType) || (m_greeter->isRunning() && m_displayServerType != X11DisplayServerType)) {
+        m_handoff = false;
+        if (session.type() == Session::WaylandSession && m_displayServerType == X11DisplayServerType) {
             // Create a new VT when we need to have another compositor running
             terminalNewSession = VirtualTerminal::setUpNewVt();
+            m_sessionTerminalId = terminalNewSession;
+        } else if (m_greeter->isRunning() && m_displayServerType != X11DisplayServerType) {
+            // the greeter's compositor gives up DRM master when it exits,
+            // so the session can have the VT without a switch and a modeset
+            if (mainConfig.SessionHandoff.get() && !mainConfig.KeepGreeter.get()) {
+                m_handoff = true;
+            } else {
+                terminalNewSession = VirtualTerminal::setUpNewVt();
+                m_sessionTerminalId = terminalNewSession;
+            }
         }
 
         // some information
-        qDebug() << "Session" << m_sessionName << "selected, command:" << session.exec() << "for VT" << terminalNewSession;
+        qCDebug(SDDM_DAEMON_DISPLAY) << "Session" << m_sessionName << "selected, command:" << session.exec() << "for VT" << terminalNewSession;
 
         QProcessEnvironment env;
         env.insert(session.additionalEnv());
@@ -384,57 +574,213 @@ namespace SDDM {
         env.insert(QStringLiteral("XDG_SESSION_DESKTOP"), session.desktopNames());
 #endif
 
+        QString displayServerCommand;
         if (session.xdgSessionType() == QLatin1String("x11")) {
           if (m_displayServerType == X11DisplayServerType)
             env.insert(QStringLiteral("DISPLAY"), name());
           else
-            m_auth->setDisplayServerCommand(XorgUserDisplayServer::command(this));
-        } else {
-            m_auth->setDisplayServerCommand(QStringLiteral());
+            displayServerCommand = XorgUserDisplayServer::command(this);
 	}
-        m_auth->setUser(user);
+
+        m_attempt.user = user;
+        m_attempt.exec = session.exec();
+        m_attempt.displayServerCommand = displayServerCommand;
+        m_attempt.environment = env;
+
+        // autologin picks its own service, so do the other services
+        // only for logins from the greeter
+        QStringList services { QString() };
+        if (!m_auth->autologin())
+            services << mainConfig.AuthServices.get();
+
+        m_authenticating.clear();
+        for (const QString &service : qAsConst(services)) {
+            Auth *auth = m_auth;
+            if (!service.isEmpty()) {
+                auth = createAuth();
+                m_concurrentAuths << auth;
+            }
+
+            // whichever service succeeds first starts the session
+            setUpAuth(auth, service);
+            m_authenticating.insert(auth);
+            auth->start();
+        }
+    }
+
+    void Display::setUpAuth(Auth *auth, const QString &service) {
+        auth->setService(service);
+        auth->setHoldSession(m_handoff);
+        auth->setDisplayServerCommand(m_attempt.displayServerCommand);
+        auth->setUser(m_attempt.user);
         if (m_reuseSessionId.isNull()) {
-            m_auth->setSession(session.exec());
+            auth->setSession(m_attempt.exec);
+
+            // the helper gets the cookie right after authenticating,
+            // so that it can open the session while we save the state
+            if (qobject_cast<XorgDisplayServer *>(m_displayServer))
+                auth->setCookie(qobject_cast<XorgDisplayServer *>(m_displayServer)->cookie());
+        }
+        auth->insertEnvironment(m_attempt.environment);
+    }
+
+    bool Display::defaultAuthFailed() const {
+        return !m_authenticating.isEmpty() && !m_authenticating.contains(m_auth);
+    }
+
+    void Display::renewDefaultAuth() {
+        if (!m_auth->isActive())
+            return;
+
+        // the failed helper may still be writing btmp, it goes on its own
+        Auth *failed = m_auth;
+        disconnect(failed, nullptr, this, nullptr);
+        connect(failed, &Auth::finished, failed, &QObject::deleteLater);
+        m_auth = createAuth();
+    }
+
+    Auth *Display::createAuth() {
+        Auth *auth = new Auth(this);
+        auth->setVerbose(true);
+        connect(auth, &Auth::requestChanged, this, &Display::slotRequestChanged);
+        connect(auth, &Auth::authentication, this, &Display::slotAuthenticationFinished);
+        connect(auth, &Auth::sessionStarted, this, &Display::slotSessionStarted);
+        connect(auth, &Auth::finished, this, &Display::slotHelperFinished);
+        connect(auth, &Auth::info, this, &Display::slotAuthInfo);
+        connect(auth, &Auth::error, this, &Display::slotAuthError);
+        return auth;
+    }
+
+    bool Display::authActive() const {
+        if (m_auth->isActive())
+            return true;
+        for (Auth *auth : m_concurrentAuths) {
+            if (auth->isActive())
+                return true;
+        }
+        return false;
+    }
+
+    bool Display::otherAuthPending(Auth *auth) const {
+        return m_authenticating.count() > (m_authenticating.contains(auth) ? 1 : 0);
+    }
+
+    void Display::dropConcurrentAuth(Auth *auth) {
+        m_concurrentAuths.removeOne(auth);
+        m_authenticating.remove(auth);
+        disconnect(auth, nullptr, this, nullptr);
+        // let a failed helper finish writing btmp, stop the rest
+        if (auth->isActive())
+            connect(auth, &Auth::finished, auth, &QObject::deleteLater);
+        else
+            auth->deleteLater();
+    }
+
+    void Display::cancelConcurrentAuths() {
+        const QVector<Auth *> auths = m_concurrentAuths;
+        for (Auth *auth : auths) {
+            dropConcurrentAuth(auth);
+            auth->stop();
         }
-        m_auth->insertEnvironment(env);
-        m_auth->start();
+        m_authenticating.clear();
     }
 
     void Display::slotAuthenticationFinished(const QString &user, bool success) {
+        Auth *auth = qobject_cast<Auth *>(sender());
+        finishAuthentication(auth ? auth : m_auth, user, success);
+    }
+
+    void Display::finishAuthentication(Auth *auth, const QString &user, bool success) {
+        if (!success && otherAuthPending(auth)) {
+            // another service may still let the user in
+            qCDebug(SDDM_DAEMON_DISPLAY) << "Authentication with" << auth->service() << "failed, waiting for the other services";
+            if (auth == m_auth) {
+                // the greeter asks for the password again right away,
+                // startAuth() lets it in while the others keep going
+                m_authenticating.remove(auth);
+                m_passPhrase.clear();
+                Metrics::increment("login_failures");
+                if (m_socket)
+                    emit loginFailed(m_socket);
+            } else {
+                dropConcurrentAuth(auth);
+            }
+            return;
+        }
+        // the greeter already heard about the password
+        const bool failureReported = !success && auth != m_auth && !m_authenticating.contains(m_auth);
+        m_authenticating.clear();
+
+        if (success && auth != m_auth) {
+            // this one opens the session, the helper of the default
+            // service goes with the others
+            qCDebug(SDDM_DAEMON_DISPLAY) << "Authenticated with" << auth->service();
+            m_concurrentAuths.removeOne(auth);
+            m_concurrentAuths << m_auth;
+            m_auth = auth;
+        }
+        cancelConcurrentAuths();
+
+        Trace::mark(success ? "login-authenticated" : "login-failed", user);
+        if (!failureReported)
+            Metrics::increment(success ? "login_successes" : "login_failures");
+        if (m_authTimer.isValid()) {
+            Metrics::observe("auth_duration_ms", m_authTimer.elapsed());
+            m_authTimer.invalidate();
+        }
+
+        // PAM doesn't ask for the secrets after authenticating
+        m_passPhrase.clear();
+        m_credentials.clear();
+
         if (success) {
-            qDebug() << "Authenticated successfully";
+            qCDebug(SDDM_DAEMON_DISPLAY) << "Authenticated successfully";
 
             if (!m_reuseSessionId.isNull()) {
                 OrgFreedesktopLogin1ManagerInterface manager(Logind::serviceName(), Logind::managerPath(), QDBusConnection::systemBus());
                 manager.UnlockSession(m_reuseSessionId);
                 manager.ActivateSession(m_reuseSessionId);
-            } else {
-                if (qobject_cast<XorgDisplayServer *>(m_displayServer))
-                    m_auth->setCookie(qobject_cast<XorgDisplayServer *>(m_displayServer)->cookie());
             }
 
-            // save last user and last session
-            if (mainConfig.Users.RememberLastUser.get())
-                stateConfig.Last.User.set(m_auth->user());
-            else
-                stateConfig.Last.User.setDefault();
-            if (mainConfig.Users.RememberLastSession.get())
-                stateConfig.Last.Session.set(m_sessionName);
-            else
-                stateConfig.Last.Session.setDefault();
-            stateConfig.save();
+            // save last user and last session, written out at once
+            {
+                ConfigBatch batch(stateConfig);
+                if (mainConfig.Users.RememberLastUser.get())
+                    stateConfig.Last.User.set(m_auth->user());
+                else
+                    stateConfig.Last.User.setDefault();
+                if (mainConfig.Users.RememberLastSession.get())
+                    stateConfig.Last.Session.set(m_sessionName);
+                else
+                    stateConfig.Last.Session.setDefault();
+                stateConfig.Last.User.save();
+                stateConfig.Last.Session.save();
+            }
 
             if (m_socket)
                 emit loginSucceeded(m_socket);
-        } else if (m_socket) {
-            qDebug() << "Authentication failure";
+
+            if (m_handoff) {
+                // the session gets the VT once the greeter is gone
+                qCDebug(SDDM_DAEMON_DISPLAY) << "Handing VT" << m_terminalId << "over to the session";
+                m_handoff = false;
+                connect(m_greeter, &Greeter::stopped, this, &Display::releaseHeldSession, Qt::UniqueConnection);
+                m_greeter->stop();
+            }
+        } else if (m_socket && !failureReported) {
+            qCDebug(SDDM_DAEMON_DISPLAY) << "Authentication failure";
             emit loginFailed(m_socket);
         }
         m_socket = nullptr;
     }
 
+    void Display::releaseHeldSession() {
+        disconnect(m_greeter, &Greeter::stopped, this, &Display::releaseHeldSession);
+        m_auth->releaseSession();
+    }
+
     void Display::slotAuthInfo(const QString &message, Auth::Info info) {
-        qWarning() << "Authentication information:" << info << message;
+        qCWarning(SDDM_DAEMON_DISPLAY) << "Authentication information:" << info << message;
 
         if (!m_socket)
             return;
@@ -443,9 +789,10 @@ namespace SDDM {
     }
 
     void Display::slotAuthError(const QString &message, Auth::Error error) {
-        qWarning() << "Authentication error:" << error << message;
+        qCWarning(SDDM_DAEMON_DISPLAY) << "Authentication error:" << error << message;
 
-        if (!m_socket)
+        // the other services are still trying
+        if (!m_socket || otherAuthPending(qobject_cast<Auth *>(sender())))
             return;
 
         m_socketServer->informationMessage(m_socket, message);
@@ -454,30 +801,169 @@ namespace SDDM {
     }
 
     void Display::slotHelperFinished(Auth::HelperExitStatus status) {
+        Auth *auth = qobject_cast<Auth *>(sender());
+        if (auth && auth != m_auth) {
+            // another service gave up without a word, count it as failed
+            if (m_authenticating.contains(auth))
+                finishAuthentication(auth, auth->user(), false);
+            else
+                dropConcurrentAuth(auth);
+            return;
+        }
+
+        // the session is gone, or never took its VT
+        VirtualTerminal::releaseVt(m_sessionTerminalId);
+        m_sessionTerminalId = 0;
+
         // Don't restart greeter and display server unless sddm-helper exited
         // with an internal error or the user session finished successfully,
         // we want to avoid greeter from restarting when an authentication
         // error happens (in this case we want to show the message from the
         // greeter
-        if (status != Auth::HELPER_AUTH_ERROR)
-            stop();
+        if (status == Auth::HELPER_AUTH_ERROR)
+            return;
+
+        // the greeter was kept running, take it back instead of restarting
+        if (m_greeterKept && m_greeter->isRunning()) {
+            showKeptGreeter();
+            return;
+        }
+
+        if (recycleDisplayServer())
+            return;
+
+        stop();
+    }
+
+    bool Display::recycleDisplayServer() {
+        XorgDisplayServer *xorg = qobject_cast<XorgDisplayServer *>(m_displayServer);
+        if (!m_started || !xorg || !mainConfig.X11.ReuseServer.get())
+            return false;
+
+        // tear down everything but the display server, like stop()
+        m_greeter->stop();
+        cancelConcurrentAuths();
+        m_auth->stop();
+        ++m_sessionLookup;
+        m_sessionLookupPending = false;
+        m_socketServer->stop();
+
+        m_started = false;
+        m_greeterKept = false;
+        // displayServerStarted() picks up once the server has been reset,
+        // in case it is stopped instead displayServerStopped() handles it
+        m_stopping = true;
+        m_recycling = true;
+
+        if (!xorg->recycle())
+            m_displayServer->stop();
+        return true;
+    }
+
+    void Display::reloadTheme() {
+        // a greeter started later finds the theme on its own
+        if (!m_greeter->isRunning())
+            return;
+
+        m_greeter->setTheme(findGreeterTheme());
+        qCDebug(SDDM_DAEMON_DISPLAY) << "Reloading the greeter theme" << m_greeter->themePath();
+        m_socketServer->reloadTheme(m_greeter->themePath(), m_greeter->themeConfigSnapshot());
+    }
+
+    void Display::recordFrameStats(const QVector<quint32> &frames, const QVector<quint32> &renders,
+                                   const QVector<quint32> &inputs) {
+        // per seat, one greeter runs on each
+        const QByteArray suffix = ':' + m_seat->name().toLatin1();
+        const auto observe = [&suffix](const char *histogram, const QVector<quint32> &samples) {
+            const QByteArray name = histogram + suffix;
+            for (quint32 sample : samples)
+                Metrics::observe(name.constData(), sample);
+        };
+        observe("greeter_frame_ms", frames);
+        observe("greeter_render_ms", renders);
+        observe("greeter_input_latency_ms", inputs);
+    }
+
+    void Display::showKeptGreeter() {
+        m_greeterKept = false;
+
+        qCDebug(SDDM_DAEMON_DISPLAY) << "Showing the greeter kept running on VT" << m_terminalId;
+        if (m_terminalId > 0)
+            VirtualTerminal::jumpToVt(m_terminalId, false);
+
+        m_socketServer->resetGreeters();
     }
 
     void Display::slotRequestChanged() {
-        if (m_auth->request()->prompts().length() == 1) {
-            m_auth->request()->prompts()[0]->setResponse(qPrintable(m_passPhrase));
-            m_auth->request()->done();
-        } else if (m_auth->request()->prompts().length() == 2) {
-            m_auth->request()->prompts()[0]->setResponse(qPrintable(m_auth->user()));
-            m_auth->request()->prompts()[1]->setResponse(qPrintable(m_passPhrase));
-            m_auth->request()->done();
+        Auth *auth = qobject_cast<Auth *>(sender());
+        if (!auth)
+            auth = m_auth;
+
+        const QList<AuthPrompt *> prompts = auth->request()->prompts();
+        if (prompts.isEmpty())
+            return;
+
+        // the password and the credentials are meant for the default
+        // service only, each failure of another stack would count against
+        // the user, e.g. with pam_faillock; a service that asks for more
+        // than the user name is dropped instead
+        if (auth != m_auth) {
+            for (int i = 0; i < prompts.length(); ++i) {
+                if ((prompts.length() == 2 && i == 0) || prompts[i]->type() == AuthPrompt::LOGIN_USER)
+                    continue;
+                qCWarning(SDDM_DAEMON_DISPLAY) << "PAM service" << auth->service()
+                                               << "asks for a secret, only the default service gets the password";
+                dropConcurrentAuth(auth);
+                auth->stop();
+                return;
+            }
+            for (AuthPrompt *prompt : prompts)
+                prompt->setResponse(qPrintable(auth->user()));
+            auth->request()->done();
+            return;
         }
+
+        // a single prompt is the password, of two the first is the user name,
+        // longer requests name their user prompt; every other prompt takes the
+        // password first and then the credentials the greeter sent along
+        bool passwordUsed = false;
+        for (int i = 0; i < prompts.length(); ++i) {
+            AuthPrompt *prompt = prompts[i];
+            if ((prompts.length() == 2 && i == 0) || (prompts.length() > 2 && prompt->type() == AuthPrompt::LOGIN_USER)) {
+                prompt->setResponse(qPrintable(auth->user()));
+            } else if (!passwordUsed || m_credentials.empty()) {
+                prompt->setResponse(m_passPhrase.toByteArray());
+                passwordUsed = true;
+            } else {
+                prompt->setResponse(m_credentials.front().toByteArray());
+                m_credentials.erase(m_credentials.begin());
+            }
+        }
+
+        // the helper answers the following prompts with the rest by itself
+        QList<QByteArray> credentials;
+        for (const SecureBuffer &credential : m_credentials)
+            credentials << credential.toByteArray();
+        m_credentials.clear();
+        auth->setCredentials(credentials);
+
+        auth->request()->done();
     }
 
     void Display::slotSessionStarted(bool success) {
-        qDebug() << "Session started" << success;
-        if (success) {
-            QTimer::singleShot(5000, m_greeter, &Greeter::stop);
+        qCDebug(SDDM_DAEMON_DISPLAY) << "Session started" << success;
+        Trace::mark("session-status", m_auth->user());
+        if (!success)
+            return;
+
+        // a greeter with its own display server can stay loaded, one
+        // sharing the X server with the session has to go
+        if (mainConfig.KeepGreeter.get() && m_displayServerType != X11DisplayServerType &&
+                m_greeter->isRunning()) {
+            m_greeterKept = true;
+            return;
         }
+
+        QTimer::singleShot(qMax(0, mainConfig.GreeterStopDelay.get()), m_greeter, &Greeter::stop);
     }
 }
@@ -25,8 +25,14 @@
 #include <QObject>
 #include <QPointer>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QVector>
+
+#include <vector>
 
 #include "Auth.h"
+#include "SecureBuffer.h"
 #include "Session.h"
 
 class QLocalSocket;
@@ -63,41 +69,95 @@ namespace SDDM {
 
         Seat *seat() const;
 
+        // tells a running greeter about the current theme, which it loads in place
+        void reloadTheme();
+
     public slots:
         bool start();
         void stop();
 
         void login(QLocalSocket *socket,
-                   const QString &user, const QString &password,
-                   const Session &session);
+                   const QString &user, const SecureBuffer &password,
+                   const Session &session, const std::vector<SecureBuffer> &credentials);
         bool attemptAutologin();
         void displayServerStarted();
+        void displaySetupFinished();
 
     signals:
+        void started();
         void stopped();
+        void startFailed();
 
         void loginFailed(QLocalSocket *socket);
         void loginSucceeded(QLocalSocket *socket);
 
     private:
         QString findGreeterTheme() const;
-        bool findSessionEntry(const QDir &dir, const QString &name) const;
+        bool autologinDue() const;
 
-        void startAuth(const QString &user, const QString &password,
+        void startAuth(const QString &user, SecureBuffer password,
                        const Session &session);
+        void findReusableSession(const QString &user, const Session &session);
+        void startAuthSession(const QString &user, const Session &session);
+        Auth *createAuth();
+        void setUpAuth(Auth *auth, const QString &service);
+        bool defaultAuthFailed() const;
+        void renewDefaultAuth();
+        bool authActive() const;
+        bool otherAuthPending(Auth *auth) const;
+        void dropConcurrentAuth(Auth *auth);
+        void cancelConcurrentAuths();
+        void finishAuthentication(Auth *auth, const QString &user, bool success);
+        void showKeptGreeter();
+        void recordFrameStats(const QVector<quint32> &frames, const QVector<quint32> &renders,
+                              const QVector<quint32> &inputs);
+        bool recycleDisplayServer();
 
         DisplayServerType m_displayServerType = X11DisplayServerType;
 
         bool m_relogin { true };
         bool m_started { false };
+        bool m_stopping { false };
+        // the X server is reset for the next greeter, see X11/ReuseServer
+        bool m_recycling { false };
+        bool m_greeterKept { false };
+        // the greeter has a frame on all of its screens
+        bool m_greeterReady { false };
+        // autologin was started along with the display server
+        bool m_autologinStarted { false };
+        bool m_sessionLookupPending { false };
+
+        int m_sessionLookup { 0 };
 
         int m_terminalId = 0;
+        // VT of the user session when it doesn't run on m_terminalId
+        int m_sessionTerminalId = 0;
+        // the session waits for the greeter to leave m_terminalId
+        bool m_handoff { false };
 
-        QString m_passPhrase;
+        QElapsedTimer m_authTimer;
+        QElapsedTimer m_greeterTimer;
+
+        SecureBuffer m_passPhrase;
+        // answers for the prompts after the password, in order
+        std::vector<SecureBuffer> m_credentials;
         QString m_sessionName;
         QString m_reuseSessionId;
 
+        // what every service of the current attempt gets, see setUpAuth()
+        struct AuthAttempt {
+            QString user;
+            QString exec;
+            QString displayServerCommand;
+            QProcessEnvironment environment;
+        } m_attempt;
+
+        // the attempt that gets to start the session
         Auth *m_auth { nullptr };
+        // attempts with the other services of General/AuthServices
+        QVector<Auth *> m_concurrentAuths;
+        // attempts that haven't finished authenticating
+        QSet<Auth *> m_authenticating;
         DisplayServer *m_displayServer { nullptr };
         Seat *m_seat { nullptr };
         SocketServer *m_socketServer { nullptr };
@@ -109,8 +169,10 @@ namespace SDDM {
         void slotAuthenticationFinished(const QString &user, bool success);
         void slotSessionStarted(bool success);
         void slotHelperFinished(Auth::HelperExitStatus status);
+        void releaseHeldSession();
         void slotAuthInfo(const QString &message, Auth::Info info);
         void slotAuthError(const QString &message, Auth::Error error);
+        void displayServerStopped();
     };
 }
 
@@ -20,16 +20,21 @@
 #include "DisplayManager.h"
 
 #include "DaemonApp.h"
+#include "Metrics.h"
 #include "SeatManager.h"
 
 #include "displaymanageradaptor.h"
+#include "metricsadaptor.h"
 #include "seatadaptor.h"
 #include "sessionadaptor.h"
 
+#include <QDBusMetaType>
+
 const QString DISPLAYMANAGER_SERVICE = QStringLiteral("org.freedesktop.DisplayManager");
 const QString DISPLAYMANAGER_PATH = QStringLiteral("/org/freedesktop/DisplayManager");
 const QString DISPLAYMANAGER_SEAT_PATH = QStringLiteral("/org/freedesktop/DisplayManager/Seat");
 const QString DISPLAYMANAGER_SESSION_PATH = QStringLiteral("/org/freedesktop/DisplayManager/Session");
+const QString DISPLAYMANAGER_METRICS_PATH = QStringLiteral("/org/freedesktop/DisplayManager/Metrics");
 
 namespace SDDM {
     DisplayManager::DisplayManager(QObject *parent) : QObject(parent) {
@@ -40,6 +45,9 @@ namespace SDDM {
         QDBusConnection connection = (daemonApp->testing()) ? QDBusConnection::sessionBus() : QDBusConnection::systemBus();
         connection.registerService(DISPLAYMANAGER_SERVICE);
         connection.registerObject(DISPLAYMANAGER_PATH, this);
+
+        // export the counters next to the seats and sessions
+        m_metrics = new DisplayManagerMetrics(this);
     }
 
     QString DisplayManager::seatPath(const QString &seatName) {
@@ -99,6 +107,13 @@ namespace SDDM {
         }
     }
 
+    void DisplayManager::updateSeatRestartState(const QString &name, int failureCount, int retryDelay, bool gaveUp) {
+        for (DisplayManagerSeat *seat: m_seats) {
+            if (seat->Name() == name)
+                seat->setRestartState(failureCount, retryDelay, gaveUp);
+        }
+    }
+
     void DisplayManager::AddSession(const QString &name, const QString &seat, const QString &user) {
         // create session object
         DisplayManagerSession *session = new DisplayManagerSession(name, seat, user, this);
@@ -129,6 +144,14 @@ namespace SDDM {
         }
     }
 
+    void DisplayManager::ReloadTheme() {
+        // the seats belong to the main thread
+        SeatManager *seatManager = daemonApp->seatManager();
+        QMetaObject::invokeMethod(seatManager, [seatManager] {
+            seatManager->reloadTheme();
+        }, Qt::QueuedConnection);
+    }
+
     DisplayManagerSeat::DisplayManagerSeat(const QString &name, QObject *parent)
         : QObject(parent), m_name(name), m_path(DISPLAYMANAGER_SEAT_PATH + name.mid(4)) {
         // create adaptor
@@ -149,7 +172,12 @@ namespace SDDM {
     }
 
     void DisplayManagerSeat::SwitchToGreeter() {
-        daemonApp->seatManager()->switchToGreeter(m_name);
+        // the seats belong to the main thread
+        SeatManager *seatManager = daemonApp->seatManager();
+        const QString name = m_name;
+        QMetaObject::invokeMethod(seatManager, [seatManager, name] {
+            seatManager->switchToGreeter(name);
+        }, Qt::QueuedConnection);
     }
 
     void DisplayManagerSeat::SwitchToGuest(const QString &/*session*/) {
@@ -168,6 +196,24 @@ namespace SDDM {
        return daemonApp->displayManager()->Sessions(this);
     }
 
+    int DisplayManagerSeat::FailureCount() const {
+        return m_failureCount;
+    }
+
+    int DisplayManagerSeat::RetryDelay() const {
+        return m_retryDelay;
+    }
+
+    bool DisplayManagerSeat::GaveUp() const {
+        return m_gaveUp;
+    }
+
+    void DisplayManagerSeat::setRestartState(int failureCount, int retryDelay, bool gaveUp) {
+        m_failureCount = failureCount;
+        m_retryDelay = retryDelay;
+        m_gaveUp = gaveUp;
+    }
+
     DisplayManagerSession::DisplayManagerSession(const QString &name, const QString &seat, const QString &user, QObject *parent)
         : QObject(parent), m_name(name), m_path(DISPLAYMANAGER_SESSION_PATH + name.mid(7)), m_seat(seat), m_user(user) {
         // create adaptor
@@ -202,4 +248,28 @@ namespace SDDM {
     const QString &DisplayManagerSession::User() const {
         return m_user;
     }
+
+    DisplayManagerMetrics::DisplayManagerMetrics(QObject *parent) : QObject(parent) {
+        // histogram buckets travel as "at" inside the a{sv}
+        qDBusRegisterMetaType<QList<quint64>>();
+
+        // create adaptor
+        new MetricsAdaptor(this);
+
+        // register object
+        QDBusConnection connection = (daemonApp->testing()) ? QDBusConnection::sessionBus() : QDBusConnection::systemBus();
+        connection.registerObject(DISPLAYMANAGER_METRICS_PATH, this);
+    }
+
+    QVariantMap DisplayManagerMetrics::Counters() const {
+        return Metrics::counters();
+    }
+
+    QVariantMap DisplayManagerMetrics::Histograms() const {
+        return Metrics::histograms();
+    }
+
+    QList<quint64> DisplayManagerMetrics::BucketBounds() const {
+        return Metrics::bucketBounds();
+    }
 }
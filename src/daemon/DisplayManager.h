@@ -24,8 +24,10 @@
 
 #include <QDBusObjectPath>
 #include <QList>
+#include <QVariantMap>
 
 namespace SDDM {
+    class DisplayManagerMetrics;
     class DisplayManagerSeat;
     class DisplayManagerSession;
 
@@ -34,6 +36,11 @@ namespace SDDM {
 
     /***************************************************************************
      * org.freedesktop.DisplayManager
+     *
+     * The objects live on the daemon's bus thread so that they keep
+     * answering while the main thread waits for a process. They only
+     * talk to the seats through queued calls and keep copies of what
+     * they report.
      **************************************************************************/
     class DisplayManager : public QObject {
         Q_OBJECT
@@ -55,6 +62,12 @@ namespace SDDM {
         void AddSession(const QString &name, const QString &seat, const QString &user);
         void RemoveSession(const QString &name);
 
+        // the running greeters pick up Theme/Current and the theme files
+        // again, without restarting their displays
+        void ReloadTheme();
+
+        void updateSeatRestartState(const QString &name, int failureCount, int retryDelay, bool gaveUp);
+
     signals:
         void SeatAdded(ObjectPath seat);
         void SeatRemoved(ObjectPath seat);
@@ -64,6 +77,24 @@ namespace SDDM {
     private:
         QList<DisplayManagerSeat *> m_seats;
         QList<DisplayManagerSession *> m_sessions;
+        DisplayManagerMetrics *m_metrics { nullptr };
+    };
+
+    /***************************************************************************
+     * org.freedesktop.DisplayManager.Metrics
+     **************************************************************************/
+    class DisplayManagerMetrics: public QObject {
+        Q_OBJECT
+        Q_DISABLE_COPY(DisplayManagerMetrics)
+        Q_PROPERTY(QVariantMap Counters READ Counters)
+        Q_PROPERTY(QVariantMap Histograms READ Histograms)
+        Q_PROPERTY(QList<quint64> BucketBounds READ BucketBounds CONSTANT)
+    public:
+        DisplayManagerMetrics(QObject *parent = 0);
+
+        QVariantMap Counters() const;
+        QVariantMap Histograms() const;
+        QList<quint64> BucketBounds() const;
     };
 
     /***************************************************************************
@@ -75,6 +106,9 @@ namespace SDDM {
         Q_PROPERTY(bool CanSwitch READ CanSwitch CONSTANT)
         Q_PROPERTY(bool HasGuestAccount READ HasGuestAccount CONSTANT)
         Q_PROPERTY(QList<QDBusObjectPath> Sessions READ Sessions CONSTANT)
+        Q_PROPERTY(int FailureCount READ FailureCount)
+        Q_PROPERTY(int RetryDelay READ RetryDelay)
+        Q_PROPERTY(bool GaveUp READ GaveUp)
     public:
         DisplayManagerSeat(const QString &name, QObject *parent = 0);
 
@@ -90,9 +124,19 @@ namespace SDDM {
         bool HasGuestAccount() { return false; }
         ObjectPathList Sessions();
 
+        // restart state of the seat's display
+        int FailureCount() const;
+        int RetryDelay() const;
+        bool GaveUp() const;
+
+        void setRestartState(int failureCount, int retryDelay, bool gaveUp);
+
     private:
         QString m_name;
         QString m_path;
+        int m_failureCount { 0 };
+        int m_retryDelay { 0 };
+        bool m_gaveUp { false };
     };
 
     /***************************************************************************
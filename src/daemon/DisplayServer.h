@@ -49,6 +49,9 @@ namespace SDDM {
     signals:
         void started();
         void stopped();
+        void failed();
+        // emitted by setupDisplay() once the greeter may be started
+        void setupFinished();
 
     protected:
         bool m_started { false };
@@ -23,14 +23,22 @@
 #include "Constants.h"
 #include "DaemonApp.h"
 #include "DisplayManager.h"
+#include "GreeterFonts.h"
+#include "ProcessPolicy.h"
+#include "ProcessSupervisor.h"
 #include "Seat.h"
+#include "ThemeBundle.h"
+#include "SystemdNotify.h"
 #include "ThemeConfig.h"
 #include "ThemeMetadata.h"
+#include "Trace.h"
 #include "Display.h"
 #include "XorgUserDisplayServer.h"
 #include "WaylandDisplayServer.h"
 
 #include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
 #include <QtCore/QProcess>
 
 namespace SDDM {
@@ -44,6 +52,7 @@ namespace SDDM {
 
     Greeter::~Greeter() {
         stop();
+        removeThemeConfigSnapshot();
 
         delete m_metadata;
         delete m_themeConfig;
@@ -59,19 +68,51 @@ namespace SDDM {
 
     void Greeter::setTheme(const QString &theme) {
         m_themePath = theme;
+        removeThemeConfigSnapshot();
 
         if (theme.isEmpty()) {
             m_metadata->setTo(QString());
             m_themeConfig->setTo(QString());
         } else {
-            const QString path = QStringLiteral("%1/metadata.desktop").arg(m_themePath);
+            // the greeter still gets the bundle and maps it on its own
+            const bool bundle = ThemeBundle::isBundle(theme);
+            const QString directory = bundle ? ThemeBundle::mount(theme) : theme;
+            const QString path = QStringLiteral("%1/metadata.desktop").arg(directory);
             m_metadata->setTo(path);
 
-            QString configFile = QStringLiteral("%1/%2").arg(m_themePath).arg(m_metadata->configFile());
+            QString configFile = QStringLiteral("%1/%2").arg(directory).arg(m_metadata->configFile());
             m_themeConfig->setTo(configFile);
+
+            // both are read by now
+            if (bundle && !directory.isEmpty())
+                ThemeBundle::unmount(directory);
+
+            // spare the greeter from reading the same files again, one
+            // snapshot per greeter, named after its socket
+            const QString snapshot = QStringLiteral(RUNTIME_DIR "/theme-%1.conf.snapshot").arg(QFileInfo(m_socket).fileName());
+            if (m_themeConfig->saveSnapshot(snapshot))
+                m_themeConfigSnapshot = snapshot;
         }
     }
 
+    QString Greeter::themePath() const
+    {
+        return m_themePath;
+    }
+
+    QString Greeter::themeConfigSnapshot() const
+    {
+        return m_themeConfigSnapshot;
+    }
+
+    void Greeter::removeThemeConfigSnapshot()
+    {
+        if (m_themeConfigSnapshot.isEmpty())
+            return;
+        QFile::remove(m_themeConfigSnapshot);
+        m_themeConfigSnapshot.clear();
+    }
+
     QString Greeter::displayServerCommand() const
     {
         return m_displayServerCmd;
@@ -115,7 +156,7 @@ namespace SDDM {
         Q_ASSERT(m_display);
         if (daemonApp->testing()) {
             // create process
-            m_process = new QProcess(this);
+            m_process = new PolicyProcess(ProcessPolicy::forRole(ProcessPolicy::Role::Greeter), this);
 
             // delete process on finish
             connect(m_process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, &Greeter::finished);
@@ -136,27 +177,39 @@ namespace SDDM {
                 env.insert(QStringLiteral("XCURSOR_THEME"), xcursorTheme);
                 if (!xcursorSize.isEmpty())
                     env.insert(QStringLiteral("XCURSOR_SIZE"), xcursorSize);
+                if (!m_themeConfigSnapshot.isEmpty())
+                    env.insert(QStringLiteral(THEME_CONFIG_SNAPSHOT_VARIABLE), m_themeConfigSnapshot);
+                if (!GreeterFonts::configFile().isEmpty())
+                    env.insert(QStringLiteral("FONTCONFIG_FILE"), GreeterFonts::configFile());
                 m_process->setProcessEnvironment(env);
             }
             // Greeter command
-            m_process->start(QStringLiteral("%1/sddm-greeter").arg(QStringLiteral(BIN_INSTALL_DIR)), args);
+            const QString greeterPath = daemonApp->greeterPath().isEmpty()
+                    ? QStringLiteral("%1/sddm-greeter").arg(QStringLiteral(BIN_INSTALL_DIR))
+                    : daemonApp->greeterPath();
 
-            //if we fail to start bail immediately, and don't block in waitForStarted
+            // the start is reported without waiting for it
+            ProcessSupervisor *supervisor = ProcessSupervisor::of(m_process);
+            connect(supervisor, &ProcessSupervisor::started, this, [this] {
+                // log message
+                qDebug() << "Greeter started.";
+                Trace::mark("greeter-process-started", m_display->name());
+                SystemdNotify::ready(QStringLiteral("Greeter started on display %1").arg(m_display->name()));
+            });
+            connect(supervisor, &ProcessSupervisor::failedToStart, this, [this] (const QString &error) {
+                qCritical() << "Failed to start greeter:" << error;
+                finished();
+            });
+
+            m_process->start(greeterPath, args);
+
+            //if we fail to start bail immediately
             if (m_process->state() == QProcess::NotRunning) {
                 qCritical() << "Greeter failed to launch.";
+                m_process->deleteLater();
+                m_process = nullptr;
                 return false;
             }
-            // wait for greeter to start
-            if (!m_process->waitForStarted()) {
-                // log message
-                qCritical() << "Failed to start greeter.";
-
-                // return fail
-                return false;
-            }
-
-            // log message
-            qDebug() << "Greeter started.";
 
             // set flag
             m_started = true;
@@ -187,13 +240,18 @@ namespace SDDM {
                                    QStringLiteral("LD_LIBRARY_PATH"),
                                    QStringLiteral("QML2_IMPORT_PATH"),
                                    QStringLiteral("QT_PLUGIN_PATH"),
-                                   QStringLiteral("XDG_DATA_DIRS")
+                                   QStringLiteral("XDG_DATA_DIRS"),
+                                   QStringLiteral(CONFIG_SNAPSHOT_VARIABLE)
             }, sysenv, env);
 
             env.insert(QStringLiteral("PATH"), mainConfig.Users.DefaultPath.get());
+            if (!m_themeConfigSnapshot.isEmpty())
+                env.insert(QStringLiteral(THEME_CONFIG_SNAPSHOT_VARIABLE), m_themeConfigSnapshot);
             env.insert(QStringLiteral("XCURSOR_THEME"), xcursorTheme);
             if (!xcursorSize.isEmpty())
                 env.insert(QStringLiteral("XCURSOR_SIZE"), xcursorSize);
+            if (!GreeterFonts::configFile().isEmpty())
+                env.insert(QStringLiteral("FONTCONFIG_FILE"), GreeterFonts::configFile());
             env.insert(QStringLiteral("XDG_SEAT"), m_display->seat()->name());
             env.insert(QStringLiteral("XDG_SEAT_PATH"), daemonApp->displayManager()->seatPath(m_display->seat()->name()));
             env.insert(QStringLiteral("XDG_SESSION_PATH"), daemonApp->displayManager()->sessionPath(QStringLiteral("Session%1").arg(daemonApp->newSessionId())));
@@ -235,21 +293,42 @@ namespace SDDM {
 
     void Greeter::stop() {
         // check flag
-        if (!m_started)
+        if (!m_started) {
+            Q_EMIT stopped();
             return;
+        }
 
         // log message
         qDebug() << "Greeter stopping...";
 
-        if (daemonApp->testing()) {
-            // terminate process
-            m_process->terminate();
+        // only the running greeter reads it
+        removeThemeConfigSnapshot();
 
-            // wait for finished
-            if (!m_process->waitForFinished(5000))
-                m_process->kill();
+        if (daemonApp->testing()) {
+            // the process terminates on its own, a greeter started
+            // meanwhile gets a new one
+            ProcessSupervisor *supervisor = ProcessSupervisor::of(m_process);
+            disconnect(m_process, nullptr, this, nullptr);
+            disconnect(supervisor, nullptr, this, nullptr);
+            supervisor->release(5000);
+            m_process = nullptr;
+            finished();
         } else {
-            m_auth->stop();
+            // the helper goes on its own like the process above, and
+            // stopped() tells when it let go of the VT
+            Auth *auth = m_auth;
+            m_auth = nullptr;
+            disconnect(auth, nullptr, this, nullptr);
+            m_started = false;
+            qDebug() << "Greeter stopped.";
+            if (auth->isActive()) {
+                connect(auth, &Auth::finished, this, &Greeter::stopped);
+                connect(auth, &Auth::finished, auth, &QObject::deleteLater);
+                auth->stop();
+            } else {
+                auth->deleteLater();
+                Q_EMIT stopped();
+            }
         }
     }
 
@@ -265,10 +344,13 @@ namespace SDDM {
         qDebug() << "Greeter stopped.";
 
         // clean up
+        removeThemeConfigSnapshot();
         if (m_process) {
             m_process->deleteLater();
             m_process = nullptr;
         }
+
+        Q_EMIT stopped();
     }
 
     void Greeter::onRequestChanged() {
@@ -280,10 +362,13 @@ namespace SDDM {
         m_started = success;
 
         // log message
-        if (success)
+        if (success) {
+            Trace::mark("greeter-process-started", m_display->name());
+            SystemdNotify::ready(QStringLiteral("Greeter started on display %1").arg(m_display->name()));
             qDebug() << "Greeter session started successfully";
-        else
+        } else {
             qDebug() << "Greeter session failed to start";
+        }
     }
 
     void Greeter::onDisplayServerReady(const QString &displayName)
@@ -307,12 +392,15 @@ namespace SDDM {
         qDebug() << "Greeter stopped." << status;
 
         // clean up
+        removeThemeConfigSnapshot();
         m_auth->deleteLater();
         m_auth = nullptr;
 
         if (status == Auth::HELPER_SESSION_ERROR) {
             Q_EMIT failed();
         }
+
+        Q_EMIT stopped();
     }
 
     bool Greeter::isRunning() const {
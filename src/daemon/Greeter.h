@@ -41,6 +41,8 @@ namespace SDDM {
         void setAuthPath(const QString &authPath);
         void setSocket(const QString &socket);
         void setTheme(const QString &theme);
+        QString themePath() const;
+        QString themeConfigSnapshot() const;
 
         QString displayServerCommand() const;
         void setDisplayServerCommand(const QString &cmd);
@@ -63,6 +65,8 @@ namespace SDDM {
 
     signals:
         void failed();
+        // once the greeter has exited, after stop() or on its own
+        void stopped();
 
     private:
         bool m_started { false };
@@ -74,10 +78,14 @@ namespace SDDM {
         QString m_displayServerCmd;
         ThemeMetadata *m_metadata { nullptr };
         ThemeConfig *m_themeConfig { nullptr };
+        // where the greeter can read m_themeConfig from, if it was saved
+        QString m_themeConfigSnapshot;
 
         Auth *m_auth { nullptr };
         QProcess *m_process { nullptr };
 
+        void removeThemeConfigSnapshot();
+
         static void insertEnvironmentList(QStringList names, QProcessEnvironment sourceEnv, QProcessEnvironment &targetEnv);
     };
 }
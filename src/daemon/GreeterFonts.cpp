@@ -0,0 +1,105 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "GreeterFonts.h"
+
+#include "Configuration.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QProcess>
+#include <QSaveFile>
+
+namespace SDDM {
+    namespace GreeterFonts {
+        static QString directory() {
+            return QStringLiteral("%1/fontconfig").arg(stateDirectory());
+        }
+
+        QString configFile() {
+            if (mainConfig.Theme.FontDirs.get().isEmpty())
+                return QString();
+            return QStringLiteral("%1/fonts.conf").arg(directory());
+        }
+
+        bool writeConfig() {
+            const QString path = configFile();
+            if (path.isEmpty())
+                return false;
+
+            QByteArray contents;
+            contents += "<?xml version=\"1.0\"?>\n"
+                        "<!DOCTYPE fontconfig SYSTEM \"urn:fontconfig:fonts.dtd\">\n"
+                        "<!-- Generated by sddm from Theme/FontDirs, don't edit -->\n"
+                        "<fontconfig>\n";
+            for (const QString &dir : mainConfig.Theme.FontDirs.ref())
+                contents += "  <dir>" + dir.toHtmlEscaped().toUtf8() + "</dir>\n";
+            contents += "  <cachedir>" + QStringLiteral("%1/cache").arg(directory()).toHtmlEscaped().toUtf8() + "</cachedir>\n"
+                        // aliases and rendering settings of the system
+                        "  <include ignore_missing=\"yes\">/etc/fonts/conf.d</include>\n"
+                        "</fontconfig>\n";
+
+            QFile current(path);
+            if (current.open(QIODevice::ReadOnly) && current.readAll() == contents)
+                return false;
+
+            if (!QDir().mkpath(directory())) {
+                qWarning() << "Unable to create" << directory();
+                return false;
+            }
+
+            QSaveFile file(path);
+            if (!file.open(QIODevice::WriteOnly)) {
+                qWarning() << "Unable to write" << path << file.errorString();
+                return false;
+            }
+            file.write(contents);
+            return file.commit();
+        }
+
+        bool updateCache(bool wait) {
+            const QString path = configFile();
+            if (path.isEmpty())
+                return false;
+
+            QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+            env.insert(QStringLiteral("FONTCONFIG_FILE"), path);
+
+            QProcess *process = new QProcess();
+            process->setProcessEnvironment(env);
+            process->setProcessChannelMode(QProcess::ForwardedChannels);
+            process->start(QStringLiteral("fc-cache"), { QStringLiteral("--force") });
+            if (!process->waitForStarted()) {
+                qWarning() << "Unable to run fc-cache:" << process->errorString();
+                delete process;
+                return false;
+            }
+
+            if (!wait) {
+                QObject::connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), process, &QObject::deleteLater);
+                return true;
+            }
+
+            const bool success = process->waitForFinished(-1) && process->exitStatus() == QProcess::NormalExit && process->exitCode() == 0;
+            delete process;
+            return success;
+        }
+    }
+}
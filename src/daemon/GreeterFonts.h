@@ -0,0 +1,46 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_GREETERFONTS_H
+#define SDDM_GREETERFONTS_H
+
+#include <QString>
+
+namespace SDDM {
+    /**
+     * The fontconfig setup of the greeter with Theme/FontDirs: only the
+     * listed directories are scanned, and the cache lives in the state
+     * directory, built ahead by root, so that the first frame doesn't
+     * wait for fontconfig to go through every installed font.
+     */
+    namespace GreeterFonts {
+        // set as FONTCONFIG_FILE for the greeter, empty when not in use
+        QString configFile();
+
+        // writes configFile() for the current configuration, returns
+        // true if it changed and the cache should be rebuilt
+        bool writeConfig();
+
+        // runs fc-cache for configFile(), in the background unless
+        // @p wait is set; returns false if it couldn't be run or failed
+        bool updateCache(bool wait);
+    }
+}
+
+#endif // SDDM_GREETERFONTS_H
@@ -0,0 +1,348 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "LogindStateCache.h"
+
+#include "LogindDBusTypes.h"
+
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDBusVariant>
+#include <QDebug>
+#include <QMutexLocker>
+
+#include <memory>
+
+namespace SDDM {
+    static const QString PROPERTIES_IFACE = QStringLiteral("org.freedesktop.DBus.Properties");
+
+    LogindStateCache::LogindStateCache(QObject *parent) : QObject(parent) {
+    }
+
+    void LogindStateCache::initialize() {
+        if (!Logind::isAvailable()) {
+            setReady();
+            return;
+        }
+
+        QDBusConnection bus = QDBusConnection::systemBus();
+
+        // subscribe before listing so nothing falls in between
+        bus.connect(Logind::serviceName(), Logind::managerPath(), Logind::managerIfaceName(), QStringLiteral("SessionNew"), this, SLOT(sessionNew(QString,QDBusObjectPath)));
+        bus.connect(Logind::serviceName(), Logind::managerPath(), Logind::managerIfaceName(), QStringLiteral("SessionRemoved"), this, SLOT(sessionRemoved(QString,QDBusObjectPath)));
+        bus.connect(Logind::serviceName(), Logind::managerPath(), Logind::managerIfaceName(), QStringLiteral("SeatNew"), this, SLOT(seatNew(QString,QDBusObjectPath)));
+        bus.connect(Logind::serviceName(), Logind::managerPath(), Logind::managerIfaceName(), QStringLiteral("SeatRemoved"), this, SLOT(seatGone(QString,QDBusObjectPath)));
+        // an empty path matches the changes of every session and seat
+        bus.connect(Logind::serviceName(), QString(), PROPERTIES_IFACE, QStringLiteral("PropertiesChanged"), this, SLOT(propertiesChanged(QString,QVariantMap,QStringList,QDBusMessage)));
+
+        // fetch seats
+        auto listSeatsMsg = QDBusMessage::createMethodCall(Logind::serviceName(), Logind::managerPath(), Logind::managerIfaceName(), QStringLiteral("ListSeats"));
+        QDBusPendingReply<NamedSeatPathList> seatsReply = bus.asyncCall(listSeatsMsg);
+        QDBusPendingCallWatcher *seatsWatcher = new QDBusPendingCallWatcher(seatsReply, this);
+        connect(seatsWatcher, &QDBusPendingCallWatcher::finished, this, [=]() {
+            seatsWatcher->deleteLater();
+            if (seatsReply.isError()) {
+                // nothing more is coming
+                qWarning() << "Failed to list seats:" << seatsReply.error().message();
+                emit seatsFetched(false);
+                return;
+            }
+
+            const auto seats = seatsReply.value();
+            for (const NamedSeatPath &seat : seats) {
+                {
+                    QMutexLocker lock(&m_mutex);
+                    if (m_seats.contains(seat.name))
+                        continue;
+
+                    SeatState state;
+                    state.name = seat.name;
+                    state.path = seat.path;
+                    m_seats.insert(state.name, state);
+                    m_seatsByPath.insert(state.path.path(), state.name);
+                }
+
+                ++m_initialSeatFetches;
+                fetchSeat(seat.name, seat.path, true);
+            }
+
+            if (m_initialSeatFetches == 0)
+                emit seatsFetched(true);
+        });
+
+        // fetch sessions, ready once all of them have their properties
+        auto listSessionsMsg = QDBusMessage::createMethodCall(Logind::serviceName(), Logind::managerPath(), Logind::managerIfaceName(), QStringLiteral("ListSessions"));
+        QDBusPendingReply<SessionInfoList> sessionsReply = bus.asyncCall(listSessionsMsg);
+        QDBusPendingCallWatcher *sessionsWatcher = new QDBusPendingCallWatcher(sessionsReply, this);
+        connect(sessionsWatcher, &QDBusPendingCallWatcher::finished, this, [=]() {
+            sessionsWatcher->deleteLater();
+            if (sessionsReply.isError())
+                qWarning() << "Failed to list sessions:" << sessionsReply.error().message();
+
+            const auto sessions = sessionsReply.value();
+            for (const SessionInfo &info : sessions) {
+                {
+                    QMutexLocker lock(&m_mutex);
+                    if (m_sessions.contains(info.sessionId))
+                        continue;
+
+                    SessionState session;
+                    session.id = info.sessionId;
+                    session.user = info.userName;
+                    session.seat = info.seatId;
+                    session.path = info.sessionPath;
+                    m_sessions.insert(session.id, session);
+                    m_sessionsByUser.insert(session.user, session.id);
+                    m_sessionsByPath.insert(session.path.path(), session.id);
+                }
+
+                ++m_initialFetches;
+                fetchSession(info.sessionId, info.sessionPath, true);
+            }
+
+            if (m_initialFetches == 0)
+                setReady();
+        });
+    }
+
+    void LogindStateCache::setReady() {
+        {
+            QMutexLocker lock(&m_mutex);
+            m_ready = true;
+        }
+        emit ready();
+    }
+
+    bool LogindStateCache::isReady() const {
+        QMutexLocker lock(&m_mutex);
+        return m_ready;
+    }
+
+    QList<LogindStateCache::SessionState> LogindStateCache::sessionsOfUser(const QString &user) const {
+        QMutexLocker lock(&m_mutex);
+        QList<SessionState> sessions;
+        for (auto it = m_sessionsByUser.constFind(user); it != m_sessionsByUser.constEnd() && it.key() == user; ++it)
+            sessions << m_sessions.value(it.value());
+        return sessions;
+    }
+
+    void LogindStateCache::findSession(const QString &user, const QString &service, const QString &state,
+                                       QObject *context, const std::function<void(const QString &)> &done) const {
+        QList<SessionState> candidates;
+        {
+            QMutexLocker lock(&m_mutex);
+            for (auto it = m_sessionsByUser.constFind(user); it != m_sessionsByUser.constEnd() && it.key() == user; ++it) {
+                const SessionState &session = m_sessions[it.value()];
+                if (session.service == service)
+                    candidates << session;
+            }
+        }
+
+        if (candidates.isEmpty()) {
+            done(QString());
+            return;
+        }
+
+        // ask for all states at once, the first candidate in the list wins
+        struct Lookup {
+            QVector<QString> states;
+            int pending { 0 };
+        };
+        auto lookup = std::make_shared<Lookup>();
+        lookup->states.resize(candidates.count());
+        lookup->pending = candidates.count();
+
+        for (int i = 0; i < candidates.count(); ++i) {
+            auto get = QDBusMessage::createMethodCall(Logind::serviceName(), candidates.at(i).path.path(), PROPERTIES_IFACE, QStringLiteral("Get"));
+            get << Logind::sessionIfaceName() << QStringLiteral("State");
+
+            QDBusPendingReply<QDBusVariant> reply = QDBusConnection::systemBus().asyncCall(get);
+            QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(reply, context);
+            connect(watcher, &QDBusPendingCallWatcher::finished, context, [=]() {
+                watcher->deleteLater();
+                // a session that went away in between has no state
+                if (reply.isValid())
+                    lookup->states[i] = reply.value().variant().toString();
+                if (--lookup->pending > 0)
+                    return;
+
+                for (int j = 0; j < candidates.count(); ++j) {
+                    if (lookup->states.at(j) == state) {
+                        done(candidates.at(j).id);
+                        return;
+                    }
+                }
+                done(QString());
+            });
+        }
+    }
+
+    QList<LogindStateCache::SeatState> LogindStateCache::seats() const {
+        QMutexLocker lock(&m_mutex);
+        return m_seats.values();
+    }
+
+    bool LogindStateCache::canGraphical(const QString &seat) const {
+        QMutexLocker lock(&m_mutex);
+        return m_seats.value(seat).canGraphical;
+    }
+
+    void LogindStateCache::sessionNew(const QString &id, const QDBusObjectPath &path) {
+        {
+            QMutexLocker lock(&m_mutex);
+            if (m_sessions.contains(id))
+                return;
+
+            SessionState session;
+            session.id = id;
+            session.path = path;
+            m_sessions.insert(id, session);
+            m_sessionsByPath.insert(path.path(), id);
+        }
+
+        // user and service arrive with the properties
+        fetchSession(id, path);
+    }
+
+    void LogindStateCache::sessionRemoved(const QString &id, const QDBusObjectPath &path) {
+        QMutexLocker lock(&m_mutex);
+        if (!m_sessions.contains(id))
+            return;
+
+        const SessionState session = m_sessions.take(id);
+        m_sessionsByUser.remove(session.user, id);
+        m_sessionsByPath.remove(path.path());
+    }
+
+    void LogindStateCache::seatNew(const QString &name, const QDBusObjectPath &path) {
+        {
+            QMutexLocker lock(&m_mutex);
+            if (m_seats.contains(name))
+                return;
+
+            SeatState seat;
+            seat.name = name;
+            seat.path = path;
+            m_seats.insert(name, seat);
+            m_seatsByPath.insert(path.path(), name);
+        }
+
+        fetchSeat(name, path);
+    }
+
+    void LogindStateCache::seatGone(const QString &name, const QDBusObjectPath &path) {
+        {
+            QMutexLocker lock(&m_mutex);
+            if (!m_seats.contains(name))
+                return;
+
+            m_seats.remove(name);
+            m_seatsByPath.remove(path.path());
+        }
+
+        emit seatRemoved(name);
+    }
+
+    void LogindStateCache::propertiesChanged(const QString &interface, const QVariantMap &changed,
+                                             const QStringList &invalidated, const QDBusMessage &message) {
+        const QString path = message.path();
+
+        // the kept session properties don't change
+        if (interface == Logind::seatIfaceName() && m_seatsByPath.contains(path)) {
+            const QString name = m_seatsByPath.value(path);
+            updateSeat(name, changed);
+            if (!invalidated.isEmpty())
+                fetchSeat(name, m_seats.value(name).path);
+        }
+    }
+
+    void LogindStateCache::fetchSession(const QString &id, const QDBusObjectPath &path, bool initial) {
+        auto getAll = QDBusMessage::createMethodCall(Logind::serviceName(), path.path(), PROPERTIES_IFACE, QStringLiteral("GetAll"));
+        getAll << Logind::sessionIfaceName();
+
+        QDBusPendingReply<QVariantMap> reply = QDBusConnection::systemBus().asyncCall(getAll);
+        QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(reply, this);
+        connect(watcher, &QDBusPendingCallWatcher::finished, this, [=]() {
+            watcher->deleteLater();
+            if (reply.isValid())
+                updateSession(id, reply.value());
+
+            if (initial && --m_initialFetches == 0)
+                setReady();
+        });
+    }
+
+    void LogindStateCache::fetchSeat(const QString &name, const QDBusObjectPath &path, bool initial) {
+        auto getAll = QDBusMessage::createMethodCall(Logind::serviceName(), path.path(), PROPERTIES_IFACE, QStringLiteral("GetAll"));
+        getAll << Logind::seatIfaceName();
+
+        QDBusPendingReply<QVariantMap> reply = QDBusConnection::systemBus().asyncCall(getAll);
+        QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(reply, this);
+        connect(watcher, &QDBusPendingCallWatcher::finished, this, [=]() {
+            watcher->deleteLater();
+            if (reply.isValid())
+                updateSeat(name, reply.value());
+
+            if (initial && --m_initialSeatFetches == 0)
+                emit seatsFetched(true);
+        });
+    }
+
+    void LogindStateCache::updateSession(const QString &id, const QVariantMap &properties) {
+        QMutexLocker lock(&m_mutex);
+
+        // the session may have gone while its properties were in flight
+        auto it = m_sessions.find(id);
+        if (it == m_sessions.end())
+            return;
+
+        const QString name = QStringLiteral("Name");
+        if (properties.contains(name)) {
+            const QString user = properties.value(name).toString();
+            if (user != it->user) {
+                m_sessionsByUser.remove(it->user, id);
+                it->user = user;
+                m_sessionsByUser.insert(user, id);
+            }
+        }
+
+        const QString service = QStringLiteral("Service");
+        if (properties.contains(service))
+            it->service = properties.value(service).toString();
+    }
+
+    void LogindStateCache::updateSeat(const QString &name, const QVariantMap &properties) {
+        const QString canGraphical = QStringLiteral("CanGraphical");
+        if (!properties.contains(canGraphical))
+            return;
+        const bool value = properties.value(canGraphical).toBool();
+
+        {
+            QMutexLocker lock(&m_mutex);
+            auto it = m_seats.find(name);
+            if (it == m_seats.end() || value == it->canGraphical)
+                return;
+            it->canGraphical = value;
+        }
+
+        emit canGraphicalChanged(name, value);
+    }
+}
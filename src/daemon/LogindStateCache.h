@@ -0,0 +1,128 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_LOGINDSTATECACHE_H
+#define SDDM_LOGINDSTATECACHE_H
+
+#include <QDBusObjectPath>
+#include <QHash>
+#include <QMultiHash>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QVariantMap>
+
+#include <functional>
+
+class QDBusMessage;
+
+namespace SDDM {
+    /**
+     * Mirror of the logind (or ConsoleKit2) sessions and seats.
+     *
+     * It is filled asynchronously once and then kept up to date from the
+     * manager's SessionNew/SessionRemoved/SeatNew/SeatRemoved signals and
+     * the seats' PropertiesChanged, so lookups never touch the bus.
+     *
+     * Only the fields of a session that never change are kept. Its State
+     * changes without PropertiesChanged, findSession() reads it from the
+     * bus for the sessions that qualify otherwise.
+     *
+     * It lives on the daemon's bus thread, the lookups may be used from
+     * any thread and its signals reach the seats and displays queued.
+     */
+    class LogindStateCache : public QObject {
+        Q_OBJECT
+        Q_DISABLE_COPY(LogindStateCache)
+    public:
+        struct SessionState {
+            QString id;
+            QString user;
+            QString service;
+            QString seat;
+            QDBusObjectPath path;
+        };
+
+        struct SeatState {
+            QString name;
+            QDBusObjectPath path;
+            bool canGraphical { false };
+        };
+
+        explicit LogindStateCache(QObject *parent = nullptr);
+
+    public slots:
+        // to be called on the thread the cache lives in
+        void initialize();
+
+    public:
+        // true once the initial session list has been read
+        bool isReady() const;
+
+        QList<SessionState> sessionsOfUser(const QString &user) const;
+        // first session of @p user with the given service and state, an
+        // empty id if there is none; @p done is called in the thread of
+        // @p context, right away when no session of the service exists
+        void findSession(const QString &user, const QString &service, const QString &state,
+                         QObject *context, const std::function<void(const QString &)> &done) const;
+
+        QList<SeatState> seats() const;
+        bool canGraphical(const QString &seat) const;
+
+    signals:
+        void ready();
+        // the initial seat list has been read, with the properties of each
+        // seat; @p listed is false when logind failed to list them
+        void seatsFetched(bool listed);
+
+        void seatRemoved(const QString &name);
+        void canGraphicalChanged(const QString &name, bool canGraphical);
+
+    private slots:
+        void sessionNew(const QString &id, const QDBusObjectPath &path);
+        void sessionRemoved(const QString &id, const QDBusObjectPath &path);
+        void seatNew(const QString &name, const QDBusObjectPath &path);
+        void seatGone(const QString &name, const QDBusObjectPath &path);
+        void propertiesChanged(const QString &interface, const QVariantMap &changed,
+                               const QStringList &invalidated, const QDBusMessage &message);
+
+    private:
+        void setReady();
+        void fetchSession(const QString &id, const QDBusObjectPath &path, bool initial = false);
+        void fetchSeat(const QString &name, const QDBusObjectPath &path, bool initial = false);
+        void updateSession(const QString &id, const QVariantMap &properties);
+        void updateSeat(const QString &name, const QVariantMap &properties);
+
+        // guards everything below, written on the bus thread only
+        mutable QMutex m_mutex;
+
+        bool m_ready { false };
+        int m_initialFetches { 0 };
+        int m_initialSeatFetches { 0 };
+
+        QHash<QString, SessionState> m_sessions;
+        QMultiHash<QString, QString> m_sessionsByUser;
+        QHash<QString, QString> m_sessionsByPath;
+
+        QHash<QString, SeatState> m_seats;
+        QHash<QString, QString> m_seatsByPath;
+    };
+}
+
+#endif // SDDM_LOGINDSTATECACHE_H
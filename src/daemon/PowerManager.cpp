@@ -23,10 +23,18 @@
 #include "DaemonApp.h"
 #include "Messages.h"
 
-#include <QDBusConnectionInterface>
+#include <QDBusConnection>
 #include <QDBusInterface>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
 #include <QDBusReply>
+#include <QDebug>
+#include <QHash>
 #include <QProcess>
+#include <QTimer>
+
+#include <functional>
 
 namespace SDDM {
     /************************************************/
@@ -40,13 +48,83 @@ namespace SDDM {
         virtual ~PowerManagerBackend() {
         }
 
-        virtual Capabilities capabilities() const = 0;
+        Capabilities capabilities() const {
+            return m_caps;
+        }
+
+        // queries the backend asynchronously, done is called once the
+        // cached capabilities have been updated
+        virtual void refresh(QObject *context, const std::function<void()> &done) = 0;
+
+        // starts the action without waiting for it, done gets an error
+        // message once it failed or an empty string once it went through
+        virtual void run(Capability action, QObject *context, const PowerManager::Done &done) const = 0;
+
+    protected:
+        // calls method without blocking, done gets the outcome
+        static void callAsync(QDBusInterface *interface, const QString &method, const QVariantList &args,
+                              QObject *context, const PowerManager::Done &done) {
+            QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(interface->asyncCallWithArgumentList(method, args), context);
+            QObject::connect(watcher, &QDBusPendingCallWatcher::finished, context, [done, method](QDBusPendingCallWatcher *watcher) {
+                watcher->deleteLater();
+                if (watcher->isError())
+                    done(QStringLiteral("%1 failed: %2").arg(method, watcher->error().message()));
+                else
+                    done(QString());
+            });
+        }
+
+        struct Query {
+            QString method;
+            Capability capability;
+            QVariant expected;
+        };
+
+        void query(QDBusInterface *interface, Capabilities caps, const QVector<Query> &queries,
+                   QObject *context, const std::function<void()> &done) {
+            // only one round of queries at a time, changes arriving
+            // meanwhile get picked up by a second round
+            if (m_pending > 0) {
+                m_refreshAgain = true;
+                return;
+            }
+
+            m_nextCaps = caps;
+            m_pending = queries.size();
+            if (m_pending == 0) {
+                m_caps = m_nextCaps;
+                done();
+                return;
+            }
 
-        virtual void powerOff() const = 0;
-        virtual void reboot() const = 0;
-        virtual void suspend() const = 0;
-        virtual void hibernate() const = 0;
-        virtual void hybridSleep() const = 0;
+            for (const Query &query : queries) {
+                QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(interface->asyncCall(query.method), context);
+                QObject::connect(watcher, &QDBusPendingCallWatcher::finished, context,
+                                 [this, interface, caps, queries, query, context, done](QDBusPendingCallWatcher *watcher) {
+                    const QDBusMessage reply = watcher->reply();
+                    if (reply.type() == QDBusMessage::ReplyMessage && reply.arguments().value(0) == query.expected)
+                        m_nextCaps |= query.capability;
+                    watcher->deleteLater();
+
+                    if (--m_pending > 0)
+                        return;
+
+                    m_caps = m_nextCaps;
+                    done();
+
+                    if (m_refreshAgain) {
+                        m_refreshAgain = false;
+                        this->query(interface, caps, queries, context, done);
+                    }
+                });
+            }
+        }
+
+    private:
+        Capabilities m_caps { Capability::None };
+        Capabilities m_nextCaps { Capability::None };
+        int m_pending { 0 };
+        bool m_refreshAgain { false };
     };
 
     /**********************************************/
@@ -67,49 +145,56 @@ const QString UPOWER_OBJECT = QStringLiteral("org.freedesktop.UPower");
             delete m_interface;
         }
 
-        Capabilities capabilities() const {
-            Capabilities caps = Capability::PowerOff | Capability::Reboot;
-
-            QDBusReply<bool> reply;
-
-            // suspend
-            reply = m_interface->call(QStringLiteral("SuspendAllowed"));
-            if (reply.isValid() && reply.value())
-                caps |= Capability::Suspend;
-
-            // hibernate
-            reply = m_interface->call(QStringLiteral("HibernateAllowed"));
-            if (reply.isValid() && reply.value())
-                caps |= Capability::Hibernate;
-
-            // return capabilities
-            return caps;
-        }
-
-        void powerOff() const {
-            auto command = QProcess::splitCommand(mainConfig.HaltCommand.get());
-            const QString program = command.takeFirst();
-            QProcess::execute(program, command);
-        }
+        void refresh(QObject *context, const std::function<void()> &done) {
+            static const QVector<Query> queries {
+                { QStringLiteral("SuspendAllowed"), Capability::Suspend, true },
+                { QStringLiteral("HibernateAllowed"), Capability::Hibernate, true },
+            };
 
-        void reboot() const {
-            auto command = QProcess::splitCommand(mainConfig.RebootCommand.get());
-            const QString program = command.takeFirst();
-            QProcess::execute(program, command);
+            query(m_interface, Capability::PowerOff | Capability::Reboot, queries, context, done);
         }
 
-        void suspend() const {
-            m_interface->call(QStringLiteral("Suspend"));
+        void run(Capability action, QObject *context, const PowerManager::Done &done) const {
+            switch (action) {
+            case Capability::PowerOff:
+                execute(mainConfig.HaltCommand.get(), context, done);
+                break;
+            case Capability::Reboot:
+                execute(mainConfig.RebootCommand.get(), context, done);
+                break;
+            case Capability::Suspend:
+                callAsync(m_interface, QStringLiteral("Suspend"), {}, context, done);
+                break;
+            case Capability::Hibernate:
+                callAsync(m_interface, QStringLiteral("Hibernate"), {}, context, done);
+                break;
+            default:
+                done(QStringLiteral("Not supported by UPower"));
+                break;
+            }
         }
 
-        void hibernate() const {
-            m_interface->call(QStringLiteral("Hibernate"));
-        }
+    private:
+        // a slow halt script must not hold up the other seats, and it has
+        // to outlive the daemon which gets torn down while it is running
+        static void execute(const QString &commandLine, QObject *context, const PowerManager::Done &done) {
+            Q_UNUSED(context)
+
+            QStringList command = QProcess::splitCommand(commandLine);
+            if (command.isEmpty()) {
+                done(QStringLiteral("No command configured"));
+                return;
+            }
 
-        void hybridSleep() const {
+            QProcess process;
+            process.setProgram(command.takeFirst());
+            process.setArguments(command);
+            if (!process.startDetached())
+                done(QStringLiteral("%1 failed to start: %2").arg(process.program(), process.errorString()));
+            else
+                done(QString());
         }
 
-    private:
         QDBusInterface *m_interface { nullptr };
     };
 
@@ -135,59 +220,30 @@ const QString CK2_OBJECT = QStringLiteral("org.freedesktop.ConsoleKit.Manager");
             delete m_interface;
         }
 
-        Capabilities capabilities() const {
-            Capabilities caps = Capability::None;
-
-            QDBusReply<QString> reply;
-
-            // power off
-            reply = m_interface->call(QStringLiteral("CanPowerOff"));
-            if (reply.isValid() && (reply.value() == QLatin1String("yes")))
-                caps |= Capability::PowerOff;
-
-            // reboot
-            reply = m_interface->call(QStringLiteral("CanReboot"));
-            if (reply.isValid() && (reply.value() == QLatin1String("yes")))
-                caps |= Capability::Reboot;
-
-            // suspend
-            reply = m_interface->call(QStringLiteral("CanSuspend"));
-            if (reply.isValid() && (reply.value() == QLatin1String("yes")))
-                caps |= Capability::Suspend;
-
-            // hibernate
-            reply = m_interface->call(QStringLiteral("CanHibernate"));
-            if (reply.isValid() && (reply.value() == QLatin1String("yes")))
-                caps |= Capability::Hibernate;
-
-            // hybrid sleep
-            reply = m_interface->call(QStringLiteral("CanHybridSleep"));
-            if (reply.isValid() && (reply.value() == QLatin1String("yes")))
-                caps |= Capability::HybridSleep;
-
-            // return capabilities
-            return caps;
-        }
-
-        void powerOff() const {
-            m_interface->call(QStringLiteral("PowerOff"), true);
+        void refresh(QObject *context, const std::function<void()> &done) {
+            static const QVariant yes = QStringLiteral("yes");
+            static const QVector<Query> queries {
+                { QStringLiteral("CanPowerOff"), Capability::PowerOff, yes },
+                { QStringLiteral("CanReboot"), Capability::Reboot, yes },
+                { QStringLiteral("CanSuspend"), Capability::Suspend, yes },
+                { QStringLiteral("CanHibernate"), Capability::Hibernate, yes },
+                { QStringLiteral("CanHybridSleep"), Capability::HybridSleep, yes },
+            };
+
+            query(m_interface, Capability::None, queries, context, done);
         }
 
-        void reboot() const {
-            if (!daemonApp->testing())
-                m_interface->call(QStringLiteral("Reboot"), true);
-        }
-
-        void suspend() const {
-            m_interface->call(QStringLiteral("Suspend"), true);
-        }
-
-        void hibernate() const {
-            m_interface->call(QStringLiteral("Hibernate"), true);
-        }
-
-        void hybridSleep() const {
-            m_interface->call(QStringLiteral("HybridSleep"), true);
+        void run(Capability action, QObject *context, const PowerManager::Done &done) const {
+            static const QHash<int, QString> methods {
+                { Capability::PowerOff, QStringLiteral("PowerOff") },
+                { Capability::Reboot, QStringLiteral("Reboot") },
+                { Capability::Suspend, QStringLiteral("Suspend") },
+                { Capability::Hibernate, QStringLiteral("Hibernate") },
+                { Capability::HybridSleep, QStringLiteral("HybridSleep") },
+            };
+
+            // interactive, so that polkit may ask instead of refusing
+            callAsync(m_interface, methods.value(action), { true }, context, done);
         }
 
     private:
@@ -197,20 +253,81 @@ const QString CK2_OBJECT = QStringLiteral("org.freedesktop.ConsoleKit.Manager");
     /**********************************************/
     /* POWER MANAGER                              */
     /**********************************************/
+    // logind lets a delay inhibitor hold up sleep for 5s by default
+    static const int SLEEP_HOLD_TIMEOUT_MS = 4000;
+
     PowerManager::PowerManager(QObject *parent) : QObject(parent) {
-        QDBusConnectionInterface *interface = QDBusConnection::systemBus().interface();
+        m_sleepTimer = new QTimer(this);
+        m_sleepTimer->setSingleShot(true);
+        m_sleepTimer->setInterval(SLEEP_HOLD_TIMEOUT_MS);
+        connect(m_sleepTimer, &QTimer::timeout, this, [this] {
+            qWarning() << "Letting the system sleep with" << m_sleepHolders.count() << "greeters not yet on screen";
+            dropSleepInhibitor();
+        });
+
+        // ConsoleKit2 may only be activated by the daemon after this, and
+        // any of them may come up late, so their owners are followed
+        QDBusConnection::systemBus().connect(QStringLiteral("org.freedesktop.DBus"), QStringLiteral("/org/freedesktop/DBus"),
+                                             QStringLiteral("org.freedesktop.DBus"), QStringLiteral("NameOwnerChanged"),
+                                             this, SLOT(nameOwnerChanged(QString,QString,QString)));
+
+        // one round trip for all the services, which doesn't hold up
+        // the rest of the daemon startup
+        auto listNamesMsg = QDBusMessage::createMethodCall(QStringLiteral("org.freedesktop.DBus"), QStringLiteral("/org/freedesktop/DBus"),
+                                                           QStringLiteral("org.freedesktop.DBus"), QStringLiteral("ListNames"));
+        QDBusPendingReply<QStringList> reply = QDBusConnection::systemBus().asyncCall(listNamesMsg);
+        QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(reply, this);
+        connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, watcher, reply] {
+            watcher->deleteLater();
+            if (reply.isError()) {
+                qWarning() << "Failed to list D-Bus services:" << reply.error().message();
+                return;
+            }
+            addBackends(reply.value());
+        });
+    }
+
+    void PowerManager::addBackends(const QStringList &services) {
+        bool added = false;
 
         // check if login1 interface exists
-        if (interface->isServiceRegistered(LOGIN1_SERVICE))
-            m_backends << new SeatManagerBackend(LOGIN1_SERVICE, LOGIN1_PATH, LOGIN1_OBJECT);
+        if (services.contains(LOGIN1_SERVICE) && !m_backendsByService.contains(LOGIN1_SERVICE)) {
+            m_backendsByService.insert(LOGIN1_SERVICE, new SeatManagerBackend(LOGIN1_SERVICE, LOGIN1_PATH, LOGIN1_OBJECT));
+            watchSeatManager(LOGIN1_SERVICE, LOGIN1_PATH, LOGIN1_OBJECT);
+            added = true;
+        }
 
         // check if ConsoleKit2 interface exists
-        if (interface->isServiceRegistered(CK2_SERVICE))
-            m_backends << new SeatManagerBackend(CK2_SERVICE, CK2_PATH, CK2_OBJECT);
+        if (services.contains(CK2_SERVICE) && !m_backendsByService.contains(CK2_SERVICE)) {
+            m_backendsByService.insert(CK2_SERVICE, new SeatManagerBackend(CK2_SERVICE, CK2_PATH, CK2_OBJECT));
+            watchSeatManager(CK2_SERVICE, CK2_PATH, CK2_OBJECT);
+            added = true;
+        }
 
         // check if upower interface exists
-        if (interface->isServiceRegistered(UPOWER_SERVICE))
-            m_backends << new UPowerBackend(UPOWER_SERVICE, UPOWER_PATH, UPOWER_OBJECT);
+        if (services.contains(UPOWER_SERVICE) && !m_backendsByService.contains(UPOWER_SERVICE)) {
+            m_backendsByService.insert(UPOWER_SERVICE, new UPowerBackend(UPOWER_SERVICE, UPOWER_PATH, UPOWER_OBJECT));
+            added = true;
+        }
+
+        if (!added)
+            return;
+
+        // run() asks them in this order, however late they came up
+        m_backends.clear();
+        for (const QString &service : { LOGIN1_SERVICE, CK2_SERVICE, UPOWER_SERVICE }) {
+            if (m_backendsByService.contains(service))
+                m_backends << m_backendsByService.value(service);
+        }
+
+        // fill the cache, greeters connecting meanwhile get updated later
+        refreshCapabilities();
+    }
+
+    void PowerManager::nameOwnerChanged(const QString &name, const QString &oldOwner, const QString &newOwner) {
+        Q_UNUSED(oldOwner)
+        if (!newOwner.isEmpty())
+            addBackends({ name });
     }
 
     PowerManager::~PowerManager() {
@@ -219,71 +336,155 @@ const QString CK2_OBJECT = QStringLiteral("org.freedesktop.ConsoleKit.Manager");
     }
 
     Capabilities PowerManager::capabilities() const {
+        return m_capabilities;
+    }
+
+    void PowerManager::refreshCapabilities() {
+        for (PowerManagerBackend *backend: m_backends)
+            backend->refresh(this, [this] { updateCapabilities(); });
+    }
+
+    void PowerManager::updateCapabilities() {
         Capabilities caps = Capability::None;
 
         for (PowerManagerBackend *backend: m_backends)
             caps |= backend->capabilities();
 
-        return caps;
+        if (caps == m_capabilities)
+            return;
+
+        m_capabilities = caps;
+        emit capabilitiesChanged(m_capabilities);
     }
 
-    void PowerManager::powerOff() const {
-        if (daemonApp->testing())
-            return;
+    void PowerManager::watchSeatManager(const QString &service, const QString &path, const QString &interface) {
+        QDBusConnection bus = QDBusConnection::systemBus();
 
-        for (PowerManagerBackend *backend: m_backends) {
-            if (backend->capabilities() & Capability::PowerOff) {
-                backend->powerOff();
-                break;
-            }
-        }
+        // the Can* answers depend on inhibitors and policy, both of
+        // which are announced through these signals
+        bus.connect(service, path, QStringLiteral("org.freedesktop.DBus.Properties"),
+                    QStringLiteral("PropertiesChanged"), this, SLOT(refreshCapabilities()));
+        bus.connect(service, path, interface,
+                    QStringLiteral("PrepareForSleep"), this, SLOT(refreshCapabilities()));
+
+        // logind and ConsoleKit2 both take delay inhibitors
+        if (!m_sleepService.isEmpty())
+            return;
+        m_sleepService = service;
+        m_sleepPath = path;
+        m_sleepInterface = interface;
+        bus.connect(service, path, interface,
+                    QStringLiteral("PrepareForSleep"), this, SLOT(prepareForSleep(bool)));
+        takeSleepInhibitor();
     }
 
-    void PowerManager::reboot() const {
-        if (daemonApp->testing())
+    void PowerManager::takeSleepInhibitor() {
+        if (m_sleepInhibitor.isValid() || daemonApp->testing())
             return;
 
-        for (PowerManagerBackend *backend: m_backends) {
-            if (backend->capabilities() & Capability::Reboot) {
-                backend->reboot();
-                break;
+        // it has to be held before sleep is announced, we let go of it
+        // once the greeters are on screen and take it again after resume
+        QDBusMessage message = QDBusMessage::createMethodCall(m_sleepService, m_sleepPath, m_sleepInterface,
+                                                              QStringLiteral("Inhibit"));
+        message << QStringLiteral("sleep") << QStringLiteral("SDDM")
+                << QStringLiteral("Showing the login screen before sleep") << QStringLiteral("delay");
+        QDBusPendingReply<QDBusUnixFileDescriptor> reply = QDBusConnection::systemBus().asyncCall(message);
+        QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(reply, this);
+        connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, watcher, reply] {
+            watcher->deleteLater();
+            if (reply.isError()) {
+                qWarning() << "Failed to take the sleep inhibitor:" << reply.error().message();
+                return;
             }
+            m_sleepInhibitor = reply.value();
+        });
+    }
+
+    void PowerManager::dropSleepInhibitor() {
+        m_sleepTimer->stop();
+        m_sleepHolders.clear();
+        // closes our copy of the file descriptor, which releases it
+        m_sleepInhibitor = QDBusUnixFileDescriptor();
+    }
+
+    void PowerManager::prepareForSleep(bool start) {
+        if (!start) {
+            dropSleepInhibitor();
+            takeSleepInhibitor();
+            return;
         }
+
+        if (!m_sleepInhibitor.isValid())
+            return;
+
+        // the displays hold sleep for greeters still coming up
+        m_sleepTimer->start();
+        emit preparingForSleep();
+
+        if (m_sleepHolders.isEmpty())
+            dropSleepInhibitor();
     }
 
-    void PowerManager::suspend() const {
-        if (daemonApp->testing())
+    void PowerManager::holdSleep(QObject *holder) {
+        // only while sleep waits for us
+        if (!m_sleepTimer->isActive())
             return;
 
-        for (PowerManagerBackend *backend: m_backends) {
-            if (backend->capabilities() & Capability::Suspend) {
-                backend->suspend();
-                break;
-            }
-        }
+        m_sleepHolders.insert(holder);
+        connect(holder, &QObject::destroyed, this, &PowerManager::sleepHolderDestroyed, Qt::UniqueConnection);
     }
 
-    void PowerManager::hibernate() const {
-        if (daemonApp->testing())
+    void PowerManager::releaseSleep(QObject *holder) {
+        if (!m_sleepHolders.remove(holder))
             return;
 
-        for (PowerManagerBackend *backend: m_backends) {
-            if (backend->capabilities() & Capability::Hibernate) {
-                backend->hibernate();
-                break;
-            }
-        }
+        disconnect(holder, &QObject::destroyed, this, &PowerManager::sleepHolderDestroyed);
+        if (m_sleepHolders.isEmpty())
+            dropSleepInhibitor();
+    }
+
+    void PowerManager::sleepHolderDestroyed(QObject *holder) {
+        if (m_sleepHolders.remove(holder) && m_sleepHolders.isEmpty())
+            dropSleepInhibitor();
     }
 
-    void PowerManager::hybridSleep() const {
-        if (daemonApp->testing())
+    void PowerManager::run(Capability action, const Done &done) {
+        if (daemonApp->testing()) {
+            done(QString());
             return;
+        }
 
         for (PowerManagerBackend *backend: m_backends) {
-            if (backend->capabilities() & Capability::HybridSleep) {
-                backend->hybridSleep();
-                break;
+            if (backend->capabilities() & action) {
+                backend->run(action, this, [action, done](const QString &error) {
+                    if (!error.isEmpty())
+                        qWarning() << "Power action" << action << "failed:" << error;
+                    done(error);
+                });
+                return;
             }
         }
+
+        done(QStringLiteral("No backend can do that"));
+    }
+
+    void PowerManager::powerOff() {
+        run(Capability::PowerOff, [](const QString &) { });
+    }
+
+    void PowerManager::reboot() {
+        run(Capability::Reboot, [](const QString &) { });
+    }
+
+    void PowerManager::suspend() {
+        run(Capability::Suspend, [](const QString &) { });
+    }
+
+    void PowerManager::hibernate() {
+        run(Capability::Hibernate, [](const QString &) { });
+    }
+
+    void PowerManager::hybridSleep() {
+        run(Capability::HybridSleep, [](const QString &) { });
     }
 }
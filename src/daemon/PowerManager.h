@@ -20,11 +20,19 @@
 #ifndef SDDM_POWERMANAGER_H
 #define SDDM_POWERMANAGER_H
 
+#include <QDBusUnixFileDescriptor>
+#include <QHash>
 #include <QObject>
+#include <QSet>
+#include <QStringList>
 #include <QVector>
 
+#include <functional>
+
 #include "Messages.h"
 
+class QTimer;
+
 namespace SDDM {
     class PowerManagerBackend;
 
@@ -32,20 +40,65 @@ namespace SDDM {
         Q_OBJECT
         Q_DISABLE_COPY(PowerManager)
     public:
+        // gets an error message, or an empty string on success
+        using Done = std::function<void(const QString &error)>;
+
         PowerManager(QObject *parent = 0);
         ~PowerManager();
 
+        /**
+         * Starts @p action with the first backend that can do it and
+         * returns right away, @p done is called once it went through or
+         * failed. Nothing happens in test mode, besides calling @p done.
+         */
+        void run(Capability action, const Done &done);
+
+        /**
+         * Keeps the system from going to sleep until releaseSleep() is
+         * called for @p holder, or a few seconds passed. Only to be used
+         * from a slot connected to preparingForSleep().
+         */
+        void holdSleep(QObject *holder);
+        void releaseSleep(QObject *holder);
+
     public slots:
         Capabilities capabilities() const;
 
-        void powerOff() const;
-        void reboot() const;
-        void suspend() const;
-        void hibernate() const;
-        void hybridSleep() const;
+        void powerOff();
+        void reboot();
+        void suspend();
+        void hibernate();
+        void hybridSleep();
+
+    signals:
+        void capabilitiesChanged(Capabilities capabilities);
+        // the system is about to sleep, see holdSleep()
+        void preparingForSleep();
+
+    private slots:
+        void refreshCapabilities();
+        void prepareForSleep(bool start);
+        void sleepHolderDestroyed(QObject *holder);
+        void nameOwnerChanged(const QString &name, const QString &oldOwner, const QString &newOwner);
 
     private:
+        void addBackends(const QStringList &services);
+        void updateCapabilities();
+        void watchSeatManager(const QString &service, const QString &path, const QString &interface);
+        void takeSleepInhibitor();
+        void dropSleepInhibitor();
+
         QVector<PowerManagerBackend *> m_backends;
+        QHash<QString, PowerManagerBackend *> m_backendsByService;
+        Capabilities m_capabilities { Capability::None };
+
+        // the seat manager whose sleep we delay, the first one found
+        QString m_sleepService;
+        QString m_sleepPath;
+        QString m_sleepInterface;
+        QDBusUnixFileDescriptor m_sleepInhibitor;
+        QSet<QObject *> m_sleepHolders;
+        QTimer *m_sleepTimer { nullptr };
     };
 }
 
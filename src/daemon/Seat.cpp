@@ -23,11 +23,15 @@
 #include "Configuration.h"
 #include "DaemonApp.h"
 #include "Display.h"
+#include "Metrics.h"
+#include "SeatManager.h"
+#include "SystemdNotify.h"
 #include "XorgDisplayServer.h"
 #include "VirtualTerminal.h"
 
 #include <QDebug>
 #include <QFile>
+#include <QRandomGenerator>
 #include <QTimer>
 
 #include <functional>
@@ -42,6 +46,17 @@ namespace SDDM {
     }
 
     void Seat::createDisplay() {
+        // an explicit request gets a fresh chance after giving up, and
+        // earlier failures don't count against the new display
+        m_failures = 0;
+        m_retryDelay = 0;
+        m_gaveUp = false;
+        restartStateUpdated();
+
+        recreateDisplay();
+    }
+
+    void Seat::recreateDisplay() {
         //reload config if needed
         mainConfig.load();
 
@@ -52,6 +67,23 @@ namespace SDDM {
         // restart display on stop
         connect(display, &Display::stopped, this, &Seat::displayStopped);
 
+        // retry when the display server gives up after having been launched
+        connect(display, &Display::startFailed, this, [this, display] { displayStartFailed(display); });
+
+        // report how long it took to get to the greeter
+        m_startTimes[display].start();
+        connect(display, &Display::started, this, [this, display] {
+            if (!m_startTimes.contains(display))
+                return;
+            qInfo() << "Seat" << m_name << "display on vt" << display->terminalId()
+                    << "ready after" << m_startTimes.take(display).elapsed() << "ms";
+
+            // the failure budget only covers consecutive failures
+            m_failures = 0;
+            m_retryDelay = 0;
+            restartStateUpdated();
+        });
+
         // add display to the list
         m_displays << display;
 
@@ -59,21 +91,87 @@ namespace SDDM {
         startDisplay(display);
     }
 
-    void Seat::startDisplay(Display *display, int tryNr) {
-        if (display->start())
-            return;
+    void Seat::startDisplay(Display *display) {
+        // displays of all seats come up concurrently, up to the
+        // configured limit
+        daemonApp->seatManager()->queueDisplayStart(display, [this, display] {
+            if (display->start())
+                return true;
+            displayStartFailed(display);
+            return false;
+        });
+    }
+
+    bool Seat::scheduleRetry() {
+        ++m_failures;
+        Metrics::increment("display_failures");
+
+        const int budget = mainConfig.DisplayFailureBudget.get();
+        if (budget > 0 && m_failures >= budget) {
+            qCritical() << "Seat" << m_name << "failed" << m_failures << "times in a row, not restarting its display";
+            m_retryDelay = 0;
+            m_gaveUp = true;
+            restartStateUpdated();
+            return false;
+        }
+
+        // double the delay with each failure, and spread it by up to a
+        // quarter so that seats failing together don't retry in lockstep
+        const int initial = qMax(0, mainConfig.DisplayRetryDelay.get());
+        const int maximum = qMax(initial, mainConfig.DisplayRetryMaxDelay.get());
+        qint64 delay = initial;
+        for (int i = 1; i < m_failures && delay < maximum; ++i)
+            delay *= 2;
+        delay = qMin<qint64>(delay, maximum);
+        if (delay > 0) {
+            const int jitter = int(delay / 4);
+            delay += QRandomGenerator::global()->bounded(-jitter, jitter + 1);
+        }
+        m_retryDelay = int(delay);
+        restartStateUpdated();
+
+        return true;
+    }
+
+    void Seat::restartStateUpdated() {
+        emit restartStateChanged(m_name, m_failures, m_retryDelay, m_gaveUp);
+    }
 
+    void Seat::displayStartFailed(Display *display) {
         // It's possible that the system isn't ready yet (driver not loaded,
         // device not enumerated, ...). It's not possible to tell when that changes,
-        // so try a few times with a delay in between.
-        qWarning() << "Attempt" << tryNr << "starting the Display server on vt" << display->terminalId() << "failed";
+        // so try a few times with a growing delay in between.
+        qWarning() << "Attempt" << m_failures + 1 << "starting the Display server on vt" << display->terminalId() << "failed";
 
-        if(tryNr >= 3) {
+        if (!scheduleRetry()) {
             qCritical() << "Could not start Display server on vt" << display->terminalId();
+            SystemdNotify::ready(QStringLiteral("Gave up starting the display server of %1").arg(m_name));
             return;
         }
 
-        QTimer::singleShot(2000, display, [=] { startDisplay(display, tryNr + 1); });
+        qDebug() << "Retrying in" << m_retryDelay << "ms";
+        SystemdNotify::status(QStringLiteral("Display server of %1 failed, retrying").arg(m_name));
+        QTimer::singleShot(m_retryDelay, display, [=] {
+            Metrics::increment("display_restarts");
+            startDisplay(display);
+        });
+    }
+
+    int Seat::failureCount() const {
+        return m_failures;
+    }
+
+    int Seat::retryDelay() const {
+        return m_retryDelay;
+    }
+
+    bool Seat::gaveUp() const {
+        return m_gaveUp;
+    }
+
+    void Seat::reloadTheme() {
+        for (Display *display : qAsConst(m_displays))
+            display->reloadTheme();
     }
 
     void Seat::removeDisplay(Display* display) {
@@ -82,11 +180,12 @@ namespace SDDM {
 
         // remove display from list
         m_displays.removeAll(display);
+        m_startTimes.remove(display);
 
-        // stop the display
-        display->blockSignals(true);
+        // stop the display, the display server may still be exiting
+        // after this so make sure its stopped() doesn't come back here
+        disconnect(display, nullptr, this, nullptr);
         display->stop();
-        display->blockSignals(false);
 
         // delete display
         display->deleteLater();
@@ -95,12 +194,26 @@ namespace SDDM {
     void Seat::displayStopped() {
         Display *display = qobject_cast<Display *>(sender());
 
+        // a display that stops before it got anywhere is a failure too,
+        // restarting it right away would just spin
+        const bool failed = m_startTimes.contains(display);
+
         // remove display
         removeDisplay(display);
 
         // restart otherwise
         if (m_displays.isEmpty()) {
-            createDisplay();
+            if (!failed) {
+                createDisplay();
+            } else if (scheduleRetry()) {
+                qWarning() << "Display on seat" << m_name << "stopped before it was up, restarting in" << m_retryDelay << "ms";
+                QTimer::singleShot(m_retryDelay, this, [this] {
+                    Metrics::increment("display_restarts");
+                    recreateDisplay();
+                });
+            } else {
+                SystemdNotify::ready(QStringLiteral("Gave up starting the display server of %1").arg(m_name));
+            }
         }
         // If there is still a session running on some display,
         // switch to last display in display vector.
@@ -20,6 +20,8 @@
 #ifndef SDDM_SEAT_H
 #define SDDM_SEAT_H
 
+#include <QElapsedTimer>
+#include <QHash>
 #include <QObject>
 #include <QVector>
 
@@ -34,19 +36,42 @@ namespace SDDM {
 
         const QString &name() const;
 
+        // consecutive display failures, the delay before the pending
+        // retry and whether the failure budget ran out
+        int failureCount() const;
+        int retryDelay() const;
+        bool gaveUp() const;
+
+        void reloadTheme();
+
     public slots:
+        // a display of its own, with a fresh failure budget
         void createDisplay();
         void removeDisplay(SDDM::Display* display);
 
+    signals:
+        // the values behind failureCount(), retryDelay() and gaveUp()
+        void restartStateChanged(const QString &name, int failureCount, int retryDelay, bool gaveUp);
+
     private slots:
         void displayStopped();
+        void displayStartFailed(SDDM::Display *display);
 
     private:
-        void startDisplay(SDDM::Display *display, int tryNr = 1);
+        // the next display after a failure, counted against the budget
+        void recreateDisplay();
+        void startDisplay(SDDM::Display *display);
+        bool scheduleRetry();
+        void restartStateUpdated();
 
         QString m_name;
 
         QVector<Display *> m_displays;
+        QHash<Display *, QElapsedTimer> m_startTimes;
+
+        int m_failures { 0 };
+        int m_retryDelay { 0 };
+        bool m_gaveUp { false };
     };
 }
 
@@ -19,107 +19,52 @@
 
 #include "SeatManager.h"
 
+#include "Configuration.h"
 #include "DaemonApp.h"
+#include "Display.h"
+#include "LogindStateCache.h"
 #include "Seat.h"
-
-#include <QDBusConnection>
-#include <QDBusMessage>
-#include <QDBusPendingReply>
-#include <QDBusContext>
+#include "SystemdNotify.h"
 
 #include "LogindDBusTypes.h"
 
-namespace SDDM {
-
-    class LogindSeat : public QObject {
-    Q_OBJECT
-    public:
-        LogindSeat(const QString &name, const QDBusObjectPath &objectPath, QObject *parent);
-        QString name() const;
-        bool canGraphical() const;
-    Q_SIGNALS:
-        void canGraphicalChanged(bool);
-    private Q_SLOTS:
-        void propertiesChanged(const QString &interface, const QVariantMap &changedProperties , const QStringList &invalidatedProperties);
-    private:
-        QString m_name;
-        bool m_canGraphical;
-    };
-
-    LogindSeat::LogindSeat(const QString& name, const QDBusObjectPath& objectPath, QObject* parent):
-        m_name(name),
-        m_canGraphical(false)
-    {
-        QDBusConnection::systemBus().connect(Logind::serviceName(), objectPath.path(), QStringLiteral("org.freedesktop.DBus.Properties"), QStringLiteral("PropertiesChanged"), this, SLOT(propertiesChanged(QString,QVariantMap,QStringList)));
-
-        auto canGraphicalMsg = QDBusMessage::createMethodCall(Logind::serviceName(), objectPath.path(), QStringLiteral("org.freedesktop.DBus.Properties"), QStringLiteral("Get"));
-        canGraphicalMsg << Logind::seatIfaceName() << QStringLiteral("CanGraphical");
-
-        QDBusPendingReply<QVariant> reply = QDBusConnection::systemBus().asyncCall(canGraphicalMsg);
-        QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(reply);
-        connect(watcher, &QDBusPendingCallWatcher::finished, this, [=]() {
-            watcher->deleteLater();
-            if (!reply.isValid())
-                return;
-
-            bool value = reply.value().toBool();
-            if (value != m_canGraphical) {
-                m_canGraphical = value;
-                emit canGraphicalChanged(m_canGraphical);
-            }
-        });
-    }
-
-    bool LogindSeat::canGraphical() const
-    {
-        return m_canGraphical;
-    }
-
-    QString LogindSeat::name() const
-    {
-        return m_name;
-    }
+#include <QDebug>
 
-    void LogindSeat::propertiesChanged(const QString& interface, const QVariantMap& changedProperties, const QStringList& invalidatedProperties)
-    {
-        Q_UNUSED(invalidatedProperties);
-        if (interface != Logind::seatIfaceName()) {
+namespace SDDM {
+    void SeatManager::createEarlySeat() {
+        if (!mainConfig.EarlySeat0.get() || DaemonApp::instance()->testing())
             return;
-        }
 
-        if (changedProperties.contains(QStringLiteral("CanGraphical"))) {
-            m_canGraphical = changedProperties[QStringLiteral("CanGraphical")].toBool();
-            emit canGraphicalChanged(m_canGraphical);
-        }
+        // nearly every machine has a graphical seat0, so its display
+        // server starts while logind is still being asked about it
+        qDebug() << "Starting seat0 ahead of the logind seat list";
+        m_earlySeat = true;
+        createSeat(QStringLiteral("seat0"));
     }
 
     void SeatManager::initialize() {
         if (DaemonApp::instance()->testing() || !Logind::isAvailable()) {
             //if we don't have logind/CK2, just create a single seat immediately and don't do any other connections
+            m_earlySeat = false;
             createSeat(QStringLiteral("seat0"));
             return;
         }
 
-        //fetch seats
-        auto listSeatsMsg = QDBusMessage::createMethodCall(Logind::serviceName(), Logind::managerPath(), Logind::managerIfaceName(), QStringLiteral("ListSeats"));
-        QDBusPendingReply<NamedSeatPathList> reply = QDBusConnection::systemBus().asyncCall(listSeatsMsg);
-
-        QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(reply);
-        connect(watcher, &QDBusPendingCallWatcher::finished, this, [=]() {
-            watcher->deleteLater();
-            const auto seats = reply.value();
-            for(const NamedSeatPath &seat : seats) {
-                logindSeatAdded(seat.name, seat.path);
-            }
-        });
-
-        QDBusConnection::systemBus().connect(Logind::serviceName(), Logind::managerPath(), Logind::managerIfaceName(), QStringLiteral("SeatNew"), this, SLOT(logindSeatAdded(QString,QDBusObjectPath)));
-        QDBusConnection::systemBus().connect(Logind::serviceName(), Logind::managerPath(), Logind::managerIfaceName(), QStringLiteral("SeatRemoved"), this, SLOT(logindSeatRemoved(QString,QDBusObjectPath)));
+        // seats come and go with their CanGraphical property
+        LogindStateCache *logind = DaemonApp::instance()->logindState();
+        connect(logind, &LogindStateCache::canGraphicalChanged, this, &SeatManager::logindSeatChanged);
+        connect(logind, &LogindStateCache::seatRemoved, this, &SeatManager::removeSeat);
+        connect(logind, &LogindStateCache::seatsFetched, this, &SeatManager::logindSeatsFetched);
     }
 
     void SeatManager::createSeat(const QString &name) {
+        // the early seat0 being confirmed
+        if (m_seats.contains(name))
+            return;
+
         // create a seat
         Seat *seat = new Seat(name, this);
+        connect(seat, &Seat::restartStateChanged, this, &SeatManager::seatRestartStateChanged);
 
         // add to the list
         m_seats.insert(name, seat);
@@ -152,27 +97,81 @@ namespace SDDM {
         m_seats.value(name)->createDisplay();
     }
 
-    void SDDM::SeatManager::logindSeatAdded(const QString& name, const QDBusObjectPath& objectPath)
-    {
-        auto logindSeat = new LogindSeat(name, objectPath, this);
-        connect(logindSeat, &LogindSeat::canGraphicalChanged, this, [=]() {
-            if (logindSeat->canGraphical()) {
-                createSeat(logindSeat->name());
-            } else {
-                removeSeat(logindSeat->name());
-            }
-        });
-
-        m_systemSeats.insert(name, logindSeat);
+    void SeatManager::reloadTheme() {
+        mainConfig.load();
+
+        for (Seat *seat : qAsConst(m_seats))
+            seat->reloadTheme();
     }
 
-    void SDDM::SeatManager::logindSeatRemoved(const QString& name, const QDBusObjectPath& objectPath)
-    {
-        Q_UNUSED(objectPath);
-        auto logindSeat = m_systemSeats.take(name);
-        delete logindSeat;
-        removeSeat(name);
+    Seat *SeatManager::seat(const QString &name) const {
+        return m_seats.value(name);
     }
-}
 
-#include "SeatManager.moc"
+    void SeatManager::queueDisplayStart(Display *display, const std::function<bool()> &start) {
+        m_startQueue.enqueue(qMakePair(QPointer<Display>(display), start));
+        startQueuedDisplays();
+    }
+
+    void SeatManager::startQueuedDisplays() {
+        const int limit = mainConfig.DisplayStartLimit.get();
+
+        while (!m_startQueue.isEmpty() && (limit <= 0 || m_startingDisplays.size() < limit)) {
+            const auto entry = m_startQueue.dequeue();
+            Display *display = entry.first;
+
+            // removed while waiting for its turn
+            if (!display)
+                continue;
+
+            // the slot is given back once the greeter or autologin is up,
+            // or the attempt is over
+            m_startingDisplays.insert(display);
+            connect(display, &Display::started, this, [this, display] { displayStartFinished(display); });
+            connect(display, &Display::startFailed, this, [this, display] { displayStartFinished(display); });
+            connect(display, &Display::stopped, this, [this, display] { displayStartFinished(display); });
+            connect(display, &QObject::destroyed, this, [this, display] { displayStartFinished(display); });
+
+            if (!entry.second())
+                displayStartFinished(display);
+        }
+    }
+
+    void SeatManager::displayStartFinished(Display *display) {
+        if (!m_startingDisplays.remove(display))
+            return;
+
+        disconnect(display, nullptr, this, nullptr);
+        startQueuedDisplays();
+    }
+
+    void SeatManager::logindSeatChanged(const QString &name, bool canGraphical) {
+        if (name == QLatin1String("seat0"))
+            m_earlySeat = false;
+
+        if (canGraphical)
+            createSeat(name);
+        else
+            removeSeat(name);
+    }
+
+    void SeatManager::logindSeatsFetched(bool listed) {
+        // without the list, go on with seat0 as if there was no logind
+        if (!listed) {
+            m_earlySeat = false;
+            createSeat(QStringLiteral("seat0"));
+            return;
+        }
+
+        // logind knows better, the seat comes back once it can do graphics
+        if (m_earlySeat && !DaemonApp::instance()->logindState()->canGraphical(QStringLiteral("seat0"))) {
+            qWarning() << "seat0 was started early but logind reports it can't do graphics, stopping it";
+            removeSeat(QStringLiteral("seat0"));
+        }
+        m_earlySeat = false;
+
+        // there is no greeter to wait for
+        if (m_seats.isEmpty())
+            SystemdNotify::ready(QStringLiteral("Waiting for a graphical seat"));
+    }
+}
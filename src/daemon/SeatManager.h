@@ -22,33 +22,56 @@
 
 #include <QObject>
 #include <QHash>
-#include <QDBusObjectPath>
+#include <QPair>
+#include <QPointer>
+#include <QQueue>
+#include <QSet>
+
+#include <functional>
 
 namespace SDDM {
+    class Display;
     class Seat;
-    class LogindSeat;
 
     class SeatManager : public QObject {
         Q_OBJECT
     public:
         explicit SeatManager(QObject *parent = 0) : QObject(parent) {}
 
+        // creates seat0 ahead of the seat list, with General.EarlySeat0
+        void createEarlySeat();
         void initialize();
         void createSeat(const QString &name);
         void removeSeat(const QString &name);
         void switchToGreeter(const QString &seat);
+        // reads the configuration again and updates the greeters of all seats
+        void reloadTheme();
+        Seat *seat(const QString &name) const;
+
+        // runs @p start once fewer than General.DisplayStartLimit displays
+        // are coming up; @p start returns false if it failed right away
+        void queueDisplayStart(Display *display, const std::function<bool()> &start);
 
     Q_SIGNALS:
         void seatCreated(const QString &name);
         void seatRemoved(const QString &name);
+        // forwarded from the seats, see Seat::restartStateChanged()
+        void seatRestartStateChanged(const QString &name, int failureCount, int retryDelay, bool gaveUp);
 
     private Q_SLOTS:
-        void logindSeatAdded(const QString &name, const QDBusObjectPath &objectPath);
-        void logindSeatRemoved(const QString &name, const QDBusObjectPath &objectPath);
+        void logindSeatChanged(const QString &name, bool canGraphical);
+        void logindSeatsFetched(bool listed);
 
     private:
+        void displayStartFinished(Display *display);
+        void startQueuedDisplays();
+
         QHash<QString, Seat *> m_seats; //these will exist only for graphical seats
-        QHash<QString, LogindSeat*> m_systemSeats; //these will exist for all seats
+        // seat0 was created before logind confirmed it
+        bool m_earlySeat { false };
+
+        QSet<Display *> m_startingDisplays;
+        QQueue<QPair<QPointer<Display>, std::function<bool()>>> m_startQueue;
     };
 }
 
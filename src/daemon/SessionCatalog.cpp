@@ -0,0 +1,142 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "SessionCatalog.h"
+
+#include "Configuration.h"
+#include "ExecutableLookup.h"
+#include "Trace.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QTimer>
+
+namespace SDDM {
+    SessionCatalog::SessionCatalog(QObject *parent) : QObject(parent) {
+        // package managers add and remove a few files in a row
+        m_refreshTimer = new QTimer(this);
+        m_refreshTimer->setSingleShot(true);
+        m_refreshTimer->setInterval(250);
+        connect(m_refreshTimer, &QTimer::timeout, this, &SessionCatalog::refresh);
+
+        m_watcher = new QFileSystemWatcher(this);
+        connect(m_watcher, &QFileSystemWatcher::directoryChanged, m_refreshTimer, QOverload<>::of(&QTimer::start));
+        // edited in place
+        connect(m_watcher, &QFileSystemWatcher::fileChanged, m_refreshTimer, QOverload<>::of(&QTimer::start));
+    }
+
+    void SessionCatalog::start() {
+        refresh();
+    }
+
+    const QVector<Session> &SessionCatalog::sessions() const {
+        return m_sessions;
+    }
+
+    Session SessionCatalog::find(const QString &name, bool *runnable) const {
+        QString fileName = name;
+        if (!fileName.endsWith(QLatin1String(".desktop")))
+            fileName += QLatin1String(".desktop");
+        const bool absolute = QFileInfo(fileName).isAbsolute();
+
+        for (const Entry &entry : m_entries) {
+            const QString path = entry.session.fileName();
+            if (absolute ? path == fileName : QFileInfo(path).fileName() == fileName) {
+                if (runnable)
+                    *runnable = entry.runnable;
+                return entry.session;
+            }
+        }
+
+        if (runnable)
+            *runnable = false;
+        return Session();
+    }
+
+    void SessionCatalog::refresh() {
+        Trace::mark("session-catalog-refresh");
+
+        // the directories may have been created or configured meanwhile
+        const QStringList dirs { mainConfig.Wayland.SessionDir.get(), mainConfig.X11.SessionDir.get() };
+        const QStringList watched = m_watcher->directories() + m_watcher->files();
+        if (!watched.isEmpty())
+            m_watcher->removePaths(watched);
+        for (const QString &dir : dirs) {
+            if (QFileInfo(dir).isDir())
+                m_watcher->addPath(dir);
+        }
+
+        QVector<Entry> entries;
+        scan(Session::WaylandSession, dirs.at(0), entries);
+        scan(Session::X11Session, dirs.at(1), entries);
+
+        QStringList files;
+        for (const Entry &entry : qAsConst(entries))
+            files << entry.session.fileName();
+        if (!files.isEmpty())
+            m_watcher->addPaths(files);
+
+        update(entries);
+        Trace::mark("session-catalog-refreshed", QString::number(m_sessions.count()));
+    }
+
+    void SessionCatalog::recheck() {
+        QVector<Entry> entries = m_entries;
+        bool modified = false;
+        for (Entry &entry : entries) {
+            const bool runnable = ExecutableLookup::canExecute(entry.session.tryExec());
+            modified |= runnable != entry.runnable;
+            entry.runnable = runnable;
+        }
+
+        if (modified)
+            update(entries);
+    }
+
+    void SessionCatalog::update(const QVector<Entry> &entries) {
+        QVector<Session> sessions;
+        for (const Entry &entry : entries) {
+            if (entry.runnable && !entry.session.isHidden() && !entry.session.isNoDisplay())
+                sessions << entry.session;
+        }
+
+        m_entries = entries;
+        m_sessions = sessions;
+
+        emit changed();
+    }
+
+    void SessionCatalog::scan(Session::Type type, const QString &path, QVector<Entry> &entries) {
+        QDir dir(path);
+        dir.setNameFilters({ QStringLiteral("*.desktop") });
+        dir.setFilter(QDir::Files);
+
+        const QStringList files = dir.entryList();
+        for (const QString &file : files) {
+            // files that didn't change are not parsed again, see Session
+            Entry entry;
+            entry.session.setTo(type, file);
+            if (!entry.session.isValid())
+                continue;
+            entry.runnable = ExecutableLookup::canExecute(entry.session.tryExec());
+            entries << entry;
+        }
+    }
+}
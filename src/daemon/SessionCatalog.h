@@ -0,0 +1,82 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_SESSIONCATALOG_H
+#define SDDM_SESSIONCATALOG_H
+
+#include <QObject>
+#include <QVector>
+
+#include "Session.h"
+
+class QFileSystemWatcher;
+class QTimer;
+
+namespace SDDM {
+    /**
+     * The sessions of Wayland/SessionDir and X11/SessionDir.
+     *
+     * The desktop files are read once for all seats and again whenever
+     * the directories or the files change, TryExec is checked at the same
+     * time and again with recheck(). Autologin picks its session from
+     * here and greeters get the ones they list over their socket, see
+     * SocketServer.
+     */
+    class SessionCatalog : public QObject {
+        Q_OBJECT
+        Q_DISABLE_COPY(SessionCatalog)
+    public:
+        explicit SessionCatalog(QObject *parent = nullptr);
+
+        void start();
+
+        // what greeters list: neither hidden nor failing TryExec, the
+        // Wayland sessions first
+        const QVector<Session> &sessions() const;
+
+        // a session by its file name or path, the extension may be left
+        // out. Hidden ones are found too, @p runnable tells whether its
+        // TryExec was found.
+        Session find(const QString &name, bool *runnable = nullptr) const;
+
+        // looks for the TryExec programs again, which come and go without
+        // the session files changing; emits changed() if any did
+        void recheck();
+
+    signals:
+        void changed();
+
+    private:
+        struct Entry {
+            Session session;
+            bool runnable { false };
+        };
+
+        void refresh();
+        void scan(Session::Type type, const QString &path, QVector<Entry> &entries);
+        void update(const QVector<Entry> &entries);
+
+        QVector<Entry> m_entries;
+        QVector<Session> m_sessions;
+        QFileSystemWatcher *m_watcher { nullptr };
+        QTimer *m_refreshTimer { nullptr };
+    };
+}
+
+#endif // SDDM_SESSIONCATALOG_H
@@ -21,15 +21,44 @@
 #include "SocketServer.h"
 
 #include "DaemonApp.h"
+#include "LoggingCategories.h"
+#include "LoginId.h"
 #include "Messages.h"
+#include "Metrics.h"
 #include "PowerManager.h"
+#include "SocketReader.h"
 #include "SocketWriter.h"
+#include "SessionCatalog.h"
+#include "UserDirectory.h"
 #include "Utils.h"
 
 #include <QLocalServer>
+#include <QPointer>
 
 namespace SDDM {
+    // users per frame, a frame may not be larger than MaximumFrameLength
+    static const int UserBatchSize = 256;
+
+    static void writeSessions(QLocalSocket *socket) {
+        const QVector<Session> &sessions = daemonApp->sessionCatalog()->sessions();
+        SocketWriter writer(socket);
+        writer << quint32(DaemonMessages::Sessions) << quint32(sessions.count());
+        for (const Session &session : sessions)
+            writer.writeEntry(session);
+    }
+
     SocketServer::SocketServer(QObject *parent) : QObject(parent) {
+        // capabilities are discovered asynchronously, push late answers
+        connect(daemonApp->powerManager(), &PowerManager::capabilitiesChanged, this, &SocketServer::sendCapabilities);
+
+        // greeters list the sessions of the catalog instead of reading them
+        connect(daemonApp->sessionCatalog(), &SessionCatalog::changed, this, &SocketServer::sendSessions);
+
+        if (UserDirectory *directory = daemonApp->userDirectory()) {
+            connect(directory, &UserDirectory::usersChanged, this, &SocketServer::sendUsers);
+            connect(directory, &UserDirectory::usersRemoved, this, &SocketServer::sendUsersRemoved);
+            connect(directory, &UserDirectory::listed, this, &SocketServer::sendUsersListed);
+        }
     }
 
     QString SocketServer::socketAddress() const {
@@ -46,7 +75,7 @@ namespace SDDM {
         QString socketName = QStringLiteral("sddm-%1-%2").arg(displayName).arg(generateName(6));
 
         // log message
-        qDebug() << "Socket server starting...";
+        qCDebug(SDDM_DAEMON_SOCKET) << "Socket server starting...";
 
         // create server
         m_server = new QLocalServer(this);
@@ -57,7 +86,7 @@ namespace SDDM {
         // start listening
         if (!m_server->listen(socketName)) {
             // log message
-            qCritical() << "Failed to start socket server.";
+            qCCritical(SDDM_DAEMON_SOCKET) << "Failed to start socket server.";
 
             // return fail
             return false;
@@ -65,7 +94,7 @@ namespace SDDM {
 
 
         // log message
-        qDebug() << "Socket server started.";
+        qCDebug(SDDM_DAEMON_SOCKET) << "Socket server started.";
 
         // connect signals
         connect(m_server, &QLocalServer::newConnection, this, &SocketServer::newConnection);
@@ -80,14 +109,15 @@ namespace SDDM {
             return;
 
         // log message
-        qDebug() << "Socket server stopping...";
+        qCDebug(SDDM_DAEMON_SOCKET) << "Socket server stopping...";
 
         // delete server
+        m_userListeners.clear();
         m_server->deleteLater();
         m_server = nullptr;
 
         // log message
-        qDebug() << "Socket server stopped.";
+        qCDebug(SDDM_DAEMON_SOCKET) << "Socket server stopped.";
     }
 
     void SocketServer::newConnection() {
@@ -97,6 +127,9 @@ namespace SDDM {
         // connect signals
         connect(socket, &QLocalSocket::readyRead, this, &SocketServer::readyRead);
         connect(socket, &QLocalSocket::disconnected, socket, &QLocalSocket::deleteLater);
+        connect(socket, &QObject::destroyed, this, [this, socket] {
+            m_userListeners.remove(socket);
+        });
     }
 
     void SocketServer::readyRead() {
@@ -106,84 +139,161 @@ namespace SDDM {
         if (!socket)
             return;
 
-        // input stream
-        QDataStream input(socket);
+        // handle all the complete messages, the rest stays buffered
+        SocketReader *reader = SocketReader::get(socket);
+        QByteArray frame;
+        // a greeter that was turned away doesn't get anything handled
+        while (socket->isOpen() && reader->next(frame)) {
+            {
+                QDataStream input(frame);
+                handleMessage(socket, input);
+            }
+            // Login frames carry the password
+            SecureBuffer::wipe(frame);
+        }
+    }
 
+    static void runPowerAction(QLocalSocket *socket, Capability action) {
+        // the reply may come in after the greeter went away
+        QPointer<QLocalSocket> guard(socket);
+        daemonApp->powerManager()->run(action, [guard, action](const QString &error) {
+            if (guard)
+                SocketWriter(guard) << quint32(DaemonMessages::PowerActionFinished) << quint32(action)
+                                    << quint32(error.isEmpty()) << error;
+        });
+    }
+
+    void SocketServer::handleMessage(QLocalSocket *socket, QDataStream &input) {
         // read message
         quint32 message;
         input >> message;
+        Metrics::increment("socket_messages_received");
 
         switch (GreeterMessages(message)) {
             case GreeterMessages::Connect: {
                 // log message
-                qDebug() << "Message received from greeter: Connect";
-
-                // send capabilities
+                qCDebug(SDDM_DAEMON_SOCKET) << "Message received from greeter: Connect";
+
+                // the greeter is installed along with the daemon, one
+                // that doesn't match was left behind by an update
+                quint32 version = 0;
+                input >> version;
+                if (version != ProtocolVersion) {
+                    qCWarning(SDDM_DAEMON_SOCKET) << "Greeter speaks protocol version" << version << "instead of" << ProtocolVersion << ", disconnecting it";
+                    socket->abort();
+                    return;
+                }
+
+                // send cached capabilities, updates follow as they change
                 SocketWriter(socket) << quint32(DaemonMessages::Capabilities) << quint32(daemonApp->powerManager()->capabilities());
 
                 // send host name
                 SocketWriter(socket) << quint32(DaemonMessages::HostName) << daemonApp->hostName();
 
+                // a TryExec program may have been installed or removed
+                daemonApp->sessionCatalog()->recheck();
+                writeSessions(socket);
+
                 // emit signal
                 emit connected();
             }
             break;
             case GreeterMessages::Login: {
                 // log message
-                qDebug() << "Message received from greeter: Login";
+                qCDebug(SDDM_DAEMON_SOCKET) << "Message received from greeter: Login";
 
                 // read username, pasword etc.
-                QString user, password, filename;
+                QString user, filename;
+                SecureBuffer password;
                 Session session;
                 input >> user >> password >> session;
 
-                // emit signal
-                emit login(socket, user, password, session);
+                // secrets for further prompts, e.g. a one-time password
+                std::vector<SecureBuffer> credentials;
+                quint32 count = 0;
+                input >> count;
+                for (quint32 i = 0; i < count && input.status() == QDataStream::Ok; ++i) {
+                    SecureBuffer credential;
+                    input >> credential;
+                    credentials.push_back(std::move(credential));
+                }
+
+                // the greeter's correlation id
+                QString loginId;
+                input >> loginId;
+                if (loginId.isEmpty())
+                    loginId = LoginId::generate();
+
+                // the login runs from the handlers, it is started with the id
+                LoginId::Scope scope(loginId);
+                emit login(socket, user, password, session, credentials);
             }
             break;
             case GreeterMessages::PowerOff: {
                 // log message
-                qDebug() << "Message received from greeter: PowerOff";
+                qCDebug(SDDM_DAEMON_SOCKET) << "Message received from greeter: PowerOff";
 
                 // power off
-                daemonApp->powerManager()->powerOff();
+                runPowerAction(socket, Capability::PowerOff);
             }
             break;
             case GreeterMessages::Reboot: {
                 // log message
-                qDebug() << "Message received from greeter: Reboot";
+                qCDebug(SDDM_DAEMON_SOCKET) << "Message received from greeter: Reboot";
 
                 // reboot
-                daemonApp->powerManager()->reboot();
+                runPowerAction(socket, Capability::Reboot);
             }
             break;
             case GreeterMessages::Suspend: {
                 // log message
-                qDebug() << "Message received from greeter: Suspend";
+                qCDebug(SDDM_DAEMON_SOCKET) << "Message received from greeter: Suspend";
 
                 // suspend
-                daemonApp->powerManager()->suspend();
+                runPowerAction(socket, Capability::Suspend);
             }
             break;
             case GreeterMessages::Hibernate: {
                 // log message
-                qDebug() << "Message received from greeter: Hibernate";
+                qCDebug(SDDM_DAEMON_SOCKET) << "Message received from greeter: Hibernate";
 
                 // hibernate
-                daemonApp->powerManager()->hibernate();
+                runPowerAction(socket, Capability::Hibernate);
             }
             break;
             case GreeterMessages::HybridSleep: {
                 // log message
-                qDebug() << "Message received from greeter: HybridSleep";
+                qCDebug(SDDM_DAEMON_SOCKET) << "Message received from greeter: HybridSleep";
 
                 // hybrid sleep
-                daemonApp->powerManager()->hybridSleep();
+                runPowerAction(socket, Capability::HybridSleep);
+            }
+            break;
+            case GreeterMessages::ListUsers: {
+                // log message
+                qCDebug(SDDM_DAEMON_SOCKET) << "Message received from greeter: ListUsers";
+
+                // send the users and keep the greeter up to date
+                listUsers(socket);
+            }
+            break;
+            case GreeterMessages::Ready: {
+                // log message
+                qCDebug(SDDM_DAEMON_SOCKET) << "Message received from greeter: Ready";
+
+                emit greeterReady();
+            }
+            break;
+            case GreeterMessages::FrameStats: {
+                QVector<quint32> frames, renders, inputs;
+                input >> frames >> renders >> inputs;
+
+                emit frameStats(frames, renders, inputs);
             }
             break;
             default: {
                 // log message
-                qWarning() << "Unknown message" << message;
+                qCWarning(SDDM_DAEMON_SOCKET) << "Unknown message" << message;
             }
         }
     }
@@ -196,6 +306,83 @@ namespace SDDM {
         SocketWriter(socket) << quint32(DaemonMessages::LoginSucceeded);
     }
 
+    void SocketServer::resetGreeters() {
+        if (!m_server)
+            return;
+
+        // connections are children of the server
+        const auto sockets = m_server->findChildren<QLocalSocket *>();
+        for (QLocalSocket *socket : sockets)
+            SocketWriter(socket) << quint32(DaemonMessages::Reset);
+    }
+
+    void SocketServer::reloadTheme(const QString &themePath, const QString &configSnapshot) {
+        if (!m_server)
+            return;
+
+        const auto sockets = m_server->findChildren<QLocalSocket *>();
+        for (QLocalSocket *socket : sockets)
+            SocketWriter(socket) << quint32(DaemonMessages::ReloadTheme) << themePath << configSnapshot;
+    }
+
+    void SocketServer::sendCapabilities() {
+        if (!m_server)
+            return;
+
+        const quint32 capabilities = quint32(daemonApp->powerManager()->capabilities());
+        const auto sockets = m_server->findChildren<QLocalSocket *>();
+        for (QLocalSocket *socket : sockets)
+            SocketWriter(socket) << quint32(DaemonMessages::Capabilities) << capabilities;
+    }
+
+    static void writeUsers(QLocalSocket *socket, const QVector<UserInfo> &users) {
+        for (int i = 0; i < users.count(); i += UserBatchSize) {
+            const int count = qMin(UserBatchSize, users.count() - i);
+            SocketWriter writer(socket);
+            writer << quint32(DaemonMessages::Users) << quint32(count);
+            for (int j = i; j < i + count; ++j)
+                writer << users.at(j);
+        }
+    }
+
+    void SocketServer::listUsers(QLocalSocket *socket) {
+        UserDirectory *directory = daemonApp->userDirectory();
+        if (!directory) {
+            qCWarning(SDDM_DAEMON_SOCKET) << "Greeter asked for the users, but Users/SharedUserList is off";
+            return;
+        }
+
+        writeUsers(socket, directory->users());
+        if (directory->isListed())
+            SocketWriter(socket) << quint32(DaemonMessages::UsersListed);
+
+        m_userListeners.insert(socket);
+    }
+
+    void SocketServer::sendSessions() {
+        if (!m_server)
+            return;
+
+        const auto sockets = m_server->findChildren<QLocalSocket *>();
+        for (QLocalSocket *socket : sockets)
+            writeSessions(socket);
+    }
+
+    void SocketServer::sendUsers(const QVector<UserInfo> &users) {
+        for (QLocalSocket *socket : qAsConst(m_userListeners))
+            writeUsers(socket, users);
+    }
+
+    void SocketServer::sendUsersRemoved(const QStringList &names) {
+        for (QLocalSocket *socket : qAsConst(m_userListeners))
+            SocketWriter(socket) << quint32(DaemonMessages::UsersRemoved) << names;
+    }
+
+    void SocketServer::sendUsersListed() {
+        for (QLocalSocket *socket : qAsConst(m_userListeners))
+            SocketWriter(socket) << quint32(DaemonMessages::UsersListed);
+    }
+
     void SocketServer::informationMessage(QLocalSocket *socket, const QString &message) {
         SocketWriter(socket) << quint32(DaemonMessages::InformationMessage) << message;
     }
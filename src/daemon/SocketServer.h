@@ -22,10 +22,17 @@
 #define SDDM_SOCKETSERVER_H
 
 #include <QObject>
+#include <QSet>
 #include <QString>
+#include <QStringList>
 
+#include <vector>
+
+#include "SecureBuffer.h"
 #include "Session.h"
+#include "UserInfo.h"
 
+class QDataStream;
 class QLocalServer;
 class QLocalSocket;
 
@@ -44,20 +51,37 @@ namespace SDDM {
     private slots:
         void newConnection();
         void readyRead();
+        void sendCapabilities();
+        void sendUsers(const QVector<SDDM::UserInfo> &users);
+        void sendUsersRemoved(const QStringList &names);
+        void sendUsersListed();
+        void sendSessions();
 
     public slots:
         void informationMessage(QLocalSocket *socket, const QString &message);
         void loginFailed(QLocalSocket *socket);
         void loginSucceeded(QLocalSocket *socket);
+        void resetGreeters();
+        void reloadTheme(const QString &themePath, const QString &configSnapshot);
 
     signals:
         void login(QLocalSocket *socket,
-                   const QString &user, const QString &password,
-                   const Session &session);
+                   const QString &user, const SecureBuffer &password,
+                   const Session &session, const std::vector<SecureBuffer> &credentials);
         void connected();
+        // the greeter has a frame on each of its screens
+        void greeterReady();
+        // durations in milliseconds the greeter measured, see GreeterMessages::FrameStats
+        void frameStats(const QVector<quint32> &frames, const QVector<quint32> &renders,
+                        const QVector<quint32> &inputs);
 
     private:
+        void handleMessage(QLocalSocket *socket, QDataStream &input);
+        void listUsers(QLocalSocket *socket);
+
         QLocalServer *m_server { nullptr };
+        // greeters that get the changes of the user directory
+        QSet<QLocalSocket *> m_userListeners;
     };
 }
 
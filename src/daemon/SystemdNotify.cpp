@@ -0,0 +1,87 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "SystemdNotify.h"
+
+#include <QByteArray>
+#include <QDebug>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace SDDM {
+    namespace SystemdNotify {
+        static QByteArray s_socketPath;
+        static bool s_ready = false;
+
+        // the protocol is a single datagram of newline separated
+        // assignments, see sd_notify(3); not worth linking libsystemd for
+        static void send(const QByteArray &state) {
+            if (s_socketPath.isEmpty())
+                return;
+
+            struct sockaddr_un address;
+            memset(&address, 0, sizeof(address));
+            address.sun_family = AF_UNIX;
+            if (size_t(s_socketPath.size()) >= sizeof(address.sun_path))
+                return;
+            memcpy(address.sun_path, s_socketPath.constData(), size_t(s_socketPath.size()));
+            // a leading '@' stands for the abstract namespace
+            if (address.sun_path[0] == '@')
+                address.sun_path[0] = '\0';
+            const socklen_t length = socklen_t(offsetof(struct sockaddr_un, sun_path) + size_t(s_socketPath.size()));
+
+            const int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+            if (fd < 0)
+                return;
+            if (sendto(fd, state.constData(), size_t(state.size()), MSG_NOSIGNAL,
+                       reinterpret_cast<struct sockaddr *>(&address), length) < 0)
+                qWarning("Failed to notify the service manager: %s", strerror(errno));
+            close(fd);
+        }
+
+        void initialize() {
+            s_socketPath = qgetenv("NOTIFY_SOCKET");
+            qunsetenv("NOTIFY_SOCKET");
+        }
+
+        void status(const QString &status) {
+            send(QByteArrayLiteral("STATUS=") + status.toUtf8());
+        }
+
+        void ready(const QString &status) {
+            const QByteArray state = QByteArrayLiteral("STATUS=") + status.toUtf8();
+            if (s_ready) {
+                send(state);
+                return;
+            }
+
+            s_ready = true;
+            send(QByteArrayLiteral("READY=1\n") + state);
+        }
+
+        void stopping() {
+            send(QByteArrayLiteral("STOPPING=1"));
+        }
+    }
+}
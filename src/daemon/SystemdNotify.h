@@ -0,0 +1,48 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_SYSTEMDNOTIFY_H
+#define SDDM_SYSTEMDNOTIFY_H
+
+#include <QString>
+
+namespace SDDM {
+    namespace SystemdNotify {
+        /**
+         * Picks up the service manager's notification socket from
+         * NOTIFY_SOCKET and removes the variable, so that the helpers,
+         * greeters and sessions don't report in the daemon's name.
+         * Everything below does nothing without a socket.
+         */
+        void initialize();
+
+        // sends STATUS=@p status
+        void status(const QString &status);
+
+        // sends READY=1 the first time, together with STATUS=@p status;
+        // the daemon is ready once the first greeter or autologin is up,
+        // a seat gave up on its display server, or there is no seat
+        void ready(const QString &status);
+
+        // sends STOPPING=1
+        void stopping();
+    }
+}
+
+#endif // SDDM_SYSTEMDNOTIFY_H
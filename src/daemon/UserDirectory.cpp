@@ -0,0 +1,256 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "UserDirectory.h"
+
+#include "AvatarResolver.h"
+#include "Configuration.h"
+#include "Trace.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QFileSystemWatcher>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+
+#include <pwd.h>
+
+namespace SDDM {
+    // watched for changes to the user database
+    static QString passwdFile() { return QStringLiteral("/etc/passwd"); }
+
+    static inline bool userLessThan(const UserInfo &u1, const UserInfo &u2) {
+        return u1.name < u2.name;
+    }
+
+    static inline bool userNameLessThan(const UserInfo &u, const QString &name) {
+        return u.name < name;
+    }
+
+    static inline bool sameAccount(const UserInfo &u1, const UserInfo &u2) {
+        return u1.realName == u2.realName && u1.homeDir == u2.homeDir &&
+                u1.uid == u2.uid && u1.gid == u2.gid && u1.needsPassword == u2.needsPassword;
+    }
+
+    /**
+     * Walks the passwd database off the main thread, because with
+     * network backed NSS modules this can take a long time.
+     */
+    class UserDirectoryEnumerator : public QThread {
+        Q_OBJECT
+    public:
+        explicit UserDirectoryEnumerator(QObject *parent) : QThread(parent) { }
+
+        // the filter is set up here, the configuration may be reloaded
+        // while the thread runs
+        void enumerate() {
+            m_filter = UserFilter();
+            start(QThread::LowPriority);
+        }
+
+    signals:
+        void usersEnumerated(const QVector<SDDM::UserInfo> &users);
+
+    protected:
+        void run() override {
+            QVector<UserInfo> users;
+            QSet<QString> names;
+
+            struct passwd *pw;
+            setpwent();
+            while ((pw = getpwent()) != nullptr) {
+                if (isInterruptionRequested())
+                    break;
+                if (!m_filter.accepts(pw))
+                    continue;
+
+                // the same user may appear in several sources
+                // specified in nsswitch.conf(5)
+                UserInfo user(pw);
+                if (names.contains(user.name))
+                    continue;
+                names.insert(user.name);
+                users << user;
+            }
+            endpwent();
+
+            // an interrupted run doesn't know about all the users
+            if (isInterruptionRequested())
+                return;
+
+            std::sort(users.begin(), users.end(), userLessThan);
+            emit usersEnumerated(users);
+        }
+
+    private:
+        UserFilter m_filter;
+    };
+
+    UserDirectory::UserDirectory(QObject *parent) : QObject(parent) {
+        qRegisterMetaType<QVector<SDDM::UserInfo>>("QVector<SDDM::UserInfo>");
+
+        m_enumerator = new UserDirectoryEnumerator(this);
+        connect(m_enumerator, &UserDirectoryEnumerator::usersEnumerated, this, &UserDirectory::usersEnumerated);
+
+        // the greeters keep their own cache, ours is written as root
+        m_avatarResolver = new AvatarResolver(this, QStringLiteral("avatars-directory.cache"));
+        m_avatarResolver->setReader(QStringLiteral("sddm"));
+        connect(m_avatarResolver, &AvatarResolver::iconResolved, this, &UserDirectory::setIcon);
+
+        m_iconTimer = new QTimer(this);
+        m_iconTimer->setSingleShot(true);
+        m_iconTimer->setInterval(50);
+        connect(m_iconTimer, &QTimer::timeout, this, &UserDirectory::sendIcons);
+
+        // tools like useradd replace the file, which drops it from the
+        // watcher, and usually write it a few times in a row
+        m_refreshTimer = new QTimer(this);
+        m_refreshTimer->setSingleShot(true);
+        m_refreshTimer->setInterval(1000);
+        connect(m_refreshTimer, &QTimer::timeout, this, &UserDirectory::enumerate);
+
+        m_watcher = new QFileSystemWatcher(this);
+        connect(m_watcher, &QFileSystemWatcher::fileChanged, this, [this](const QString &path) {
+            if (!m_watcher->files().contains(path) && QFile::exists(path))
+                m_watcher->addPath(path);
+            m_refreshTimer->start();
+        });
+    }
+
+    UserDirectory::~UserDirectory() {
+        m_enumerator->requestInterruption();
+        m_enumerator->wait();
+    }
+
+    void UserDirectory::start() {
+        if (QFile::exists(passwdFile()))
+            m_watcher->addPath(passwdFile());
+        enumerate();
+    }
+
+    const QVector<UserInfo> &UserDirectory::users() const {
+        return m_users;
+    }
+
+    bool UserDirectory::isListed() const {
+        return m_listed;
+    }
+
+    void UserDirectory::enumerate() {
+        // the file might not have been there when it changed
+        if (m_watcher->files().isEmpty() && QFile::exists(passwdFile()))
+            m_watcher->addPath(passwdFile());
+
+        // walk it again once the current run is done
+        if (m_enumerator->isRunning()) {
+            m_stale = true;
+            return;
+        }
+
+        Trace::mark("user-directory-enumerate");
+        m_enumerator->enumerate();
+    }
+
+    void UserDirectory::usersEnumerated(const QVector<UserInfo> &found) {
+        Trace::mark("user-directory-enumerated", QString::number(found.count()));
+
+        // avatars are disabled by default for long lists, like the greeters do
+        m_avatarsEnabled = mainConfig.Theme.EnableAvatars.get() &&
+                !(mainConfig.Theme.EnableAvatars.isDefault() && found.count() > mainConfig.Theme.DisableAvatarsThreshold.get());
+        if (!m_avatarsEnabled)
+            m_avatarResolver->clear();
+
+        // both lists are sorted, walk them side by side
+        QVector<UserInfo> users = found;
+        QVector<UserInfo> changed;
+        QStringList removed;
+        auto old = m_users.constBegin();
+        for (UserInfo &user : users) {
+            while (old != m_users.constEnd() && old->name < user.name)
+                removed << (old++)->name;
+
+            const bool known = old != m_users.constEnd() && old->name == user.name;
+            if (known) {
+                if (m_avatarsEnabled)
+                    user.icon = old->icon;
+                const bool same = sameAccount(*old, user) && old->icon == user.icon;
+                ++old;
+                if (same)
+                    continue;
+            } else if (m_avatarsEnabled) {
+                // what we found last time, it's checked below
+                user.icon = m_avatarResolver->cachedIcon(user.name);
+            }
+
+            changed << user;
+            if (m_avatarsEnabled)
+                m_avatarResolver->resolve(user.name, user.homeDir);
+        }
+        for (; old != m_users.constEnd(); ++old)
+            removed << old->name;
+
+        m_users = users;
+
+        if (!removed.isEmpty())
+            emit usersRemoved(removed);
+        if (!changed.isEmpty())
+            emit usersChanged(changed);
+        if (!m_listed) {
+            qDebug() << "User directory lists" << m_users.count() << "users";
+            m_listed = true;
+            emit listed();
+        }
+
+        if (m_stale) {
+            m_stale = false;
+            enumerate();
+        }
+    }
+
+    void UserDirectory::setIcon(const QString &name, const QString &icon) {
+        if (!m_avatarsEnabled)
+            return;
+
+        auto it = std::lower_bound(m_users.begin(), m_users.end(), name, userNameLessThan);
+        if (it == m_users.end() || it->name != name || it->icon == icon)
+            return;
+
+        it->icon = icon;
+        m_changedIcons.insert(name);
+        if (!m_iconTimer->isActive())
+            m_iconTimer->start();
+    }
+
+    void UserDirectory::sendIcons() {
+        QVector<UserInfo> changed;
+        for (const QString &name : qAsConst(m_changedIcons)) {
+            auto it = std::lower_bound(m_users.constBegin(), m_users.constEnd(), name, userNameLessThan);
+            if (it != m_users.constEnd() && it->name == name)
+                changed << *it;
+        }
+        m_changedIcons.clear();
+
+        if (!changed.isEmpty())
+            emit usersChanged(changed);
+    }
+}
+
+#include "UserDirectory.moc"
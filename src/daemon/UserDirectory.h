@@ -0,0 +1,86 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_USERDIRECTORY_H
+#define SDDM_USERDIRECTORY_H
+
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+
+#include "UserInfo.h"
+
+class QFileSystemWatcher;
+class QTimer;
+
+namespace SDDM {
+    class AvatarResolver;
+    class UserDirectoryEnumerator;
+
+    /**
+     * The users listed by the greeters, with Users/SharedUserList.
+     *
+     * The user database is walked once for all seats and again whenever
+     * /etc/passwd changes, and the avatars are looked up here. Greeters
+     * get the list and the changes over their socket, see SocketServer.
+     */
+    class UserDirectory : public QObject {
+        Q_OBJECT
+        Q_DISABLE_COPY(UserDirectory)
+    public:
+        explicit UserDirectory(QObject *parent = nullptr);
+        ~UserDirectory();
+
+        void start();
+
+        // sorted by name
+        const QVector<UserInfo> &users() const;
+        // whether the database has been walked once
+        bool isListed() const;
+
+    signals:
+        // added users, and users whose properties or avatar changed
+        void usersChanged(const QVector<SDDM::UserInfo> &users);
+        void usersRemoved(const QStringList &names);
+        void listed();
+
+    private:
+        void enumerate();
+        void usersEnumerated(const QVector<SDDM::UserInfo> &found);
+        void setIcon(const QString &name, const QString &icon);
+        void sendIcons();
+
+        QVector<UserInfo> m_users;
+        bool m_listed { false };
+        bool m_avatarsEnabled { true };
+        // the database changed while it was being walked
+        bool m_stale { false };
+
+        UserDirectoryEnumerator *m_enumerator { nullptr };
+        AvatarResolver *m_avatarResolver { nullptr };
+        QFileSystemWatcher *m_watcher { nullptr };
+        QTimer *m_refreshTimer { nullptr };
+        // avatars resolved since the last update went out
+        QSet<QString> m_changedIcons;
+        QTimer *m_iconTimer { nullptr };
+    };
+}
+
+#endif // SDDM_USERDIRECTORY_H
@@ -23,19 +23,29 @@
 #include "Configuration.h"
 #include "DaemonApp.h"
 #include "Display.h"
+#include "ProcessPolicy.h"
+#include "ProcessSupervisor.h"
 #include "Seat.h"
+#include "Trace.h"
+#include "XcbCursor.h"
 
+#include <QCoreApplication>
 #include <QDebug>
 #include <QFile>
 #include <QDir>
 #include <QProcess>
+#include <QSocketNotifier>
+#include <QTimer>
 #include <QUuid>
 
 #include <random>
 
 #include <xcb/xcb.h>
 
+#include <errno.h>
+#include <fcntl.h>
 #include <pwd.h>
+#include <string.h>
 #include <unistd.h>
 
 namespace SDDM {
@@ -46,7 +56,20 @@ namespace SDDM {
     }
 
     XorgDisplayServer::~XorgDisplayServer() {
+        closeDisplayFd();
         stop();
+
+        if (!process)
+            return;
+
+        // let the server finish terminating on its own, at shutdown
+        // nobody is left to supervise it and it is waited for
+        disconnect(process, nullptr, this, nullptr);
+        ProcessSupervisor::of(process)->release();
+        process = nullptr;
+
+        // remove authority file
+        QFile::remove(m_xauth.authPath());
     }
 
     const QString &XorgDisplayServer::display() const {
@@ -76,7 +99,7 @@ namespace SDDM {
         }
 
         // create process
-        process = new QProcess(this);
+        process = new PolicyProcess(ProcessPolicy::forRole(ProcessPolicy::Role::DisplayServer), this);
 
         // delete process on finish
         connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, &XorgDisplayServer::finished);
@@ -103,9 +126,12 @@ namespace SDDM {
 
         //create pipe for communicating with X server
         //0 == read from X, 1== write to from X
+        // Both ends are close-on-exec so that no other child inherits them;
+        // only the X server gets the write end, see below.
         int pipeFds[2];
-        if (pipe(pipeFds) != 0) {
+        if (pipe2(pipeFds, O_CLOEXEC) != 0) {
             qCritical("Could not create pipe to start X server");
+            return false;
         }
 
         // start display server
@@ -122,54 +148,98 @@ namespace SDDM {
                  << QStringLiteral("-screen") << QStringLiteral("800x600");
         }
 
-        args << QStringLiteral("-auth") << m_xauth.authPath()
-             << QStringLiteral("-noreset")
-             << QStringLiteral("-displayfd") << QString::number(pipeFds[1]);
+        args << QStringLiteral("-auth") << m_xauth.authPath();
+        // a server that is reused has to be able to reset, see recycle()
+        if (!mainConfig.X11.ReuseServer.get())
+            args << QStringLiteral("-noreset");
+        args << QStringLiteral("-displayfd") << QString::number(pipeFds[1]);
 
         process->setArguments(args);
         qDebug() << "Running:"
             << qPrintable(process->program())
             << qPrintable(process->arguments().join(QLatin1Char(' ')));
+
+        // QProcess forks synchronously, so the write end only needs to be
+        // inheritable for the duration of start()
+        fcntl(pipeFds[1], F_SETFD, 0);
+        Trace::mark("x11-start");
         process->start();
 
-        // wait for display server to start
-        if (!process->waitForStarted()) {
+        // close the other side of pipe in our process, otherwise reading
+        // from it may stuck even X server exit.
+        close(pipeFds[1]);
+
+        if (process->state() == QProcess::NotRunning) {
             // log message
             qCritical() << "Failed to start display server process.";
 
-            // return fail
             close(pipeFds[0]);
+            process->deleteLater();
+            process = nullptr;
             return false;
         }
 
-        // close the other side of pipe in our process, otherwise reading
-        // from it may stuck even X server exit.
-        close(pipeFds[1]);
+        // wait for the display number without blocking the event loop,
+        // other seats keep starting meanwhile
+        fcntl(pipeFds[0], F_SETFL, fcntl(pipeFds[0], F_GETFL) | O_NONBLOCK);
+        m_displayFd = pipeFds[0];
+        m_displayNumber.clear();
 
-        QFile readPipe;
+        m_displayFdNotifier = new QSocketNotifier(m_displayFd, QSocketNotifier::Read, this);
+        connect(m_displayFdNotifier, &QSocketNotifier::activated, this, &XorgDisplayServer::displayFdActivated);
 
-        if (!readPipe.open(pipeFds[0], QIODevice::ReadOnly)) {
-            qCritical("Failed to open pipe to start X Server");
+        m_startTimer = new QTimer(this);
+        m_startTimer->setSingleShot(true);
+        connect(m_startTimer, &QTimer::timeout, this, &XorgDisplayServer::startTimedOut);
+        m_startTimer->start(qMax(1, mainConfig.X11.ServerTimeout.get()) * 1000);
 
-            close(pipeFds[0]);
-            stop();
-            return false;
+        // return success, started() or failed() follows
+        return true;
+    }
+
+    void XorgDisplayServer::displayFdActivated() {
+        char buffer[32];
+        for (;;) {
+            const ssize_t count = ::read(m_displayFd, buffer, sizeof(buffer));
+            if (count > 0) {
+                m_displayNumber.append(buffer, int(count));
+                if (m_displayNumber.contains('\n'))
+                    break;
+                continue;
+            }
+            if (count < 0 && errno == EINTR)
+                continue;
+            if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                return;
+
+            // end of file: the X server exited or closed the pipe
+            break;
         }
-        QByteArray displayNumber = readPipe.readLine();
-        if (displayNumber.size() < 2) {
+
+        const int newline = m_displayNumber.indexOf('\n');
+        if (newline < 1) {
             // X server gave nothing (or a whitespace).
             qCritical("Failed to read display number from pipe");
-
-            close(pipeFds[0]);
-            stop();
-            return false;
+            abortStart();
+            return;
         }
-        displayNumber.prepend(QByteArray(":"));
-        displayNumber.remove(displayNumber.size() -1, 1); // trim trailing whitespace
-        m_display = QString::fromLocal8Bit(displayNumber);
 
-        // close our pipe
-        close(pipeFds[0]);
+        m_displayNumber.truncate(newline);
+        displayReady();
+    }
+
+    void XorgDisplayServer::startTimedOut() {
+        qCritical() << "X server did not report a display number within"
+                    << mainConfig.X11.ServerTimeout.get() << "seconds";
+        abortStart();
+    }
+
+    void XorgDisplayServer::displayReady() {
+        closeDisplayFd();
+
+        m_display = QStringLiteral(":") + QString::fromLocal8Bit(m_displayNumber);
+        m_displayNumber.clear();
+        Trace::mark("x11-ready", m_display);
 
         // The file is also used by the greeter, which does care about the
         // display number. Write the proper entry, if it's different.
@@ -177,39 +247,161 @@ namespace SDDM {
             if(!m_xauth.addCookie(m_display)) {
                 qCritical() << "Failed to write xauth file";
                 stop();
-                return false;
+                emit failed();
+                return;
             }
         }
         changeOwner(m_xauth.authPath());
 
-        emit started();
+        // stands in for -noreset until the server is recycled
+        if (mainConfig.X11.ReuseServer.get() && !holdServer())
+            qWarning() << "Failed to connect to" << m_display << "the server resets whenever its clients are gone";
 
         // set flag
         m_started = true;
 
-        // return success
+        emit started();
+    }
+
+    bool XorgDisplayServer::recycle() {
+        if (!m_started || !process || !mainConfig.X11.ReuseServer.get())
+            return false;
+
+        qDebug() << "Resetting display server" << m_display << "for the next greeter";
+        Trace::mark("x11-recycle", m_display);
+
+        // the server only reads its authority file when it resets, write
+        // one with nothing but a new cookie so that whoever the previous
+        // session handed its cookie to can't connect anymore
+        m_xauth.newCookie();
+        QFile::remove(m_xauth.authPath());
+        if (!m_xauth.addCookie(m_display)) {
+            qCritical() << "Failed to write xauth file";
+            return false;
+        }
+        changeOwner(m_xauth.authPath());
+
+        // the server resets once the last client is gone, ours included
+        releaseServer();
+        m_recycleAttempts = 0;
+        m_recycleTimer = new QTimer(this);
+        m_recycleTimer->setInterval(100);
+        connect(m_recycleTimer, &QTimer::timeout, this, &XorgDisplayServer::recycleAttempt);
+        m_recycleTimer->start();
         return true;
     }
 
+    void XorgDisplayServer::recycleAttempt() {
+        // the new cookie is only accepted after the reset
+        if (holdServer()) {
+            m_recycleTimer->deleteLater();
+            m_recycleTimer = nullptr;
+            Trace::mark("x11-ready", m_display);
+            emit started();
+            return;
+        }
+
+        if (++m_recycleAttempts < 50)
+            return;
+
+        qWarning() << "Display server" << m_display << "did not reset, clients of the previous session are still connected. Restarting it";
+        m_recycleTimer->deleteLater();
+        m_recycleTimer = nullptr;
+        stop();
+    }
+
+    bool XorgDisplayServer::holdServer() {
+        static char authName[] = "MIT-MAGIC-COOKIE-1";
+        QByteArray authData = QByteArray::fromHex(m_xauth.cookie().toLatin1());
+
+        xcb_auth_info_t auth;
+        auth.namelen = int(strlen(authName));
+        auth.name = authName;
+        auth.datalen = authData.size();
+        auth.data = authData.data();
+
+        xcb_connection_t *connection = xcb_connect_to_display_with_auth_info(qPrintable(m_display), &auth, nullptr);
+        if (xcb_connection_has_error(connection)) {
+            xcb_disconnect(connection);
+            return false;
+        }
+
+        releaseServer();
+        m_holdConnection = connection;
+        return true;
+    }
+
+    void XorgDisplayServer::releaseServer() {
+        if (m_holdConnection) {
+            xcb_disconnect(m_holdConnection);
+            m_holdConnection = nullptr;
+        }
+    }
+
+    void XorgDisplayServer::abortStart() {
+        closeDisplayFd();
+        m_displayNumber.clear();
+
+        stop();
+
+        emit failed();
+    }
+
+    void XorgDisplayServer::closeDisplayFd() {
+        if (m_startTimer) {
+            m_startTimer->stop();
+            m_startTimer->deleteLater();
+            m_startTimer = nullptr;
+        }
+
+        if (m_displayFdNotifier) {
+            m_displayFdNotifier->setEnabled(false);
+            m_displayFdNotifier->deleteLater();
+            m_displayFdNotifier = nullptr;
+        }
+
+        if (m_displayFd != -1) {
+            close(m_displayFd);
+            m_displayFd = -1;
+        }
+    }
+
     void XorgDisplayServer::stop() {
+        if (m_recycleTimer) {
+            m_recycleTimer->deleteLater();
+            m_recycleTimer = nullptr;
+        }
+        releaseServer();
+
         if (!process)
             return;
 
+        // a process that never got to run does not emit finished()
+        if (process->state() == QProcess::NotRunning) {
+            process->deleteLater();
+            process = nullptr;
+            return;
+        }
+
+        ProcessSupervisor *supervisor = ProcessSupervisor::of(process);
+        if (supervisor->isStopping())
+            return;
+
         // log message
         qDebug() << "Display server stopping...";
 
-        // terminate process
-        process->terminate();
-
-        // wait for finished
-        if (!process->waitForFinished(5000)) {
-            process->kill();
-            process->waitForFinished(25000);
-        }
+        // finished() is called once it exited, the supervisor escalates
+        // to SIGKILL if that takes too long
+        supervisor->stop(5000);
     }
 
     void XorgDisplayServer::finished() {
         // clean up
+        if (m_recycleTimer) {
+            m_recycleTimer->deleteLater();
+            m_recycleTimer = nullptr;
+        }
+        releaseServer();
         if (process) {
             process->deleteLater();
             process = nullptr;
@@ -238,19 +430,18 @@ namespace SDDM {
         env.insert(QStringLiteral("SHELL"), QStringLiteral("/bin/sh"));
         displayStopScript->setProcessEnvironment(env);
 
+        // the script runs in the background, nothing waits for it
+        connect(displayStopScript, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+                displayStopScript, &QObject::deleteLater);
+        ProcessSupervisor *supervisor = ProcessSupervisor::of(displayStopScript);
+        connect(supervisor, &ProcessSupervisor::failedToStart, displayStopScript, &QObject::deleteLater);
+        supervisor->setDeadline(5000);
+
         // start display stop script
         qDebug() << "Running display stop script " << displayStopCommand;
         const auto program = displayStopCommand.takeFirst();
         displayStopScript->start(program, displayStopCommand);
 
-        // wait for finished
-        if (!displayStopScript->waitForFinished(5000))
-            displayStopScript->kill();
-
-        // clean up the script process
-        displayStopScript->deleteLater();
-        displayStopScript = nullptr;
-
         // remove authority file
         QFile::remove(m_xauth.authPath());
 
@@ -259,10 +450,9 @@ namespace SDDM {
     }
 
     void XorgDisplayServer::setupDisplay() {
-        // create cursor setup process
-        QProcess *setCursor = new QProcess();
-        // create display setup script process
-        QProcess *displayScript = new QProcess();
+        // steps left over from a previous server instance no longer count
+        ++m_setupGeneration;
+        m_pendingSetupSteps = 0;
 
         // set process environment
         QProcessEnvironment env;
@@ -272,36 +462,73 @@ namespace SDDM {
         env.insert(QStringLiteral("XAUTHORITY"), m_xauth.authPath());
         env.insert(QStringLiteral("SHELL"), QStringLiteral("/bin/sh"));
         env.insert(QStringLiteral("XCURSOR_THEME"), mainConfig.Theme.CursorTheme.get());
-        setCursor->setProcessEnvironment(env);
-        displayScript->setProcessEnvironment(env);
 
+        // set the cursor in-process if possible, xsetroot is the fallback;
+        // the cursor is cosmetic, the greeter doesn't wait for it
         qDebug() << "Setting default cursor";
-        setCursor->start(QStringLiteral("xsetroot"), { QStringLiteral("-cursor_name"), QStringLiteral("left_ptr") });
-
-        // delete setCursor on finish
-        connect(setCursor, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), setCursor, &QProcess::deleteLater);
-
-        // wait for finished
-        if (!setCursor->waitForFinished(1000)) {
-            qWarning() << "Could not setup default cursor";
-            setCursor->kill();
-        }
+        const int generation = m_setupGeneration;
+        XcbCursor::setRootCursor(m_display, m_xauth.cookie(),
+                                 mainConfig.Theme.CursorTheme.get(), mainConfig.Theme.CursorSize.get(),
+                                 this, [this, env, generation] (bool success) {
+            if (success || !m_started || generation != m_setupGeneration)
+                return;
+            startSetupStep(env, QStringLiteral("xsetroot"),
+                           { QStringLiteral("-cursor_name"), QStringLiteral("left_ptr") },
+                           1000, false);
+        });
 
         // start display setup script
         qDebug() << "Running display setup script " << mainConfig.X11.DisplayCommand.get();
         QStringList displayCommand = QProcess::splitCommand(mainConfig.X11.DisplayCommand.get());
-        const QString program = displayCommand.takeFirst();
-        displayScript->start(program, displayCommand);
+        if (!displayCommand.isEmpty()) {
+            const QString program = displayCommand.takeFirst();
+            startSetupStep(env, program, displayCommand,
+                           30000, mainConfig.X11.WaitForDisplayCommand.get());
+        }
 
-        // delete displayScript on finish
-        connect(displayScript, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), displayScript, &QProcess::deleteLater);
+        if (m_pendingSetupSteps == 0)
+            finishSetup();
+    }
+
+    void XorgDisplayServer::startSetupStep(const QProcessEnvironment &env, const QString &program,
+                                           const QStringList &arguments, int timeout, bool blocking) {
+        QProcess *step = new QProcess(this);
+        step->setProcessEnvironment(env);
+
+        // kill the step if it takes too long
+        ProcessSupervisor *supervisor = ProcessSupervisor::of(step);
+        supervisor->setDeadline(timeout);
+
+        const int generation = m_setupGeneration;
+        auto done = [this, step, blocking, generation] {
+            step->deleteLater();
+            if (!blocking || generation != m_setupGeneration)
+                return;
+            if (--m_pendingSetupSteps == 0)
+                finishSetup();
+        };
+        connect(step, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, done);
+        // a step that fails to start never emits finished()
+        connect(supervisor, &ProcessSupervisor::failedToStart, this, [step, done] (const QString &error) {
+            qWarning() << "Failed to run display setup step" << step->program() << ":" << error;
+            done();
+        });
+
+        if (blocking)
+            ++m_pendingSetupSteps;
+        step->start(program, arguments);
+    }
 
-        // wait for finished
-        if (!displayScript->waitForFinished(30000))
-            displayScript->kill();
+    void XorgDisplayServer::finishSetup() {
+        // server went away while setting up
+        if (!m_started)
+            return;
 
         // reload config if needed
         mainConfig.load();
+
+        Trace::mark("x11-setup-finished", m_display);
+        emit setupFinished();
     }
 
     void XorgDisplayServer::changeOwner(const QString &fileName) {
@@ -24,7 +24,13 @@
 #include "DisplayServer.h"
 #include "XAuth.h"
 
+#include <QStringList>
+
 class QProcess;
+class QProcessEnvironment;
+class QSocketNotifier;
+class QTimer;
+struct xcb_connection_t;
 
 namespace SDDM {
     class XorgDisplayServer : public DisplayServer {
@@ -41,18 +47,51 @@ namespace SDDM {
 
         QString cookie() const;
 
+        // with X11/ReuseServer, resets the running server with a new
+        // cookie; emits started() once it's done, or stops the server
+        bool recycle();
+
     public slots:
         bool start();
         void stop();
         void finished();
         void setupDisplay();
 
+    private slots:
+        void displayFdActivated();
+        void startTimedOut();
+        void recycleAttempt();
+
     private:
         XAuth m_xauth;
 
         QProcess *process { nullptr };
 
+        // -displayfd pipe, only valid while the server is starting
+        int m_displayFd { -1 };
+        QSocketNotifier *m_displayFdNotifier { nullptr };
+        QTimer *m_startTimer { nullptr };
+        QByteArray m_displayNumber;
+
+        // with X11/ReuseServer our own connection keeps the server from
+        // resetting whenever the greeter and session come and go
+        xcb_connection_t *m_holdConnection { nullptr };
+        QTimer *m_recycleTimer { nullptr };
+        int m_recycleAttempts { 0 };
+
+        // display setup, see setupDisplay()
+        int m_setupGeneration { 0 };
+        int m_pendingSetupSteps { 0 };
+
+        bool holdServer();
+        void releaseServer();
         void changeOwner(const QString &fileName);
+        void startSetupStep(const QProcessEnvironment &env, const QString &program,
+                            const QStringList &arguments, int timeout, bool blocking);
+        void finishSetup();
+        void displayReady();
+        void abortStart();
+        void closeDisplayFd();
     };
 }
 
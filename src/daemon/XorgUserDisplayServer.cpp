@@ -97,6 +97,7 @@ void XorgUserDisplayServer::finished()
 
 void XorgUserDisplayServer::setupDisplay()
 {
+    emit setupFinished();
 }
 
 } // namespace SDDM
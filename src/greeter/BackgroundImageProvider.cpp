@@ -0,0 +1,165 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "BackgroundImageProvider.h"
+
+#include <QCache>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QImageWriter>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QUrl>
+#include <QtMath>
+
+namespace SDDM {
+    const QString BackgroundImageProvider::providerId = QStringLiteral("sddm-background");
+
+    // in KiB, a 1920x1080 background takes about 8100 of them
+    static const int MemoryCacheCost = 64 * 1024;
+
+    static QMutex cacheMutex;
+    static QCache<QString, QImage> memoryCache(MemoryCacheCost);
+
+    class BackgroundImageResponse : public QQuickImageResponse, public QRunnable {
+    public:
+        BackgroundImageResponse(const QString &id, const QSize &requestedSize)
+            : m_id(QUrl::fromPercentEncoding(id.toUtf8())), m_requestedSize(requestedSize) {
+            setAutoDelete(false);
+        }
+
+        QQuickTextureFactory *textureFactory() const override {
+            return QQuickTextureFactory::textureFactoryForImage(m_image);
+        }
+
+        QString errorString() const override {
+            return m_error;
+        }
+
+        void run() override {
+            load();
+            emit finished();
+        }
+
+    private:
+        void load();
+        void decode(const QString &path, const QFileInfo &info);
+
+        QString m_id;
+        QSize m_requestedSize;
+        QImage m_image;
+        QString m_error;
+    };
+
+    static QString localPath(const QUrl &url) {
+        if (url.scheme() == QLatin1String("qrc"))
+            return QLatin1Char(':') + url.path();
+        if (url.isLocalFile())
+            return url.toLocalFile();
+        return QString();
+    }
+
+    void BackgroundImageResponse::load() {
+        const QString path = localPath(QUrl(m_id));
+        const QFileInfo info(path);
+        if (path.isEmpty() || !info.exists()) {
+            m_error = QStringLiteral("Cannot open %1").arg(m_id);
+            return;
+        }
+
+        // screens of the same size share the decoded image
+        const QString key = QStringLiteral("%1:%2:%3:%4x%5").arg(path).arg(info.size())
+            .arg(info.lastModified().toMSecsSinceEpoch())
+            .arg(m_requestedSize.width()).arg(m_requestedSize.height());
+        {
+            QMutexLocker locker(&cacheMutex);
+            if (const QImage *image = memoryCache.object(key)) {
+                m_image = *image;
+                return;
+            }
+        }
+
+        decode(path, info);
+        if (m_image.isNull())
+            return;
+
+        QMutexLocker locker(&cacheMutex);
+        memoryCache.insert(key, new QImage(m_image), qMax(1, int(m_image.sizeInBytes() / 1024)));
+    }
+
+    void BackgroundImageResponse::decode(const QString &path, const QFileInfo &info) {
+        QImageReader reader(path);
+        reader.setAutoTransform(true);
+        const QSize size = reader.size();
+
+        // scale so that the image still covers the requested size, never up
+        QSize scaledSize;
+        if (size.isValid() && m_requestedSize.width() > 0 && m_requestedSize.height() > 0) {
+            const qreal factor = qMax(qreal(m_requestedSize.width()) / size.width(),
+                                      qreal(m_requestedSize.height()) / size.height());
+            if (factor < 1.0)
+                scaledSize = QSize(qCeil(size.width() * factor), qCeil(size.height() * factor));
+        }
+
+        if (!scaledSize.isValid()) {
+            if (!reader.read(&m_image))
+                m_error = reader.errorString();
+            return;
+        }
+
+        // one cached file per source version and screen size
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(path.toUtf8());
+        hash.addData(QByteArray::number(info.size()));
+        hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+        hash.addData(QByteArray::number(scaledSize.width()) + 'x' + QByteArray::number(scaledSize.height()));
+        const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/backgrounds");
+        const QString cacheFile = QStringLiteral("%1/%2.png").arg(cacheDir, QString::fromLatin1(hash.result().toHex()));
+
+        if (m_image.load(cacheFile, "png") && m_image.size() == scaledSize)
+            return;
+
+        // decoders like JPEG scale while decoding, which is much cheaper
+        reader.setScaledSize(scaledSize);
+        if (!reader.read(&m_image)) {
+            m_error = reader.errorString();
+            return;
+        }
+
+        QDir().mkpath(cacheDir);
+        QSaveFile file(cacheFile);
+        QImageWriter writer(&file, "png");
+        if (!file.open(QIODevice::WriteOnly) || !writer.write(m_image) || !file.commit())
+            qDebug() << "Could not cache scaled background" << cacheFile;
+    }
+
+    QQuickImageResponse *BackgroundImageProvider::requestImageResponse(const QString &id, const QSize &requestedSize) {
+        auto *response = new BackgroundImageResponse(id, requestedSize);
+        QThreadPool::globalInstance()->start(response);
+        return response;
+    }
+}
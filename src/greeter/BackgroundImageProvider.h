@@ -0,0 +1,42 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_BACKGROUNDIMAGEPROVIDER_H
+#define SDDM_BACKGROUNDIMAGEPROVIDER_H
+
+#include <QQuickAsyncImageProvider>
+
+namespace SDDM {
+    /**
+     * Serves image://sddm-background/<url> for the Background component.
+     *
+     * Each image is decoded on the thread pool, already scaled down to cover
+     * the requested size, and the result is kept in memory and on disk
+     * keyed by the source's path, size and modification time and the
+     * requested size.
+     */
+    class BackgroundImageProvider : public QQuickAsyncImageProvider {
+    public:
+        static const QString providerId;
+
+        QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) override;
+    };
+}
+
+#endif // SDDM_BACKGROUNDIMAGEPROVIDER_H
@@ -0,0 +1,67 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "Benchmark.h"
+
+#include <QElapsedTimer>
+#include <QVector>
+
+#include <stdio.h>
+
+namespace SDDM {
+    namespace Benchmark {
+        struct Phase {
+            QString name;
+            qint64 start;
+            qint64 end;
+        };
+
+        static bool enabled = false;
+        static QElapsedTimer clock;
+        static QVector<Phase> phases;
+
+        void enable() {
+            enabled = true;
+            clock.start();
+        }
+
+        bool isEnabled() {
+            return enabled;
+        }
+
+        qint64 now() {
+            return enabled ? clock.nsecsElapsed() : 0;
+        }
+
+        void record(const QString &name, qint64 start) {
+            if (enabled)
+                phases.append({ name, start, clock.nsecsElapsed() });
+        }
+
+        void report() {
+            // stdout, unlike the log, is left alone by the message handler
+            printf("%-40s %12s %12s\n", "phase", "duration ms", "done at ms");
+            for (const Phase &phase : qAsConst(phases)) {
+                printf("%-40s %12.2f %12.2f\n", qPrintable(phase.name),
+                       (phase.end - phase.start) / 1000000.0, phase.end / 1000000.0);
+            }
+            fflush(stdout);
+        }
+    }
+}
@@ -0,0 +1,45 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_BENCHMARK_H
+#define SDDM_BENCHMARK_H
+
+#include <QString>
+
+namespace SDDM {
+    namespace Benchmark {
+        /**
+         * Starts the clock of sddm-greeter --benchmark. Until then the
+         * functions below do nothing.
+         */
+        void enable();
+        bool isEnabled();
+
+        // nanoseconds since enable(), to pass to record()
+        qint64 now();
+
+        // the phase @p name took from @p start until now
+        void record(const QString &name, qint64 start);
+
+        // prints the phases in the order they ended
+        void report();
+    }
+}
+
+#endif // SDDM_BENCHMARK_H
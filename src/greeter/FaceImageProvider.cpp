@@ -0,0 +1,199 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "FaceImageProvider.h"
+
+#include <QCache>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QImageWriter>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QUrl>
+#include <QtMath>
+
+namespace SDDM {
+    const QString FaceImageProvider::providerId = QStringLiteral("sddm-face");
+
+    // used when the theme doesn't set a sourceSize
+    static const int DefaultFaceSize = 256;
+    // in KiB, a 256x256 thumbnail takes 256 of them
+    static const int MemoryCacheCost = 32 * 1024;
+    static const int DiskCacheEntries = 512;
+
+    static QMutex cacheMutex;
+    static QCache<QString, QImage> memoryCache(MemoryCacheCost);
+
+    // owned by the engine, which deletes it as soon as the delegate
+    // showing it goes away, the loader may still be running then
+    class FaceImageResponse : public QQuickImageResponse {
+    public:
+        QQuickTextureFactory *textureFactory() const override {
+            return QQuickTextureFactory::textureFactoryForImage(m_image);
+        }
+
+        QString errorString() const override {
+            return m_error;
+        }
+
+        // on the main thread
+        void finish(const QImage &image, const QString &error) {
+            m_image = image;
+            m_error = error;
+            emit finished();
+        }
+
+    private:
+        QImage m_image;
+        QString m_error;
+    };
+
+    // owned by the thread pool, it only hands the result to the response
+    class FaceImageLoader : public QRunnable {
+    public:
+        FaceImageLoader(FaceImageResponse *response, const QString &id, const QSize &requestedSize)
+            : m_response(response), m_id(QUrl::fromPercentEncoding(id.toUtf8())), m_requestedSize(requestedSize) {
+            if (m_requestedSize.width() <= 0 && m_requestedSize.height() <= 0)
+                m_requestedSize = QSize(DefaultFaceSize, DefaultFaceSize);
+        }
+
+        void run() override {
+            // scrolled out of view before it was our turn
+            if (m_response.isNull())
+                return;
+
+            load();
+
+            const QPointer<FaceImageResponse> response = m_response;
+            const QImage image = m_image;
+            const QString error = m_error;
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [response, image, error] {
+                if (response)
+                    response->finish(image, error);
+            }, Qt::QueuedConnection);
+        }
+
+    private:
+        void load();
+
+        QPointer<FaceImageResponse> m_response;
+        QString m_id;
+        QSize m_requestedSize;
+        QImage m_image;
+        QString m_error;
+    };
+
+    static QString localPath(const QUrl &url) {
+        if (url.scheme() == QLatin1String("qrc"))
+            return QLatin1Char(':') + url.path();
+        if (url.isLocalFile())
+            return url.toLocalFile();
+        return QString();
+    }
+
+    // drops the least recently used thumbnails, hits touch their files
+    static void pruneDiskCache(const QString &cacheDir) {
+        const QFileInfoList entries = QDir(cacheDir).entryInfoList({ QStringLiteral("*.png") }, QDir::Files, QDir::Time);
+        for (int i = DiskCacheEntries; i < entries.count(); ++i)
+            QFile::remove(entries.at(i).filePath());
+    }
+
+    static void touch(const QString &fileName) {
+        QFile file(fileName);
+        if (file.open(QIODevice::ReadOnly))
+            file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    }
+
+    void FaceImageLoader::load() {
+        const QString path = localPath(QUrl(m_id));
+        const QFileInfo info(path);
+        if (path.isEmpty() || !info.exists()) {
+            m_error = QStringLiteral("Cannot open %1").arg(m_id);
+            return;
+        }
+
+        // one thumbnail per source version and size
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(path.toUtf8());
+        hash.addData(QByteArray::number(info.size()));
+        hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+        hash.addData(QByteArray::number(m_requestedSize.width()) + 'x' + QByteArray::number(m_requestedSize.height()));
+        const QString key = QString::fromLatin1(hash.result().toHex());
+
+        {
+            QMutexLocker locker(&cacheMutex);
+            if (const QImage *image = memoryCache.object(key)) {
+                m_image = *image;
+                return;
+            }
+        }
+
+        const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/faces");
+        const QString cacheFile = QStringLiteral("%1/%2.png").arg(cacheDir, key);
+
+        if (m_image.load(cacheFile, "png")) {
+            touch(cacheFile);
+        } else {
+            QImageReader reader(path);
+            reader.setAutoTransform(true);
+            const QSize size = reader.size();
+
+            // scale so that the image still covers the requested size, never up
+            if (size.isValid()) {
+                const qreal factor = qMax(m_requestedSize.width() > 0 ? qreal(m_requestedSize.width()) / size.width() : 0.0,
+                                          m_requestedSize.height() > 0 ? qreal(m_requestedSize.height()) / size.height() : 0.0);
+                if (factor < 1.0)
+                    reader.setScaledSize(QSize(qCeil(size.width() * factor), qCeil(size.height() * factor)));
+            }
+
+            if (!reader.read(&m_image)) {
+                m_error = reader.errorString();
+                return;
+            }
+
+            QDir().mkpath(cacheDir);
+            QSaveFile file(cacheFile);
+            QImageWriter writer(&file, "png");
+            if (file.open(QIODevice::WriteOnly) && writer.write(m_image) && file.commit())
+                pruneDiskCache(cacheDir);
+            else
+                qDebug() << "Could not cache avatar thumbnail" << cacheFile;
+        }
+
+        QMutexLocker locker(&cacheMutex);
+        memoryCache.insert(key, new QImage(m_image), qMax(1, int(m_image.sizeInBytes() / 1024)));
+    }
+
+    QQuickImageResponse *FaceImageProvider::requestImageResponse(const QString &id, const QSize &requestedSize) {
+        auto *response = new FaceImageResponse();
+        QThreadPool::globalInstance()->start(new FaceImageLoader(response, id, requestedSize));
+        return response;
+    }
+}
@@ -0,0 +1,118 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "FrameStats.h"
+#include "GreeterProxy.h"
+
+#include <QEvent>
+#include <QMutexLocker>
+#include <QQuickItem>
+#include <QQuickView>
+#include <QTimer>
+
+#include <memory>
+
+namespace SDDM {
+    static const int FlushInterval = 10000;
+    // a batch stays small even while something animates all the time
+    static const int MaximumSamples = 1000;
+
+    // the state of one view, only touched on its render thread
+    struct ViewFrame {
+        qint64 syncStart { 0 };
+        qint64 renderStart { 0 };
+    };
+
+    FrameStats::FrameStats(GreeterProxy *proxy, QObject *parent)
+        : QObject(parent)
+        , m_proxy(proxy)
+        , m_flushTimer(new QTimer(this)) {
+        m_clock.start();
+
+        m_flushTimer->setInterval(FlushInterval);
+        connect(m_flushTimer, &QTimer::timeout, this, &FrameStats::flush);
+        m_flushTimer->start();
+    }
+
+    void FrameStats::watch(QQuickView *view) {
+        auto frame = std::make_shared<ViewFrame>();
+
+        // a frame is synchronized with the items, rendered and swapped
+        connect(view, &QQuickWindow::beforeSynchronizing, this, [this, frame] {
+            frame->syncStart = m_clock.nsecsElapsed();
+        }, Qt::DirectConnection);
+        connect(view, &QQuickWindow::beforeRendering, this, [this, frame] {
+            frame->renderStart = m_clock.nsecsElapsed();
+        }, Qt::DirectConnection);
+        connect(view, &QQuickWindow::afterRendering, this, [this, frame] {
+            if (frame->renderStart > 0)
+                add(m_renders, frame->renderStart);
+        }, Qt::DirectConnection);
+        connect(view, &QQuickWindow::frameSwapped, this, [this, frame] {
+            if (frame->syncStart > 0)
+                add(m_frames, frame->syncStart);
+            frame->syncStart = 0;
+            frame->renderStart = 0;
+
+            const qint64 keyPress = m_keyPress.fetchAndStoreRelaxed(0);
+            if (keyPress > 0)
+                add(m_inputs, keyPress);
+        }, Qt::DirectConnection);
+
+        view->installEventFilter(this);
+    }
+
+    bool FrameStats::eventFilter(QObject *watched, QEvent *event) {
+        if (event->type() != QEvent::KeyPress)
+            return false;
+
+        // Password and PasswordEchoOnEdit of TextInput, the field the
+        // typing feels slow in first
+        QQuickView *view = qobject_cast<QQuickView *>(watched);
+        QQuickItem *item = view ? view->activeFocusItem() : nullptr;
+        if (item && item->property("echoMode").toInt() >= 2)
+            m_keyPress.testAndSetRelaxed(0, m_clock.nsecsElapsed());
+        return false;
+    }
+
+    qint64 FrameStats::msecsSince(qint64 start) const {
+        return (m_clock.nsecsElapsed() - start + 999999) / 1000000;
+    }
+
+    void FrameStats::add(QVector<quint32> &samples, qint64 start) {
+        const qint64 msecs = msecsSince(start);
+        QMutexLocker lock(&m_mutex);
+        if (samples.size() < MaximumSamples)
+            samples.append(quint32(msecs));
+    }
+
+    void FrameStats::flush() {
+        QVector<quint32> frames, renders, inputs;
+        {
+            QMutexLocker lock(&m_mutex);
+            frames.swap(m_frames);
+            renders.swap(m_renders);
+            inputs.swap(m_inputs);
+        }
+
+        if (frames.isEmpty() && renders.isEmpty() && inputs.isEmpty())
+            return;
+        m_proxy->frameStats(frames, renders, inputs);
+    }
+}
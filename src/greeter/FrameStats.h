@@ -0,0 +1,76 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_FRAMESTATS_H
+#define SDDM_FRAMESTATS_H
+
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QVector>
+
+class QQuickView;
+class QTimer;
+
+namespace SDDM {
+    class GreeterProxy;
+
+    /**
+     * Times the frames of the greeter views and how long a key press in
+     * a password field takes to reach the screen, and sends the samples
+     * to the daemon every few seconds.
+     *
+     * The frame signals come from the render thread, everything they
+     * touch is either atomic or guarded by the mutex.
+     */
+    class FrameStats : public QObject {
+        Q_OBJECT
+        Q_DISABLE_COPY(FrameStats)
+    public:
+        explicit FrameStats(GreeterProxy *proxy, QObject *parent = nullptr);
+
+        void watch(QQuickView *view);
+
+        // sends what was collected so far
+        void flush();
+
+    protected:
+        bool eventFilter(QObject *watched, QEvent *event) override;
+
+    private:
+        // milliseconds, rounded up, since @p start in nanoseconds
+        qint64 msecsSince(qint64 start) const;
+        void add(QVector<quint32> &samples, qint64 start);
+
+        GreeterProxy *m_proxy { nullptr };
+        QTimer *m_flushTimer { nullptr };
+        QElapsedTimer m_clock;
+
+        // a key press waiting for its frame, 0 if there is none
+        QAtomicInteger<qint64> m_keyPress { 0 };
+
+        QMutex m_mutex;
+        QVector<quint32> m_frames;
+        QVector<quint32> m_renders;
+        QVector<quint32> m_inputs;
+    };
+}
+
+#endif // SDDM_FRAMESTATS_H
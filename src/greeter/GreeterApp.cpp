@@ -19,14 +19,23 @@
 ***************************************************************************/
 
 #include "GreeterApp.h"
+#include "BackgroundImageProvider.h"
+#include "Benchmark.h"
+#include "FaceImageProvider.h"
+#include "FrameStats.h"
 #include "Configuration.h"
 #include "GreeterProxy.h"
+#include "LoggingCategories.h"
 #include "Constants.h"
+#include "Prefetch.h"
 #include "ScreenModel.h"
 #include "SessionModel.h"
 #include "SignalHandler.h"
+#include "ThemeBundle.h"
 #include "ThemeConfig.h"
 #include "ThemeMetadata.h"
+#include "Trace.h"
+#include "UserInfo.h"
 #include "UserModel.h"
 #include "KeyboardModel.h"
 
@@ -36,37 +45,121 @@
 #include <QGuiApplication>
 #include <QQuickItem>
 #include <QQuickView>
+#include <QQuickWindow>
+#include <QQmlComponent>
 #include <QQmlContext>
 #include <QQmlEngine>
+#include <QQmlPropertyMap>
 #include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QPixmapCache>
+#include <QPointer>
+#include <QStyleHints>
 #include <QTimer>
 #include <QTranslator>
 #include <QLibraryInfo>
 #include <QVersionNumber>
 #include <QSurfaceFormat>
+#include <QTemporaryDir>
 
 #include <iostream>
+#include <memory>
+#include <thread>
 
 #define TR(x) QT_TRANSLATE_NOOP("Command line parser", QStringLiteral(x))
 
 static const QEvent::Type StartupEventType = static_cast<QEvent::Type>(QEvent::registerEventType());
 
 namespace SDDM {
+    /**
+     * Loads a translation catalog on a worker thread, so that reading
+     * the .qm file overlaps with connecting to the daemon and setting up
+     * the models. The translator is only handed out by take(), which
+     * waits for the worker, and must be installed from the main thread.
+     */
+    class TranslationLoader {
+    public:
+        explicit TranslationLoader(const QString &directory) {
+            const QLocale locale = QLocale::system();
+            // Most greeters run with a locale no catalog exists for,
+            // so don't spend a thread, or a QTranslator, on them
+            if (!hasCatalog(directory, locale))
+                return;
+
+            m_translator.reset(new QTranslator());
+            QTranslator *translator = m_translator.get();
+            m_thread = std::thread([this, translator, locale, directory] {
+                m_loaded = translator->load(locale, QString(), QString(), directory);
+            });
+        }
+
+        ~TranslationLoader() {
+            if (m_thread.joinable())
+                m_thread.join();
+        }
+
+        // Returns the loaded translator, or a null pointer if there was nothing to load
+        QTranslator *take() {
+            if (m_thread.joinable())
+                m_thread.join();
+            if (!m_loaded)
+                return nullptr;
+            return m_translator.release();
+        }
+
+    private:
+        static bool hasCatalog(const QString &directory, const QLocale &locale) {
+            const QStringList catalogs = QDir(directory).entryList({ QStringLiteral("*.qm") }, QDir::Files);
+            if (catalogs.isEmpty())
+                return false;
+
+            // Same candidates QTranslator::load() tries: each UI language,
+            // then with its territory and script parts stripped
+            const QStringList languages = locale.uiLanguages();
+            for (QString language : languages) {
+                language.replace(QLatin1Char('-'), QLatin1Char('_'));
+                while (!language.isEmpty()) {
+                    for (const QString &catalog : catalogs) {
+                        if (catalog.compare(language + QStringLiteral(".qm"), Qt::CaseInsensitive) == 0)
+                            return true;
+                    }
+                    const int separator = language.lastIndexOf(QLatin1Char('_'));
+                    if (separator < 0)
+                        break;
+                    language.truncate(separator);
+                }
+            }
+            return false;
+        }
+
+        std::thread m_thread;
+        std::unique_ptr<QTranslator> m_translator;
+        bool m_loaded = false;
+    };
+
     GreeterApp::GreeterApp(QObject *parent)
         : QObject(parent)
     {
         // Translations
-        // Components translation
-        m_components_tranlator = new QTranslator();
-        if (m_components_tranlator->load(QLocale::system(), QString(), QString(), QStringLiteral(COMPONENTS_TRANSLATION_DIR)))
-            QCoreApplication::installTranslator(m_components_tranlator);
-
+        // Components translation, installed in startup()
+        m_componentsLoader.reset(new TranslationLoader(QStringLiteral(COMPONENTS_TRANSLATION_DIR)));
 
         // Create models
-        m_sessionModel = new SessionModel();
+        // the sessions come from the daemon, see startup()
+        const qint64 start = Benchmark::now();
+        m_sessionModel = new SessionModel(SessionModel::LoadLater);
         m_keyboard = new KeyboardModel();
+        Benchmark::record(QStringLiteral("models"), start);
     }
 
+    GreeterApp::~GreeterApp() = default;
+
     bool GreeterApp::isTestModeEnabled() const
     {
         return m_testing;
@@ -92,11 +185,23 @@ namespace SDDM {
         return m_themePath;
     }
 
+    void GreeterApp::setBenchmarkUsers(int count)
+    {
+        m_benchmarkUsers = count;
+    }
+
     void GreeterApp::setThemePath(const QString &path)
     {
+        const qint64 start = Benchmark::now();
+        m_themeLoadTime = QDateTime::currentDateTime();
         m_themePath = path;
-        if (m_themePath.isEmpty())
+        m_bundleRoot.clear();
+        if (m_themePath.isEmpty()) {
             m_themePath = QLatin1String("qrc:/theme");
+        } else if (ThemeBundle::isBundle(m_themePath)) {
+            m_themePath = ThemeBundle::mount(m_themePath);
+            m_bundleRoot = m_themePath;
+        }
 
         // Read theme metadata
         const QString metadataPath = QStringLiteral("%1/metadata.desktop").arg(m_themePath);
@@ -113,28 +218,49 @@ namespace SDDM {
             m_themeConfig->setTo(configFile);
         else
             m_themeConfig = new ThemeConfig(configFile);
+        updateConfig();
 
+        // The theme might need all users while the current user model
+        // doesn't have them, it then goes on from where it stopped
         const bool themeNeedsAllUsers = m_themeConfig->value(QStringLiteral("needsFullUserModel"), true).toBool();
-        if(m_userModel && themeNeedsAllUsers && !m_userModel->containsAllUsers()) {
-            // The theme needs all users, but the current user model doesn't have them -> recreate
-            m_userModel->deleteLater();
-            m_userModel = nullptr;
-        }
-
-        if (!m_userModel)
-            m_userModel = new UserModel(themeNeedsAllUsers, nullptr);
+        if (m_userModel)
+            m_userModel->setNeedAllUsers(themeNeedsAllUsers);
+        else
+            m_userModel = new UserModel(themeNeedsAllUsers, userSource(), nullptr);
 
         // Set default icon theme from greeter theme
         if (m_themeConfig->contains(QStringLiteral("iconTheme")))
             QIcon::setThemeName(m_themeConfig->value(QStringLiteral("iconTheme")).toString());
 
         // Theme specific translation
-        if (m_theme_translator)
+        if (m_theme_translator) {
             m_theme_translator->deleteLater();
-        m_theme_translator = new QTranslator();
-        if (m_theme_translator->load(QLocale::system(), QString(), QString(),
-                           QStringLiteral("%1/%2/").arg(m_themePath, m_metadata->translationsDirectory())))
-            QCoreApplication::installTranslator(m_theme_translator);
+            m_theme_translator = nullptr;
+        }
+        m_themeLoader.reset(new TranslationLoader(QStringLiteral("%1/%2/").arg(m_themePath, m_metadata->translationsDirectory())));
+
+        // Views already exist, they have to pick it up right away
+        if (m_proxy)
+            installTranslators();
+
+        Benchmark::record(QStringLiteral("theme-parse"), start);
+    }
+
+    void GreeterApp::installTranslators()
+    {
+        if (m_componentsLoader) {
+            m_components_tranlator = m_componentsLoader->take();
+            m_componentsLoader.reset();
+            if (m_components_tranlator)
+                QCoreApplication::installTranslator(m_components_tranlator);
+        }
+
+        if (m_themeLoader) {
+            m_theme_translator = m_themeLoader->take();
+            m_themeLoader.reset();
+            if (m_theme_translator)
+                QCoreApplication::installTranslator(m_theme_translator);
+        }
     }
 
     void GreeterApp::customEvent(QEvent *event)
@@ -143,15 +269,51 @@ namespace SDDM {
             startup();
     }
 
-    void GreeterApp::addViewForScreen(QScreen *screen) {
-        // create view
-        QQuickView *view = new QQuickView();
+    bool GreeterApp::eventFilter(QObject *watched, QEvent *event)
+    {
+        switch (event->type()) {
+        case QEvent::KeyPress:
+        case QEvent::MouseButtonPress:
+        case QEvent::MouseMove:
+        case QEvent::TouchBegin:
+        case QEvent::Wheel:
+            if (m_idle)
+                setIdle(false);
+            m_idleTimer->start();
+            break;
+        default:
+            break;
+        }
+        return QObject::eventFilter(watched, event);
+    }
+
+    void GreeterApp::setIdle(bool idle)
+    {
+        m_idle = idle;
+        qDebug() << (idle ? "Greeter idle" : "Greeter awake");
+
+        // a blinking cursor alone keeps the scene graph rendering
+        if (idle) {
+            m_cursorFlashTime = QGuiApplication::styleHints()->cursorFlashTime();
+            QGuiApplication::styleHints()->setCursorFlashTime(0);
+        } else {
+            QGuiApplication::styleHints()->setCursorFlashTime(m_cursorFlashTime);
+        }
+
+        if (m_engine) {
+            m_engine->rootContext()->setContextProperty(QStringLiteral("greeterIdle"), idle);
+        } else {
+            for (QQuickView *view : qAsConst(m_views))
+                view->rootContext()->setContextProperty(QStringLiteral("greeterIdle"), idle);
+            for (QQuickView *view : qAsConst(m_spareViews))
+                view->rootContext()->setContextProperty(QStringLiteral("greeterIdle"), idle);
+        }
+    }
+
+    void GreeterApp::assignScreen(QQuickView *view, QScreen *screen) {
         view->setScreen(screen);
-        view->setResizeMode(QQuickView::SizeRootObjectToView);
         //view->setGeometry(QRect(QPoint(0, 0), screen->geometry().size()));
         view->setGeometry(screen->geometry());
-        view->setFlags(Qt::FramelessWindowHint);
-        m_views.append(view);
 
         // remove the view when the screen is removed, but we
         // need to be careful here since Qt will move the view to
@@ -163,11 +325,49 @@ namespace SDDM {
         });
 
         // always resize when the screen geometry changes
-        connect(screen, &QScreen::geometryChanged, this, [view](const QRect &r) {
+        connect(screen, &QScreen::geometryChanged, view, [view](const QRect &r) {
             view->setGeometry(r);
         });
+    }
+
+    void GreeterApp::addViewForScreen(QScreen *screen) {
+        const qint64 start = Benchmark::now();
 
-        view->engine()->addImportPath(QStringLiteral(IMPORTS_INSTALL_DIR));
+        // a docking station or KVM switch brings back screens it just
+        // took away, a view that was set up before only needs a resize
+        if (!m_spareViews.isEmpty()) {
+            QQuickView *view = m_spareViews.takeLast();
+            assignScreen(view, screen);
+            m_views.append(view);
+
+            if (ScreenModel *screenModel = view->findChild<ScreenModel *>())
+                screenModel->setScreen(screen);
+            QQmlContext *context = m_engine ? (view->rootObject() ? QQmlEngine::contextForObject(view->rootObject()) : nullptr)
+                                            : view->rootContext();
+            if (context)
+                context->setContextProperty(QStringLiteral("primaryScreen"), QGuiApplication::primaryScreen() == screen);
+
+            qDebug() << "Reusing view for" << screen->name() << screen->geometry();
+            view->show();
+            if (QGuiApplication::primaryScreen() == screen)
+                view->requestActivate();
+            return;
+        }
+
+        // create view
+        QQuickView *view = m_engine ? new QQuickView(m_engine, nullptr) : new QQuickView();
+        view->setResizeMode(QQuickView::SizeRootObjectToView);
+        view->setFlags(Qt::FramelessWindowHint);
+        assignScreen(view, screen);
+        m_views.append(view);
+        if (m_frameStats)
+            m_frameStats->watch(view);
+
+        if (!m_engine) {
+            view->engine()->addImportPath(QStringLiteral(IMPORTS_INSTALL_DIR));
+            view->engine()->addImageProvider(BackgroundImageProvider::providerId, new BackgroundImageProvider);
+            view->engine()->addImageProvider(FaceImageProvider::providerId, new FaceImageProvider);
+        }
 
         // connect proxy signals
         connect(m_proxy, &GreeterProxy::loginSucceeded, view, &QQuickView::close);
@@ -181,50 +381,62 @@ namespace SDDM {
         // we want to keep it for compatibility reasons, we do however create
         // one for each view and expose only the screen that the view belongs to
         // in order to avoid creating items with different sizes.
-        ScreenModel *screenModel = new ScreenModel(screen, view);
-
-        // set context properties
-        view->rootContext()->setContextProperty(QStringLiteral("sessionModel"), m_sessionModel);
-        view->rootContext()->setContextProperty(QStringLiteral("screenModel"), screenModel);
-        view->rootContext()->setContextProperty(QStringLiteral("userModel"), m_userModel);
-        view->rootContext()->setContextProperty(QStringLiteral("config"), *m_themeConfig);
-        view->rootContext()->setContextProperty(QStringLiteral("sddm"), m_proxy);
-        view->rootContext()->setContextProperty(QStringLiteral("keyboard"), m_keyboard);
-        view->rootContext()->setContextProperty(QStringLiteral("primaryScreen"), QGuiApplication::primaryScreen() == screen);
-        view->rootContext()->setContextProperty(QStringLiteral("__sddm_errors"), QString());
+        new ScreenModel(screen, view);
 
-        // get theme main script
-        QString mainScript = QStringLiteral("%1/%2").arg(m_themePath).arg(m_metadata->mainScript());
-        QUrl mainScriptUrl;
-        if (m_themePath.startsWith(QLatin1String("qrc:/")))
-            mainScriptUrl = QUrl(mainScript);
-        else
-            mainScriptUrl = QUrl::fromLocalFile(mainScript);
+        // set context properties, with a shared engine they are set up
+        // once and loadTheme() adds the per view ones
+        if (!m_engine) {
+            setContextProperties(view->rootContext());
+            setViewContextProperties(view, view->rootContext());
 
-        // load theme from resources when an error has occurred
-        connect(view, &QQuickView::statusChanged, this, [view](QQuickView::Status status) {
-            if (status != QQuickView::Error)
-                return;
+            // load theme from resources when an error has occurred
+            connect(view, &QQuickView::statusChanged, this, [view](QQuickView::Status status) {
+                if (status != QQuickView::Error)
+                    return;
 
-            QString errors;
-            const auto errorList = view->errors();
-            for(const QQmlError &e : errorList) {
-                qWarning() << e;
-                errors += QLatin1String("\n") + e.toString();
-            }
+                QString errors;
+                const auto errorList = view->errors();
+                for(const QQmlError &e : errorList) {
+                    qWarning() << e;
+                    errors += QLatin1String("\n") + e.toString();
+                }
 
-            qWarning() << "Fallback to embedded theme";
-            view->rootContext()->setContextProperty(QStringLiteral("__sddm_errors"), errors);
-            view->setSource(QUrl(QStringLiteral("qrc:/theme/Main.qml")));
-        });
+                qWarning() << "Fallback to embedded theme";
+                view->rootContext()->setContextProperty(QStringLiteral("__sddm_errors"), errors);
+                view->setSource(QUrl(QStringLiteral("qrc:/theme/Main.qml")));
+            });
+        }
 
-        // set main script as source
-        qInfo("Loading %s...", qPrintable(mainScriptUrl.toString()));
-        view->setSource(mainScriptUrl);
+        loadTheme(view);
+        Trace::mark("greeter-theme-loaded", screen->name());
 
-        // set default cursor
-        QCursor cursor(Qt::ArrowCursor);
-        view->rootObject()->setCursor(cursor);
+        // note when the first frame is on screen
+        auto firstFrame = std::make_shared<QMetaObject::Connection>();
+        const QString screenName = screen->name();
+        *firstFrame = connect(view, &QQuickWindow::frameSwapped, this, [this, firstFrame, screenName] {
+            QObject::disconnect(*firstFrame);
+            Trace::mark("greeter-first-frame", screenName);
+            Benchmark::record(QStringLiteral("first-frame %1").arg(screenName), 0);
+
+            // done once all screens have something on them
+            const bool allShown = ++m_shownViews >= m_views.count() && m_pendingScreens.isEmpty();
+            if (Benchmark::isEnabled() && allShown) {
+                Benchmark::report();
+                QCoreApplication::exit(EXIT_SUCCESS);
+            }
+
+            // the daemon holds back sleep until this arrives
+            if (allShown && !m_readySent && m_proxy) {
+                m_readySent = true;
+                m_proxy->ready();
+            }
+
+            // everything needed to get here is loaded by now
+            if (!m_prefetchLearned && !m_testing && mainConfig.Theme.Prefetch.get()) {
+                m_prefetchLearned = true;
+                QTimer::singleShot(0, this, [] { Prefetch::learn(); });
+            }
+        });
 
         // show
         qDebug() << "Adding view for" << screen->name() << screen->geometry();
@@ -233,12 +445,117 @@ namespace SDDM {
         // activate windows for the primary screen to give focus to text fields
         if (QGuiApplication::primaryScreen() == screen)
             view->requestActivate();
+
+        Benchmark::record(QStringLiteral("view %1").arg(screen->name()), start);
+    }
+
+    void GreeterApp::setContextProperties(QQmlContext *context) {
+        context->setContextProperty(QStringLiteral("sessionModel"), m_sessionModel);
+        context->setContextProperty(QStringLiteral("userModel"), m_userModel);
+        context->setContextProperty(QStringLiteral("config"), m_config);
+        context->setContextProperty(QStringLiteral("sddm"), m_proxy);
+        context->setContextProperty(QStringLiteral("keyboard"), m_keyboard);
+        context->setContextProperty(QStringLiteral("greeterIdle"), m_idle);
+    }
+
+    void GreeterApp::setViewContextProperties(QQuickView *view, QQmlContext *context) {
+        context->setContextProperty(QStringLiteral("screenModel"), view->findChild<ScreenModel *>());
+        context->setContextProperty(QStringLiteral("primaryScreen"), QGuiApplication::primaryScreen() == view->screen());
+        context->setContextProperty(QStringLiteral("__sddm_errors"), QString());
+    }
+
+    QUrl GreeterApp::mainScriptUrl() const {
+        // get theme main script
+        QString mainScript = QStringLiteral("%1/%2").arg(m_themePath).arg(m_metadata->mainScript());
+        if (m_themePath.startsWith(QLatin1String("qrc:/")))
+            return QUrl(mainScript);
+        if (m_themePath.startsWith(QLatin1String(":/")))
+            return QUrl(QStringLiteral("qrc") + mainScript);
+        return QUrl::fromLocalFile(mainScript);
+    }
+
+    void GreeterApp::loadTheme(QQuickView *view) {
+        const QUrl url = mainScriptUrl();
+
+        if (!m_engine) {
+            // set main script as source
+            qInfo("Loading %s...", qPrintable(url.toString()));
+            const qint64 start = Benchmark::now();
+            view->setSource(url);
+            Benchmark::record(QStringLiteral("qml-load %1").arg(view->screen()->name()), start);
+        } else {
+            // the theme is compiled once for all the views, each one only
+            // gets its own context on top of the shared one
+            QQmlContext *context = new QQmlContext(m_engine->rootContext(), view);
+            setViewContextProperties(view, context);
+
+            if (!m_component) {
+                qInfo("Loading %s...", qPrintable(url.toString()));
+                const qint64 start = Benchmark::now();
+                m_component = new QQmlComponent(m_engine, url, this);
+                Benchmark::record(QStringLiteral("qml-compile"), start);
+            }
+
+            QQmlComponent *component = m_component;
+            if (component->isError()) {
+                QString errors;
+                const auto errorList = component->errors();
+                for(const QQmlError &e : errorList) {
+                    qWarning() << e;
+                    errors += QLatin1String("\n") + e.toString();
+                }
+
+                qWarning() << "Fallback to embedded theme";
+                context->setContextProperty(QStringLiteral("__sddm_errors"), errors);
+                if (!m_fallbackComponent)
+                    m_fallbackComponent = new QQmlComponent(m_engine, QUrl(QStringLiteral("qrc:/theme/Main.qml")), this);
+                component = m_fallbackComponent;
+            }
+
+            // replaces whatever a previous load left behind
+            QObject *oldRoot = view->rootObject();
+            QQmlContext *oldContext = oldRoot ? QQmlEngine::contextForObject(oldRoot) : nullptr;
+
+            view->setContent(component->url(), component, component->create(context));
+
+            delete oldRoot;
+            if (oldContext && oldContext != m_engine->rootContext())
+                delete oldContext;
+        }
+
+        // set default cursor
+        if (view->rootObject())
+            view->rootObject()->setCursor(QCursor(Qt::ArrowCursor));
     }
 
     void GreeterApp::removeViewForScreen(QQuickView *view) {
-        // screen is gone, remove the window
+        // screen is gone, hide the window and keep it for the next screen
         m_views.removeOne(view);
-        view->deleteLater();
+        disconnect(qGuiApp, &QGuiApplication::screenRemoved, view, nullptr);
+        for (QScreen *screen : QGuiApplication::screens())
+            disconnect(screen, &QScreen::geometryChanged, view, nullptr);
+        view->hide();
+        m_spareViews.append(view);
+    }
+
+    UserModel::Source GreeterApp::userSource() const {
+        // made up users are fed like the daemon's
+        if (m_benchmarkUsers > 0)
+            return UserModel::DaemonUsers;
+        // there is no daemon to ask in test mode
+        if (mainConfig.Users.SharedUserList.get() && !m_testing)
+            return UserModel::DaemonUsers;
+        return UserModel::LocalUsers;
+    }
+
+    void GreeterApp::listUsers() {
+        if (!m_userModel || !m_proxy || m_benchmarkUsers > 0 || userSource() != UserModel::DaemonUsers)
+            return;
+
+        connect(m_proxy, &GreeterProxy::usersReceived, m_userModel, &UserModel::addDirectoryUsers, Qt::UniqueConnection);
+        connect(m_proxy, &GreeterProxy::usersRemoved, m_userModel, &UserModel::removeDirectoryUsers, Qt::UniqueConnection);
+        connect(m_proxy, &GreeterProxy::usersListed, m_userModel, &UserModel::directoryListed, Qt::UniqueConnection);
+        m_proxy->listUsers();
     }
 
     void GreeterApp::startup()
@@ -250,14 +567,13 @@ namespace SDDM {
             QCoreApplication::exit(EXIT_FAILURE);
             return;
         }
+        m_frameStats = new FrameStats(m_proxy, this);
+
+        const bool staged = mainConfig.Theme.StagedStartup.get();
 
         // Set numlock upon start
-        if (m_keyboard->enabled()) {
-            if (mainConfig.Numlock.get() == MainConfig::NUM_SET_ON)
-                m_keyboard->setNumLockState(true);
-            else if (mainConfig.Numlock.get() == MainConfig::NUM_SET_OFF)
-                m_keyboard->setNumLockState(false);
-        }
+        if (!staged)
+            setNumLock();
 
         // Set font
         const QString fontStr = mainConfig.Theme.Font.get();
@@ -271,13 +587,91 @@ namespace SDDM {
         // Set session model on proxy
         m_proxy->setSessionModel(m_sessionModel);
 
+        // the daemon sends the sessions of its catalog, without one the
+        // files are read here, after the first frame with a staged startup
+        if (m_proxy->isConnected()) {
+            m_sessionModel->useDaemonCatalog();
+            connect(m_proxy, &GreeterProxy::sessionsReceived, m_sessionModel, &SessionModel::setSessions);
+        } else if (!staged) {
+            m_sessionModel->load();
+        }
+
         // If the socket ends, bail. There is not much we can do.
         connect(m_proxy, &GreeterProxy::socketDisconnected, qGuiApp, &QCoreApplication::quit);
 
+        // the daemon sends the users, if it keeps the list
+        listUsers();
+
+        if (m_benchmarkUsers > 0) {
+            const qint64 start = Benchmark::now();
+            QVector<UserInfo> users;
+            users.reserve(m_benchmarkUsers);
+            for (int i = 0; i < m_benchmarkUsers; ++i) {
+                UserInfo user;
+                user.name = QStringLiteral("user%1").arg(i, 6, 10, QLatin1Char('0'));
+                user.realName = QStringLiteral("Benchmark User %1").arg(i);
+                user.homeDir = QStringLiteral("/home/%1").arg(user.name);
+                user.uid = user.gid = 100000 + i;
+                user.needsPassword = true;
+                users << user;
+            }
+            m_userModel->addDirectoryUsers(users);
+            m_userModel->directoryListed();
+            Benchmark::record(QStringLiteral("users"), start);
+        }
+
+        // save power when nobody is in front of the screen
+        if (mainConfig.Theme.IdleTimeout.get() > 0) {
+            m_idleTimer = new QTimer(this);
+            m_idleTimer->setSingleShot(true);
+            m_idleTimer->setInterval(mainConfig.Theme.IdleTimeout.get() * 1000);
+            connect(m_idleTimer, &QTimer::timeout, this, [this] { setIdle(true); });
+            m_idleTimer->start();
+            qGuiApp->installEventFilter(this);
+        }
+
+        // Show up again after the session of a previous login ended
+        connect(m_proxy, &GreeterProxy::reset, this, &GreeterApp::resetViews);
+
+        // a new theme, or the files of the current one were changed
+        connect(m_proxy, &GreeterProxy::themeReloadRequested, this, &GreeterApp::reloadTheme);
+
+        // Nothing is shown until then, so don't hold on to the theme
+        connect(m_proxy, &GreeterProxy::loginSucceeded, this, &GreeterApp::releaseResources);
+
+        // Translations have to be in place before QML asks for any string
+        installTranslators();
+
+        // Share one engine between the views if asked to
+        if (mainConfig.Theme.SharedEngine.get()) {
+            m_engine = new QQmlEngine(this);
+            m_engine->addImportPath(QStringLiteral(IMPORTS_INSTALL_DIR));
+            m_engine->addImageProvider(BackgroundImageProvider::providerId, new BackgroundImageProvider);
+            m_engine->addImageProvider(FaceImageProvider::providerId, new FaceImageProvider);
+            setContextProperties(m_engine->rootContext());
+        }
+
         // Create views
         const QList<QScreen *> screens = qGuiApp->primaryScreen()->virtualSiblings();
-        for (QScreen *screen : screens)
-            addViewForScreen(screen);
+        if (staged) {
+            // Only the primary screen gets a view for now, everything
+            // else waits until it has something on screen
+            QScreen *primary = qGuiApp->primaryScreen();
+            for (QScreen *screen : screens) {
+                if (screen != primary)
+                    m_pendingScreens.append(screen);
+            }
+            addViewForScreen(primary);
+
+            auto firstFrame = std::make_shared<QMetaObject::Connection>();
+            *firstFrame = connect(m_views.last(), &QQuickWindow::frameSwapped, this, [this, firstFrame] {
+                QObject::disconnect(*firstFrame);
+                QTimer::singleShot(0, this, &GreeterApp::continueStartup);
+            });
+        } else {
+            for (QScreen *screen : screens)
+                addViewForScreen(screen);
+        }
 
         // Handle screens
         connect(qGuiApp, &QGuiApplication::screenAdded, this, &GreeterApp::addViewForScreen);
@@ -286,6 +680,39 @@ namespace SDDM {
         });
     }
 
+    void GreeterApp::continueStartup()
+    {
+        // One step per event loop iteration, so that input and
+        // repaints of the views already shown are not held up
+        if (!m_sessionModel->isLoaded()) {
+            setNumLock();
+            m_sessionModel->load();
+        } else {
+            while (!m_pendingScreens.isEmpty()) {
+                // the screen might have gone away in the meantime
+                const QPointer<QScreen> screen = m_pendingScreens.takeFirst();
+                if (screen) {
+                    addViewForScreen(screen);
+                    break;
+                }
+            }
+        }
+
+        if (!m_pendingScreens.isEmpty())
+            QTimer::singleShot(0, this, &GreeterApp::continueStartup);
+    }
+
+    void GreeterApp::setNumLock()
+    {
+        if (!m_keyboard->enabled())
+            return;
+
+        if (mainConfig.Numlock.get() == MainConfig::NUM_SET_ON)
+            m_keyboard->setNumLockState(true);
+        else if (mainConfig.Numlock.get() == MainConfig::NUM_SET_OFF)
+            m_keyboard->setNumLockState(false);
+    }
+
     void GreeterApp::activatePrimary() {
         // activate and give focus to the window assigned to the primary screen
         for (QQuickView *view : qAsConst(m_views)) {
@@ -296,26 +723,338 @@ namespace SDDM {
         }
     }
 
+    void GreeterApp::releaseResources() {
+        // the greeter is done, with this login at the latest
+        m_frameStats->flush();
+
+        // spare views are cheap to recreate compared to what they hold
+        qDeleteAll(m_spareViews);
+        m_spareViews.clear();
+
+        // the theme items are recreated by resetViews() anyway, with
+        // them go their scene graph, textures and image references
+        for (QQuickView *view : qAsConst(m_views)) {
+            QObject *root = view->rootObject();
+            if (m_engine) {
+                QQmlContext *context = root ? QQmlEngine::contextForObject(root) : nullptr;
+                delete root;
+                if (context && context != m_engine->rootContext())
+                    delete context;
+            } else {
+                view->setSource(QUrl());
+            }
+            view->releaseResources();
+
+            if (!m_engine) {
+                view->engine()->collectGarbage();
+                view->engine()->trimComponentCache();
+            }
+        }
+        if (m_engine) {
+            m_engine->collectGarbage();
+            m_engine->trimComponentCache();
+        }
+        QPixmapCache::clear();
+
+        // a greeter that is not kept for the next logout is about to be
+        // stopped, the user list won't be needed again
+        const bool kept = mainConfig.KeepGreeter.get() &&
+                mainConfig.DisplayServer.get().toLower() != QLatin1String("x11");
+        if (!kept && m_userModel) {
+            m_userModel->deleteLater();
+            m_userModel = nullptr;
+        }
+    }
+
+    void GreeterApp::resetViews() {
+        // should the greeter be shown again after all
+        if (!m_userModel) {
+            m_userModel = new UserModel(m_themeConfig->value(QStringLiteral("needsFullUserModel"), true).toBool(), userSource(), nullptr);
+            listUsers();
+            if (m_engine) {
+                m_engine->rootContext()->setContextProperty(QStringLiteral("userModel"), m_userModel);
+            } else {
+                for (QQuickView *view : qAsConst(m_views))
+                    view->rootContext()->setContextProperty(QStringLiteral("userModel"), m_userModel);
+            }
+        }
+
+        // recreate the theme items for a clean state, the engine keeps the
+        // compiled components and the models stay populated
+        for (QQuickView *view : qAsConst(m_views)) {
+            loadTheme(view);
+            view->show();
+        }
+
+        activatePrimary();
+    }
+
+    void GreeterApp::reloadTheme(const QString &themePath, const QString &configSnapshot) {
+        qInfo() << "Reloading the theme from" << themePath;
+
+        // the daemon saved the configuration for us once more
+        if (!configSnapshot.isEmpty())
+            qputenv(THEME_CONFIG_SNAPSHOT_VARIABLE, configSnapshot.toLocal8Bit());
+
+        // with only the configuration changed the bindings on it are
+        // enough, the views stay as they are
+        const QString previousPath = m_themePath;
+        const QString previousBundle = m_bundleRoot;
+        const bool filesChanged = themeFilesChanged();
+        setThemePath(themePath);
+        if (m_themePath == previousPath && !filesChanged) {
+            qDebug() << "Only the theme configuration changed, keeping the views";
+            // the same bundle was mounted once more
+            if (!previousBundle.isEmpty())
+                ThemeBundle::unmount(previousBundle);
+            return;
+        }
+
+        // views put aside still hold the items of the previous theme
+        qDeleteAll(m_spareViews);
+        m_spareViews.clear();
+
+        // the items of the previous theme must be gone before the
+        // cache is cleared, their bindings stop working with it
+        for (QQuickView *view : qAsConst(m_views)) {
+            QObject *root = view->rootObject();
+            if (m_engine) {
+                QQmlContext *context = root ? QQmlEngine::contextForObject(root) : nullptr;
+                delete root;
+                if (context && context != m_engine->rootContext())
+                    delete context;
+            } else {
+                view->setSource(QUrl());
+                view->engine()->clearComponentCache();
+            }
+        }
+        if (m_engine) {
+            // the files may have changed without their URLs changing
+            delete m_component;
+            m_component = nullptr;
+            m_engine->clearComponentCache();
+        }
+
+        // nothing uses the files of a reinstalled bundle anymore
+        if (!previousBundle.isEmpty())
+            ThemeBundle::unmount(previousBundle);
+
+        // hidden views get the new theme from resetViews()
+        for (QQuickView *view : qAsConst(m_views)) {
+            if (view->isVisible())
+                loadTheme(view);
+        }
+
+        activatePrimary();
+    }
+
+    void GreeterApp::updateConfig() {
+        if (!m_config)
+            m_config = new QQmlPropertyMap(this);
+
+        // keys are never taken out of a property map, the ones gone
+        // become undefined; unchanged values don't notify
+        const QStringList keys = m_config->keys();
+        for (const QString &key : keys) {
+            if (!m_themeConfig->contains(key))
+                m_config->clear(key);
+        }
+        for (auto it = m_themeConfig->constBegin(); it != m_themeConfig->constEnd(); ++it) {
+            if (m_config->value(it.key()) != it.value())
+                m_config->insert(it.key(), it.value());
+        }
+    }
+
+    bool GreeterApp::themeFilesChanged() const {
+        // the configuration is read again anyway, anything else written
+        // since the theme was loaded needs new views; the theme directory
+        // itself changes with each config file saved by renaming it
+        const QString configFile = QStringLiteral("%1/%2").arg(m_themePath, m_metadata->configFile());
+        QDirIterator it(m_themePath, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            const QString fileName = it.next();
+            if (fileName == configFile || fileName == configFile + QStringLiteral(".user"))
+                continue;
+            if (it.fileInfo().lastModified() > m_themeLoadTime)
+                return true;
+        }
+        return false;
+    }
+
+    static int compileFiles(QQmlEngine &engine, const QString &path) {
+        int failures = 0;
+
+        QDirIterator it(path, { QStringLiteral("*.qml") }, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            const QString fileName = it.next();
+
+            // compiling is enough for the engine to write the cache file
+            QQmlComponent component(&engine, QUrl::fromLocalFile(fileName));
+            if (component.isError()) {
+                qWarning() << "Failed to compile" << fileName << component.errors();
+                ++failures;
+            } else {
+                qDebug() << "Compiled" << fileName;
+            }
+        }
+
+        return failures;
+    }
+
+    int GreeterApp::compileCache() {
+        qInfo("Compiling QML into %s...", QML_CACHE_DIR);
+
+        QQmlEngine engine;
+        engine.addImportPath(QStringLiteral(IMPORTS_INSTALL_DIR));
+
+        // the cache is keyed by path, so compile the files where the
+        // greeter will load them from
+        int failures = compileFiles(engine, QStringLiteral(IMPORTS_INSTALL_DIR "/SddmComponents"));
+
+        QDir themeDir(mainConfig.Theme.ThemeDir.get());
+        const auto themes = themeDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+        for (const QString &theme : themes) {
+            if (themeDir.exists(theme + QStringLiteral("/metadata.desktop")))
+                failures += compileFiles(engine, themeDir.absoluteFilePath(theme));
+        }
+
+        if (failures > 0)
+            qWarning("%d QML files failed to compile", failures);
+        return failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
     StartupEvent::StartupEvent()
         : QEvent(StartupEventType)
     {
     }
 }
 
+// a device with the kbd handler that repeats keys, leaving out
+// power buttons and the like, which look like keyboards otherwise
+static bool hasHardwareKeyboard()
+{
+    QFile devices(QStringLiteral("/proc/bus/input/devices"));
+    if (!devices.open(QIODevice::ReadOnly))
+        return true;
+
+    bool kbdHandler = false;
+    while (!devices.atEnd()) {
+        const QByteArray line = devices.readLine().trimmed();
+        if (line.isEmpty()) {
+            kbdHandler = false;
+        } else if (line.startsWith("H: Handlers=")) {
+            kbdHandler = line.mid(12).split(' ').contains("kbd");
+        } else if (kbdHandler && line.startsWith("B: EV=")) {
+            bool ok = false;
+            const qulonglong events = line.mid(6).toULongLong(&ok, 16);
+            // EV_KEY and EV_REP
+            if (ok && (events & 0x2) && (events & 0x100000))
+                return true;
+        }
+    }
+    return false;
+}
+
+static bool needsInputMethod(int argc, char **argv)
+{
+    // compose, ibus and the like are wanted with a keyboard as well,
+    // only the virtual keyboard stands in for one
+    if (!SDDM::mainConfig.InputMethodOnDemand.get()
+            || SDDM::mainConfig.InputMethod.get() != QLatin1String("qtvirtualkeyboard"))
+        return true;
+
+    for (int i = 1; i < argc - 1; ++i) {
+        if (qstrcmp(argv[i], "--theme") != 0)
+            continue;
+        const QString metadataPath = QStringLiteral("%1/metadata.desktop").arg(QString::fromLocal8Bit(argv[i + 1]));
+        if (QFileInfo::exists(metadataPath) && SDDM::ThemeMetadata(metadataPath).virtualKeyboard())
+            return true;
+    }
+
+    return !hasHardwareKeyboard();
+}
+
+// llvmpipe and friends render whole frames on the CPU, the software
+// scene graph only repaints what changed
+static bool hasSoftwareOpenGL()
+{
+#if QT_CONFIG(opengl)
+    QOpenGLContext context;
+    if (!context.create())
+        return true;
+
+    QOffscreenSurface surface;
+    surface.setFormat(context.format());
+    surface.create();
+    if (!context.makeCurrent(&surface))
+        return true;
+
+    const QByteArray renderer(reinterpret_cast<const char *>(context.functions()->glGetString(GL_RENDERER)));
+    context.doneCurrent();
+    qDebug() << "OpenGL renderer:" << renderer;
+
+    static const char *const softwareRenderers[] = { "llvmpipe", "softpipe", "Software Rasterizer", "SWR" };
+    for (const char *name : softwareRenderers) {
+        if (renderer.contains(name))
+            return true;
+    }
+    return false;
+#else
+    return true;
+#endif
+}
+
+static void selectSceneGraphBackend()
+{
+    if (!qEnvironmentVariableIsEmpty("QT_QUICK_BACKEND")) {
+        qInfo() << "Using the" << qgetenv("QT_QUICK_BACKEND") << "scene graph backend from QT_QUICK_BACKEND";
+        return;
+    }
+
+    // probing OpenGL costs a context, only done when asked for
+    QString backend = SDDM::mainConfig.Theme.SceneGraphBackend.get();
+    if (backend == QLatin1String("auto"))
+        backend = hasSoftwareOpenGL() ? QStringLiteral("software") : QStringLiteral("opengl");
+
+    qInfo() << "Using the" << backend << "scene graph backend";
+    if (backend != QLatin1String("opengl"))
+        QQuickWindow::setSceneGraphBackend(backend);
+}
+
 int main(int argc, char **argv)
 {
     // Install message handler
     qInstallMessageHandler(SDDM::GreeterMessageHandler);
+    SDDM::applyLogRules();
+    SDDM::Trace::mark("greeter-main");
 
     // We set an attribute based on the platform we run on.
     // We only know the platform after we constructed QGuiApplication
     // though, so we need to find it out ourselves.
     QString platform;
-    for (int i = 1; i < argc - 1; ++i) {
-        if(qstrcmp(argv[i], "-platform") == 0) {
+    bool compileCache = false;
+    bool benchmark = false;
+    for (int i = 1; i < argc; ++i) {
+        if(i < argc - 1 && qstrcmp(argv[i], "-platform") == 0) {
             platform = QString::fromUtf8(argv[i + 1]);
+        } else if (qstrcmp(argv[i], "--compile-cache") == 0) {
+            compileCache = true;
+        } else if (qstrcmp(argv[i], "--benchmark") == 0) {
+            benchmark = true;
         }
     }
+
+    if (benchmark)
+        SDDM::Benchmark::enable();
+
+    // Compiling and benchmarking need no display
+    if ((compileCache || benchmark) && platform.isEmpty() && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    // Use the ahead-of-time compiled cache written by --compile-cache,
+    // the sddm user's own cache is often on tmpfs or wiped
+    if (compileCache || (qEnvironmentVariableIsEmpty("QML_DISK_CACHE_PATH") && QFileInfo::exists(QStringLiteral(QML_CACHE_DIR))))
+        qputenv("QML_DISK_CACHE_PATH", QML_CACHE_DIR);
     if (platform.isEmpty()) {
         platform = QString::fromUtf8(qgetenv("QT_QPA_PLATFORM"));
     }
@@ -342,13 +1081,20 @@ int main(int argc, char **argv)
         QSurfaceFormat::setDefaultFormat(format);
     }
 
+    // cap the frame rate to a fraction of the refresh rate
+    if (SDDM::mainConfig.Theme.SwapInterval.get() > 1) {
+        auto format(QSurfaceFormat::defaultFormat());
+        format.setSwapInterval(SDDM::mainConfig.Theme.SwapInterval.get());
+        QSurfaceFormat::setDefaultFormat(format);
+    }
+
     // Some themes may use KDE components and that will automatically load KDE's
     // crash handler which we don't want counterintuitively setting this env
     // disables that handler
     qputenv("KDE_DEBUG", "1");
 
     // Qt IM module
-    if (!SDDM::mainConfig.InputMethod.get().isEmpty())
+    if (!SDDM::mainConfig.InputMethod.get().isEmpty() && needsInputMethod(argc, argv))
         qputenv("QT_IM_MODULE", SDDM::mainConfig.InputMethod.get().toLocal8Bit().constData());
 
     QGuiApplication app(argc, argv);
@@ -371,10 +1117,59 @@ int main(int argc, char **argv)
     QCommandLineOption themeOption(QLatin1String("theme"), TR("Greeter theme"), TR("path"));
     parser.addOption(themeOption);
 
+    QCommandLineOption compileCacheOption(QLatin1String("compile-cache"), TR("Compile the installed themes into the system QML cache and exit"));
+    parser.addOption(compileCacheOption);
+
+    QCommandLineOption benchmarkOption(QLatin1String("benchmark"), TR("Start the greeter in test mode without a display, print how long each startup phase took and exit"));
+    parser.addOption(benchmarkOption);
+
+    QCommandLineOption benchmarkUsersOption(QLatin1String("benchmark-users"), TR("Number of made up users listed with --benchmark"), TR("count"), QStringLiteral("1000"));
+    parser.addOption(benchmarkUsersOption);
+
+    QCommandLineOption benchmarkSessionsOption(QLatin1String("benchmark-sessions"), TR("Number of made up sessions listed with --benchmark"), TR("count"), QStringLiteral("20"));
+    parser.addOption(benchmarkSessionsOption);
+
     parser.process(app);
 
+    if (parser.isSet(compileCacheOption))
+        return SDDM::GreeterApp::compileCache();
+
+    // stand-ins for the system's sessions, kept until the greeter exits
+    QTemporaryDir benchmarkSessions;
+    if (benchmark) {
+        const qint64 start = SDDM::Benchmark::now();
+        SDDM::mainConfig.load();
+        SDDM::Benchmark::record(QStringLiteral("config"), start);
+
+        if (!benchmarkSessions.isValid() || !QDir(benchmarkSessions.path()).mkdir(QStringLiteral("wayland"))) {
+            qCritical() << "Cannot create the benchmark sessions";
+            return EXIT_FAILURE;
+        }
+        const int sessions = parser.value(benchmarkSessionsOption).toInt();
+        for (int i = 0; i < sessions; ++i) {
+            QFile file(QStringLiteral("%1/benchmark-%2.desktop").arg(benchmarkSessions.path()).arg(i));
+            if (!file.open(QIODevice::WriteOnly))
+                continue;
+            file.write(QStringLiteral("[Desktop Entry]\nType=XSession\nName=Benchmark Session %1\nExec=true\n").arg(i).toUtf8());
+        }
+        SDDM::mainConfig.X11.SessionDir.set(benchmarkSessions.path());
+        SDDM::mainConfig.Wayland.SessionDir.set(benchmarkSessions.path() + QStringLiteral("/wayland"));
+
+        // views that never get a frame on screen
+        QTimer::singleShot(60000, &app, [] {
+            qCritical() << "Benchmark timed out waiting for the first frames";
+            SDDM::Benchmark::report();
+            QCoreApplication::exit(EXIT_FAILURE);
+        });
+    }
+
+    // before the first view is created
+    selectSceneGraphBackend();
+
     SDDM::GreeterApp *greeter = new SDDM::GreeterApp();
-    greeter->setTestModeEnabled(parser.isSet(testModeOption));
+    greeter->setTestModeEnabled(parser.isSet(testModeOption) || benchmark);
+    if (benchmark)
+        greeter->setBenchmarkUsers(parser.value(benchmarkUsersOption).toInt());
     greeter->setSocketName(parser.value(socketOption));
     greeter->setThemePath(parser.value(themeOption));
     QCoreApplication::postEvent(greeter, new SDDM::StartupEvent());
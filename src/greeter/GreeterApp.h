@@ -21,10 +21,21 @@
 #ifndef GREETERAPP_H
 #define GREETERAPP_H
 
+#include <QDateTime>
 #include <QObject>
+#include <QPointer>
 #include <QScreen>
 #include <QQuickView>
 
+#include <memory>
+
+#include "UserModel.h"
+
+class QQmlComponent;
+class QQmlContext;
+class QQmlEngine;
+class QQmlPropertyMap;
+class QTimer;
 class QTranslator;
 
 namespace SDDM {
@@ -33,10 +44,10 @@ namespace SDDM {
     class ThemeConfig;
     class SessionModel;
     class ScreenModel;
-    class UserModel;
     class GreeterProxy;
+    class FrameStats;
     class KeyboardModel;
-
+    class TranslationLoader;
 
     class GreeterApp : public QObject
     {
@@ -44,6 +55,7 @@ namespace SDDM {
         Q_DISABLE_COPY(GreeterApp)
     public:
         explicit GreeterApp(QObject *parent = nullptr);
+        ~GreeterApp() override;
 
         bool isTestModeEnabled() const;
         void setTestModeEnabled(bool value);
@@ -54,8 +66,14 @@ namespace SDDM {
         QString themePath() const;
         void setThemePath(const QString &path);
 
+        // --benchmark lists that many made up users, before setThemePath()
+        void setBenchmarkUsers(int count);
+
+        static int compileCache();
+
     protected:
         void customEvent(QEvent *event) override;
+        bool eventFilter(QObject *watched, QEvent *event) override;
 
     private slots:
         void addViewForScreen(QScreen *screen);
@@ -63,22 +81,65 @@ namespace SDDM {
 
     private:
         bool m_testing = false;
+        // the prefetch list was updated, see Theme/Prefetch
+        bool m_prefetchLearned = false;
+        int m_benchmarkUsers = 0;
+        // views with their first frame on screen
+        int m_shownViews = 0;
+        bool m_readySent = false;
+        // no input for Theme/IdleTimeout
+        bool m_idle = false;
+        QTimer *m_idleTimer { nullptr };
+        int m_cursorFlashTime = 0;
         QString m_socket;
         QString m_themePath;
+        // the root of the mounted theme bundle, if the theme is one
+        QString m_bundleRoot;
 
         QList<QQuickView *> m_views;
+        // views of removed screens, handed to the next screen added
+        QList<QQuickView *> m_spareViews;
+        // only with Theme/StagedStartup, screens still without a view
+        QList<QPointer<QScreen>> m_pendingScreens;
         QTranslator *m_theme_translator { nullptr },
                     *m_components_tranlator { nullptr };
+        std::unique_ptr<TranslationLoader> m_themeLoader, m_componentsLoader;
 
         ThemeMetadata *m_metadata { nullptr };
         ThemeConfig *m_themeConfig { nullptr };
+        // what the views see as "config", one object they all share
+        QQmlPropertyMap *m_config { nullptr };
+        // when the theme files were read, see themeFilesChanged()
+        QDateTime m_themeLoadTime;
         SessionModel *m_sessionModel { nullptr };
         UserModel *m_userModel { nullptr };
         GreeterProxy *m_proxy { nullptr };
+        FrameStats *m_frameStats { nullptr };
         KeyboardModel *m_keyboard { nullptr };
 
+        // only with Theme/SharedEngine
+        QQmlEngine *m_engine { nullptr };
+        QQmlComponent *m_component { nullptr };
+        QQmlComponent *m_fallbackComponent { nullptr };
+
         void startup();
+        void continueStartup();
+        void setNumLock();
+        void installTranslators();
         void activatePrimary();
+        void releaseResources();
+        void resetViews();
+        void reloadTheme(const QString &themePath, const QString &configSnapshot);
+        void updateConfig();
+        bool themeFilesChanged() const;
+        UserModel::Source userSource() const;
+        void listUsers();
+        void assignScreen(QQuickView *view, QScreen *screen);
+        void setIdle(bool idle);
+        void setContextProperties(QQmlContext *context);
+        void setViewContextProperties(QQuickView *view, QQmlContext *context);
+        QUrl mainScriptUrl() const;
+        void loadTheme(QQuickView *view);
     };
 
     class StartupEvent : public QEvent
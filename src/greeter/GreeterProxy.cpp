@@ -21,8 +21,12 @@
 #include "GreeterProxy.h"
 
 #include "Configuration.h"
+#include "LoggingCategories.h"
+#include "LoginId.h"
 #include "Messages.h"
+#include "SecureBuffer.h"
 #include "SessionModel.h"
+#include "SocketReader.h"
 #include "SocketWriter.h"
 
 #include <QLocalSocket>
@@ -38,6 +42,8 @@ namespace SDDM {
         bool canSuspend { false };
         bool canHibernate { false };
         bool canHybridSleep { false };
+        // the views came on screen, possibly before the socket connected
+        bool ready { false };
     };
 
     GreeterProxy::GreeterProxy(const QString &socket, QObject *parent) : QObject(parent), d(new GreeterProxyPrivate()) {
@@ -108,10 +114,27 @@ namespace SDDM {
         SocketWriter(d->socket) << quint32(GreeterMessages::HybridSleep);
     }
 
-    void GreeterProxy::login(const QString &user, const QString &password, const int sessionIndex) const {
+    void GreeterProxy::listUsers() {
+        SocketWriter(d->socket) << quint32(GreeterMessages::ListUsers);
+    }
+
+    void GreeterProxy::ready() {
+        d->ready = true;
+        if (isConnected())
+            SocketWriter(d->socket) << quint32(GreeterMessages::Ready);
+    }
+
+    void GreeterProxy::frameStats(const QVector<quint32> &frames, const QVector<quint32> &renders,
+                                  const QVector<quint32> &inputs) {
+        if (isConnected())
+            SocketWriter(d->socket) << quint32(GreeterMessages::FrameStats) << frames << renders << inputs;
+    }
+
+    void GreeterProxy::login(const QString &user, const QString &password, const int sessionIndex,
+                             const QStringList &credentials) const {
         if (!d->sessionModel) {
             // log error
-            qCritical() << "Session model is not set.";
+            qCCritical(SDDM_GREETER) << "Session model is not set.";
 
             // return
             return;
@@ -120,103 +143,205 @@ namespace SDDM {
         // get model index
         QModelIndex index = d->sessionModel->index(sessionIndex, 0);
 
-        // send command to the daemon
-        Session::Type type = static_cast<Session::Type>(d->sessionModel->data(index, SessionModel::TypeRole).toInt());
-        QString name = d->sessionModel->data(index, SessionModel::FileRole).toString();
-        Session session(type, name);
-        SocketWriter(d->socket) << quint32(GreeterMessages::Login) << user << password << session;
+        // send command to the daemon, which reads the session itself: it
+        // is sent the same as a Session, without parsing the file here
+        const quint32 type = d->sessionModel->data(index, SessionModel::TypeRole).toUInt();
+        const QString name = d->sessionModel->data(index, SessionModel::FileRole).toString();
+        // what the greeter logs from here on belongs to this attempt
+        LoginId::set(LoginId::generate());
+        qCDebug(SDDM_GREETER) << "Logging in as" << user;
+
+        SocketWriter writer(d->socket);
+        writer << quint32(GreeterMessages::Login) << user << SecureBuffer::fromString(password) << type << name;
+        writer << quint32(credentials.size());
+        for (const QString &credential : credentials)
+            writer << SecureBuffer::fromString(credential);
+        writer << LoginId::current();
     }
 
     void GreeterProxy::connected() {
         // log connection
-        qDebug() << "Connected to the daemon.";
+        qCDebug(SDDM_GREETER) << "Connected to the daemon.";
 
         // send connected message
-        SocketWriter(d->socket) << quint32(GreeterMessages::Connect);
+        SocketWriter(d->socket) << quint32(GreeterMessages::Connect) << ProtocolVersion;
+
+        // ready() came first, tell the daemon now
+        if (d->ready)
+            SocketWriter(d->socket) << quint32(GreeterMessages::Ready);
     }
 
     void GreeterProxy::disconnected() {
         // log disconnection
-        qDebug() << "Disconnected from the daemon.";
+        qCDebug(SDDM_GREETER) << "Disconnected from the daemon.";
 
         Q_EMIT socketDisconnected();
     }
 
     void GreeterProxy::error() {
-        qCritical() << "Socket error: " << d->socket->errorString();
+        qCCritical(SDDM_GREETER) << "Socket error: " << d->socket->errorString();
     }
 
     void GreeterProxy::readyRead() {
-        // input stream
-        QDataStream input(d->socket);
-
-        while (input.device()->bytesAvailable()) {
-            // read message
-            quint32 message;
-            input >> message;
-
-            switch (DaemonMessages(message)) {
-                case DaemonMessages::Capabilities: {
-                    // log message
-                    qDebug() << "Message received from daemon: Capabilities";
-
-                    // read capabilities
-                    quint32 capabilities;
-                    input >> capabilities;
-
-                    // parse capabilities
-                    d->canPowerOff = capabilities & Capability::PowerOff;
-                    d->canReboot = capabilities & Capability::Reboot;
-                    d->canSuspend = capabilities & Capability::Suspend;
-                    d->canHibernate = capabilities & Capability::Hibernate;
-                    d->canHybridSleep = capabilities & Capability::HybridSleep;
-
-                    // emit signals
-                    emit canPowerOffChanged(d->canPowerOff);
-                    emit canRebootChanged(d->canReboot);
-                    emit canSuspendChanged(d->canSuspend);
-                    emit canHibernateChanged(d->canHibernate);
-                    emit canHybridSleepChanged(d->canHybridSleep);
-                }
-                break;
-                case DaemonMessages::HostName: {
-                    // log message
-                    qDebug() << "Message received from daemon: HostName";
+        // handle all the complete messages, the rest stays buffered
+        SocketReader *reader = SocketReader::get(d->socket);
+        QByteArray frame;
+        while (reader->next(frame)) {
+            QDataStream input(frame);
+            handleMessage(input);
+        }
+    }
 
-                    // read host name
-                    input >> d->hostName;
+    void GreeterProxy::handleMessage(QDataStream &input) {
+        // read message
+        quint32 message;
+        input >> message;
+
+        switch (DaemonMessages(message)) {
+            case DaemonMessages::Capabilities: {
+                // log message
+                qCDebug(SDDM_GREETER) << "Message received from daemon: Capabilities";
+
+                // read capabilities
+                quint32 capabilities;
+                input >> capabilities;
+
+                // parse capabilities
+                d->canPowerOff = capabilities & Capability::PowerOff;
+                d->canReboot = capabilities & Capability::Reboot;
+                d->canSuspend = capabilities & Capability::Suspend;
+                d->canHibernate = capabilities & Capability::Hibernate;
+                d->canHybridSleep = capabilities & Capability::HybridSleep;
+
+                // emit signals
+                emit canPowerOffChanged(d->canPowerOff);
+                emit canRebootChanged(d->canReboot);
+                emit canSuspendChanged(d->canSuspend);
+                emit canHibernateChanged(d->canHibernate);
+                emit canHybridSleepChanged(d->canHybridSleep);
+            }
+            break;
+            case DaemonMessages::HostName: {
+                // log message
+                qCDebug(SDDM_GREETER) << "Message received from daemon: HostName";
 
-                    // emit signal
-                    emit hostNameChanged(d->hostName);
-                }
-                break;
-                case DaemonMessages::LoginSucceeded: {
-                    // log message
-                    qDebug() << "Message received from daemon: LoginSucceeded";
+                // read host name
+                input >> d->hostName;
 
-                    // emit signal
-                    emit loginSucceeded();
-                }
-                break;
-                case DaemonMessages::LoginFailed: {
-                    // log message
-                    qDebug() << "Message received from daemon: LoginFailed";
+                // emit signal
+                emit hostNameChanged(d->hostName);
+            }
+            break;
+            case DaemonMessages::LoginSucceeded: {
+                // log message
+                qCDebug(SDDM_GREETER) << "Message received from daemon: LoginSucceeded";
+
+                // emit signal
+                emit loginSucceeded();
+            }
+            break;
+            case DaemonMessages::LoginFailed: {
+                // log message
+                qCDebug(SDDM_GREETER) << "Message received from daemon: LoginFailed";
 
-                    // emit signal
-                    emit loginFailed();
+                // emit signal
+                emit loginFailed();
+            }
+            break;
+            case DaemonMessages::InformationMessage: {
+                QString message;
+                input >> message;
+
+                qCDebug(SDDM_GREETER) << "Information Message received from daemon: " << message;
+                emit informationMessage(message);
+            }
+            break;
+            case DaemonMessages::Reset: {
+                // log message
+                qCDebug(SDDM_GREETER) << "Message received from daemon: Reset";
+
+                // emit signal
+                emit reset();
+            }
+            break;
+            case DaemonMessages::Users: {
+                quint32 count;
+                input >> count;
+
+                QVector<UserInfo> users;
+                // the count comes from the wire, don't trust it for the allocation
+                users.reserve(int(qMin(count, 1024u)));
+                for (quint32 i = 0; i < count && input.status() == QDataStream::Ok; ++i) {
+                    UserInfo user;
+                    input >> user;
+                    users << user;
+                }
+                if (input.status() != QDataStream::Ok) {
+                    qCWarning(SDDM_GREETER) << "Malformed user list received from daemon.";
+                    break;
                 }
-                case DaemonMessages::InformationMessage: {
-                    QString message;
-                    input >> message;
 
-                    qDebug() << "Information Message received from daemon: " << message;
-                    emit informationMessage(message);
+                qCDebug(SDDM_GREETER) << "Message received from daemon: Users" << users.count();
+                emit usersReceived(users);
+            }
+            break;
+            case DaemonMessages::UsersRemoved: {
+                QStringList names;
+                input >> names;
+
+                qCDebug(SDDM_GREETER) << "Message received from daemon: UsersRemoved" << names;
+                emit usersRemoved(names);
+            }
+            break;
+            case DaemonMessages::UsersListed: {
+                // log message
+                qCDebug(SDDM_GREETER) << "Message received from daemon: UsersListed";
+
+                // emit signal
+                emit usersListed();
+            }
+            break;
+            case DaemonMessages::PowerActionFinished: {
+                quint32 action, success;
+                QString error;
+                input >> action >> success >> error;
+
+                qCDebug(SDDM_GREETER) << "Message received from daemon: PowerActionFinished" << action << success << error;
+                emit powerActionFinished(int(action), success != 0, error);
+            }
+            break;
+            case DaemonMessages::Sessions: {
+                quint32 count;
+                input >> count;
+
+                QVector<Session> sessions;
+                // the count comes from the wire, don't trust it for the allocation
+                sessions.reserve(int(qMin(count, 256u)));
+                for (quint32 i = 0; i < count && input.status() == QDataStream::Ok; ++i) {
+                    Session session;
+                    session.readEntry(input);
+                    sessions << session;
                 }
-                break;
-                default: {
-                    // log message
-                    qWarning() << "Unknown message received from daemon.";
+                if (input.status() != QDataStream::Ok) {
+                    qCWarning(SDDM_GREETER) << "Malformed session list received from daemon.";
+                    break;
                 }
+
+                qCDebug(SDDM_GREETER) << "Message received from daemon: Sessions" << sessions.count();
+                emit sessionsReceived(sessions);
+            }
+            break;
+            case DaemonMessages::ReloadTheme: {
+                QString themePath, configSnapshot;
+                input >> themePath >> configSnapshot;
+
+                qCDebug(SDDM_GREETER) << "Message received from daemon: ReloadTheme" << themePath;
+                emit themeReloadRequested(themePath, configSnapshot);
+            }
+            break;
+            default: {
+                // log message
+                qCWarning(SDDM_GREETER) << "Unknown message received from daemon.";
             }
         }
     }
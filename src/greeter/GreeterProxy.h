@@ -21,7 +21,13 @@
 #define SDDM_GREETERPROXY_H
 
 #include <QObject>
+#include <QStringList>
+#include <QVector>
 
+#include "Session.h"
+#include "UserInfo.h"
+
+class QDataStream;
 class QLocalSocket;
 
 namespace SDDM {
@@ -55,6 +61,12 @@ namespace SDDM {
 
         void setSessionModel(SessionModel *model);
 
+        // tells the daemon the views are all on screen, once connected
+        void ready();
+        // samples in milliseconds, see FrameStats
+        void frameStats(const QVector<quint32> &frames, const QVector<quint32> &renders,
+                        const QVector<quint32> &inputs);
+
     public slots:
         void powerOff();
         void reboot();
@@ -62,7 +74,11 @@ namespace SDDM {
         void hibernate();
         void hybridSleep();
 
-        void login(const QString &user, const QString &password, const int sessionIndex) const;
+        // the users come with usersReceived(), then follow the changes
+        void listUsers();
+
+        void login(const QString &user, const QString &password, const int sessionIndex,
+                   const QStringList &credentials = QStringList()) const;
 
     private slots:
         void connected();
@@ -82,8 +98,21 @@ namespace SDDM {
         void socketDisconnected();
         void loginFailed();
         void loginSucceeded();
+        void reset();
+
+        void usersReceived(const QVector<SDDM::UserInfo> &users);
+        void usersRemoved(const QStringList &names);
+        void usersListed();
+        // the sessions to list, replacing the previous ones
+        void sessionsReceived(const QVector<SDDM::Session> &sessions);
+
+        void powerActionFinished(int action, bool success, const QString &error);
+
+        void themeReloadRequested(const QString &themePath, const QString &configSnapshot);
 
     private:
+        void handleMessage(QDataStream &input);
+
         GreeterProxyPrivate *d { nullptr };
     };
 }
@@ -20,6 +20,7 @@
 
 #include <QGuiApplication>
 
+#include "KeyboardLayout.h"
 #include "KeyboardModel.h"
 #include "KeyboardModel_p.h"
 #include "waylandkeyboardbackend.h"
@@ -82,6 +83,11 @@ namespace SDDM {
     }
 
     QList<QObject*> KeyboardModel::layouts() const {
+        if (!d->layoutNames.isEmpty()) {
+            for (const auto &name : qAsConst(d->layoutNames))
+                d->layouts << new KeyboardLayout(name.first, name.second);
+            d->layoutNames.clear();
+        }
         return d->layouts;
     }
 
@@ -90,6 +96,10 @@ namespace SDDM {
     }
 
     void KeyboardModel::setCurrentLayout(int id) {
+        // don't pretend to switch to a layout that is not in effect
+        if (!d->layoutSwitching || id < 0 || id >= d->layouts.size() + d->layoutNames.size())
+            return;
+
         if (d->layout_id != id) {
             d->layout_id = id;
             if (m_backend)
@@ -21,6 +21,7 @@
 #define KEYBOARDMODEL_P_H
 
 #include <QtCore/QObject>
+#include <QtCore/QPair>
 
 namespace SDDM {
     struct Indicator {
@@ -36,9 +37,13 @@ namespace SDDM {
         // indicator state
         Indicator numlock, capslock;
 
-        // Layouts
+        // Layouts, switching them is up to the backend
+        bool layoutSwitching { false };
         int layout_id { 0 };
         QList<QObject*> layouts;
+        // short and long names of layouts that only get a KeyboardLayout
+        // object once layouts() is asked for
+        QList<QPair<QString, QString>> layoutNames;
     };
 }
 
@@ -38,6 +38,17 @@ namespace SDDM {
         delete d;
     }
 
+    void ScreenModel::setScreen(QScreen *screen) {
+        if (d->screen == screen)
+            return;
+
+        const bool wasPrimary = primary() == 0;
+        d->screen = screen;
+        emit dataChanged(index(0), index(0));
+        if (wasPrimary != (primary() == 0))
+            emit primaryChanged();
+    }
+
     QHash<int, QByteArray> ScreenModel::roleNames() const {
         // set role names
         QHash<int, QByteArray> roleNames;
@@ -48,6 +48,8 @@ namespace SDDM {
         QHash<int, QByteArray> roleNames() const override;
         int primary() const;
 
+        void setScreen(QScreen *screen);
+
         int rowCount(const QModelIndex &parent = QModelIndex()) const override;
         QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
 
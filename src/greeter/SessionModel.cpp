@@ -21,43 +21,111 @@
 #include "SessionModel.h"
 
 #include "Configuration.h"
+#include "ExecutableLookup.h"
 
+#include <QFile>
 #include <QVector>
-#include <QProcessEnvironment>
 #include <QFileSystemWatcher>
 
+#include <sys/stat.h>
+
 namespace SDDM {
+    typedef QPair<int, QString> SessionKey;
+
+    struct SessionEntry {
+        qint64 modified { 0 };
+        quint64 inode { 0 };
+        Session *session { nullptr };
+    };
+
     class SessionModelPrivate {
     public:
         ~SessionModelPrivate() {
-            qDeleteAll(sessions);
+            for (const SessionEntry &entry : qAsConst(cache))
+                delete entry.session;
+            cache.clear();
             sessions.clear();
         }
 
         int lastIndex { 0 };
+        bool loaded { false };
+        bool fromDaemon { false };
+        QFileSystemWatcher *watcher { nullptr };
         QStringList displayNames;
+        // sessions shown by the model, owned by the cache
         QVector<Session *> sessions;
+        // parsed desktop entries by type and path, including the hidden ones
+        QHash<SessionKey, SessionEntry> cache;
     };
 
-    SessionModel::SessionModel(QObject *parent) : QAbstractListModel(parent), d(new SessionModelPrivate()) {
+    static SessionKey sessionKey(const Session *session) {
+        return qMakePair(int(session->type()), session->fileName());
+    }
+
+    SessionModel::SessionModel(LoadingMode mode, QObject *parent) : QAbstractListModel(parent), d(new SessionModelPrivate()) {
+        if (mode == LoadNow)
+            load();
+
+        // refresh everytime a file is changed, added or removed
+        d->watcher = new QFileSystemWatcher(this);
+        connect(d->watcher, &QFileSystemWatcher::directoryChanged, this, &SessionModel::refresh);
+        d->watcher->addPath(mainConfig.Wayland.SessionDir.get());
+        d->watcher->addPath(mainConfig.X11.SessionDir.get());
+    }
+
+    bool SessionModel::isLoaded() const {
+        return d->loaded;
+    }
+
+    void SessionModel::load() {
+        if (d->loaded)
+            return;
+        d->loaded = true;
+
+        // whatever the daemon sent, or is about to send
+        if (d->fromDaemon)
+            return;
+
         // initial population
         beginResetModel();
-        populate(Session::WaylandSession, mainConfig.Wayland.SessionDir.get());
-        populate(Session::X11Session, mainConfig.X11.SessionDir.get());
+        QSet<SessionKey> seen;
+        QVector<Session *> obsolete;
+        d->sessions << populate(Session::WaylandSession, mainConfig.Wayland.SessionDir.get(), seen, obsolete);
+        d->sessions << populate(Session::X11Session, mainConfig.X11.SessionDir.get(), seen, obsolete);
+        updateDisplayNames();
+        updateLastIndex();
         endResetModel();
+    }
 
-        // refresh everytime a file is changed, added or removed
-        QFileSystemWatcher *watcher = new QFileSystemWatcher(this);
-        connect(watcher, &QFileSystemWatcher::directoryChanged, [this](const QString &path) {
-            beginResetModel();
-            d->sessions.clear();
-            d->displayNames.clear();
-            populate(Session::WaylandSession, mainConfig.Wayland.SessionDir.get());
-            populate(Session::X11Session, mainConfig.X11.SessionDir.get());
-            endResetModel();
-        });
-        watcher->addPath(mainConfig.Wayland.SessionDir.get());
-        watcher->addPath(mainConfig.X11.SessionDir.get());
+    void SessionModel::useDaemonCatalog() {
+        d->fromDaemon = true;
+        delete d->watcher;
+        d->watcher = nullptr;
+    }
+
+    void SessionModel::setSessions(const QVector<Session> &sessions) {
+        if (!d->fromDaemon)
+            useDaemonCatalog();
+        d->loaded = true;
+
+        // the daemon checked TryExec and dropped the hidden ones already
+        QSet<SessionKey> seen;
+        QVector<Session *> obsolete;
+        QVector<Session *> list;
+        for (const Session &session : sessions) {
+            const SessionKey key = qMakePair(int(session.type()), session.fileName());
+            // keep the first of any repeats, the model must not list one twice
+            if (seen.contains(key))
+                continue;
+            seen.insert(key);
+            SessionEntry &entry = d->cache[key];
+            if (entry.session)
+                obsolete << entry.session;
+            entry.session = new Session(session);
+            list << entry.session;
+        }
+
+        update(list, seen, obsolete);
     }
 
     SessionModel::~SessionModel() {
@@ -116,7 +184,99 @@ namespace SDDM {
         return QVariant();
     }
 
-    void SessionModel::populate(Session::Type type, const QString &path) {
+    void SessionModel::refresh() {
+        // still to be loaded, it will see the change anyway
+        if (!d->loaded)
+            return;
+
+        QSet<SessionKey> seen;
+        QVector<Session *> obsolete;
+        QVector<Session *> sessions;
+        sessions << populate(Session::WaylandSession, mainConfig.Wayland.SessionDir.get(), seen, obsolete);
+        sessions << populate(Session::X11Session, mainConfig.X11.SessionDir.get(), seen, obsolete);
+        update(sessions, seen, obsolete);
+    }
+
+    void SessionModel::update(const QVector<Session *> &sessions, const QSet<SessionKey> &seen,
+                              QVector<Session *> &obsolete) {
+        // forget about files that were removed
+        for (auto it = d->cache.begin(); it != d->cache.end(); ) {
+            if (!seen.contains(it.key())) {
+                obsolete << it->session;
+                it = d->cache.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        // both lists are in the same order, so a single walk
+        // is enough to find out what was added and removed
+        QSet<SessionKey> oldKeys, newKeys;
+        for (const Session *session : qAsConst(d->sessions))
+            oldKeys.insert(sessionKey(session));
+        for (const Session *session : qAsConst(sessions))
+            newKeys.insert(sessionKey(session));
+
+        int row = 0, j = 0;
+        while (row < d->sessions.count() || j < sessions.count()) {
+            if (row < d->sessions.count() && (j >= sessions.count() || !newKeys.contains(sessionKey(d->sessions.at(row))))) {
+                beginRemoveRows(QModelIndex(), row, row);
+                d->sessions.remove(row);
+                endRemoveRows();
+            } else if (row >= d->sessions.count() || !oldKeys.contains(sessionKey(sessions.at(j)))) {
+                beginInsertRows(QModelIndex(), row, row);
+                d->sessions.insert(row, sessions.at(j));
+                endInsertRows();
+                ++row;
+                ++j;
+            } else {
+                // the file was parsed again
+                if (d->sessions.at(row) != sessions.at(j)) {
+                    d->sessions[row] = sessions.at(j);
+                    emit dataChanged(index(row), index(row));
+                }
+                ++row;
+                ++j;
+            }
+        }
+
+        qDeleteAll(obsolete);
+
+        // names might need to be disambiguated differently
+        const QStringList displayNames = d->displayNames;
+        updateDisplayNames();
+        if (displayNames != d->displayNames && !d->sessions.isEmpty())
+            emit dataChanged(index(0), index(d->sessions.count() - 1), { NameRole });
+
+        updateLastIndex();
+    }
+
+    void SessionModel::updateDisplayNames() {
+        d->displayNames.clear();
+        for (const Session *session : qAsConst(d->sessions))
+            d->displayNames.append(session->displayName());
+    }
+
+    void SessionModel::updateLastIndex() {
+        // find out index of the last session
+        int lastIndex = 0;
+        const auto lastSession = freeze(stateConfig.Last.Session);
+        for (int i = 0; i < d->sessions.size(); ++i) {
+            if (d->sessions.at(i)->fileName() == lastSession.get()) {
+                lastIndex = i;
+                break;
+            }
+        }
+
+        if (lastIndex != d->lastIndex) {
+            d->lastIndex = lastIndex;
+            emit lastIndexChanged();
+        }
+    }
+
+    QVector<Session *> SessionModel::populate(Session::Type type, const QString &path, QSet<SessionKey> &seen, QVector<Session *> &obsolete) {
+        QVector<Session *> result;
+
         // read session files
         QDir dir(path);
         dir.setNameFilters(QStringList() << QStringLiteral("*.desktop"));
@@ -124,43 +284,33 @@ namespace SDDM {
         // read session
         const auto sessions = dir.entryList();
         for(const QString &session : sessions) {
-            if (!dir.exists(session))
+            const QString fileName = dir.absoluteFilePath(session);
+
+            struct stat st;
+            if (::stat(QFile::encodeName(fileName).constData(), &st) != 0)
                 continue;
 
-            Session *si = new Session(type, session);
-            bool execAllowed = true;
-            QFileInfo fi(si->tryExec());
-            if (fi.isAbsolute()) {
-                if (!fi.exists() || !fi.isExecutable())
-                    execAllowed = false;
-            } else {
-                execAllowed = false;
-                QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
-                QString envPath = env.value(QStringLiteral("PATH"));
-                const QStringList pathList = envPath.split(QLatin1Char(':'));
-                for(const QString &path : pathList) {
-                    QDir pathDir(path);
-                    fi.setFile(pathDir, si->tryExec());
-                    if (fi.exists() && fi.isExecutable()) {
-                        execAllowed = true;
-                        break;
-                    }
-                }
+            // only parse files that are new or have been changed
+            const SessionKey key = qMakePair(int(type), fileName);
+            seen.insert(key);
+            SessionEntry &entry = d->cache[key];
+            const qint64 modified = qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+            if (!entry.session || entry.modified != modified || entry.inode != quint64(st.st_ino)) {
+                if (entry.session)
+                    obsolete << entry.session;
+                entry.session = new Session(type, session);
+                entry.modified = modified;
+                entry.inode = quint64(st.st_ino);
             }
+
+            Session *si = entry.session;
+            const bool execAllowed = ExecutableLookup::canExecute(si->tryExec());
+
             // add to sessions list
-            if (!si->isHidden() && !si->isNoDisplay() && execAllowed) {
-                d->displayNames.append(si->displayName());
-                d->sessions.push_back(si);
-            } else {
-                delete si;
-            }
-        }
-        // find out index of the last session
-        for (int i = 0; i < d->sessions.size(); ++i) {
-            if (d->sessions.at(i)->fileName() == stateConfig.Last.Session.get()) {
-                d->lastIndex = i;
-                break;
-            }
+            if (!si->isHidden() && !si->isNoDisplay() && execAllowed)
+                result.push_back(si);
         }
+
+        return result;
     }
 }
@@ -26,6 +26,8 @@
 #include <QAbstractListModel>
 
 #include <QHash>
+#include <QSet>
+#include <QVector>
 
 namespace SDDM {
     class SessionModelPrivate;
@@ -33,7 +35,7 @@ namespace SDDM {
     class SessionModel : public QAbstractListModel {
         Q_OBJECT
         Q_DISABLE_COPY(SessionModel)
-        Q_PROPERTY(int lastIndex READ lastIndex CONSTANT)
+        Q_PROPERTY(int lastIndex READ lastIndex NOTIFY lastIndexChanged)
     public:
         enum SessionRole {
             DirectoryRole = Qt::UserRole + 1,
@@ -45,9 +47,23 @@ namespace SDDM {
         };
         Q_ENUM(SessionRole)
 
-        SessionModel(QObject *parent = 0);
+        enum LoadingMode {
+            LoadNow,
+            LoadLater
+        };
+
+        explicit SessionModel(LoadingMode mode = LoadNow, QObject *parent = nullptr);
         ~SessionModel();
 
+        // read the session files, unless that already happened
+        void load();
+        bool isLoaded() const;
+
+        // the daemon sends the sessions, see setSessions(), the files
+        // are neither read nor watched here
+        void useDaemonCatalog();
+        void setSessions(const QVector<SDDM::Session> &sessions);
+
         QHash<int, QByteArray> roleNames() const override;
 
         const int lastIndex() const;
@@ -55,10 +71,19 @@ namespace SDDM {
         int rowCount(const QModelIndex &parent = QModelIndex()) const override;
         QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
 
+    signals:
+        void lastIndexChanged();
+
     private:
         SessionModelPrivate *d { nullptr };
 
-        void populate(Session::Type type, const QString &path);
+        void refresh();
+        void update(const QVector<Session *> &sessions, const QSet<QPair<int, QString>> &seen,
+                    QVector<Session *> &obsolete);
+        void updateDisplayNames();
+        void updateLastIndex();
+        QVector<Session *> populate(Session::Type type, const QString &path,
+                                    QSet<QPair<int, QString>> &seen, QVector<Session *> &obsolete);
     };
 }
 
@@ -19,32 +19,62 @@
 
 #include "UserModel.h"
 
+#include "AvatarResolver.h"
 #include "Constants.h"
 #include "Configuration.h"
-
+#include "LoggingCategories.h"
+#include "UserInfo.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusObjectPath>
+#include <QDBusPendingReply>
+#include <QDebug>
 #include <QFile>
+#include <QFileSystemWatcher>
 #include <QList>
+#include <QPointer>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QSet>
 #include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
 #include <QStringList>
+#include <QUrl>
 
+#include <functional>
 #include <memory>
 #include <pwd.h>
+#include <unistd.h>
 
 namespace SDDM {
+    /**
+     * One entry of the model. Users are kept by value in one contiguous
+     * vector, so a lookup or a sort walks memory in order instead of
+     * chasing a pointer per user. The icon is empty as long as the user
+     * has no avatar of their own, the model then returns the default
+     * icon, which is kept once.
+     */
     class User {
     public:
-        User(const struct passwd *data, const QString icon) :
-            name(QString::fromLocal8Bit(data->pw_name)),
-            realName(QString::fromLocal8Bit(data->pw_gecos).split(QLatin1Char(',')).first()),
-            homeDir(QString::fromLocal8Bit(data->pw_dir)),
-            uid(data->pw_uid),
-            gid(data->pw_gid),
-            // if shadow is used pw_passwd will be 'x' nevertheless, so this
-            // will always be true
-            needsPassword(strcmp(data->pw_passwd, "") != 0),
-            icon(icon)
+        explicit User(const struct passwd *data) : User(UserInfo(data)) {}
+
+        explicit User(const UserInfo &info) :
+            name(info.name),
+            realName(info.realName),
+            homeDir(info.homeDir),
+            uid(info.uid),
+            gid(info.gid),
+            needsPassword(info.needsPassword),
+            icon(info.icon)
         {}
 
+        User() {}
+
         QString name;
         QString realName;
         QString homeDir;
@@ -54,107 +84,769 @@ namespace SDDM {
         QString icon;
     };
 
-    typedef std::shared_ptr<User> UserPtr;
+    static inline bool userLessThan(const User &u1, const User &u2) {
+        return u1.name < u2.name;
+    }
+
+    static inline bool userNameLessThan(const User &u, const QString &name) {
+        return u.name < name;
+    }
+}
+
+Q_DECLARE_TYPEINFO(SDDM::User, Q_MOVABLE_TYPE);
+Q_DECLARE_METATYPE(QVector<SDDM::User>)
+
+namespace SDDM {
+    // number of users collected by the enumerator before they are handed over to the model
+    static const int UserBatchSize = 32;
+
+    // watched for changes to the user database
+    static QString passwdFile() { return QStringLiteral("/etc/passwd"); }
+
+    // getpwnam() without its static buffer, which getpwent() of the
+    // enumerator shares
+    static bool lookupUser(const QString &name, const UserFilter &filter, User &user) {
+        long bufsize = sysconf(_SC_GETPW_R_SIZE_MAX);
+        if (bufsize == -1)
+            bufsize = 16384;
+        QByteArray buffer(int(bufsize), Qt::Uninitialized);
+
+        struct passwd pw;
+        struct passwd *result = nullptr;
+        if (getpwnam_r(name.toLocal8Bit().constData(), &pw, buffer.data(), size_t(buffer.size()), &result) != 0
+                || !result || !filter.accepts(result))
+            return false;
+
+        user = User(result);
+        return true;
+    }
+
+    /**
+     * Walks the passwd database off the GUI thread, because with
+     * network backed NSS modules this can take a long time.
+     * Users are delivered to the model in batches.
+     */
+    class UserEnumerator : public QThread {
+        Q_OBJECT
+    public:
+        UserEnumerator(bool needAllUsers, QObject *parent)
+            : QThread(parent)
+            , m_needAllUsers(needAllUsers)
+            , m_threshold(mainConfig.Theme.DisableAvatarsThreshold.get()) {
+        }
+
+        bool accepts(const struct passwd *pw) const {
+            return m_filter.accepts(pw);
+        }
+
+        const UserFilter &filter() const {
+            return m_filter;
+        }
+
+        // looked up and reported on its own before the next walk
+        void setFirstUser(const QString &name) {
+            m_firstUser = name;
+        }
+
+        // walks the database again, the run is reported with the given generation
+        void enumerate(bool needAllUsers, int generation) {
+            m_needAllUsers = needAllUsers;
+            m_generation = generation;
+            start();
+        }
+
+    signals:
+        void usersFound(const QVector<SDDM::User> &users);
+        void enumerationFinished(bool containsAllUsers, int generation);
+
+    protected:
+        void run() override {
+            QVector<User> batch;
+            batch.reserve(UserBatchSize);
+            QSet<QString> names;
+            bool containsAllUsers = true;
+
+            // the last user is shown right away, the others are streamed in
+            if (!m_firstUser.isEmpty()) {
+                User user;
+                if (lookupUser(m_firstUser, m_filter, user)) {
+                    names.insert(user.name);
+                    emit usersFound({ user });
+                }
+                m_firstUser.clear();
+            }
+
+            struct passwd *current_pw;
+            setpwent();
+            while ((current_pw = getpwent()) != nullptr) {
+                if (isInterruptionRequested())
+                    break;
+
+                if (!accepts(current_pw))
+                    continue;
+
+                // create user, the same user may appear in several
+                // sources specified in nsswitch.conf(5)
+                User user(current_pw);
+                if (names.contains(user.name))
+                    continue;
+                names.insert(user.name);
+
+                batch << user;
+                if (batch.count() >= UserBatchSize) {
+                    emit usersFound(batch);
+                    batch.clear();
+                }
+
+                if (!m_needAllUsers && names.count() > m_threshold) {
+                    containsAllUsers = false;
+                    break;
+                }
+            }
+            endpwent();
+
+            // an interrupted run doesn't know about all the users
+            if (isInterruptionRequested())
+                return;
+
+            if (!batch.isEmpty())
+                emit usersFound(batch);
+
+            emit enumerationFinished(containsAllUsers, m_generation);
+        }
+
+    private:
+        bool m_needAllUsers { true };
+        UserFilter m_filter;
+        QString m_firstUser;
+        int m_threshold { 0 };
+        int m_generation { 0 };
+    };
+
+    /**
+     * Looks up a single user in the thread pool, for a name the
+     * partial list doesn't have. @p done runs on the GUI thread, with
+     * no user if there is none or it isn't listed.
+     */
+    class UserLookup : public QRunnable {
+    public:
+        UserLookup(const QString &name, const UserFilter &filter, const std::function<void(const QVector<User> &)> &done)
+            : m_name(name)
+            , m_filter(filter)
+            , m_done(done) {
+        }
+
+        void run() override {
+            QVector<User> found;
+            User user;
+            if (lookupUser(m_name, m_filter, user))
+                found << user;
+
+            const auto done = m_done;
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [done, found] {
+                done(found);
+            }, Qt::QueuedConnection);
+        }
+
+    private:
+        QString m_name;
+        UserFilter m_filter;
+        std::function<void(const QVector<User> &)> m_done;
+    };
+
+    /**
+     * Gets users from AccountsService, which already keeps
+     * a list of the users together with their icons.
+     */
+    class AccountsServiceUsers : public QObject {
+        Q_OBJECT
+    public:
+        explicit AccountsServiceUsers(QObject *parent)
+            : QObject(parent) {
+        }
+
+        void start() {
+            QDBusConnection::systemBus().connect(accountsService(), accountsPath(), accountsIface(), QStringLiteral("UserAdded"), this, SLOT(userAdded(QDBusObjectPath)));
+            QDBusConnection::systemBus().connect(accountsService(), accountsPath(), accountsIface(), QStringLiteral("UserDeleted"), this, SLOT(userDeleted(QDBusObjectPath)));
+
+            auto listMsg = QDBusMessage::createMethodCall(accountsService(), accountsPath(), accountsIface(), QStringLiteral("ListCachedUsers"));
+            QDBusPendingReply<QList<QDBusObjectPath>> reply = QDBusConnection::systemBus().asyncCall(listMsg);
+            QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(reply, this);
+            connect(watcher, &QDBusPendingCallWatcher::finished, this, [=]() {
+                watcher->deleteLater();
+                if (!reply.isValid()) {
+                    qCWarning(SDDM_GREETER_MODELS) << "Failed to list users from AccountsService:" << reply.error().message();
+                    emit failed();
+                    return;
+                }
+
+                const auto paths = reply.value();
+                m_pending = paths.count();
+                if (m_pending == 0)
+                    emit enumerationFinished(true);
+                for (const QDBusObjectPath &path : paths)
+                    fetchUser(path, true);
+            });
+        }
+
+    signals:
+        void usersFound(const QVector<SDDM::User> &users);
+        void userRemoved(const QString &name);
+        void enumerationFinished(bool containsAllUsers);
+        void failed();
+
+    private slots:
+        void userAdded(const QDBusObjectPath &path) {
+            fetchUser(path, false);
+        }
+
+        void userDeleted(const QDBusObjectPath &path) {
+            const QString name = m_names.take(path.path());
+            if (!name.isEmpty())
+                emit userRemoved(name);
+        }
+
+    private:
+        static QString accountsService() { return QStringLiteral("org.freedesktop.Accounts"); }
+        static QString accountsPath() { return QStringLiteral("/org/freedesktop/Accounts"); }
+        static QString accountsIface() { return QStringLiteral("org.freedesktop.Accounts"); }
+        static QString userIface() { return QStringLiteral("org.freedesktop.Accounts.User"); }
+
+        void fetchUser(const QDBusObjectPath &path, bool initial) {
+            auto getAllMsg = QDBusMessage::createMethodCall(accountsService(), path.path(), QStringLiteral("org.freedesktop.DBus.Properties"), QStringLiteral("GetAll"));
+            getAllMsg << userIface();
+
+            QDBusPendingReply<QVariantMap> reply = QDBusConnection::systemBus().asyncCall(getAllMsg);
+            QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(reply, this);
+            connect(watcher, &QDBusPendingCallWatcher::finished, this, [=]() {
+                watcher->deleteLater();
+
+                if (reply.isValid()) {
+                    User user;
+                    if (createUser(reply.value(), user)) {
+                        m_names.insert(path.path(), user.name);
+                        m_batch << user;
+                    }
+                }
+
+                // deliver all the users of the initial list at once
+                if (initial && --m_pending > 0)
+                    return;
+
+                if (!m_batch.isEmpty()) {
+                    emit usersFound(m_batch);
+                    m_batch.clear();
+                }
+
+                if (initial)
+                    emit enumerationFinished(true);
+            });
+        }
+
+        bool createUser(const QVariantMap &properties, User &user) const {
+            const QString name = properties.value(QStringLiteral("UserName")).toString();
+            const int uid = int(properties.value(QStringLiteral("Uid")).toULongLong());
+            const QString shell = properties.value(QStringLiteral("Shell")).toString();
+
+            if (name.isEmpty() || properties.value(QStringLiteral("SystemAccount")).toBool())
+                return false;
+            if (!m_filter.accepts(name.toLocal8Bit(), uid, shell.toLocal8Bit()))
+                return false;
+
+            user.name = name;
+            user.realName = properties.value(QStringLiteral("RealName")).toString();
+            user.homeDir = properties.value(QStringLiteral("HomeDirectory")).toString();
+            user.uid = uid;
+            // password mode 2 means no password is set
+            user.needsPassword = properties.value(QStringLiteral("PasswordMode")).toInt() != 2;
+
+            const QString iconFile = properties.value(QStringLiteral("IconFile")).toString();
+            if (!iconFile.isEmpty())
+                user.icon = QStringLiteral("file://%1").arg(iconFile);
+
+            return true;
+        }
+
+        UserFilter m_filter;
+        QHash<QString, QString> m_names;
+        QVector<User> m_batch;
+        int m_pending { 0 };
+    };
 
     class UserModelPrivate {
     public:
         int lastIndex { 0 };
-        QList<UserPtr> users;
+        // sorted by name
+        QVector<User> users;
         bool containsAllUsers { true };
+        bool loading { true };
+        bool lastUserFound { false };
+        bool needAllUsers { true };
+        // the users already listed are checked against the running
+        // enumeration, the ones it doesn't find are removed at the end
+        bool syncing { false };
+        QSet<QString> seenUsers;
+        // names findUser() is looking up
+        QSet<QString> pendingLookups;
+        int enumerationGeneration { 0 };
+        QFileSystemWatcher *watcher { nullptr };
+        QTimer *refreshTimer { nullptr };
+        // lower case words of the real names, sorted, for type-ahead search
+        mutable QVector<QPair<QString, QString>> realNameIndex;
+        mutable bool realNameIndexDirty { true };
+        bool avatarsEnabled { true };
+        // the daemon sends the users, with their avatars
+        bool fromDaemon { false };
+        // returned for every user without an avatar of their own
+        QString defaultIcon;
+        UserEnumerator *enumerator { nullptr };
+        AccountsServiceUsers *accountsService { nullptr };
+        AvatarResolver *avatarResolver { nullptr };
     };
 
-    UserModel::UserModel(bool needAllUsers, QObject *parent) : QAbstractListModel(parent), d(new UserModelPrivate()) {
+    static const quint32 UserSnapshotVersion = 1;
+
+    static QString userSnapshotPath() {
+        return QStringLiteral("%1/users.cache").arg(stateDirectory());
+    }
+
+    // filters used to create the snapshot, it's stale if they change
+    static QStringList userSnapshotFilters() {
+        return QStringList()
+                << QString::number(mainConfig.Users.MinimumUid.get())
+                << QString::number(mainConfig.Users.MaximumUid.get())
+                << mainConfig.Users.HideUsers.ref().join(QLatin1Char(','))
+                << mainConfig.Users.HideShells.ref().join(QLatin1Char(','));
+    }
+
+    static QVector<User> loadUserSnapshot() {
+        QVector<User> users;
+
+        QFile file(userSnapshotPath());
+        if (!file.open(QIODevice::ReadOnly))
+            return users;
+
+        QDataStream in(&file);
+        quint32 version = 0;
+        QStringList filters;
+        quint32 count = 0;
+        in >> version;
+        if (version != UserSnapshotVersion)
+            return users;
+        in >> filters >> count;
+        if (in.status() != QDataStream::Ok || filters != userSnapshotFilters())
+            return users;
+
+        // don't trust the count with the allocation, the stream runs dry anyway
+        users.reserve(int(qMin(count, quint32(1 << 16))));
+        for (quint32 i = 0; i < count; ++i) {
+            User user;
+            qint32 uid = 0, gid = 0;
+            in >> user.name >> user.realName >> user.homeDir >> uid >> gid >> user.needsPassword;
+            if (in.status() != QDataStream::Ok) {
+                qCWarning(SDDM_GREETER_MODELS) << "Ignoring corrupted user list snapshot";
+                return QVector<User>();
+            }
+            user.uid = uid;
+            user.gid = gid;
+            users << user;
+        }
+
+        return users;
+    }
+
+    static void saveUserSnapshot(const QVector<User> &users) {
+        QSaveFile file(userSnapshotPath());
+        if (!file.open(QIODevice::WriteOnly)) {
+            qCWarning(SDDM_GREETER_MODELS) << "Failed to write user list snapshot:" << file.errorString();
+            return;
+        }
+
+        QDataStream out(&file);
+        out << UserSnapshotVersion << userSnapshotFilters() << quint32(users.count());
+        for (const User &user : users)
+            out << user.name << user.realName << user.homeDir << qint32(user.uid) << qint32(user.gid) << user.needsPassword;
+
+        file.commit();
+    }
+
+    UserModel::UserModel(bool needAllUsers, Source source, QObject *parent) : QAbstractListModel(parent), d(new UserModelPrivate()) {
         const QString facesDir = mainConfig.Theme.FacesDir.get();
         const QString themeDir = mainConfig.Theme.ThemeDir.get();
         const QString currentTheme = mainConfig.Theme.Current.get();
         const QString themeDefaultFace = QStringLiteral("%1/%2/faces/.face.icon").arg(themeDir).arg(currentTheme);
         const QString defaultFace = QStringLiteral("%1/.face.icon").arg(facesDir);
-        const QString iconURI = QStringLiteral("file://%1").arg(
+        d->defaultIcon = QStringLiteral("file://%1").arg(
                 QFile::exists(themeDefaultFace) ? themeDefaultFace : defaultFace);
 
-        bool lastUserFound = false;
+        // we don't know whether the list is going to be truncated
+        // until the enumeration is over
+        d->containsAllUsers = needAllUsers;
 
-        struct passwd *current_pw;
-        setpwent();
-        while ((current_pw = getpwent()) != nullptr) {
+        qRegisterMetaType<QVector<SDDM::User>>("QVector<SDDM::User>");
 
-            // skip entries with uids smaller than minimum uid
-            if (int(current_pw->pw_uid) < mainConfig.Users.MinimumUid.get())
-                continue;
+        d->avatarsEnabled = mainConfig.Theme.EnableAvatars.get();
 
-            // skip entries with uids greater than maximum uid
-            if (int(current_pw->pw_uid) > mainConfig.Users.MaximumUid.get())
-                continue;
-            // skip entries with user names in the hide users list
-            if (mainConfig.Users.HideUsers.get().contains(QString::fromLocal8Bit(current_pw->pw_name)))
-                continue;
+        // the daemon has the list already, it arrives through the
+        // directory slots; the enumerator is only asked about filtering
+        if (source == DaemonUsers) {
+            d->fromDaemon = true;
+            d->needAllUsers = true;
+            d->containsAllUsers = true;
+            d->enumerator = new UserEnumerator(true, this);
+            return;
+        }
 
-            // skip entries with shells in the hide shells list
-            if (mainConfig.Users.HideShells.get().contains(QString::fromLocal8Bit(current_pw->pw_shell)))
-                continue;
+        d->avatarResolver = new AvatarResolver(this);
+        connect(d->avatarResolver, &AvatarResolver::iconResolved, this, &UserModel::setUserIcon);
 
-            // create user
-            UserPtr user { new User(current_pw, iconURI) };
+        // start with the users we found last time, they are
+        // checked against the user database in the background
+        if (mainConfig.Users.CacheUserList.get()) {
+            d->users = loadUserSnapshot();
+            d->syncing = !d->users.isEmpty();
+        }
 
-            // add user
-            d->users << user;
+        const bool fromSnapshot = d->syncing;
+        if (fromSnapshot) {
+            // a partial enumeration can't tell which users are gone
+            needAllUsers = true;
+            d->containsAllUsers = true;
+
+            if (d->avatarsEnabled && mainConfig.Theme.EnableAvatars.isDefault() &&
+                    d->users.count() > mainConfig.Theme.DisableAvatarsThreshold.get())
+                d->avatarsEnabled = false;
+
+            for (int i = 0; i < d->users.count(); ++i) {
+                User &user = d->users[i];
+                requestIcon(user);
+
+                // find out index of the last user
+                if (user.name == lastUser()) {
+                    d->lastIndex = i;
+                    d->lastUserFound = true;
+                }
+            }
+        }
 
-            if (user->name == lastUser())
-                lastUserFound = true;
+        d->needAllUsers = needAllUsers;
+        d->enumerator = new UserEnumerator(needAllUsers, this);
+
+        // the enumerator looks up the last user first, a lookup
+        // here could block the GUI thread on a slow NSS module
+        if (!fromSnapshot)
+            d->enumerator->setFirstUser(lastUser());
+
+        connect(d->enumerator, &UserEnumerator::usersFound, this, &UserModel::insertUsers);
+        connect(d->enumerator, &UserEnumerator::enumerationFinished, this, [this](bool containsAllUsers, int generation) {
+            // a newer run has been started since
+            if (generation == d->enumerationGeneration)
+                enumerationFinished(containsAllUsers);
+        });
+
+        if (mainConfig.Users.UseAccountsService.get()) {
+            d->accountsService = new AccountsServiceUsers(this);
+            connect(d->accountsService, &AccountsServiceUsers::usersFound, this, &UserModel::insertUsers);
+            connect(d->accountsService, &AccountsServiceUsers::userRemoved, this, &UserModel::removeUser);
+            connect(d->accountsService, &AccountsServiceUsers::enumerationFinished, this, &UserModel::enumerationFinished);
+            connect(d->accountsService, &AccountsServiceUsers::failed, this, [this] {
+                // fall back to the user database
+                d->accountsService->deleteLater();
+                d->accountsService = nullptr;
+                startEnumeration();
+                watchUserDatabase();
+            });
+            d->accountsService->start();
+        } else {
+            startEnumeration();
+            watchUserDatabase();
+        }
+    }
 
-            if (!needAllUsers && d->users.count() > mainConfig.Theme.DisableAvatarsThreshold.get()) {
-                struct passwd *lastUserData;
-                // If the theme doesn't require that all users are present, try to add the data for lastUser at least
-                if(!lastUserFound && (lastUserData = getpwnam(qPrintable(lastUser()))))
-                    d->users << UserPtr(new User(lastUserData, themeDefaultFace));
+    void UserModel::setNeedAllUsers(bool needAllUsers) {
+        // users are only ever added, whatever a partial
+        // enumeration found stays in the list
+        if (!needAllUsers || d->needAllUsers)
+            return;
+        d->needAllUsers = true;
+
+        // AccountsService and the daemon list everybody anyway, and the
+        // database may just have had fewer users than the partial
+        // enumeration stops at
+        if (d->accountsService || d->fromDaemon || (!d->loading && d->containsAllUsers))
+            return;
+
+        if (!d->loading) {
+            d->loading = true;
+            emit loadingChanged();
+        }
+        startEnumeration();
+    }
 
-                d->containsAllUsers = false;
-                break;
+    void UserModel::startEnumeration() {
+        // a run that is still going is of no use anymore
+        if (d->enumerator->isRunning()) {
+            d->enumerator->requestInterruption();
+            d->enumerator->wait();
+        }
+        d->enumerator->enumerate(d->needAllUsers, ++d->enumerationGeneration);
+    }
+
+    void UserModel::watchUserDatabase() {
+        // tools like useradd replace the file, which drops it from the
+        // watcher, and usually write it a few times in a row
+        d->refreshTimer = new QTimer(this);
+        d->refreshTimer->setSingleShot(true);
+        d->refreshTimer->setInterval(1000);
+        connect(d->refreshTimer, &QTimer::timeout, this, &UserModel::refreshUsers);
+
+        d->watcher = new QFileSystemWatcher(this);
+        connect(d->watcher, &QFileSystemWatcher::fileChanged, this, [this](const QString &path) {
+            if (!d->watcher->files().contains(path) && QFile::exists(path))
+                d->watcher->addPath(path);
+            d->refreshTimer->start();
+        });
+        if (QFile::exists(passwdFile()))
+            d->watcher->addPath(passwdFile());
+    }
+
+    void UserModel::refreshUsers() {
+        qCDebug(SDDM_GREETER_MODELS) << "User database changed, updating the user list";
+
+        // the file might not have been there when it changed
+        if (d->watcher->files().isEmpty() && QFile::exists(passwdFile()))
+            d->watcher->addPath(passwdFile());
+
+        // only a complete walk can tell which users are gone
+        d->syncing = d->needAllUsers;
+        d->seenUsers.clear();
+        startEnumeration();
+    }
+
+    void UserModel::insertUsers(const QVector<User> &users) {
+        QVector<User> batch = users;
+
+        // keep users sorted by username
+        std::sort(batch.begin(), batch.end(), userLessThan);
+
+        // avatars are disabled by default for long lists
+        if (d->avatarsEnabled && mainConfig.Theme.EnableAvatars.isDefault() &&
+                d->users.count() + batch.count() > mainConfig.Theme.DisableAvatarsThreshold.get())
+            disableAvatars();
+
+        int lastIndex = d->lastIndex;
+
+        // merge the batch inserting consecutive users with one call
+        int i = 0;
+        while (i < batch.count()) {
+            const User &found = batch.at(i);
+            auto it = std::lower_bound(d->users.begin(), d->users.end(), found, userLessThan);
+            const int row = int(it - d->users.begin());
+
+            if (d->syncing)
+                d->seenUsers.insert(found.name);
+
+            // the user is already there, this happens for the last user
+            // and for users loaded from the snapshot
+            if (it != d->users.end() && it->name == found.name) {
+                User &user = *it;
+                if (user.realName != found.realName || user.homeDir != found.homeDir ||
+                        user.uid != found.uid || user.gid != found.gid ||
+                        user.needsPassword != found.needsPassword) {
+                    user.realName = found.realName;
+                    user.homeDir = found.homeDir;
+                    user.uid = found.uid;
+                    user.gid = found.gid;
+                    user.needsPassword = found.needsPassword;
+                    emit dataChanged(index(row), index(row), { RealNameRole, HomeDirRole, NeedsPasswordRole });
+                }
+                // the daemon resends users whose avatar changed
+                if (d->fromDaemon && d->avatarsEnabled && user.icon != found.icon) {
+                    user.icon = found.icon;
+                    emit dataChanged(index(row), index(row), { IconRole, ThumbnailRole });
+                }
+                ++i;
+                continue;
+            }
+
+            int j = i + 1;
+            while (j < batch.count() && (row == d->users.count() || batch.at(j).name < d->users.at(row).name))
+                ++j;
+
+            beginInsertRows(QModelIndex(), row, row + j - i - 1);
+            d->users.insert(row, j - i, User());
+            for (int k = i; k < j; ++k) {
+                User &user = d->users[row + k - i];
+                user = batch.at(k);
+                requestIcon(user);
             }
+            endInsertRows();
+
+            // keep track of the index of the last user
+            if (d->lastUserFound && row <= lastIndex) {
+                lastIndex += j - i;
+            } else if (!d->lastUserFound) {
+                for (int k = i; k < j; ++k) {
+                    if (batch.at(k).name == lastUser()) {
+                        lastIndex = row + k - i;
+                        d->lastUserFound = true;
+                        break;
+                    }
+                }
+            }
+
+            i = j;
         }
 
-        endpwent();
+        if (lastIndex != d->lastIndex) {
+            d->lastIndex = lastIndex;
+            emit lastIndexChanged();
+        }
 
-        // sort users by username
-        std::sort(d->users.begin(), d->users.end(), [&](const UserPtr &u1, const UserPtr &u2) { return u1->name < u2->name; });
-        // Remove duplicates in case we have several sources specified
-        // in nsswitch.conf(5).
-        auto newEnd = std::unique(d->users.begin(), d->users.end(), [&](const UserPtr &u1, const UserPtr &u2) { return u1->name == u2->name; });
-        d->users.erase(newEnd, d->users.end());
+        d->realNameIndexDirty = true;
+        emit countChanged();
+    }
 
-        bool avatarsEnabled = mainConfig.Theme.EnableAvatars.get();
-        if (avatarsEnabled && mainConfig.Theme.EnableAvatars.isDefault()) {
-            if (d->users.count() > mainConfig.Theme.DisableAvatarsThreshold.get()) avatarsEnabled=false;
+    void UserModel::requestIcon(User &user) {
+        if (!d->avatarsEnabled) {
+            user.icon.clear();
+            return;
         }
 
-        // find out index of the last user
-        for (int i = 0; i < d->users.size(); ++i) {
-            UserPtr user { d->users.at(i) };
-            if (user->name == stateConfig.Last.User.get())
-                d->lastIndex = i;
+        // the icon is already known, for example from AccountsService,
+        // and the daemon resolves them itself
+        if (!user.icon.isEmpty() || d->fromDaemon)
+            return;
+
+        // show what we found last time, then check in the background
+        user.icon = d->avatarResolver->cachedIcon(user.name);
+        d->avatarResolver->resolve(user.name, user.homeDir);
+    }
+
+    void UserModel::setUserIcon(const QString &name, const QString &icon) {
+        if (!d->avatarsEnabled)
+            return;
+
+        auto it = std::lower_bound(d->users.begin(), d->users.end(), name, userNameLessThan);
+        if (it == d->users.end() || it->name != name || it->icon == icon)
+            return;
+
+        it->icon = icon;
+        const int row = int(it - d->users.begin());
+        emit dataChanged(index(row), index(row), { IconRole, ThumbnailRole });
+    }
+
+    void UserModel::disableAvatars() {
+        d->avatarsEnabled = false;
+        if (d->avatarResolver)
+            d->avatarResolver->clear();
+
+        // reset avatars that were already resolved
+        for (User &user : d->users)
+            user.icon.clear();
+
+        if (!d->users.isEmpty())
+            emit dataChanged(index(0), index(d->users.count() - 1), { IconRole, ThumbnailRole });
+    }
+
+    void UserModel::addDirectoryUsers(const QVector<UserInfo> &users) {
+        if (!d->fromDaemon)
+            return;
+
+        QVector<User> batch;
+        batch.reserve(users.count());
+        for (const UserInfo &info : users)
+            batch << User(info);
+        insertUsers(batch);
+    }
 
-            if (avatarsEnabled) {
-                const QString userFace = QStringLiteral("%1/.face.icon").arg(user->homeDir);
-                const QString systemFace = QStringLiteral("%1/%2.face.icon").arg(facesDir).arg(user->name);
-                const QString accountsServiceFace = QStringLiteral("/var/lib/AccountsService/icons/%1").arg(user->name);
+    void UserModel::removeDirectoryUsers(const QStringList &names) {
+        if (!d->fromDaemon)
+            return;
+
+        for (const QString &name : names)
+            removeUser(name);
+    }
 
-                QString userIcon;
-                // If the home is encrypted it takes a lot of time to open
-                // up the greeter, therefore we try the system avatar first
-                if (QFile::exists(systemFace))
-                    userIcon = systemFace;
-                else if (QFile::exists(userFace))
-                    userIcon = userFace;
-                else if (QFile::exists(accountsServiceFace))
-                    userIcon = accountsServiceFace;
+    void UserModel::directoryListed() {
+        if (d->fromDaemon)
+            enumerationFinished(true);
+    }
 
-                if (!userIcon.isEmpty())
-                    user->icon = QStringLiteral("file://%1").arg(userIcon);
+    void UserModel::removeUser(const QString &name) {
+        auto it = std::lower_bound(d->users.begin(), d->users.end(), name, userNameLessThan);
+        if (it == d->users.end() || it->name != name)
+            return;
+
+        const int row = int(it - d->users.begin());
+        beginRemoveRows(QModelIndex(), row, row);
+        d->users.remove(row);
+        endRemoveRows();
+
+        if (d->lastUserFound && row <= d->lastIndex) {
+            if (row == d->lastIndex) {
+                d->lastIndex = 0;
+                d->lastUserFound = false;
+            } else {
+                --d->lastIndex;
             }
+            emit lastIndexChanged();
+        }
+
+        d->realNameIndexDirty = true;
+        emit countChanged();
+    }
+
+    void UserModel::enumerationFinished(bool containsAllUsers) {
+        // remove users that don't exist anymore
+        if (d->syncing && containsAllUsers) {
+            int lastIndex = d->lastIndex;
+            for (int i = d->users.count() - 1; i >= 0; --i) {
+                if (d->seenUsers.contains(d->users.at(i).name))
+                    continue;
+
+                beginRemoveRows(QModelIndex(), i, i);
+                d->users.remove(i);
+                endRemoveRows();
+
+                if (i < lastIndex)
+                    --lastIndex;
+                else if (i == lastIndex) {
+                    lastIndex = 0;
+                    d->lastUserFound = false;
+                }
+            }
+            d->realNameIndexDirty = true;
+
+            if (lastIndex != d->lastIndex) {
+                d->lastIndex = lastIndex;
+                emit lastIndexChanged();
+            }
+            emit countChanged();
+        }
+        d->seenUsers.clear();
+        d->syncing = false;
+
+        // save the list for the next time, the daemon keeps its own
+        if (containsAllUsers && !d->fromDaemon && mainConfig.Users.CacheUserList.get())
+            saveUserSnapshot(d->users);
+
+        if (d->containsAllUsers != containsAllUsers) {
+            d->containsAllUsers = containsAllUsers;
+            emit containsAllUsersChanged();
+        }
+
+        if (d->loading) {
+            d->loading = false;
+            emit loadingChanged();
         }
     }
 
     UserModel::~UserModel() {
+        // stop the enumeration
+        d->enumerator->requestInterruption();
+        d->enumerator->wait();
+
         delete d;
     }
 
@@ -165,6 +857,7 @@ namespace SDDM {
         roleNames[RealNameRole] = QByteArrayLiteral("realName");
         roleNames[HomeDirRole] = QByteArrayLiteral("homeDir");
         roleNames[IconRole] = QByteArrayLiteral("icon");
+        roleNames[ThumbnailRole] = QByteArrayLiteral("thumbnail");
         roleNames[NeedsPasswordRole] = QByteArrayLiteral("needsPassword");
 
         return roleNames;
@@ -183,28 +876,101 @@ namespace SDDM {
     }
 
     QVariant UserModel::data(const QModelIndex &index, int role) const {
-        if (index.row() < 0 || index.row() > d->users.count())
+        if (index.row() < 0 || index.row() >= d->users.count())
             return QVariant();
 
         // get user
-        UserPtr user = d->users[index.row()];
+        const User &user = d->users.at(index.row());
 
         // return correct value
         if (role == NameRole)
-            return user->name;
+            return user.name;
         else if (role == RealNameRole)
-            return user->realName;
+            return user.realName;
         else if (role == HomeDirRole)
-            return user->homeDir;
+            return user.homeDir;
         else if (role == IconRole)
-            return user->icon;
+            return user.icon.isEmpty() ? d->defaultIcon : user.icon;
         else if (role == NeedsPasswordRole)
-            return user->needsPassword;
+            return user.needsPassword;
+        else if (role == ThumbnailRole)
+            return QStringLiteral("image://sddm-face/%1").arg(QString::fromUtf8(QUrl::toPercentEncoding(user.icon.isEmpty() ? d->defaultIcon : user.icon)));
 
         // return empty value
         return QVariant();
     }
 
+    int UserModel::indexOf(const QString &name) const {
+        auto it = std::lower_bound(d->users.constBegin(), d->users.constEnd(), name, userNameLessThan);
+        if (it == d->users.constEnd() || it->name != name)
+            return -1;
+        return int(it - d->users.constBegin());
+    }
+
+    QStringList UserModel::search(const QString &text, int limit) const {
+        QStringList result;
+        if (text.isEmpty() || limit <= 0)
+            return result;
+
+        // users are sorted by name, so matching names are contiguous
+        auto it = std::lower_bound(d->users.constBegin(), d->users.constEnd(), text, userNameLessThan);
+        for (; it != d->users.constEnd() && result.count() < limit; ++it) {
+            if (!it->name.startsWith(text))
+                break;
+            result << it->name;
+        }
+
+        // then look for words of the real names
+        if (d->realNameIndexDirty) {
+            d->realNameIndex.clear();
+            for (const User &user : qAsConst(d->users)) {
+                const auto words = user.realName.toLower().split(QLatin1Char(' '), Qt::SkipEmptyParts);
+                for (const QString &word : words)
+                    d->realNameIndex.append(qMakePair(word, user.name));
+            }
+            std::sort(d->realNameIndex.begin(), d->realNameIndex.end());
+            d->realNameIndexDirty = false;
+        }
+
+        const QString word = text.toLower();
+        auto wit = std::lower_bound(d->realNameIndex.constBegin(), d->realNameIndex.constEnd(), word,
+                                    [&](const QPair<QString, QString> &p, const QString &w) { return p.first < w; });
+        for (; wit != d->realNameIndex.constEnd() && result.count() < limit; ++wit) {
+            if (!wit->first.startsWith(word))
+                break;
+            if (!result.contains(wit->second))
+                result << wit->second;
+        }
+
+        return result;
+    }
+
+    int UserModel::findUser(const QString &name) {
+        int row = indexOf(name);
+        if (row >= 0 || name.isEmpty())
+            return row;
+
+        // the list is partial, the user is looked up in the background
+        // and userFound() tells where it was inserted
+        if (d->pendingLookups.contains(name))
+            return -1;
+        d->pendingLookups.insert(name);
+
+        QPointer<UserModel> model(this);
+        QThreadPool::globalInstance()->start(new UserLookup(name, d->enumerator->filter(), [model, name](const QVector<User> &found) {
+            if (!model)
+                return;
+            model->d->pendingLookups.remove(name);
+            if (!found.isEmpty() && model->indexOf(name) < 0)
+                model->insertUsers(found);
+
+            const int row = model->indexOf(name);
+            if (row >= 0)
+                emit model->userFound(name, row);
+        }));
+        return -1;
+    }
+
     int UserModel::disableAvatarsThreshold() const {
         return mainConfig.Theme.DisableAvatarsThreshold.get();
     }
@@ -212,4 +978,10 @@ namespace SDDM {
     bool UserModel::containsAllUsers() const {
         return d->containsAllUsers;
     }
+
+    bool UserModel::loading() const {
+        return d->loading;
+    }
 }
+
+#include "UserModel.moc"
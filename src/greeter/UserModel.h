@@ -23,29 +23,42 @@
 #include <QAbstractListModel>
 
 #include <QHash>
+#include <QStringList>
+#include <QVector>
 
 namespace SDDM {
+    class User;
     class UserModelPrivate;
+    struct UserInfo;
 
     class UserModel : public QAbstractListModel {
         Q_OBJECT
         Q_DISABLE_COPY(UserModel)
-        Q_PROPERTY(int lastIndex READ lastIndex CONSTANT)
+        Q_PROPERTY(int lastIndex READ lastIndex NOTIFY lastIndexChanged)
         Q_PROPERTY(QString lastUser READ lastUser CONSTANT)
-        Q_PROPERTY(int count READ rowCount CONSTANT)
+        Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
         Q_PROPERTY(int disableAvatarsThreshold READ disableAvatarsThreshold CONSTANT)
-        Q_PROPERTY(bool containsAllUsers READ containsAllUsers CONSTANT)
+        Q_PROPERTY(bool containsAllUsers READ containsAllUsers NOTIFY containsAllUsersChanged)
+        Q_PROPERTY(bool loading READ loading NOTIFY loadingChanged)
     public:
         enum UserRoles {
             NameRole = Qt::UserRole + 1,
             RealNameRole,
             HomeDirRole,
             IconRole,
-            NeedsPasswordRole
+            NeedsPasswordRole,
+            ThumbnailRole
         };
         Q_ENUM(UserRoles)
 
-        UserModel(bool needAllUsers, QObject *parent = 0);
+        enum Source {
+            // enumerated by the model itself
+            LocalUsers,
+            // sent by the daemon, see addDirectoryUsers()
+            DaemonUsers
+        };
+
+        UserModel(bool needAllUsers, Source source = LocalUsers, QObject *parent = 0);
         ~UserModel();
 
         QHash<int, QByteArray> roleNames() const override;
@@ -58,7 +71,41 @@ namespace SDDM {
 
         int disableAvatarsThreshold() const;
         bool containsAllUsers() const;
+        bool loading() const;
+
+        // switches to a complete list, extending the users found so far
+        void setNeedAllUsers(bool needAllUsers);
+
+        // the feed of the daemon's user directory, for DaemonUsers
+        void addDirectoryUsers(const QVector<SDDM::UserInfo> &users);
+        void removeDirectoryUsers(const QStringList &names);
+        void directoryListed();
+
+    public slots:
+        int indexOf(const QString &name) const;
+        QStringList search(const QString &text, int limit = 20) const;
+        // the row of the user, or -1 while a user the partial list
+        // doesn't have is looked up, see userFound()
+        int findUser(const QString &name);
+
+    signals:
+        void userFound(const QString &name, int index);
+        void lastIndexChanged();
+        void countChanged();
+        void containsAllUsersChanged();
+        void loadingChanged();
+
     private:
+        void insertUsers(const QVector<User> &users);
+        void requestIcon(User &user);
+        void setUserIcon(const QString &name, const QString &icon);
+        void removeUser(const QString &name);
+        void disableAvatars();
+        void enumerationFinished(bool containsAllUsers);
+        void startEnumeration();
+        void watchUserDatabase();
+        void refreshUsers();
+
         UserModelPrivate *d { nullptr };
     };
 }
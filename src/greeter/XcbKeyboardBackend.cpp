@@ -19,6 +19,9 @@
 
 #include <QtCore/QDebug>
 #include <QtCore/QObject>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+#include <QtCore/QtAlgorithms>
 
 #include "KeyboardModel.h"
 #include "KeyboardModel_p.h"
@@ -36,12 +39,81 @@ namespace SDDM {
 
     void XcbKeyboardBackend::init() {
         connectToDisplay();
-        if (d->enabled)
-            initLedMap();
-        if (d->enabled)
-            initLayouts();
-        if (d->enabled)
-            initState();
+        if (!d->enabled)
+            return;
+
+        // Send everything first and only then wait, the replies come back
+        // together so that a slow display costs the same as a local one
+        const uint16_t events = XCB_XKB_EVENT_TYPE_STATE_NOTIFY | XCB_XKB_EVENT_TYPE_NEW_KEYBOARD_NOTIFY;
+        xcb_xkb_select_events_details_t details;
+        xcb_void_cookie_t selectCookie = xcb_xkb_select_events_checked(m_conn, XCB_XKB_ID_USE_CORE_KBD,
+                events, 0, events, 0, 0, &details);
+        xcb_xkb_get_names_cookie_t namesCookie = xcb_xkb_get_names(m_conn, XCB_XKB_ID_USE_CORE_KBD,
+                XCB_XKB_NAME_DETAIL_INDICATOR_NAMES | XCB_XKB_NAME_DETAIL_GROUP_NAMES | XCB_XKB_NAME_DETAIL_SYMBOLS);
+        xcb_xkb_get_indicator_map_cookie_t mapCookie = xcb_xkb_get_indicator_map(m_conn, XCB_XKB_ID_USE_CORE_KBD, 0xffffffff);
+        xcb_xkb_get_state_cookie_t stateCookie = xcb_xkb_get_state(m_conn, XCB_XKB_ID_USE_CORE_KBD);
+        xcb_flush(m_conn);
+
+        xcb_generic_error_t *error = nullptr;
+        xcb_xkb_use_extension_reply_t *extension = xcb_xkb_use_extension_reply(m_conn, m_extensionCookie, &error);
+        free(extension);
+        if (error != nullptr) {
+            qCritical() << "xcb_xkb_use_extension failed, extension disabled, error code"
+                        << error->error_code;
+            free(error);
+            d->enabled = false;
+            return;
+        }
+
+        xcb_xkb_get_names_reply_t *names = xcb_xkb_get_names_reply(m_conn, namesCookie, &error);
+        if (error) {
+            qCritical() << "Can't init led map and layouts: " << error->error_code;
+            free(error);
+            d->enabled = false;
+            return;
+        }
+
+        xcb_xkb_get_indicator_map_reply_t *maps = xcb_xkb_get_indicator_map_reply(m_conn, mapCookie, &error);
+        if (error) {
+            qWarning() << "Can't get indicator masks: " << error->error_code;
+            free(error);
+        }
+
+        readNames(names, maps);
+        free(names);
+        free(maps);
+
+        xcb_xkb_get_state_reply_t *state = xcb_xkb_get_state_reply(m_conn, stateCookie, &error);
+        if (state) {
+            // Set locks state
+            d->capslock.enabled = state->lockedMods & d->capslock.mask;
+            d->numlock.enabled  = state->lockedMods & d->numlock.mask;
+
+            // Set current layout
+            d->layout_id = state->group;
+
+            // Free
+            free(state);
+        } else {
+            // Log error and disable extension
+            qCritical() << "Can't load leds state - " << error->error_code;
+            free(error);
+            d->enabled = false;
+            return;
+        }
+
+        // from here on the state only changes through events
+        error = xcb_request_check(m_conn, selectCookie);
+        if (error) {
+            qCritical() << "Can't select xck-xkb events: " << error->error_code;
+            free(error);
+            d->enabled = false;
+            return;
+        }
+
+        // the groups of the server's keymap are all compiled already,
+        // switching is just a matter of locking another one
+        d->layoutSwitching = true;
     }
 
     void XcbKeyboardBackend::disconnect() {
@@ -50,174 +122,118 @@ namespace SDDM {
     }
 
     void XcbKeyboardBackend::sendChanges() {
-        xcb_void_cookie_t cookie;
-        xcb_generic_error_t *error = nullptr;
-
         // Compute masks
         uint8_t mask_full = d->numlock.mask | d->capslock.mask,
                 mask_cur  = (d->numlock.enabled  ? d->numlock.mask  : 0) |
                             (d->capslock.enabled ? d->capslock.mask : 0);
 
-        // Change state
-        cookie = xcb_xkb_latch_lock_state(m_conn,
+        // Change state, errors come in along with the events
+        xcb_xkb_latch_lock_state(m_conn,
                     XCB_XKB_ID_USE_CORE_KBD,
                     mask_full,
                     mask_cur,
                     1,
                     d->layout_id,
                     0, 0, 0);
-        error = xcb_request_check(m_conn, cookie);
-
-        if (error) {
-            qWarning() << "Can't update state: " << error->error_code;
-        }
+        xcb_flush(m_conn);
     }
 
     void XcbKeyboardBackend::connectToDisplay() {
-        // Connect and initialize xkb extension
-        xcb_xkb_use_extension_cookie_t cookie;
-        xcb_generic_error_t *error = nullptr;
-
         m_conn = xcb_connect(nullptr, nullptr);
-        if (m_conn == nullptr) {
+        if (m_conn == nullptr || xcb_connection_has_error(m_conn)) {
             qCritical() << "xcb_connect failed, keyboard extension disabled";
             d->enabled = false;
             return;
         }
 
-        // Initialize xkb extension
-        cookie = xcb_xkb_use_extension(m_conn, XCB_XKB_MAJOR_VERSION, XCB_XKB_MINOR_VERSION);
-        xcb_xkb_use_extension_reply(m_conn, cookie, &error);
-
-        if (error != nullptr) {
-            qCritical() << "xcb_xkb_use_extension failed, extension disabled, error code"
-                        << error->error_code;
-            d->enabled = false;
-            return;
-        }
+        // Initialize xkb extension, the reply is collected in init()
+        m_extensionCookie = xcb_xkb_use_extension(m_conn, XCB_XKB_MAJOR_VERSION, XCB_XKB_MINOR_VERSION);
     }
 
-    void XcbKeyboardBackend::initLedMap() {
-        // Get indicator names atoms
-        xcb_xkb_get_names_cookie_t cookie;
-        xcb_xkb_get_names_reply_t *reply = nullptr;
-        xcb_generic_error_t *error = nullptr;
-
-        cookie = xcb_xkb_get_names(m_conn,
-                XCB_XKB_ID_USE_CORE_KBD,
-                XCB_XKB_NAME_DETAIL_INDICATOR_NAMES);
-        reply = xcb_xkb_get_names_reply(m_conn, cookie, &error);
-
-        if (error) {
-            qCritical() << "Can't init led map: " << error->error_code;
-            d->enabled = false;
-            return;
-        }
-
+    void XcbKeyboardBackend::readNames(xcb_xkb_get_names_reply_t *reply, xcb_xkb_get_indicator_map_reply_t *maps) {
         // Unpack
-        xcb_xkb_get_names_value_list_t list;
         const void *buffer = xcb_xkb_get_names_value_list(reply);
+        xcb_xkb_get_names_value_list_t list;
         xcb_xkb_get_names_value_list_unpack(buffer, reply->nTypes, reply->indicators,
                 reply->virtualMods, reply->groupNames, reply->nKeys, reply->nKeyAliases,
                 reply->nRadioGroups, reply->which, &list);
 
-        // Get indicators count
-        int ind_cnt = xcb_xkb_get_names_value_list_indicator_names_length(reply, &list);
+        const bool hasIndicators = reply->which & XCB_XKB_NAME_DETAIL_INDICATOR_NAMES;
+        const int indicatorCount = hasIndicators ? xcb_xkb_get_names_value_list_indicator_names_length(reply, &list) : 0;
+        const int groupCount = xcb_xkb_get_names_value_list_groups_length(reply, &list);
 
-        // Loop through indicators and get their properties
-        QList<xcb_get_atom_name_cookie_t> cookies;
-        for (int i = 0; i < ind_cnt; i++) {
+        // Ask for all atom names at once
+        QVector<xcb_get_atom_name_cookie_t> cookies;
+        cookies.reserve(indicatorCount + groupCount + 1);
+        for (int i = 0; i < indicatorCount; i++)
             cookies << xcb_get_atom_name(m_conn, list.indicatorNames[i]);
-        }
+        for (int i = 0; i < groupCount; i++)
+            cookies << xcb_get_atom_name(m_conn, list.groups[i]);
+        cookies << xcb_get_atom_name(m_conn, list.symbolsName);
+        xcb_flush(m_conn);
 
-        for (int i = 0; i < ind_cnt; i++) {
-            QString name = atomName(cookies[i]);
+        // Names are listed for the indicators set in the reply, in bit order,
+        // and so are the maps
+        int bit = -1;
+        for (int i = 0; i < indicatorCount; i++) {
+            do {
+                ++bit;
+            } while (bit < 32 && !(reply->indicators & (1u << bit)));
 
+            const QString name = atomName(cookies[i]);
+            if (!maps || bit >= 32 || !(maps->which & (1u << bit)))
+                continue;
+
+            const xcb_xkb_indicator_map_t *map = xcb_xkb_get_indicator_map_maps(maps)
+                    + qPopulationCount(maps->which & ((1u << bit) - 1));
             if (name == QLatin1String("Num Lock")) {
-                d->numlock.mask = getIndicatorMask(i);
+                d->numlock.mask = map->mods;
             } else if (name == QLatin1String("Caps Lock")) {
-                d->capslock.mask = getIndicatorMask(i);
+                d->capslock.mask = map->mods;
             }
         }
 
-        // Free memory
-        free(reply);
+        QStringList longNames;
+        for (int i = 0; i < groupCount; i++)
+            longNames << atomName(cookies[indicatorCount + i]);
+
+        // Get short names
+        const QList<QString> short_names = parseShortNames(atomName(cookies.last()));
+
+        // Loop through group names, the old layouts may still be
+        // referenced until layoutsChanged() got around
+        for (QObject *layout : qAsConst(d->layouts))
+            layout->deleteLater();
+        d->layouts.clear();
+        for (int i = 0; i < groupCount; i++) {
+            QString nshort;
+            if (i < short_names.length())
+                nshort = short_names[i];
+
+            d->layouts << new KeyboardLayout(nshort, longNames[i]);
+        }
     }
 
     void XcbKeyboardBackend::initLayouts() {
-        xcb_xkb_get_names_cookie_t cookie;
-        xcb_xkb_get_names_reply_t *reply = nullptr;
         xcb_generic_error_t *error = nullptr;
 
         // Get atoms for short and long names
-        cookie = xcb_xkb_get_names(m_conn,
+        xcb_xkb_get_names_cookie_t cookie = xcb_xkb_get_names(m_conn,
                 XCB_XKB_ID_USE_CORE_KBD,
                 XCB_XKB_NAME_DETAIL_GROUP_NAMES | XCB_XKB_NAME_DETAIL_SYMBOLS);
-        reply = xcb_xkb_get_names_reply(m_conn, cookie, nullptr);
+        xcb_xkb_get_names_reply_t *reply = xcb_xkb_get_names_reply(m_conn, cookie, &error);
 
         if (error) {
             // Log and disable
             qCritical() << "Can't init layouts: " << error->error_code;
+            free(error);
             return;
         }
 
-        // Unpack
-        const void *buffer = xcb_xkb_get_names_value_list(reply);
-        xcb_xkb_get_names_value_list_t res_list;
-        xcb_xkb_get_names_value_list_unpack(buffer, reply->nTypes, reply->indicators,
-                reply->virtualMods, reply->groupNames, reply->nKeys, reply->nKeyAliases,
-                reply->nRadioGroups, reply->which, &res_list);
-
-        // Get short names
-        QList<QString> short_names = parseShortNames(atomName(res_list.symbolsName));
-
-        // Loop through group names
-        d->layouts.clear();
-        int groups_cnt = xcb_xkb_get_names_value_list_groups_length(reply, &res_list);
-
-        QList<xcb_get_atom_name_cookie_t> cookies;
-        for (int i = 0; i < groups_cnt; i++) {
-            cookies << xcb_get_atom_name(m_conn, res_list.groups[i]);
-        }
-
-        for (int i = 0; i < groups_cnt; i++) {
-            QString nshort, nlong = atomName(cookies[i]);
-            if (i < short_names.length())
-                nshort = short_names[i];
-
-            d->layouts << new KeyboardLayout(nshort, nlong);
-        }
-
-        // Free
+        readNames(reply, nullptr);
         free(reply);
     }
 
-    void XcbKeyboardBackend::initState() {
-        xcb_xkb_get_state_cookie_t cookie;
-        xcb_xkb_get_state_reply_t *reply = nullptr;
-        xcb_generic_error_t *error = nullptr;
-
-        // Get xkb state
-        cookie = xcb_xkb_get_state(m_conn, XCB_XKB_ID_USE_CORE_KBD);
-        reply = xcb_xkb_get_state_reply(m_conn, cookie, &error);
-
-        if (reply) {
-            // Set locks state
-            d->capslock.enabled = reply->lockedMods & d->capslock.mask;
-            d->numlock.enabled  = reply->lockedMods & d->numlock.mask;
-
-            // Set current layout
-            d->layout_id = reply->group;
-
-            // Free
-            free(reply);
-        } else {
-            // Log error and disable extension
-            qCritical() << "Can't load leds state - " << error->error_code;
-            d->enabled = false;
-        }
-    }
-
     QString XcbKeyboardBackend::atomName(xcb_get_atom_name_cookie_t cookie) const {
         xcb_get_atom_name_reply_t *reply = nullptr;
         xcb_generic_error_t *error = nullptr;
@@ -235,37 +251,11 @@ namespace SDDM {
         } else {
             // Log error
             qWarning() << "Failed to get atom name: " << error->error_code;
+            free(error);
         }
         return res;
     }
 
-    QString XcbKeyboardBackend::atomName(xcb_atom_t atom) const {
-        return atomName(xcb_get_atom_name(m_conn, atom));
-    }
-
-    uint8_t XcbKeyboardBackend::getIndicatorMask(uint8_t i) const {
-        xcb_xkb_get_indicator_map_cookie_t cookie;
-        xcb_xkb_get_indicator_map_reply_t *reply = nullptr;
-        xcb_generic_error_t *error = nullptr;
-        uint8_t mask = 0;
-
-        cookie = xcb_xkb_get_indicator_map(m_conn, XCB_XKB_ID_USE_CORE_KBD, 1 << i);
-        reply = xcb_xkb_get_indicator_map_reply(m_conn, cookie, &error);
-
-
-        if (reply) {
-            xcb_xkb_indicator_map_t *map = xcb_xkb_get_indicator_map_maps(reply);
-
-            mask = map->mods;
-
-            free(reply);
-        } else {
-            // Log error
-            qWarning() << "Can't get indicator mask " << error->error_code;
-        }
-        return mask;
-    }
-
     QList<QString> XcbKeyboardBackend::parseShortNames(QString text) {
         QRegExp re(QStringLiteral(R"(\+([a-z]+))"));
         re.setCaseSensitivity(Qt::CaseInsensitive);
@@ -299,35 +289,26 @@ namespace SDDM {
             } else if (event->response_type != 0 && event->pad0 == XCB_XKB_NEW_KEYBOARD_NOTIFY) {
                 // Keyboards changed, reinit layouts
                 initLayouts();
+            } else if (event->response_type == 0) {
+                // from sendChanges()
+                qWarning() << "Can't update state: " << ((xcb_generic_error_t *)event)->error_code;
             }
             free(event);
         }
     }
 
     void XcbKeyboardBackend::connectEventsDispatcher(KeyboardModel *model) {
-        // Setup events filter
-        xcb_void_cookie_t cookie;
-        xcb_xkb_select_events_details_t foo;
-        xcb_generic_error_t *error = nullptr;
-
-        cookie = xcb_xkb_select_events(m_conn, XCB_XKB_ID_USE_CORE_KBD,
-                XCB_XKB_EVENT_TYPE_STATE_NOTIFY | XCB_XKB_EVENT_TYPE_NEW_KEYBOARD_NOTIFY, 0,
-                XCB_XKB_EVENT_TYPE_STATE_NOTIFY | XCB_XKB_EVENT_TYPE_NEW_KEYBOARD_NOTIFY, 0, 0, &foo);
-        // Check errors
-        error = xcb_request_check(m_conn, cookie);
-        if (error) {
-            qCritical() << "Can't select xck-xkb events: " << error->error_code;
-            d->enabled = false;
+        // events were selected in init()
+        if (!d->enabled)
             return;
-        }
-
-        // Flush connection
-        xcb_flush(m_conn);
 
         // Get file descripor and init socket listener
         int fd = xcb_get_file_descriptor(m_conn);
         m_socket = new QSocketNotifier(fd, QSocketNotifier::Read);
 
         QObject::connect(m_socket, SIGNAL(activated(int)), model, SLOT(dispatchEvents()));
+
+        // replies to init() may have brought events along
+        QMetaObject::invokeMethod(model, "dispatchEvents", Qt::QueuedConnection);
     }
 }
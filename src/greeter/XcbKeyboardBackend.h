@@ -48,18 +48,15 @@ namespace SDDM {
     private:
         // Initializers
         void connectToDisplay();
-        void initLedMap();
         void initLayouts();
-        void initState();
+        void readNames(xcb_xkb_get_names_reply_t *reply, xcb_xkb_get_indicator_map_reply_t *maps);
 
         // Helpers
-        QString atomName(xcb_atom_t atom) const;
         QString atomName(xcb_get_atom_name_cookie_t cookie) const;
 
-        uint8_t getIndicatorMask(uint8_t id) const;
-
         // Connection
         xcb_connection_t *m_conn { nullptr };
+        xcb_xkb_use_extension_cookie_t m_extensionCookie { 0 };
 
         // Socket listener
         QSocketNotifier *m_socket { nullptr };
@@ -82,7 +82,7 @@ Rectangle {
             PictureBox {
                 anchors.verticalCenter: parent.verticalCenter
                 name: (model.realName === "") ? model.name : model.realName
-                icon: model.icon
+                icon: model.thumbnail
                 showPassword: model.needsPassword
 
                 focus: (listView.currentIndex === index) ? true : false
@@ -18,6 +18,7 @@
 ***************************************************************************/
 
 #include <QDir>
+#include <QFile>
 
 #include "KeyboardModel.h"
 #include "KeyboardModel_p.h"
@@ -26,6 +27,39 @@
 
 namespace SDDM {
 
+// Reads the "! layout" section of an xkeyboard-config rules list,
+// where each line is a layout name followed by its description
+static QList<QPair<QString, QString>> readRulesList(const QString &fileName)
+{
+    QList<QPair<QString, QString>> layouts;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return layouts;
+
+    bool inLayouts = false;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().trimmed();
+        if (line.startsWith('!')) {
+            if (inLayouts)
+                break;
+            inLayouts = line.mid(1).trimmed() == "layout";
+            continue;
+        }
+        if (!inLayouts || line.isEmpty())
+            continue;
+
+        int split = 0;
+        while (split < line.size() && line.at(split) != ' ' && line.at(split) != '\t')
+            ++split;
+        const QString name = QString::fromUtf8(line.left(split));
+        const QString description = QString::fromUtf8(line.mid(split).trimmed());
+        layouts.append(qMakePair(name, description.isEmpty() ? name : description));
+    }
+
+    return layouts;
+}
+
 WaylandKeyboardBackend::WaylandKeyboardBackend(KeyboardModelPrivate *kmp)
     : KeyboardBackend(kmp)
 {
@@ -38,11 +72,25 @@ WaylandKeyboardBackend::~WaylandKeyboardBackend()
 void WaylandKeyboardBackend::init()
 {
     d->layouts.clear();
+    d->layoutNames.clear();
+
+    // the keymap belongs to the compositor, there is nothing a client can
+    // switch; the layouts are only listed
+    d->layoutSwitching = false;
+
+    // the rules lists have the layouts along with their descriptions
+    // for a fraction of what listing the symbols costs
+    const QString xkbRoot = QStringLiteral("/usr/share/X11/xkb");
+    for (const QString &list : { QStringLiteral("/rules/evdev.lst"), QStringLiteral("/rules/base.lst") }) {
+        d->layoutNames = readRulesList(xkbRoot + list);
+        if (!d->layoutNames.isEmpty())
+            return;
+    }
 
-    QDir dir(QStringLiteral("/usr/share/X11/xkb/symbols"));
-    auto entries = dir.entryList(QDir::Files);
-    for (const auto &entry : qAsConst(entries))
-        d->layouts << new KeyboardLayout(entry, entry);
+    QDir dir(xkbRoot + QStringLiteral("/symbols"));
+    const auto entries = dir.entryList(QDir::Files);
+    for (const auto &entry : entries)
+        d->layoutNames.append(qMakePair(entry, entry));
 }
 
 void WaylandKeyboardBackend::disconnect()
@@ -21,6 +21,7 @@
 #include "Backend.h"
 #include "HelperApp.h"
 
+#include "backend/MockBackend.h"
 #include "backend/PamBackend.h"
 #include "backend/PasswdBackend.h"
 #include "Configuration.h"
@@ -43,7 +44,9 @@ namespace SDDM {
 
     Backend *Backend::get(HelperApp* parent)
     {
-    #ifdef USE_PAM
+    #if defined(USE_MOCK_AUTH)
+        return new MockBackend(parent);
+    #elif defined(USE_PAM)
         return new PamBackend(parent);
     #else
         return new PasswdBackend(parent);
@@ -63,26 +66,37 @@ namespace SDDM {
         m_greeter = on;
     }
 
+    void Backend::setService(const QString &service) {
+        m_service = service;
+    }
+
     bool Backend::openSession() {
         struct passwd *pw;
         pw = getpwnam(qPrintable(qobject_cast<HelperApp*>(parent())->user()));
         if (pw) {
-            QProcessEnvironment env = m_app->session()->processEnvironment();
-            env.insert(QStringLiteral("HOME"), QString::fromLocal8Bit(pw->pw_dir));
-            env.insert(QStringLiteral("PWD"), QString::fromLocal8Bit(pw->pw_dir));
-            env.insert(QStringLiteral("SHELL"), QString::fromLocal8Bit(pw->pw_shell));
-            env.insert(QStringLiteral("USER"), QString::fromLocal8Bit(pw->pw_name));
-            env.insert(QStringLiteral("LOGNAME"), QString::fromLocal8Bit(pw->pw_name));
+            // TODO: I'm fairly sure this shouldn't be done for PAM sessions, investigate!
+            SessionEnvironment &env = m_app->session()->environment();
+            env.insert(SessionEnvironment::Account, QStringLiteral("HOME"), QString::fromLocal8Bit(pw->pw_dir));
+            env.insert(SessionEnvironment::Account, QStringLiteral("PWD"), QString::fromLocal8Bit(pw->pw_dir));
+            env.insert(SessionEnvironment::Account, QStringLiteral("SHELL"), QString::fromLocal8Bit(pw->pw_shell));
+            env.insert(SessionEnvironment::Account, QStringLiteral("USER"), QString::fromLocal8Bit(pw->pw_name));
+            env.insert(SessionEnvironment::Account, QStringLiteral("LOGNAME"), QString::fromLocal8Bit(pw->pw_name));
             if (env.contains(QStringLiteral("DISPLAY")) && !env.contains(QStringLiteral("XAUTHORITY"))) {
-                // determine Xauthority path
-                QString value = QStringLiteral("%1/%2")
-                        .arg(QString::fromLocal8Bit(pw->pw_dir))
-                        .arg(mainConfig.X11.UserAuthFile.get());
-                env.insert(QStringLiteral("XAUTHORITY"), value);
+                // determine Xauthority path, the runtime directory is
+                // set up by PAM when the session is opened
+                const QString runtimeDir = env.value(QStringLiteral("XDG_RUNTIME_DIR"));
+                QString value;
+                if (mainConfig.X11.UserAuthInRuntimeDir.get() && !runtimeDir.isEmpty())
+                    value = QStringLiteral("%1/Xauthority").arg(runtimeDir);
+                else
+                    value = QStringLiteral("%1/%2")
+                            .arg(QString::fromLocal8Bit(pw->pw_dir))
+                            .arg(mainConfig.X11.UserAuthFile.get());
+                env.insert(SessionEnvironment::Account, QStringLiteral("XAUTHORITY"), value);
             }
 #if defined(Q_OS_FREEBSD)
         /* get additional environment variables via setclassenvironment();
-            this needs to be done here instead of in UserSession::setupChildProcess
+            this needs to be done here instead of in sddm-helper-exec
             as the environment for execve() is prepared here
         */
         login_cap_t *lc;
@@ -106,18 +120,16 @@ namespace SDDM {
             }
 
             // copy all environment variables that are now set
-            env.insert(QProcessEnvironment::systemEnvironment());
+            env.insert(SessionEnvironment::Account, QProcessEnvironment::systemEnvironment());
             // for sddm itself, we don't want to set LANG from capabilities.
             // instead, honour sddm_lang variable from rc script
             if (qobject_cast<HelperApp*>(parent())->user() == QStringLiteral("sddm"))
-                env.insert(QStringLiteral("LANG"), savedLang);
+                env.insert(SessionEnvironment::Account, QStringLiteral("LANG"), savedLang);
             // finally, restore original helper environment
             QProcessEnvironment::systemEnvironment().clear();
             QProcessEnvironment::systemEnvironment().insert(savedEnv);
         }
 #endif
-            // TODO: I'm fairly sure this shouldn't be done for PAM sessions, investigate!
-            m_app->session()->setProcessEnvironment(env);
         }
         return m_app->session()->start();
     }
@@ -38,6 +38,7 @@ namespace SDDM {
         void setAutologin(bool on = true);
         void setDisplayServer(bool on = true);
         void setGreeter(bool on = true);
+        void setService(const QString &service);
 
     public slots:
         virtual bool start(const QString &user = QString()) = 0;
@@ -53,6 +54,8 @@ namespace SDDM {
         bool m_autologin { false };
         bool m_displayServer = false;
         bool m_greeter { false };
+        // overrides the PAM service picked by start()
+        QString m_service;
     };
 }
 
@@ -21,182 +21,300 @@
 #include "HelperApp.h"
 #include "Backend.h"
 #include "Configuration.h"
+#include "LoggingCategories.h"
+#include "LoginId.h"
 #include "UserSession.h"
 #include "SafeDataStream.h"
 
 #include "MessageHandler.h"
 #include "VirtualTerminal.h"
 #include "SignalHandler.h"
+#include "Trace.h"
 
+#include <QtCore/QEventLoop>
 #include <QtCore/QTimer>
 #include <QtCore/QFile>
 #include <QtCore/QDebug>
 #include <QtNetwork/QLocalSocket>
 
 #include <iostream>
+#include <fcntl.h>
 #include <unistd.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 
 #if defined(Q_OS_LINUX)
 #include <utmp.h>
 #endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
 #include <utmpx.h>
 #include <QByteArray>
 #include <signal.h>
 
 namespace SDDM {
-    HelperApp::HelperApp(int& argc, char** argv)
+    HelperApp::HelperApp(int& argc, char** argv, bool greeted)
             : QCoreApplication(argc, argv)
-            , m_backend(Backend::get(this))
-            , m_session(new UserSession(this))
-            , m_socket(new QLocalSocket(this)) {
+            , m_greeted(greeted)
+            , m_socket(new QLocalSocket(this))
+            , m_startEnvironment(QProcessEnvironment::systemEnvironment()) {
         qInstallMessageHandler(HelperMessageHandler);
         SignalHandler *s = new SignalHandler(this);
-        QObject::connect(s, &SignalHandler::sigtermReceived, m_session, [] {
-            QCoreApplication::instance()->exit(-1);
+        QObject::connect(s, &SignalHandler::sigtermReceived, this, [this] {
+            // leave once the session is gone, sessionFinished() takes it from there
+            if (m_session && m_session->state() != QProcess::NotRunning)
+                m_session->stop();
+            else
+                QCoreApplication::instance()->exit(-1);
         });
 
         QTimer::singleShot(0, this, SLOT(setUp()));
     }
 
+    bool HelperApp::sayHello(int argc, char **argv) {
+        int fd = -1;
+        for (int i = 1; i < argc - 1; ++i) {
+            if (qstrcmp(argv[i], "--fd") == 0) {
+                bool ok = false;
+                fd = QByteArray(argv[i + 1]).toInt(&ok);
+                if (!ok)
+                    fd = -1;
+                break;
+            }
+        }
+
+        // setUp() has the complaints about a missing or bogus channel
+        struct stat st;
+        if (fd < 0 || ::fstat(fd, &st) == -1 || !S_ISSOCK(st.st_mode))
+            return false;
+
+        QFile channel;
+        if (!channel.open(fd, QIODevice::WriteOnly | QIODevice::Unbuffered, QFileDevice::DontCloseHandle))
+            return false;
+        SafeDataStream str(&channel);
+        str << Msg::HELLO << HelperProtocolVersion;
+        str.send();
+        return str.status() == QDataStream::Ok;
+    }
+
     void HelperApp::setUp() {
+        Trace::mark("helper-setup");
+
+        // nothing before needed the configuration, the daemon has its
+        // snapshot ready by now
+        mainConfig.load();
+        applyLogRules();
+
         const QStringList args = QCoreApplication::arguments();
-        QString server;
         int pos;
 
-        if ((pos = args.indexOf(QStringLiteral("--socket"))) >= 0) {
+        if ((pos = args.indexOf(QStringLiteral("--fd"))) >= 0) {
             if (pos >= args.length() - 1) {
                 qCritical() << "This application is not supposed to be executed manually";
                 exit(Auth::HELPER_OTHER_ERROR);
                 return;
             }
-            server = args[pos + 1];
+            bool ok = false;
+            m_fd = args[pos + 1].toInt(&ok);
+            if (!ok)
+                m_fd = -1;
         }
 
-        if ((pos = args.indexOf(QStringLiteral("--id"))) >= 0) {
+        if ((pos = args.indexOf(QStringLiteral("--start"))) >= 0) {
             if (pos >= args.length() - 1) {
                 qCritical() << "This application is not supposed to be executed manually";
                 exit(Auth::HELPER_OTHER_ERROR);
                 return;
             }
-            m_id = QString(args[pos + 1]).toLongLong();
+            session()->setPath(args[pos + 1]);
         }
 
-        if ((pos = args.indexOf(QStringLiteral("--start"))) >= 0) {
+        if ((pos = args.indexOf(QStringLiteral("--user"))) >= 0) {
             if (pos >= args.length() - 1) {
                 qCritical() << "This application is not supposed to be executed manually";
                 exit(Auth::HELPER_OTHER_ERROR);
                 return;
             }
-            m_session->setPath(args[pos + 1]);
+            m_user = args[pos + 1];
         }
 
-        if ((pos = args.indexOf(QStringLiteral("--user"))) >= 0) {
+        if ((pos = args.indexOf(QStringLiteral("--display-server"))) >= 0) {
             if (pos >= args.length() - 1) {
                 qCritical() << "This application is not supposed to be executed manually";
                 exit(Auth::HELPER_OTHER_ERROR);
                 return;
             }
-            m_user = args[pos + 1];
+            session()->setDisplayServerCommand(args[pos + 1]);
+            backend()->setDisplayServer(true);
         }
 
-        if ((pos = args.indexOf(QStringLiteral("--display-server"))) >= 0) {
+        if ((pos = args.indexOf(QStringLiteral("--autologin"))) >= 0) {
+            backend()->setAutologin(true);
+        }
+
+        if ((pos = args.indexOf(QStringLiteral("--greeter"))) >= 0) {
+            backend()->setGreeter(true);
+        }
+
+        if ((pos = args.indexOf(QStringLiteral("--service"))) >= 0) {
             if (pos >= args.length() - 1) {
                 qCritical() << "This application is not supposed to be executed manually";
                 exit(Auth::HELPER_OTHER_ERROR);
                 return;
             }
-            m_session->setDisplayServerCommand(args[pos + 1]);
-            m_backend->setDisplayServer(true);
+            backend()->setService(args[pos + 1]);
         }
 
-        if ((pos = args.indexOf(QStringLiteral("--autologin"))) >= 0) {
-            m_backend->setAutologin(true);
+        if ((pos = args.indexOf(QStringLiteral("--id"))) >= 0) {
+            if (pos >= args.length() - 1) {
+                qCritical() << "This application is not supposed to be executed manually";
+                exit(Auth::HELPER_OTHER_ERROR);
+                return;
+            }
+            LoginId::set(args[pos + 1]);
         }
 
-        if ((pos = args.indexOf(QStringLiteral("--greeter"))) >= 0) {
-            m_backend->setGreeter(true);
+        if ((pos = args.indexOf(QStringLiteral("--pool"))) >= 0) {
+            m_pooled = true;
         }
 
-        if (server.isEmpty() || m_id <= 0) {
+        // the channel is inherited, keep it from the session
+        if (m_fd < 0 || ::fcntl(m_fd, F_SETFD, FD_CLOEXEC) == -1) {
             qCritical() << "This application is not supposed to be executed manually";
             exit(Auth::HELPER_OTHER_ERROR);
             return;
         }
 
-        connect(m_socket, &QLocalSocket::connected, this, &HelperApp::doAuth);
-        connect(m_session, &UserSession::finished, this, &HelperApp::sessionFinished);
-        m_socket->connectToServer(server, QIODevice::ReadWrite | QIODevice::Unbuffered);
+        if (!m_socket->setSocketDescriptor(m_fd, QLocalSocket::ConnectedState, QIODevice::ReadWrite | QIODevice::Unbuffered)) {
+            qCritical() << "Failed to use the channel to the daemon:" << m_socket->errorString();
+            exit(Auth::HELPER_OTHER_ERROR);
+            return;
+        }
+
+        doAuth();
     }
 
     void HelperApp::doAuth() {
+        if (!m_greeted) {
+            SafeDataStream str(m_socket);
+            str << Msg::HELLO << HelperProtocolVersion;
+            str.send();
+            if (str.status() != QDataStream::Ok)
+                qCritical() << "Couldn't write initial message:" << str.status();
+        }
+
+        // wait for the daemon to tell us what to do
+        if (m_pooled) {
+            connect(m_socket, &QLocalSocket::readyRead, this, &HelperApp::assigned);
+            return;
+        }
+
+        startAuth();
+    }
+
+    void HelperApp::assigned() {
+        disconnect(m_socket, &QLocalSocket::readyRead, this, &HelperApp::assigned);
+
+        Msg m = Msg::MSG_UNKNOWN;
+        QString sessionPath, displayServerCmd, service, loginId;
+        bool autologin = false, greeter = false;
         SafeDataStream str(m_socket);
-        str << Msg::HELLO << m_id;
-        str.send();
-        if (str.status() != QDataStream::Ok)
-            qCritical() << "Couldn't write initial message:" << str.status();
+        str.receive();
+        str >> m >> sessionPath >> m_user >> autologin >> displayServerCmd >> greeter >> service >> loginId;
+        if (m != ASSIGN || str.status() != QDataStream::Ok) {
+            qCritical() << "Received a wrong opcode instead of ASSIGN:" << m;
+            exit(Auth::HELPER_OTHER_ERROR);
+            return;
+        }
 
-        if (!m_backend->start(m_user)) {
+        if (!sessionPath.isEmpty())
+            session()->setPath(sessionPath);
+        if (!displayServerCmd.isEmpty()) {
+            session()->setDisplayServerCommand(displayServerCmd);
+            backend()->setDisplayServer(true);
+        }
+        if (autologin)
+            backend()->setAutologin(true);
+        if (greeter)
+            backend()->setGreeter(true);
+        if (!service.isEmpty())
+            backend()->setService(service);
+        LoginId::set(loginId);
+
+        startAuth();
+    }
+
+    void HelperApp::startAuth() {
+        UserSession *session = this->session();
+        Backend *backend = this->backend();
+
+        // resolve the account while PAM talks to the user
+        if (!m_user.isEmpty() && !session->path().isEmpty())
+            session->prepare(m_user);
+
+        if (!backend->start(m_user)) {
             authenticated(QString());
 
             // write failed login to btmp
-            const QProcessEnvironment env = m_session->processEnvironment();
+            const SessionEnvironment &env = session->environment();
             const QString displayId = env.value(QStringLiteral("DISPLAY"));
             const QString vt = env.value(QStringLiteral("XDG_VTNR"));
             utmpLogin(vt, displayId, m_user, 0, false);
+            m_utmp.flush();
 
             exit(Auth::HELPER_AUTH_ERROR);
             return;
         }
 
         Q_ASSERT(getuid() == 0);
-        if (!m_backend->authenticate()) {
+        if (!backend->authenticate()) {
             authenticated(QString());
 
             // write failed login to btmp
-            const QProcessEnvironment env = m_session->processEnvironment();
+            const SessionEnvironment &env = session->environment();
             const QString displayId = env.value(QStringLiteral("DISPLAY"));
             const QString vt = env.value(QStringLiteral("XDG_VTNR"));
             utmpLogin(vt, displayId, m_user, 0, false);
+            m_utmp.flush();
 
             exit(Auth::HELPER_AUTH_ERROR);
             return;
         }
 
-        m_user = m_backend->userName();
-        QProcessEnvironment env = authenticated(m_user);
+        m_user = backend->userName();
+        Trace::mark("helper-authenticated", m_user);
+        SessionEnvironment &env = session->environment();
+        env.insert(SessionEnvironment::Daemon, authenticated(m_user));
 
         if (env.value(QStringLiteral("XDG_SESSION_CLASS")) == QLatin1String("greeter")) {
-            for (const auto &entry : mainConfig.GreeterEnvironment.get()) {
+            for (const auto &entry : mainConfig.GreeterEnvironment.ref()) {
                 const int index = entry.indexOf(QLatin1Char('='));
                 if (index < 0) {
                     qWarning() << "Malformed environment variable" << entry;
                     continue;
                 }
-                env.insert(entry.left(index), entry.mid(index + 1));
+                env.insert(SessionEnvironment::Greeter, entry.left(index), entry.mid(index + 1));
             }
         }
 
-        if (!m_session->path().isEmpty()) {
-            env.insert(m_session->processEnvironment());
-            m_session->setProcessEnvironment(env);
-
-            if (!m_backend->openSession()) {
+        if (!session->path().isEmpty()) {
+            if (!backend->openSession()) {
                 sessionOpened(false);
                 exit(Auth::HELPER_SESSION_ERROR);
                 return;
             }
 
+            Trace::mark("helper-session-opened", m_user);
             sessionOpened(true);
 
             // write successful login to utmp/wtmp
-            const QProcessEnvironment env = m_session->processEnvironment();
             const QString displayId = env.value(QStringLiteral("DISPLAY"));
             const QString vt = env.value(QStringLiteral("XDG_VTNR"));
             if (env.value(QStringLiteral("XDG_SESSION_CLASS")) != QLatin1String("greeter")) {
                 // cache pid for session end
-                utmpLogin(vt, displayId, m_user, m_session->processId(), true);
+                utmpLogin(vt, displayId, m_user, session->processId(), true);
             }
         }
         else
@@ -205,10 +323,43 @@ namespace SDDM {
     }
 
     void HelperApp::sessionFinished(int status) {
+        // the display is stopped once we are gone, the login records
+        // are out by then
+        m_utmp.flush();
         exit(status);
     }
 
+    static long residentKiB() {
+        QFile statm(QStringLiteral("/proc/self/statm"));
+        if (!statm.open(QIODevice::ReadOnly))
+            return -1;
+        const QList<QByteArray> fields = statm.readAll().split(' ');
+        if (fields.size() < 2)
+            return -1;
+        return fields.at(1).toLong() * (::sysconf(_SC_PAGESIZE) / 1024);
+    }
+
+    void HelperApp::compact() {
+        // from here on the helper only waits for the session to end, it
+        // stays around as long as the session does, once per login
+        const long before = residentKiB();
+
+        // the daemon got everything it needs, it watches the process
+        // and stops it with a signal
+        m_socket->abort();
+        m_startEnvironment = QProcessEnvironment();
+        mainConfig.unload();
+#if defined(__GLIBC__)
+        ::malloc_trim(0);
+#endif
+
+        qDebug() << "Compacted the helper from" << before << "KiB to" << residentKiB() << "KiB";
+    }
+
     void HelperApp::info(const QString& message, Auth::Info type) {
+        // closing the session may still talk, with nobody to listen
+        if (!m_socket->isOpen())
+            return;
         SafeDataStream str(m_socket);
         str << Msg::INFO << message << type;
         str.send();
@@ -216,38 +367,49 @@ namespace SDDM {
     }
 
     void HelperApp::error(const QString& message, Auth::Error type) {
+        if (!m_socket->isOpen())
+            return;
         SafeDataStream str(m_socket);
         str << Msg::ERROR << message << type;
         str.send();
         m_socket->waitForBytesWritten();
     }
 
-    Request HelperApp::request(const Request& request) {
+    Request HelperApp::request(const Request& request, QList<QByteArray> *credentials) {
         Msg m = Msg::MSG_UNKNOWN;
         Request response;
+        QList<QByteArray> pending;
+        if (!m_socket->isOpen())
+            return response;
         SafeDataStream str(m_socket);
         str << Msg::REQUEST << request;
         str.send();
         str.receive();
-        str >> m >> response;
+        str >> m >> response >> pending;
         if (m != REQUEST) {
             response = Request();
+            pending.clear();
             qCritical() << "Received a wrong opcode instead of REQUEST:" << m;
         }
+        if (credentials)
+            *credentials = pending;
         return response;
     }
 
     QProcessEnvironment HelperApp::authenticated(const QString &user) {
         Msg m = Msg::MSG_UNKNOWN;
         QProcessEnvironment env;
+        EnvironmentDelta delta;
         SafeDataStream str(m_socket);
         str << Msg::AUTHENTICATED << user;
         str.send();
         if (user.isEmpty())
             return env;
         str.receive();
-        str >> m >> env >> m_cookie;
-        if (m != AUTHENTICATED) {
+        str >> m >> delta >> m_cookie;
+        // the daemon only sends what differs from our own environment
+        env = delta.apply(m_startEnvironment);
+        if (m != AUTHENTICATED || str.status() != QDataStream::Ok) {
             env = QProcessEnvironment();
             m_cookie = QString();
             qCritical() << "Received a wrong opcode instead of AUTHENTICATED:" << m;
@@ -281,9 +443,20 @@ namespace SDDM {
     }
 
     UserSession *HelperApp::session() {
+        if (!m_session) {
+            m_session = new UserSession(this);
+            connect(m_session, &UserSession::finished, this, &HelperApp::sessionFinished);
+            connect(m_session, &QProcess::started, this, &HelperApp::compact);
+        }
         return m_session;
     }
 
+    Backend *HelperApp::backend() {
+        if (!m_backend)
+            m_backend = Backend::get(this);
+        return m_backend;
+    }
+
     const QString& HelperApp::user() const {
         return m_user;
     }
@@ -295,7 +468,18 @@ namespace SDDM {
     HelperApp::~HelperApp() {
         Q_ASSERT(getuid() == 0);
 
-        m_session->stop();
+        // assigned nothing, there is nothing to close
+        if (!m_session || !m_backend)
+            return;
+
+        // left the event loop with the session still running
+        if (m_session->state() != QProcess::NotRunning) {
+            disconnect(m_session, &UserSession::finished, this, &HelperApp::sessionFinished);
+            QEventLoop loop;
+            connect(m_session, &UserSession::finished, &loop, &QEventLoop::quit);
+            m_session->stop();
+            loop.exec();
+        }
         m_backend->closeSession();
 
         // write logout to utmp/wtmp
@@ -303,11 +487,12 @@ namespace SDDM {
         if (pid < 0) {
             return;
         }
-        QProcessEnvironment env = m_session->processEnvironment();
+        const SessionEnvironment &env = m_session->environment();
         if (env.value(QStringLiteral("XDG_SESSION_CLASS")) != QLatin1String("greeter")) {
             QString vt = env.value(QStringLiteral("XDG_VTNR"));
             QString displayId = env.value(QStringLiteral("DISPLAY"));
             utmpLogout(vt, displayId, pid);
+            m_utmp.flush();
         }
     }
 
@@ -342,26 +527,11 @@ namespace SDDM {
         entry.ut_tv.tv_sec = tv.tv_sec;
         entry.ut_tv.tv_usec = tv.tv_usec;
 
-        // write to utmp
-        setutxent();
-        if (!pututxline (&entry))
-            qWarning() << "Failed to write utmpx: " << strerror(errno);
-        endutxent();
-
+        // write to utmp, and append to wtmp or the failed login database btmp
 #if !defined(Q_OS_FREEBSD)
-        // append to failed login database btmp
-        if (!authSuccessful) {
-#if defined(Q_OS_LINUX)
-            updwtmpx("/var/log/btmp", &entry);
-#endif
-        }
-
-        // append to wtmp
-        else {
-#if defined(Q_OS_LINUX)
-            updwtmpx("/var/log/wtmp", &entry);
-#endif
-        }
+        m_utmp.write(entry, authSuccessful ? UtmpWriter::Wtmp : UtmpWriter::Btmp);
+#else
+        m_utmp.write(entry, UtmpWriter::NoLog);
 #endif
     }
 
@@ -391,22 +561,15 @@ namespace SDDM {
         entry.ut_tv.tv_sec = tv.tv_sec;
         entry.ut_tv.tv_usec = tv.tv_usec;
 
-        // write to utmp
-        setutxent();
-        if (!pututxline (&entry))
-            qWarning() << "Failed to write utmpx: " << strerror(errno);
-        endutxent();
-
-#if defined(Q_OS_LINUX)
-        // append to wtmp
-        updwtmpx("/var/log/wtmp", &entry);
-#elif defined(Q_OS_FREEBSD)
-        pututxline(&entry);
-#endif
+        // write to utmp and append to wtmp
+        m_utmp.write(entry, UtmpWriter::Wtmp);
     }
 }
 
 int main(int argc, char** argv) {
-    SDDM::HelperApp app(argc, argv);
+    // the daemon times the spawn until HELLO, the rest of the start up
+    // follows while it reads it
+    const bool greeted = SDDM::HelperApp::sayHello(argc, argv);
+    SDDM::HelperApp app(argc, argv, greeted);
     return app.exec();
 }
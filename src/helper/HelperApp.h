@@ -25,6 +25,7 @@
 #include <QtCore/QProcessEnvironment>
 
 #include "AuthMessages.h"
+#include "UtmpWriter.h"
 
 class QLocalSocket;
 
@@ -35,15 +36,22 @@ namespace SDDM {
     {
         Q_OBJECT
     public:
-        HelperApp(int& argc, char** argv);
+        // @p greeted tells whether sayHello() already got through
+        HelperApp(int& argc, char** argv, bool greeted = false);
         virtual ~HelperApp();
 
+        // sends HELLO on the --fd channel straight from main(), before
+        // Qt and the configuration are set up
+        static bool sayHello(int argc, char **argv);
+
+        // created on first use, a pooled helper only needs them once
+        // the daemon assigned it a login
         UserSession *session();
         const QString &user() const;
         const QString &cookie() const;
 
     public slots:
-        Request request(const Request &request);
+        Request request(const Request &request, QList<QByteArray> *credentials = nullptr);
         void info(const QString &message, Auth::Info type);
         void error(const QString &message, Auth::Error type);
         QProcessEnvironment authenticated(const QString &user);
@@ -53,17 +61,31 @@ namespace SDDM {
     private slots:
         void setUp();
         void doAuth();
+        void assigned();
+        void startAuth();
 
         void sessionFinished(int status);
+        void compact();
 
     private:
-        qint64 m_id { -1 };
+        Backend *backend();
+
+        // our end of the socketpair the daemon started us with
+        int m_fd { -1 };
+        // started ahead of time, waiting for the daemon to assign work
+        bool m_pooled { false };
+        // HELLO went out from main() already
+        bool m_greeted { false };
         Backend *m_backend { nullptr };
         UserSession *m_session { nullptr };
         QLocalSocket *m_socket { nullptr };
         QString m_user { };
         // TODO: get rid of this in a nice clean way along the way with moving to user session X server
         QString m_cookie { };
+        // what the daemon started us with, the session environment is sent relative to it
+        QProcessEnvironment m_startEnvironment;
+        // written out when the helper is destroyed at the latest
+        UtmpWriter m_utmp;
 
         /*!
          \brief Write utmp/wtmp/btmp records when a user logs in
@@ -0,0 +1,508 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+/**
+ * Sets up the process of a session the way sddm-helper laid it out and
+ * executes the session: sddm-helper-exec [options] -- program [args...]
+ *
+ * It is executed right after the fork of sddm-helper, so that nothing
+ * of Qt runs between fork and exec. Of Qt it only uses the VT handling
+ * shared with the daemon. The options come from
+ * UserSession::prepareChild() and are applied in order:
+ *
+ *   --vt N             take /dev/ttyN as the controlling terminal and stdin
+ *   --vt-auto          let the kernel switch away from the VT, for X11
+ *   --namespace PATH   enter the Linux namespace bound to PATH
+ *   --cgroup-procs, --sched-policy, --nice, --io-priority
+ *                      see ProcessPolicy::arguments()
+ *   --user NAME --uid N --gid N --groups N,N... --home DIR
+ *   --journal ID       send the output to the journal as ID
+ *   --log FILE         write the error output to FILE
+ *   --log-dir DIR      create DIR before opening the log
+ *   --cookie-fd N      read the X cookie from N and add it to $XAUTHORITY
+ *   --xauth PATH       xauth, for displays the file isn't written for
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <grp.h>
+#include <pwd.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#ifdef __FreeBSD__
+#include <login_cap.h>
+#endif
+#ifdef HAVE_JOURNALD
+#include <systemd/sd-journal.h>
+#include <syslog.h>
+#endif
+
+#include <string>
+#include <vector>
+
+#include "VirtualTerminal.h"
+
+// Auth::HelperExitStatus, what the helper reports for a session that
+// couldn't be set up or started
+static const int ExitSessionFailed = 2;
+static const int ExitSetupFailed = 3;
+
+static const char *s_program = "sddm-helper-exec";
+
+#define warn(format, ...) fprintf(stderr, "%s: " format "\n", s_program, ##__VA_ARGS__)
+
+[[noreturn]] static void fail(const char *what, const char *argument) {
+    warn("%s(%s) failed: %s", what, argument, strerror(errno));
+    _exit(ExitSetupFailed);
+}
+
+struct Options {
+    int vt { 0 };
+    bool vtAuto { false };
+    std::vector<std::string> namespaces;
+
+    std::string cgroupProcs;
+    int schedPolicy { -1 };
+    bool setNice { false };
+    int nice { 0 };
+    int ioPriority { -1 };
+
+    std::string user;
+    uid_t uid { 0 };
+    gid_t gid { 0 };
+    bool userSet { false };
+    std::vector<gid_t> groups;
+    bool groupsSet { false };
+    std::string home;
+
+    std::string journalIdentifier;
+    std::string log;
+    std::vector<std::string> logDirs;
+    int cookieFd { -1 };
+    std::string xauth;
+
+    char **command { nullptr };
+};
+
+static bool parseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string option = argv[i];
+        if (option == "--") {
+            if (i + 1 >= argc)
+                return false;
+            options.command = argv + i + 1;
+            return true;
+        }
+        if (option == "--vt-auto") {
+            options.vtAuto = true;
+            continue;
+        }
+
+        // the rest takes a value
+        if (i + 1 >= argc)
+            return false;
+        const char *value = argv[++i];
+
+        if (option == "--vt") {
+            options.vt = atoi(value);
+        } else if (option == "--namespace") {
+            options.namespaces.push_back(value);
+        } else if (option == "--cgroup-procs") {
+            options.cgroupProcs = value;
+        } else if (option == "--sched-policy") {
+            options.schedPolicy = atoi(value);
+        } else if (option == "--nice") {
+            options.setNice = true;
+            options.nice = atoi(value);
+        } else if (option == "--io-priority") {
+            options.ioPriority = atoi(value);
+        } else if (option == "--user") {
+            options.user = value;
+        } else if (option == "--uid") {
+            options.uid = uid_t(strtoul(value, nullptr, 10));
+            options.userSet = true;
+        } else if (option == "--gid") {
+            options.gid = gid_t(strtoul(value, nullptr, 10));
+        } else if (option == "--groups") {
+            options.groupsSet = true;
+            for (const char *p = value; *p; ) {
+                char *end = nullptr;
+                options.groups.push_back(gid_t(strtoul(p, &end, 10)));
+                p = *end == ',' ? end + 1 : end;
+                if (end == p && *p)
+                    return false;
+            }
+        } else if (option == "--home") {
+            options.home = value;
+        } else if (option == "--journal") {
+            options.journalIdentifier = value;
+        } else if (option == "--log") {
+            options.log = value;
+        } else if (option == "--log-dir") {
+            options.logDirs.push_back(value);
+        } else if (option == "--cookie-fd") {
+            options.cookieFd = atoi(value);
+        } else if (option == "--xauth") {
+            options.xauth = value;
+        } else {
+            return false;
+        }
+    }
+    return false;
+}
+
+// the policy part of ProcessPolicy::apply()
+static void applyPolicy(const Options &options) {
+    if (!options.cgroupProcs.empty()) {
+        const int fd = ::open(options.cgroupProcs.c_str(), O_WRONLY | O_CLOEXEC);
+        if (fd == -1 || ::write(fd, "0", 1) != 1)
+            warn("Failed to move to %s: %s", options.cgroupProcs.c_str(), strerror(errno));
+        if (fd != -1)
+            ::close(fd);
+    }
+
+    if (options.schedPolicy != -1) {
+        struct sched_param param;
+        param.sched_priority = 0;
+        if (sched_setscheduler(0, options.schedPolicy, &param) != 0)
+            warn("Failed to set the scheduling policy to %d: %s", options.schedPolicy, strerror(errno));
+    }
+
+    if (options.setNice && setpriority(PRIO_PROCESS, 0, options.nice) != 0)
+        warn("Failed to set the nice level to %d: %s", options.nice, strerror(errno));
+
+#ifdef __linux__
+    // IOPRIO_WHO_PROCESS
+    if (options.ioPriority != -1 && syscall(SYS_ioprio_set, 1, 0, options.ioPriority) != 0)
+        warn("Failed to set the IO priority to %x: %s", options.ioPriority, strerror(errno));
+#endif
+}
+
+static std::string readAll(int fd) {
+    std::string data;
+    char buffer[256];
+    for (;;) {
+        const ssize_t count = ::read(fd, buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            break;
+        data.append(buffer, size_t(count));
+    }
+    return data;
+}
+
+static bool writeAll(int fd, const std::string &data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        const ssize_t result = ::write(fd, data.data() + written, data.size() - written);
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result < 0)
+            return false;
+        written += size_t(result);
+    }
+    return true;
+}
+
+// an Xauthority record, see Xau(3) and XAuth.cpp
+struct XAuthEntry {
+    unsigned family { 0 };
+    std::string address, number, name, data;
+};
+
+static const unsigned FamilyLocal = 256;
+static const unsigned FamilyWild = 65535;
+
+static bool readField(const std::string &in, size_t &pos, std::string &field) {
+    if (pos + 2 > in.size())
+        return false;
+    const size_t length = (size_t(uint8_t(in[pos])) << 8) | uint8_t(in[pos + 1]);
+    pos += 2;
+    if (pos + length > in.size())
+        return false;
+    field = in.substr(pos, length);
+    pos += length;
+    return true;
+}
+
+static void appendField(std::string &out, const std::string &field) {
+    out += char((field.size() >> 8) & 0xff);
+    out += char(field.size() & 0xff);
+    out += field;
+}
+
+static std::string fromHex(const std::string &hex) {
+    std::string bytes;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2)
+        bytes += char(strtoul(hex.substr(i, 2).c_str(), nullptr, 16));
+    return bytes;
+}
+
+static void redirect(int fd, int target) {
+    if (fd < 0)
+        return;
+    dup2(fd, target);
+    ::close(fd);
+}
+
+static bool addCookieWithXauth(const std::string &xauth, const char *display, const char *file, const std::string &cookie) {
+    if (xauth.empty())
+        return false;
+
+    // touch the file, xauth doesn't create it
+    const int fd = ::open(file, O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+    if (fd >= 0)
+        ::close(fd);
+
+    // no shell in between, the path of the file is the user's to pick
+    int input[2];
+    if (::pipe(input) != 0)
+        return false;
+
+    const pid_t pid = ::fork();
+    if (pid < 0) {
+        ::close(input[0]);
+        ::close(input[1]);
+        return false;
+    }
+    if (pid == 0) {
+        ::close(input[1]);
+        redirect(input[0], STDIN_FILENO);
+        const char *args[] = { xauth.c_str(), "-f", file, "-q", nullptr };
+        ::execvp(args[0], const_cast<char **>(args));
+        _exit(127);
+    }
+    ::close(input[0]);
+
+    // an xauth that died early must not take us along
+    struct sigaction ignore {}, previous {};
+    ignore.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &ignore, &previous);
+    const std::string commands = std::string("remove ") + display + "\n"
+            + "add " + display + " . " + cookie + "\n"
+            + "exit\n";
+    const bool written = writeAll(input[1], commands);
+    ::close(input[1]);
+    sigaction(SIGPIPE, &previous, nullptr);
+
+    int status = 0;
+    while (::waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR)
+            return false;
+    }
+    return written && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// XAuth::addCookieToFile(), as the user
+static bool addCookie(const std::string &xauth, const std::string &cookie) {
+    const char *display = getenv("DISPLAY");
+    const char *file = getenv("XAUTHORITY");
+    if (!display || !file)
+        return false;
+
+    // the directory of the file may not be there yet
+    const std::string path = file;
+    for (size_t slash = path.find('/', 1); slash != std::string::npos; slash = path.find('/', slash + 1))
+        ::mkdir(path.substr(0, slash).c_str(), 0777);
+
+    // only local displays, like the ones we start, are handled here
+    std::string number = display;
+    if (number.rfind(':') != 0)
+        return addCookieWithXauth(xauth, display, file, cookie);
+    number = number.substr(1, number.find('.') - 1);
+    if (number.empty() || number.find_first_not_of("0123456789") != std::string::npos)
+        return addCookieWithXauth(xauth, display, file, cookie);
+
+    char hostName[256] = { 0 };
+    if (::gethostname(hostName, sizeof(hostName) - 1) != 0)
+        return addCookieWithXauth(xauth, display, file, cookie);
+
+    std::vector<XAuthEntry> entries;
+    const int in = ::open(file, O_RDONLY | O_CLOEXEC);
+    if (in >= 0) {
+        const std::string contents = readAll(in);
+        ::close(in);
+        size_t pos = 0;
+        while (pos < contents.size()) {
+            XAuthEntry entry;
+            if (pos + 2 > contents.size())
+                return addCookieWithXauth(xauth, display, file, cookie);
+            entry.family = (unsigned(uint8_t(contents[pos])) << 8) | uint8_t(contents[pos + 1]);
+            pos += 2;
+            if (!readField(contents, pos, entry.address) || !readField(contents, pos, entry.number)
+                    || !readField(contents, pos, entry.name) || !readField(contents, pos, entry.data))
+                return addCookieWithXauth(xauth, display, file, cookie);
+            // same as "xauth remove", drop whatever was there for this display
+            if ((entry.family == FamilyLocal || entry.family == FamilyWild) && entry.address == hostName && entry.number == number)
+                continue;
+            entries.push_back(entry);
+        }
+    } else if (errno != ENOENT) {
+        return addCookieWithXauth(xauth, display, file, cookie);
+    }
+
+    XAuthEntry entry;
+    entry.family = FamilyLocal;
+    entry.address = hostName;
+    entry.number = number;
+    entry.name = "MIT-MAGIC-COOKIE-1";
+    entry.data = fromHex(cookie);
+    entries.push_back(entry);
+
+    std::string contents;
+    for (const XAuthEntry &e : entries) {
+        contents += char((e.family >> 8) & 0xff);
+        contents += char(e.family & 0xff);
+        appendField(contents, e.address);
+        appendField(contents, e.number);
+        appendField(contents, e.name);
+        appendField(contents, e.data);
+    }
+
+    // written next to the file and renamed over it
+    const std::string tempPath = std::string(file) + "-n";
+    ::unlink(tempPath.c_str());
+    const int out = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (out < 0)
+        return false;
+    const bool written = writeAll(out, contents);
+    ::close(out);
+    if (!written || ::rename(tempPath.c_str(), file) != 0) {
+        ::unlink(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        warn("This application is not supposed to be executed manually");
+        return ExitSetupFailed;
+    }
+
+    if (options.vt > 0) {
+        // the VT becomes stdin, which keeps it open without races
+        const std::string tty = "/dev/tty" + std::to_string(options.vt);
+        const int vtFd = ::open(tty.c_str(), O_RDWR | O_NOCTTY);
+        const bool takeControl = vtFd >= 0;
+        redirect(takeControl ? vtFd : ::open("/dev/null", O_RDWR), STDIN_FILENO);
+
+        if (setsid() < 0)
+            fail("setsid", "");
+        if (takeControl && ioctl(STDIN_FILENO, TIOCSCTTY) < 0)
+            fail("TIOCSCTTY", tty.c_str());
+
+        SDDM::VirtualTerminal::jumpToVt(options.vt, options.vtAuto);
+    } else if (setpgid(0, 0) < 0) {
+        // a group of its own so that stopping it reaches all of the session
+        warn("Failed to become a process group leader: %s", strerror(errno));
+    }
+
+#ifdef __linux__
+    for (const std::string &ns : options.namespaces) {
+        const int fd = ::open(ns.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            fail("open", ns.c_str());
+        if (setns(fd, 0) != 0)
+            fail("setns", ns.c_str());
+        ::close(fd);
+    }
+#endif
+
+    // still privileged enough to raise priorities
+    applyPolicy(options);
+
+    // the cookie is read while the pipe is ours, and written as the user
+    std::string cookie;
+    if (options.cookieFd >= 0) {
+        cookie = readAll(options.cookieFd);
+        ::close(options.cookieFd);
+    }
+
+    if (options.userSet) {
+#ifdef __FreeBSD__
+        // login.conf applies to the environment prepared by the helper,
+        // what setusercontext() sets here is ignored by execve()
+        struct passwd *pw = getpwnam(options.user.c_str());
+        if (!pw || setusercontext(NULL, pw, options.uid, LOGIN_SETALL) != 0)
+            fail("setusercontext", options.user.c_str());
+#else
+        if (setgid(options.gid) != 0)
+            fail("setgid", options.user.c_str());
+        if (options.groupsSet) {
+            if (!options.groups.empty() && setgroups(options.groups.size(), options.groups.data()) != 0)
+                fail("setgroups", options.user.c_str());
+        } else if (initgroups(options.user.c_str(), options.gid) != 0) {
+            fail("initgroups", options.user.c_str());
+        }
+        if (setuid(options.uid) != 0)
+            fail("setuid", options.user.c_str());
+#endif
+    }
+    if (!options.home.empty() && chdir(options.home.c_str()) != 0)
+        fail("chdir", options.home.c_str());
+
+#ifdef HAVE_JOURNALD
+    // connected as the user, so that the output shows up in their journal
+    if (!options.journalIdentifier.empty()) {
+        const int fd = sd_journal_stream_fd(options.journalIdentifier.c_str(), LOG_INFO, 0);
+        if (fd >= 0) {
+            dup2(fd, STDOUT_FILENO);
+            redirect(fd, STDERR_FILENO);
+        } else {
+            warn("Could not connect the session output to the journal: %s", strerror(-fd));
+        }
+    }
+#endif
+
+    if (!options.log.empty()) {
+        // opened as the user, so that the log is owned by them
+        for (const std::string &dir : options.logDirs)
+            ::mkdir(dir.c_str(), 0777);
+
+        const int fd = ::open(options.log.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd < 0)
+            warn("Could not open stderr to %s: %s", options.log.c_str(), strerror(errno));
+        redirect(fd, STDERR_FILENO);
+        redirect(::open("/dev/null", O_WRONLY | O_CLOEXEC), STDOUT_FILENO);
+    }
+
+    // as the user, which is what home directories on root squashing
+    // network mounts require
+    if (!cookie.empty() && !addCookie(options.xauth, cookie))
+        warn("Failed to add the X cookie to %s", getenv("XAUTHORITY") ? getenv("XAUTHORITY") : "(unset)");
+
+    execvp(options.command[0], options.command);
+    warn("Failed to execute %s: %s", options.command[0], strerror(errno));
+    return ExitSessionFailed;
+}
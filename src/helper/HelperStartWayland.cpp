@@ -21,6 +21,9 @@
 /**
  * This application sole purpose is to launch a wayland compositor (first
  * argument) and as soon as it's set up to launch a client (second argument)
+ *
+ * With --persistent before them, a client which fails is launched again
+ * in the same compositor.
  */
 
 #include <unistd.h>
@@ -45,7 +48,11 @@ int main(int argc, char** argv)
     });
 
     Q_ASSERT(::getuid() != 0);
-    if (argc != 3) {
+    QStringList arguments = app.arguments().mid(1);
+    const bool persistent = !arguments.isEmpty() && arguments.first() == QLatin1String("--persistent");
+    if (persistent)
+        arguments.removeFirst();
+    if (arguments.size() != 2) {
         QTextStream(stderr) << "Wrong number of arguments\n";
         return 1;
     }
@@ -61,7 +68,8 @@ int main(int argc, char** argv)
         app.exit(2);
     });
 
-    helper.startCompositor(app.arguments()[1]);
-    helper.startGreeter(app.arguments()[2]);
+    helper.setPersistent(persistent);
+    helper.startCompositor(arguments.at(0));
+    helper.startGreeter(arguments.at(1));
     return app.exec();
 }
@@ -30,6 +30,7 @@
 #include <QDebug>
 #include "xorguserhelper.h"
 #include "MessageHandler.h"
+#include "ProcessSupervisor.h"
 #include <signal.h>
 #include "SignalHandler.h"
 
@@ -67,8 +68,12 @@ int main(int argc, char** argv)
         process->setProgram(args.takeFirst());
         process->setArguments(args);
         process->setProcessEnvironment(helper.sessionEnvironment());
-        process->start();
         QObject::connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), &app, &QCoreApplication::quit);
+        QObject::connect(ProcessSupervisor::of(process), &ProcessSupervisor::failedToStart, &app, [](const QString &error) {
+            qWarning() << "Failed to start the greeter:" << error;
+            QCoreApplication::quit();
+        });
+        process->start();
     });
 
     helper.start(app.arguments()[1]);
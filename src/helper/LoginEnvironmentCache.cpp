@@ -0,0 +1,220 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "LoginEnvironmentCache.h"
+
+#include "Constants.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QSocketNotifier>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pwd.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace SDDM {
+    static const quint32 s_cacheMagic = 0x5344454e; // SDEN
+    static const qint32 s_cacheVersion = 1;
+    // more than any sane environment, the pipe is written by the user
+    static const int s_maxCaptureSize = 1024 * 1024;
+
+    // what login shells read, relative paths are in the home directory
+    static const char *const s_profileFiles[] = {
+        "/etc/profile", "/etc/profile.d", "/etc/bashrc", "/etc/bash.bashrc",
+        "/etc/zshenv", "/etc/zsh/zshenv", "/etc/zprofile", "/etc/zsh/zprofile", "/etc/zlogin", "/etc/zsh/zlogin",
+        "/etc/csh.cshrc", "/etc/csh.login",
+        "/etc/fish/config.fish", "/etc/fish/conf.d",
+        ".profile", ".bash_profile", ".bash_login", ".bashrc",
+        ".zshenv", ".zprofile", ".zlogin",
+        ".cshrc", ".tcshrc", ".login",
+        ".config/fish/config.fish", ".config/fish/conf.d",
+    };
+
+    static void stampFile(QDataStream &out, const QByteArray &path, bool entries) {
+        struct stat st;
+        if (::stat(path.constData(), &st) != 0) {
+            out << path << false;
+            return;
+        }
+        out << path << true << qint64(st.st_mtim.tv_sec) << qint64(st.st_mtim.tv_nsec)
+            << qint64(st.st_size) << quint64(st.st_ino);
+
+        // a drop-in directory changes with every file in it
+        if (entries && S_ISDIR(st.st_mode)) {
+            const QDir dir(QString::fromLocal8Bit(path));
+            const QStringList names = dir.entryList(QDir::Files | QDir::NoDotAndDotDot, QDir::Name);
+            for (const QString &name : names)
+                stampFile(out, QFile::encodeName(dir.filePath(name)), false);
+        }
+    }
+
+    LoginEnvironmentCache::LoginEnvironmentCache(const struct passwd &pw, const QString &sessionCommand, const QString &session, QObject *parent)
+            : QObject(parent)
+            , m_path(QStringLiteral(RUNTIME_DIR "/login-environment/%1").arg(pw.pw_uid)) {
+        const QByteArray home(pw.pw_dir);
+
+        QDataStream out(&m_key, QIODevice::WriteOnly);
+        out << quint32(pw.pw_uid) << home << QByteArray(pw.pw_shell) << session.toUtf8();
+        stampFile(out, QFile::encodeName(sessionCommand), false);
+        for (const char *file : s_profileFiles) {
+            const QByteArray path = file[0] == '/' ? QByteArray(file) : home + '/' + file;
+            stampFile(out, path, true);
+        }
+    }
+
+    LoginEnvironmentCache::~LoginEnvironmentCache() {
+        if (m_readFd != -1)
+            ::close(m_readFd);
+        if (m_writeFd != -1)
+            ::close(m_writeFd);
+    }
+
+    bool LoginEnvironmentCache::lookup(EnvironmentDelta &delta) const {
+        QFile file(m_path);
+        if (!file.open(QIODevice::ReadOnly))
+            return false;
+
+        QDataStream in(&file);
+        in.setVersion(QDataStream::Qt_5_0);
+
+        quint32 magic = 0;
+        qint32 version = 0;
+        QByteArray key;
+        in >> magic >> version >> key;
+        if (in.status() != QDataStream::Ok || magic != s_cacheMagic || version != s_cacheVersion || key != m_key)
+            return false;
+
+        EnvironmentDelta cached;
+        in >> cached;
+        if (in.status() != QDataStream::Ok)
+            return false;
+        delta = cached;
+        return true;
+    }
+
+    int LoginEnvironmentCache::beginCapture(const QProcessEnvironment &base) {
+        int fds[2];
+        if (::pipe2(fds, O_CLOEXEC) == -1) {
+            qWarning() << "Failed to create the pipe for the login environment:" << strerror(errno);
+            return -1;
+        }
+        ::fcntl(fds[0], F_SETFL, ::fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+
+        m_readFd = fds[0];
+        m_writeFd = fds[1];
+        m_base = base;
+        m_notifier = new QSocketNotifier(m_readFd, QSocketNotifier::Read, this);
+        connect(m_notifier, &QSocketNotifier::activated, this, &LoginEnvironmentCache::readCapture);
+        return m_writeFd;
+    }
+
+    void LoginEnvironmentCache::childStarted() {
+        if (m_writeFd != -1) {
+            ::close(m_writeFd);
+            m_writeFd = -1;
+        }
+    }
+
+    void LoginEnvironmentCache::readCapture() {
+        char buffer[4096];
+        for (;;) {
+            const ssize_t count = ::read(m_readFd, buffer, sizeof(buffer));
+            if (count > 0) {
+                m_captured.append(buffer, int(count));
+                if (m_captured.size() > s_maxCaptureSize) {
+                    qWarning() << "The login environment is too large to be cached";
+                    m_captured.clear();
+                    break;
+                }
+                continue;
+            }
+            if (count == 0) {
+                finishCapture();
+                break;
+            }
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN)
+                return;
+            break;
+        }
+
+        // written, given up on, or the script didn't write anything
+        m_notifier->setEnabled(false);
+        m_notifier->deleteLater();
+        m_notifier = nullptr;
+        ::close(m_readFd);
+        m_readFd = -1;
+        m_captured = QByteArray();
+        m_base = QProcessEnvironment();
+    }
+
+    void LoginEnvironmentCache::finishCapture() {
+        // nothing, or not what "env -0" writes, the next login runs the
+        // profile again
+        if (!m_captured.contains('\0'))
+            return;
+
+        QProcessEnvironment env;
+        const QList<QByteArray> entries = m_captured.split('\0');
+        for (const QByteArray &entry : entries) {
+            const int index = entry.indexOf('=');
+            if (index > 0)
+                env.insert(QString::fromLocal8Bit(entry.left(index)), QString::fromLocal8Bit(entry.mid(index + 1)));
+        }
+
+        // what the shell keeps for itself is the same as it was started with
+        static const char *const shellVariables[] = { "_", "SHLVL", "PWD", "OLDPWD" };
+        for (const char *name : shellVariables) {
+            const QString key = QLatin1String(name);
+            if (m_base.contains(key))
+                env.insert(key, m_base.value(key));
+            else
+                env.remove(key);
+        }
+
+        const QByteArray directory = QByteArrayLiteral(RUNTIME_DIR "/login-environment");
+        if (::mkdir(directory.constData(), 0700) == -1 && errno != EEXIST) {
+            qWarning() << "Failed to create" << directory << ":" << strerror(errno);
+            return;
+        }
+
+        QSaveFile file(m_path);
+        if (!file.open(QIODevice::WriteOnly)) {
+            qWarning() << "Failed to write the login environment to" << m_path;
+            return;
+        }
+        file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+
+        QDataStream out(&file);
+        out.setVersion(QDataStream::Qt_5_0);
+        out << s_cacheMagic << s_cacheVersion << m_key << EnvironmentDelta(env, m_base);
+        if (!file.commit())
+            qWarning() << "Failed to write the login environment to" << m_path;
+        else
+            qDebug() << "Cached the login environment in" << m_path;
+    }
+}
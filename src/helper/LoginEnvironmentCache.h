@@ -0,0 +1,76 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_LOGINENVIRONMENTCACHE_H
+#define SDDM_LOGINENVIRONMENTCACHE_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QProcessEnvironment>
+#include <QString>
+
+#include "AuthMessages.h"
+
+class QSocketNotifier;
+struct passwd;
+
+// the session script hands its final environment to this descriptor
+#define LOGIN_ENVIRONMENT_FD_VARIABLE "SDDM_LOGIN_ENVIRONMENT_FD"
+
+namespace SDDM {
+    /**
+     * What the user's profile chain did to the session environment, see
+     * Wayland/CacheLoginEnvironment.
+     *
+     * The session script writes the environment it execs the desktop
+     * with to a pipe, the difference to what it was started with is kept
+     * for the user in the runtime directory. The next login execs the
+     * same session directly with it, as long as the shell, the session
+     * script and every profile file are unchanged.
+     */
+    class LoginEnvironmentCache : public QObject {
+        Q_OBJECT
+    public:
+        LoginEnvironmentCache(const struct passwd &pw, const QString &sessionCommand, const QString &session, QObject *parent = nullptr);
+        ~LoginEnvironmentCache();
+
+        // the changes of the last capture, false if there is none or it is stale
+        bool lookup(EnvironmentDelta &delta) const;
+
+        // opens the pipe for the session started with @p base, the
+        // returned descriptor goes to the child; -1 on failure
+        int beginCapture(const QProcessEnvironment &base);
+        // the child has its copy of the write end
+        void childStarted();
+
+    private:
+        void readCapture();
+        void finishCapture();
+
+        QString m_path;
+        QByteArray m_key;
+        QProcessEnvironment m_base;
+        QByteArray m_captured;
+        int m_readFd { -1 };
+        int m_writeFd { -1 };
+        QSocketNotifier *m_notifier { nullptr };
+    };
+}
+
+#endif // SDDM_LOGINENVIRONMENTCACHE_H
@@ -0,0 +1,79 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "SessionEnvironment.h"
+
+namespace SDDM {
+    void SessionEnvironment::insert(Layer layer, const QString &key, const QString &value) {
+        m_layers[layer].insert(key, value);
+    }
+
+    void SessionEnvironment::insert(Layer layer, const QProcessEnvironment &env) {
+        QHash<QString, QString> &variables = m_layers[layer];
+        const QStringList keys = env.keys();
+        for (const QString &key : keys)
+            variables.insert(key, env.value(key));
+    }
+
+    bool SessionEnvironment::contains(const QString &key) const {
+        return origin(key) != LayerCount;
+    }
+
+    QString SessionEnvironment::value(const QString &key, const QString &defaultValue) const {
+        const Layer layer = origin(key);
+        return layer == LayerCount ? defaultValue : m_layers[layer].value(key);
+    }
+
+    SessionEnvironment::Layer SessionEnvironment::origin(const QString &key) const {
+        for (int layer = LayerCount - 1; layer >= 0; --layer) {
+            if (m_layers[layer].contains(key))
+                return Layer(layer);
+        }
+        return LayerCount;
+    }
+
+    QString SessionEnvironment::layerName(Layer layer) {
+        switch (layer) {
+        case Daemon:
+            return QStringLiteral("daemon");
+        case Greeter:
+            return QStringLiteral("greeter");
+        case Pam:
+            return QStringLiteral("pam");
+        case Account:
+            return QStringLiteral("account");
+        default:
+            return QString();
+        }
+    }
+
+    QStringList SessionEnvironment::toStringList() const {
+        const QProcessEnvironment env = toProcessEnvironment();
+        return env.toStringList();
+    }
+
+    QProcessEnvironment SessionEnvironment::toProcessEnvironment() const {
+        QProcessEnvironment env;
+        for (int layer = 0; layer < LayerCount; ++layer) {
+            for (auto it = m_layers[layer].constBegin(); it != m_layers[layer].constEnd(); ++it)
+                env.insert(it.key(), it.value());
+        }
+        return env;
+    }
+}
@@ -0,0 +1,71 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_SESSIONENVIRONMENT_H
+#define SDDM_SESSIONENVIRONMENT_H
+
+#include <QHash>
+#include <QProcessEnvironment>
+#include <QString>
+#include <QStringList>
+
+namespace SDDM {
+    /**
+     * Environment of a session, kept as the layers that make it up.
+     *
+     * Every step of the session start adds its variables to a layer of
+     * its own instead of copying the whole environment, lookups go
+     * through the layers from the top. The process environment is put
+     * together once, when the session is started.
+     */
+    class SessionEnvironment {
+    public:
+        // from the bottom to the top, a higher layer wins
+        enum Layer {
+            // sent by the daemon along with AUTHENTICATED
+            Daemon,
+            // General/GreeterEnvironment, greeters only
+            Greeter,
+            // set by the PAM modules while opening the session
+            Pam,
+            // from the account database, like HOME and SHELL
+            Account,
+            LayerCount
+        };
+
+        void insert(Layer layer, const QString &key, const QString &value);
+        void insert(Layer layer, const QProcessEnvironment &env);
+
+        bool contains(const QString &key) const;
+        QString value(const QString &key, const QString &defaultValue = QString()) const;
+
+        // the layer which set @p key, LayerCount if none did
+        Layer origin(const QString &key) const;
+        static QString layerName(Layer layer);
+
+        // KEY=VALUE, for pam_putenv()
+        QStringList toStringList() const;
+        QProcessEnvironment toProcessEnvironment() const;
+
+    private:
+        QHash<QString, QString> m_layers[LayerCount];
+    };
+}
+
+#endif // SDDM_SESSIONENVIRONMENT_H
@@ -20,37 +20,118 @@
  */
 
 #include <QSocketNotifier>
+#include <QVector>
 
 #include "Configuration.h"
 #include "UserSession.h"
 #include "HelperApp.h"
-#include "VirtualTerminal.h"
-#include "XAuth.h"
+#include "LoginEnvironmentCache.h"
+#include "ProcessPolicy.h"
+#include "ProcessSupervisor.h"
 
 #include <sys/types.h>
-#include <sys/ioctl.h>
 #include <errno.h>
 #include <string.h>
 #include <unistd.h>
 #include <pwd.h>
 #include <grp.h>
-#include <unistd.h>
 #include <fcntl.h>
-#include <sched.h>
-#ifdef Q_OS_FREEBSD
-#include <login_cap.h>
-#endif
 
 namespace SDDM {
+    // passwd entry and groups of the user, looked up ahead of time
+    struct PreparedAccount {
+        QByteArray name;
+        struct passwd pw;
+        QByteArray buffer;
+        QVector<gid_t> groups;
+        bool found { false };
+        bool groupsFound { false };
+    };
+
+    // how sddm-helper-exec sets up the session, worked out before forking
+    struct ChildSetup {
+        std::unique_ptr<PreparedAccount> account;
+        QStringList arguments;
+        // handed over through a pipe, it doesn't belong on a command line
+        QString cookie;
+        // kept open across exec, for the login environment
+        int loginEnvironmentFd { -1 };
+    };
+
+    static void lookupAccount(PreparedAccount *account) {
+        long bufsize = sysconf(_SC_GETPW_R_SIZE_MAX);
+        if (bufsize == -1)
+            bufsize = 16384;
+        account->buffer.resize(int(bufsize));
+
+        struct passwd *rpw = nullptr;
+        if (getpwnam_r(account->name.constData(), &account->pw, account->buffer.data(), bufsize, &rpw) != 0 || !rpw)
+            return;
+        account->found = true;
+
+#if !defined(Q_OS_FREEBSD) && defined(USE_PAM)
+        int count = 0;
+        if (getgrouplist(account->pw.pw_name, account->pw.pw_gid, nullptr, &count) == -1) {
+            account->groups.resize(count);
+            if (getgrouplist(account->pw.pw_name, account->pw.pw_gid, account->groups.data(), &count) == -1)
+                return;
+            account->groups.resize(count);
+        }
+        account->groupsFound = true;
+#endif
+    }
+
     UserSession::UserSession(HelperApp *parent)
         : QProcess(parent)
     {
-        connect(this, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, &UserSession::finished);
+        connect(this, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, [this](int exitCode) {
+            const bool stopped = m_stopping;
+            m_stopping = false;
+            Q_EMIT finished(stopped ? Auth::HELPER_OTHER_ERROR : exitCode);
+        });
+
+        // the session leads its own process group, which takes everything
+        // it started along unless they moved to a group of their own
+        ProcessSupervisor *supervisor = ProcessSupervisor::of(this);
+        supervisor->setSignalGroup(true);
+        connect(supervisor, &ProcessSupervisor::failedToStart, this, [this](const QString &error) {
+            qCritical() << "Failed to start" << program() << ":" << error;
+            Q_EMIT finished(Auth::HELPER_SESSION_ERROR);
+        });
+        connect(supervisor, &ProcessSupervisor::stopFailed, this, [this] {
+            qWarning() << "Could not fully finish the process" << program();
+            m_stopping = false;
+            Q_EMIT finished(Auth::HELPER_OTHER_ERROR);
+        });
+    }
+
+    UserSession::~UserSession() {
+        if (m_prepareThread.joinable())
+            m_prepareThread.join();
+    }
+
+    void UserSession::prepare(const QString &user) {
+        if (m_prepareThread.joinable())
+            m_prepareThread.join();
+
+        m_account.reset(new PreparedAccount);
+        m_account->name = user.toLocal8Bit();
+        PreparedAccount *account = m_account.get();
+        m_prepareThread = std::thread([account] { lookupAccount(account); });
     }
 
     bool UserSession::start() {
-        auto helper = qobject_cast<HelperApp*>(parent());
-        QProcessEnvironment env = helper->session()->processEnvironment();
+        // the child reads the prepared account
+        if (m_prepareThread.joinable())
+            m_prepareThread.join();
+
+        // the one copy of the environment, which the child gets
+        setProcessEnvironment(m_environment.toProcessEnvironment());
+
+        if (!prepareChild())
+            return false;
+
+        const SessionEnvironment &env = m_environment;
 
         bool isWaylandGreeter = false;
         if (env.value(QStringLiteral("XDG_SESSION_TYPE")) == QLatin1String("x11")) {
@@ -65,20 +146,21 @@ namespace SDDM {
             if (m_displayServerCmd.isEmpty()) {
                 auto args = QProcess::splitCommand(command);
                 const auto program = args.takeFirst();
-                QProcess::start(program, args);
+                startChild(program, args);
             } else {
-                QProcess::start(QStringLiteral(LIBEXEC_INSTALL_DIR "/sddm-helper-start-x11user"), {m_displayServerCmd, command});
+                startChild(QStringLiteral(LIBEXEC_INSTALL_DIR "/sddm-helper-start-x11user"), {m_displayServerCmd, command});
             }
 
         } else if (env.value(QStringLiteral("XDG_SESSION_TYPE")) == QLatin1String("wayland")) {
             if (env.value(QStringLiteral("XDG_SESSION_CLASS")) == QLatin1String("greeter")) {
                 Q_ASSERT(!m_displayServerCmd.isEmpty());
-                QProcess::start(QStringLiteral(LIBEXEC_INSTALL_DIR "/sddm-helper-start-wayland"), {m_displayServerCmd, m_path});
+                QStringList args { m_displayServerCmd, m_path };
+                if (mainConfig.Wayland.PersistentCompositor.get())
+                    args.prepend(QStringLiteral("--persistent"));
+                startChild(QStringLiteral(LIBEXEC_INSTALL_DIR "/sddm-helper-start-wayland"), args);
                 isWaylandGreeter = true;
             } else {
-                const QString cmd = QStringLiteral("%1 %2").arg(mainConfig.Wayland.SessionCommand.get()).arg(m_path);
-                qInfo() << "Starting Wayland user session:" << cmd;
-                QProcess::start(mainConfig.Wayland.SessionCommand.get(), QStringList{m_path});
+                startWaylandSession();
                 closeWriteChannel();
                 closeReadChannel(QProcess::StandardOutput);
             }
@@ -86,7 +168,9 @@ namespace SDDM {
             qCritical() << "Unable to run user session: unknown session type";
         }
 
-        const bool started = waitForStarted();
+        // the child is forked by now, a failing exec is reported by the
+        // supervisor without waiting for it here
+        const bool started = state() != QProcess::NotRunning;
         m_cachedProcessId = processId();
         if (started) {
             return true;
@@ -98,21 +182,90 @@ namespace SDDM {
         return false;
     }
 
-    void UserSession::stop()
-    {
-        if (state() != QProcess::NotRunning) {
-            terminate();
-            const bool isGreeter = processEnvironment().value(QStringLiteral("XDG_SESSION_CLASS")) == QLatin1String("greeter");
-
-            // Wait longer for a session than a greeter
-            if (!waitForFinished(isGreeter ? 5000 : 60000)) {
-                kill();
-                if (!waitForFinished(5000)) {
-                    qWarning() << "Could not fully finish the process" << program();
+    void UserSession::startWaylandSession() {
+        const QString command = mainConfig.Wayland.SessionCommand.get();
+        LoginEnvironmentCache *cache = nullptr;
+        if (mainConfig.Wayland.CacheLoginEnvironment.get())
+            cache = new LoginEnvironmentCache(m_childSetup->account->pw, command, m_path, this);
+
+        // what the profile chain did the last time, without running it again
+        EnvironmentDelta delta;
+        QStringList args = QProcess::splitCommand(m_path);
+        if (cache && !args.isEmpty() && cache->lookup(delta)) {
+            qInfo() << "Starting Wayland user session with the cached login environment:" << m_path;
+            setProcessEnvironment(delta.apply(processEnvironment()));
+            const QString program = args.takeFirst();
+            startChild(program, args);
+            cache->deleteLater();
+            return;
+        }
+
+        if (cache) {
+            const int fd = cache->beginCapture(processEnvironment());
+            if (fd >= 0) {
+                QProcessEnvironment env = processEnvironment();
+                env.insert(QStringLiteral(LOGIN_ENVIRONMENT_FD_VARIABLE), QString::number(fd));
+                setProcessEnvironment(env);
+                m_childSetup->loginEnvironmentFd = fd;
+            }
+        }
+
+        qInfo() << "Starting Wayland user session:" << QStringLiteral("%1 %2").arg(command).arg(m_path);
+        startChild(command, QStringList{m_path});
+        if (cache)
+            cache->childStarted();
+    }
+
+    void UserSession::startChild(const QString &program, const QStringList &arguments) {
+        ChildSetup &setup = *m_childSetup;
+        QStringList args = setup.arguments;
+
+        // the only descriptors the stub inherits besides stdio
+        int cookieFd = -1;
+        if (!setup.cookie.isEmpty()) {
+            int fds[2];
+            if (::pipe2(fds, O_CLOEXEC) == 0) {
+                const QByteArray cookie = setup.cookie.toLatin1();
+                if (::write(fds[1], cookie.constData(), cookie.size()) == cookie.size()) {
+                    cookieFd = fds[0];
+                    ::fcntl(cookieFd, F_SETFD, 0);
+                    args << QStringLiteral("--cookie-fd") << QString::number(cookieFd)
+                         << QStringLiteral("--xauth") << mainConfig.X11.XauthPath.get();
+                } else {
+                    qWarning() << "Failed to hand over the X cookie:" << strerror(errno);
+                    ::close(fds[0]);
                 }
+                ::close(fds[1]);
+            } else {
+                qWarning() << "Failed to create the pipe for the X cookie:" << strerror(errno);
             }
         }
-        Q_EMIT finished(Auth::HELPER_OTHER_ERROR);
+        if (setup.loginEnvironmentFd != -1)
+            ::fcntl(setup.loginEnvironmentFd, F_SETFD, 0);
+
+        args << QStringLiteral("--") << program << arguments;
+        QProcess::start(QStringLiteral(LIBEXEC_INSTALL_DIR "/sddm-helper-exec"), args);
+
+        if (cookieFd != -1)
+            ::close(cookieFd);
+        if (setup.loginEnvironmentFd != -1)
+            ::fcntl(setup.loginEnvironmentFd, F_SETFD, FD_CLOEXEC);
+    }
+
+    void UserSession::stop()
+    {
+        if (state() == QProcess::NotRunning) {
+            Q_EMIT finished(Auth::HELPER_OTHER_ERROR);
+            return;
+        }
+        if (m_stopping)
+            return;
+
+        m_stopping = true;
+
+        // Wait longer for a session than a greeter
+        const bool isGreeter = m_environment.value(QStringLiteral("XDG_SESSION_CLASS")) == QLatin1String("greeter");
+        ProcessSupervisor::of(this)->stop(isGreeter ? 5000 : 60000);
     }
 
     QString UserSession::displayServerCommand() const
@@ -133,226 +286,128 @@ namespace SDDM {
         return m_path;
     }
 
-    void UserSession::setupChildProcess() {
-        // Session type
-        QString sessionType = processEnvironment().value(QStringLiteral("XDG_SESSION_TYPE"));
-        QString sessionClass = processEnvironment().value(QStringLiteral("XDG_SESSION_CLASS"));
-        const bool hasDisplayServer = !m_displayServerCmd.isEmpty();
-        const bool x11UserSession = sessionType == QLatin1String("x11") && sessionClass == QLatin1String("user");
-        const bool waylandUserSession = sessionType == QLatin1String("wayland") && sessionClass == QLatin1String("user");
+    SessionEnvironment &UserSession::environment() {
+        return m_environment;
+    }
 
-        // When the display server is part of the session, we leak the VT into
-        // the session as stdin so that it stays open without races
-        if (hasDisplayServer || waylandUserSession) {
-            // open VT and get the fd
-            int vtNumber = processEnvironment().value(QStringLiteral("XDG_VTNR")).toInt();
-            QString ttyString = QStringLiteral("/dev/tty%1").arg(vtNumber);
-            int vtFd = ::open(qPrintable(ttyString), O_RDWR | O_NOCTTY);
-
-            // when this is true we'll take control of the tty
-            bool takeControl = false;
-
-            if (vtFd > 0) {
-                dup2(vtFd, STDIN_FILENO);
-                ::close(vtFd);
-                takeControl = true;
-            } else {
-                int stdinFd = ::open("/dev/null", O_RDWR);
-                dup2(stdinFd, STDIN_FILENO);
-                ::close(stdinFd);
-            }
+    const SessionEnvironment &UserSession::environment() const {
+        return m_environment;
+    }
 
-            // set this process as session leader
-            if (setsid() < 0) {
-                qCritical("Failed to set pid %lld as leader of the new session and process group: %s",
-                          QCoreApplication::applicationPid(), strerror(errno));
-                exit(Auth::HELPER_OTHER_ERROR);
-            }
+    bool UserSession::prepareChild() {
+        const SessionEnvironment &env = m_environment;
+        const QString sessionType = env.value(QStringLiteral("XDG_SESSION_TYPE"));
+        const QString sessionClass = env.value(QStringLiteral("XDG_SESSION_CLASS"));
+        const bool waylandUserSession = sessionType == QLatin1String("wayland") && sessionClass == QLatin1String("user");
+        const bool x11UserSession = sessionType == QLatin1String("x11") && sessionClass == QLatin1String("user");
 
-            // take control of the tty
-            if (takeControl) {
-                if (ioctl(STDIN_FILENO, TIOCSCTTY) < 0) {
-                    const auto error = strerror(errno);
-                    qCritical().nospace() << "Failed to take control of " << ttyString << " (" << QFileInfo(ttyString).owner() << "): " << error;
-                    exit(Auth::HELPER_OTHER_ERROR);
-                }
-            }
+        std::unique_ptr<ChildSetup> setup(new ChildSetup);
+        QStringList &args = setup->arguments;
 
-            VirtualTerminal::jumpToVt(vtNumber, x11UserSession);
+        // When the display server is part of the session, we leak the VT into
+        // the session as stdin so that it stays open without races
+        if (!m_displayServerCmd.isEmpty() || waylandUserSession) {
+            args << QStringLiteral("--vt") << QString::number(env.value(QStringLiteral("XDG_VTNR")).toInt());
+            if (x11UserSession)
+                args << QStringLiteral("--vt-auto");
         }
 
 #ifdef Q_OS_LINUX
-        // enter Linux namespaces
-        for (const QString &ns: mainConfig.Namespaces.get()) {
+        for (const QString &ns: mainConfig.Namespaces.ref()) {
             qInfo() << "Entering namespace" << ns;
-            int fd = ::open(qPrintable(ns), O_RDONLY);
-            if (fd < 0) {
-                qCritical("open(%s) failed: %s", qPrintable(ns), strerror(errno));
-                exit(Auth::HELPER_OTHER_ERROR);
-            }
-            if (setns(fd, 0) != 0) {
-                qCritical("setns(open(%s), 0) failed: %s", qPrintable(ns), strerror(errno));
-                exit(Auth::HELPER_OTHER_ERROR);
-            }
-            ::close(fd);
+            args << QStringLiteral("--namespace") << ns;
         }
 #endif
 
-        // switch user
+        // user sessions don't inherit what the helper was started with,
+        // and the greeter stays in the scope of its login session
+        if (sessionClass == QLatin1String("greeter"))
+            args << ProcessPolicy::forSession(ProcessPolicy::Role::Greeter).arguments();
+        else if (ProcessPolicy::isConfigured(ProcessPolicy::Role::Helper))
+            args << ProcessPolicy::defaults().arguments();
+
+        // the account looked up while authenticating, if the user is still the same
         const QByteArray username = qobject_cast<HelperApp*>(parent())->user().toLocal8Bit();
-        struct passwd pw;
-        struct passwd *rpw;
-        long bufsize = sysconf(_SC_GETPW_R_SIZE_MAX);
-        if (bufsize == -1)
-            bufsize = 16384;
-        QScopedPointer<char, QScopedPointerPodDeleter> buffer(static_cast<char*>(malloc(bufsize)));
-        if (buffer.isNull()) {
-            qCritical() << "Could not allocate buffer of size" << bufsize;
-            exit(Auth::HELPER_OTHER_ERROR);
-        }
-        int err = getpwnam_r(username.constData(), &pw, buffer.data(), bufsize, &rpw);
-        if (rpw == NULL) {
-            if (err == 0)
-                qCritical() << "getpwnam_r(" << username << ") username not found!";
-            else
-                qCritical() << "getpwnam_r(" << username << ") failed with error: " << strerror(err);
-            exit(Auth::HELPER_OTHER_ERROR);
-        }
-#if defined(Q_OS_FREEBSD)
-        // execve() uses the environment prepared in Backend::openSession(),
-        // therefore environment variables which are set here are ignored.
-        if (setusercontext(NULL, &pw, pw.pw_uid, LOGIN_SETALL) != 0) {
-            qCritical() << "setusercontext(NULL, *, " << pw.pw_uid << ", LOGIN_SETALL) failed for user: " << username;
-            exit(Auth::HELPER_OTHER_ERROR);
-        }
-#else
-        if (setgid(pw.pw_gid) != 0) {
-            qCritical() << "setgid(" << pw.pw_gid << ") failed for user: " << username;
-            exit(Auth::HELPER_OTHER_ERROR);
+        if (m_account && m_account->found && m_account->name == username) {
+            setup->account = std::move(m_account);
+        } else {
+            setup->account.reset(new PreparedAccount);
+            setup->account->name = username;
+            lookupAccount(setup->account.get());
+            if (!setup->account->found) {
+                qCritical() << "getpwnam_r(" << username << ") failed, cannot start the session";
+                return false;
+            }
         }
-        qputenv("XDG_RUNTIME_DIR", QByteArrayLiteral("/run/user/") + QByteArray::number(pw.pw_uid));
-
-#ifdef USE_PAM
-
-        // fetch ambient groups from PAM's environment;
-        // these are set by modules such as pam_groups.so
-        int n_pam_groups = getgroups(0, NULL);
-        gid_t *pam_groups = NULL;
-        if (n_pam_groups > 0) {
-            pam_groups = new gid_t[n_pam_groups];
-            if ((n_pam_groups = getgroups(n_pam_groups, pam_groups)) == -1) {
+        const struct passwd &pw = setup->account->pw;
+        args << QStringLiteral("--user") << QString::fromLocal8Bit(pw.pw_name)
+             << QStringLiteral("--uid") << QString::number(pw.pw_uid)
+             << QStringLiteral("--gid") << QString::number(pw.pw_gid);
+
+#if !defined(Q_OS_FREEBSD) && defined(USE_PAM)
+        // ambient groups from PAM's environment, these are set by modules
+        // such as pam_groups.so, followed by the user's groups;
+        // setgroups(2) handles duplicate groups
+        QVector<gid_t> groups;
+        const int pamGroups = getgroups(0, nullptr);
+        if (pamGroups > 0) {
+            groups.resize(pamGroups);
+            if (getgroups(pamGroups, groups.data()) == -1) {
                 qCritical() << "getgroups() failed to fetch supplemental"
                             << "PAM groups for user:" << username;
-                exit(Auth::HELPER_OTHER_ERROR);
+                return false;
             }
-        } else {
-            n_pam_groups = 0;
         }
-
-        // fetch session's user's groups
-        int n_user_groups = 0;
-        gid_t *user_groups = NULL;
-        if (-1 == getgrouplist(pw.pw_name, pw.pw_gid,
-                               NULL, &n_user_groups)) {
-            user_groups = new gid_t[n_user_groups];
-            if ((n_user_groups = getgrouplist(pw.pw_name,
-                                              pw.pw_gid, user_groups,
-                                              &n_user_groups)) == -1 ) {
-                qCritical() << "getgrouplist(" << pw.pw_name << ", " << pw.pw_gid
-                            << ") failed";
-                exit(Auth::HELPER_OTHER_ERROR);
-            }
+        if (!setup->account->groupsFound) {
+            qCritical() << "getgrouplist(" << pw.pw_name << ", " << pw.pw_gid << ") failed";
+            return false;
         }
+        groups += setup->account->groups;
 
-        // set groups to concatenation of PAM's ambient
-        // groups and the session's user's groups
-        int n_groups = n_pam_groups + n_user_groups;
-        if (n_groups > 0) {
-            gid_t *groups = new gid_t[n_groups];
-            memcpy(groups, pam_groups, (n_pam_groups * sizeof(gid_t)));
-            memcpy((groups + n_pam_groups), user_groups,
-                   (n_user_groups * sizeof(gid_t)));
-
-            // setgroups(2) handles duplicate groups
-            if (setgroups(n_groups, groups) != 0) {
-                qCritical() << "setgroups() failed for user: " << username;
-                exit (Auth::HELPER_OTHER_ERROR);
-            }
-            delete[] groups;
-        }
-        delete[] pam_groups;
-        delete[] user_groups;
-
-#else
-
-        if (initgroups(pw.pw_name, pw.pw_gid) != 0) {
-            qCritical() << "initgroups(" << pw.pw_name << ", " << pw.pw_gid << ") failed for user: " << username;
-            exit(Auth::HELPER_OTHER_ERROR);
-        }
+        QStringList groupList;
+        for (gid_t gid : qAsConst(groups))
+            groupList << QString::number(gid);
+        args << QStringLiteral("--groups") << groupList.join(QLatin1Char(','));
+#endif
 
-#endif /* USE_PAM */
+        args << QStringLiteral("--home") << QString::fromLocal8Bit(pw.pw_dir);
 
-        if (setuid(pw.pw_uid) != 0) {
-            qCritical() << "setuid(" << pw.pw_uid << ") failed for user: " << username;
-            exit(Auth::HELPER_OTHER_ERROR);
-        }
-#endif /* Q_OS_FREEBSD */
-        if (chdir(pw.pw_dir) != 0) {
-            qCritical() << "chdir(" << pw.pw_dir << ") failed for user: " << username;
-            qCritical() << "verify directory exist and has sufficient permissions";
-            exit(Auth::HELPER_OTHER_ERROR);
+        bool journal = false;
+        if (sessionClass != QLatin1String("greeter") && mainConfig.SessionLog.get() == QLatin1String("journal")) {
+#ifdef HAVE_JOURNALD
+            const QString desktop = env.value(QStringLiteral("DESKTOP_SESSION"));
+            args << QStringLiteral("--journal") << (desktop.isEmpty() ? QStringLiteral("sddm-session") : desktop);
+            journal = true;
+#else
+            qWarning() << "Built without journald support, writing the session log to a file";
+#endif
         }
 
-        if (sessionClass != QLatin1String("greeter")) {
-            //we cannot use setStandardError file as this code is run in the child process
-            //we want to redirect after we setuid so that the log file is owned by the user
-
+        if (sessionClass != QLatin1String("greeter") && !journal) {
             // determine stderr log file based on session type
-            QString sessionLog = QStringLiteral("%1/%2")
-                    .arg(QString::fromLocal8Bit(pw.pw_dir))
-                    .arg(sessionType == QLatin1String("x11")
-                         ? mainConfig.X11.SessionLogFile.get()
-                         : mainConfig.Wayland.SessionLogFile.get());
-
-            // create the path
-            QFileInfo finfo(sessionLog);
-            QDir().mkpath(finfo.absolutePath());
-
-            //swap the stderr pipe of this subprcess into a file
-            int fd = ::open(qPrintable(sessionLog), O_WRONLY | O_CREAT | O_TRUNC, 0600);
-            if (fd >= 0)
-            {
-                dup2 (fd, STDERR_FILENO);
-                ::close(fd);
-            } else {
-                qWarning() << "Could not open stderr to" << sessionLog;
-            }
-
-            //redirect any stdout to /dev/null
-            fd = ::open("/dev/null", O_WRONLY);
-            if (fd >= 0)
-            {
-                dup2 (fd, STDOUT_FILENO);
-                ::close(fd);
-            } else {
-                qWarning() << "Could not redirect stdout";
+            const QString logFile = sessionType == QLatin1String("x11")
+                    ? mainConfig.X11.SessionLogFile.get()
+                    : mainConfig.Wayland.SessionLogFile.get();
+            const QString home = QString::fromLocal8Bit(pw.pw_dir);
+
+            // directories between the home and the log, created as the user
+            QString dir = home;
+            const QStringList parts = logFile.split(QLatin1Char('/'));
+            for (int i = 0; i < parts.size() - 1; ++i) {
+                if (parts.at(i).isEmpty())
+                    continue;
+                dir += QLatin1Char('/') + parts.at(i);
+                args << QStringLiteral("--log-dir") << dir;
             }
+            args << QStringLiteral("--log") << home + QLatin1Char('/') + logFile;
         }
 
         // set X authority for X11 sessions only
-        if (x11UserSession) {
-            QString cookie = qobject_cast<HelperApp*>(parent())->cookie();
-            if (!cookie.isEmpty()) {
-                QString file = processEnvironment().value(QStringLiteral("XAUTHORITY"));
-                QString display = processEnvironment().value(QStringLiteral("DISPLAY"));
-
-                // Create the path
-                QFileInfo finfo(file);
-                QDir().mkpath(finfo.absolutePath());
+        if (x11UserSession)
+            setup->cookie = qobject_cast<HelperApp*>(parent())->cookie();
 
-                XAuth::addCookieToFile(display, file, cookie);
-            }
-        }
+        m_childSetup = std::move(setup);
+        return true;
     }
 
     qint64 UserSession::cachedProcessId() {
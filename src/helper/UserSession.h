@@ -25,17 +25,42 @@
 #include <QtCore/QObject>
 #include <QtCore/QProcess>
 
+#include <memory>
+#include <thread>
+
+#include "SessionEnvironment.h"
+
 namespace SDDM {
     class HelperApp;
     class XOrgUserHelper;
     class WaylandHelper;
+    struct PreparedAccount;
+    struct ChildSetup;
     class UserSession : public QProcess
     {
         Q_OBJECT
     public:
         explicit UserSession(HelperApp *parent);
+        ~UserSession();
+
+        /*!
+         \brief Looks up the account of the user in the background
+         \param user name the user is logging in with
+
+         Meant to run while the auth stack is busy, the session process
+         uses the result unless the user changed in the meantime.
+        */
+        void prepare(const QString &user);
 
         bool start();
+
+        /*!
+         \brief Asks the session to finish without waiting for it
+
+         The process group of the session gets SIGTERM and, if it is still
+         around after a grace period, SIGKILL. finished() is emitted once
+         the process is gone or could not be stopped.
+        */
         void stop();
 
         QString displayServerCommand() const;
@@ -44,6 +69,14 @@ namespace SDDM {
         void setPath(const QString &path);
         QString path() const;
 
+        /*!
+         \brief The environment the session is started with, as its layers
+
+         It becomes the process environment in start().
+        */
+        SessionEnvironment &environment();
+        const SessionEnvironment &environment() const;
+
         /*!
          \brief Gets m_cachedProcessId
          \return  The cached process ID
@@ -55,14 +88,22 @@ namespace SDDM {
         void finished(int exitCode);
 
 
-    protected:
-        void setupChildProcess() override;
-
     private:
         void setup();
+        bool prepareChild();
+        // runs @p program through sddm-helper-exec, which sets up the process
+        void startChild(const QString &program, const QStringList &arguments);
+        void startWaylandSession();
 
         QString m_path { };
         QString m_displayServerCmd;
+        SessionEnvironment m_environment;
+
+        std::unique_ptr<PreparedAccount> m_account;
+        std::thread m_prepareThread;
+        std::unique_ptr<ChildSetup> m_childSetup;
+
+        bool m_stopping { false };
 
         /*!
          Needed for getting the PID of a finished UserSession and calling HelperApp::utmpLogout
@@ -0,0 +1,96 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "UtmpWriter.h"
+
+#include <QtCore/QDebug>
+
+#if defined(Q_OS_LINUX)
+#include <utmp.h>
+#endif
+#include <errno.h>
+#include <string.h>
+
+namespace SDDM {
+    UtmpWriter::~UtmpWriter() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wake.notify_one();
+        if (m_thread.joinable())
+            m_thread.join();
+    }
+
+    void UtmpWriter::write(const struct utmpx &entry, Log log) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(Record { entry, log });
+            if (!m_thread.joinable())
+                m_thread = std::thread(&UtmpWriter::run, this);
+        }
+        m_wake.notify_one();
+    }
+
+    void UtmpWriter::flush() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle.wait(lock, [this] { return m_queue.empty() && !m_busy; });
+    }
+
+    void UtmpWriter::run() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            m_wake.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+            // whatever is queued still gets written when stopping
+            if (m_queue.empty())
+                break;
+
+            const Record record = m_queue.front();
+            m_queue.pop_front();
+            m_busy = true;
+            lock.unlock();
+            writeRecord(record);
+            lock.lock();
+            m_busy = false;
+            if (m_queue.empty())
+                m_idle.notify_all();
+        }
+    }
+
+    void UtmpWriter::writeRecord(const Record &record) {
+        struct utmpx entry = record.entry;
+
+        // write to utmp
+        setutxent();
+        if (!pututxline(&entry))
+            qWarning() << "Failed to write utmpx: " << strerror(errno);
+        endutxent();
+
+#if defined(Q_OS_LINUX)
+        if (record.log == Btmp)
+            updwtmpx("/var/log/btmp", &entry);
+        else if (record.log == Wtmp)
+            updwtmpx("/var/log/wtmp", &entry);
+#elif defined(Q_OS_FREEBSD)
+        // utmpx keeps the log as well, logouts are written twice like before
+        if (record.log == Wtmp && entry.ut_type == DEAD_PROCESS)
+            pututxline(&entry);
+#endif
+    }
+}
@@ -0,0 +1,76 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_UTMPWRITER_H
+#define SDDM_UTMPWRITER_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <utmpx.h>
+
+namespace SDDM {
+    /**
+     * Writes utmp/wtmp/btmp records on a thread of its own
+     *
+     * Appending to a large wtmp on slow storage can take a while, the
+     * login and logout paths only queue the records. Everything queued is
+     * written when the writer is flushed or destroyed.
+     */
+    class UtmpWriter {
+    public:
+        enum Log {
+            NoLog,
+            Wtmp,
+            Btmp
+        };
+
+        UtmpWriter() = default;
+        ~UtmpWriter();
+
+        // queues the entry for utmp and, where the system keeps one, the log
+        void write(const struct utmpx &entry, Log log);
+        // returns once everything queued so far is written
+        void flush();
+
+    private:
+        UtmpWriter(const UtmpWriter &) = delete;
+        UtmpWriter &operator=(const UtmpWriter &) = delete;
+
+        struct Record {
+            struct utmpx entry;
+            Log log;
+        };
+
+        void run();
+        static void writeRecord(const Record &record);
+
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_idle;
+        std::deque<Record> m_queue;
+        std::thread m_thread;
+        bool m_busy { false };
+        bool m_stopping { false };
+    };
+}
+
+#endif // SDDM_UTMPWRITER_H
@@ -0,0 +1,79 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "MockBackend.h"
+
+#include "AuthMessages.h"
+#include "HelperApp.h"
+
+#include <QtCore/QDebug>
+
+#include <sys/types.h>
+#include <pwd.h>
+
+namespace SDDM {
+    static const char MockPassword[] = "mock";
+
+    MockBackend::MockBackend(HelperApp *parent)
+            : Backend(parent) { }
+
+    bool MockBackend::authenticate() {
+        if (m_autologin || m_greeter)
+            return true;
+
+        Request r;
+        QString password;
+
+        if (m_user.isEmpty())
+            r.prompts << Prompt(AuthPrompt::LOGIN_USER, QStringLiteral("Login"), false);
+        r.prompts << Prompt(AuthPrompt::LOGIN_PASSWORD, QStringLiteral("Password"), true);
+
+        Request response = m_app->request(r);
+        for (const Prompt &p : qAsConst(response.prompts)) {
+            switch (p.type) {
+                case AuthPrompt::LOGIN_USER:
+                    m_user = QString::fromUtf8(p.response);
+                    break;
+                case AuthPrompt::LOGIN_PASSWORD:
+                    password = QString::fromUtf8(p.response);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        // the session still needs a real account to run as
+        if (!getpwnam(qPrintable(m_user)) || password != QLatin1String(MockPassword)) {
+            m_app->error(QStringLiteral("Wrong user/password combination"), Auth::ERROR_AUTHENTICATION);
+            return false;
+        }
+
+        qWarning() << "[Mock] Accepted" << m_user << "without checking any credentials";
+        return true;
+    }
+
+    bool MockBackend::start(const QString &user) {
+        m_user = user;
+        return true;
+    }
+
+    QString MockBackend::userName() {
+        return m_user;
+    }
+}
@@ -0,0 +1,47 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef MOCKBACKEND_H
+#define MOCKBACKEND_H
+
+#include "../Backend.h"
+
+namespace SDDM {
+    /**
+     * Accepts any existing user with the password "mock", for tests
+     * that drive logins without real credentials. It is only built into
+     * sddm-helper-mock, which is never installed.
+     */
+    class MockBackend : public Backend {
+        Q_OBJECT
+    public:
+        MockBackend(HelperApp *parent);
+
+    public slots:
+        bool start(const QString &user = QString()) override;
+        bool authenticate() override;
+
+        QString userName() override;
+
+    private:
+        QString m_user { };
+    };
+}
+
+#endif // MOCKBACKEND_H
@@ -20,14 +20,18 @@
 
 #include "PamBackend.h"
 #include "PamHandle.h"
+#include "PromptClassifier.h"
 #include "HelperApp.h"
 #include "UserSession.h"
 #include "Auth.h"
+#include "Configuration.h"
+#include "LoggingCategories.h"
 
 #include <QtCore/QString>
 #include <QtCore/QDebug>
 
 #include <stdlib.h>
+#include <string.h>
 
 namespace SDDM {
     static Request loginRequest {
@@ -55,36 +59,21 @@ namespace SDDM {
 
     PamData::PamData() { }
 
-    AuthPrompt::Type PamData::detectPrompt(const struct pam_message* msg) const {
-        if (msg->msg_style == PAM_PROMPT_ECHO_OFF) {
-            QString message = QString::fromLocal8Bit(msg->msg);
-            if (message.indexOf(QRegExp(QStringLiteral("\\bpassword\\b"), Qt::CaseInsensitive)) >= 0) {
-                if (message.indexOf(QRegExp(QStringLiteral("\\b(re-?(enter|type)|again|confirm|repeat)\\b"), Qt::CaseInsensitive)) >= 0) {
-                    return AuthPrompt::CHANGE_REPEAT;
-                }
-                else if (message.indexOf(QRegExp(QStringLiteral("\\bnew\\b"), Qt::CaseInsensitive)) >= 0) {
-                    return AuthPrompt::CHANGE_NEW;
-                }
-                else if (message.indexOf(QRegExp(QStringLiteral("\\b(old|current)\\b"), Qt::CaseInsensitive)) >= 0) {
-                    return AuthPrompt::CHANGE_CURRENT;
-                }
-                else {
-                    return AuthPrompt::LOGIN_PASSWORD;
-                }
-            }
-        }
-        else {
-            return AuthPrompt::LOGIN_USER;
-        }
+    PamData::~PamData() {
+        for (QByteArray &credential : m_credentials)
+            memset(credential.data(), 0, credential.length());
+    }
 
-        return AuthPrompt::UNKNOWN;
+    AuthPrompt::Type PamData::detectPrompt(const struct pam_message* msg) const {
+        return PromptClassifier::classify(QString::fromLocal8Bit(msg->msg), msg->msg_style == PAM_PROMPT_ECHO_OFF);
     }
 
     const Prompt& PamData::findPrompt(const struct pam_message* msg) const {
         AuthPrompt::Type type = detectPrompt(msg);
+        const QString message = QString::fromLocal8Bit(msg->msg);
 
         for (const Prompt &p : m_currentRequest.prompts) {
-            if (type == p.type && p.message == QString::fromLocal8Bit(msg->msg))
+            if (type == p.type && p.message == message)
                 return p;
         }
 
@@ -93,9 +82,10 @@ namespace SDDM {
 
     Prompt& PamData::findPrompt(const struct pam_message* msg) {
         AuthPrompt::Type type = detectPrompt(msg);
+        const QString message = QString::fromLocal8Bit(msg->msg);
 
         for (Prompt &p : m_currentRequest.prompts) {
-            if (type == AuthPrompt::UNKNOWN && QString::fromLocal8Bit(msg->msg) == p.message)
+            if (type == AuthPrompt::UNKNOWN && message == p.message)
                 return p;
             if (type == p.type)
                 return p;
@@ -133,13 +123,13 @@ namespace SDDM {
             AuthPrompt::Type type = detectPrompt(msg);
             switch (type) {
                 case AuthPrompt::LOGIN_USER:
-                    m_currentRequest = Request(loginRequest);
+                    m_currentRequest = loginRequest;
                     return true;
                 case AuthPrompt::CHANGE_CURRENT:
-                    m_currentRequest = Request(changePassRequest);
+                    m_currentRequest = changePassRequest;
                     return true;
                 case AuthPrompt::CHANGE_NEW:
-                    m_currentRequest = Request(changePassNoOldRequest);
+                    m_currentRequest = changePassNoOldRequest;
                     return true;
                 default:
                     break;
@@ -153,9 +143,9 @@ namespace SDDM {
     }
 
     Auth::Info PamData::handleInfo(const struct pam_message* msg, bool predict) {
-        if (QString::fromLocal8Bit(msg->msg).indexOf(QRegExp(QStringLiteral("^Changing password for [^ ]+$")))) {
+        if (PromptClassifier::isPasswordChange(QString::fromLocal8Bit(msg->msg))) {
             if (predict)
-                m_currentRequest = Request(changePassRequest);
+                m_currentRequest = changePassRequest;
             return Auth::INFO_PASS_CHANGE_REQUIRED;
         }
         return Auth::INFO_UNKNOWN;
@@ -179,9 +169,9 @@ namespace SDDM {
             return invalidRequest;
     }
 
-    void PamData::completeRequest(const Request& request) {
+    void PamData::completeRequest(Request request) {
         if (request.prompts.length() != m_currentRequest.prompts.length()) {
-            qWarning() << "[PAM] Different request/response list length, ignoring";
+            qCWarning(SDDM_PAM) << "[PAM] Different request/response list length, ignoring";
             return;
         }
 
@@ -189,13 +179,42 @@ namespace SDDM {
             if (request.prompts[i].type != m_currentRequest.prompts[i].type
                 || request.prompts[i].message != m_currentRequest.prompts[i].message
                 || request.prompts[i].hidden != m_currentRequest.prompts[i].hidden) {
-                qWarning() << "[PAM] Order or type of the messages doesn't match, ignoring";
+                qCWarning(SDDM_PAM) << "[PAM] Order or type of the messages doesn't match, ignoring";
                 return;
             }
         }
 
-        m_currentRequest = request;
+        m_currentRequest = std::move(request);
+        m_sent = true;
+    }
+
+    void PamData::addCredentials(const QList<QByteArray> &credentials) {
+        m_credentials << credentials;
+    }
+
+    bool PamData::answerLocally() {
+        if (m_sent || m_credentials.isEmpty())
+            return false;
+
+        // only answer requests made of secrets we have enough of, anything
+        // else goes to the greeter like before
+        int needed = 0;
+        for (const Prompt &p : qAsConst(m_currentRequest.prompts)) {
+            if (!p.hidden)
+                return false;
+            if (p.response.isEmpty())
+                ++needed;
+        }
+        if (needed == 0 || needed > m_credentials.length())
+            return false;
+
+        qCDebug(SDDM_PAM) << "[PAM] Answering" << needed << "prompts with credentials sent ahead";
+        for (Prompt &p : m_currentRequest.prompts) {
+            if (p.response.isEmpty())
+                p.response = m_credentials.takeFirst();
+        }
         m_sent = true;
+        return true;
     }
 
 
@@ -221,6 +240,8 @@ namespace SDDM {
             service = QStringLiteral("sddm-greeter");
         else if (m_autologin)
             service = QStringLiteral("sddm-autologin");
+        else if (!m_service.isEmpty())
+            service = m_service;
         result = m_pam->start(service, user);
 
         if (!result)
@@ -230,6 +251,12 @@ namespace SDDM {
     }
 
     bool PamBackend::authenticate() {
+        // the greeter service permits anybody, see GreeterAuthentication
+        if (m_greeter && !mainConfig.GreeterAuthentication.get()) {
+            qCDebug(SDDM_PAM) << "[PAM] Starting the greeter without authentication";
+            return true;
+        }
+
         if (!m_pam->authenticate()) {
             m_app->error(m_pam->errorString(), Auth::ERROR_AUTHENTICATION);
             return false;
@@ -247,7 +274,7 @@ namespace SDDM {
             return false;
         }
 
-        QProcessEnvironment sessionEnv = m_app->session()->processEnvironment();
+        SessionEnvironment &sessionEnv = m_app->session()->environment();
         const auto sessionType = sessionEnv.value(QStringLiteral("XDG_SESSION_TYPE"));
         const auto sessionClass = sessionEnv.value(QStringLiteral("XDG_SESSION_CLASS"));
         if (sessionType == QLatin1String("x11") && (sessionClass == QLatin1String("user") || !m_displayServer)) {
@@ -263,7 +290,7 @@ namespace SDDM {
             m_pam->setItem(PAM_TTY, qPrintable(tty));
         }
 
-        if (!m_pam->putEnv(sessionEnv)) {
+        if (!m_pam->putEnv(sessionEnv.toStringList())) {
             m_app->error(m_pam->errorString(), Auth::ERROR_INTERNAL);
             return false;
         }
@@ -271,19 +298,18 @@ namespace SDDM {
             m_app->error(m_pam->errorString(), Auth::ERROR_INTERNAL);
             return false;
         }
-        sessionEnv.insert(m_pam->getEnv());
-        m_app->session()->setProcessEnvironment(sessionEnv);
+        sessionEnv.insert(SessionEnvironment::Pam, m_pam->getEnv());
         return Backend::openSession();
     }
 
     bool PamBackend::closeSession() {
         if (m_pam->isOpen()) {
-            qDebug() << "[PAM] Closing session";
+            qCDebug(SDDM_PAM) << "[PAM] Closing session";
             m_pam->closeSession();
             m_pam->setCred(PAM_DELETE_CRED);
             return true;
         }
-        qWarning() << "[PAM] Asked to close the session but it wasn't previously open";
+        qCWarning(SDDM_PAM) << "[PAM] Asked to close the session but it wasn't previously open";
         return Backend::closeSession();
     }
 
@@ -292,7 +318,7 @@ namespace SDDM {
     }
 
     int PamBackend::converse(int n, const struct pam_message **msg, struct pam_response **resp) {
-        qDebug() << "[PAM] Conversation with" << n << "messages";
+        qCDebug(SDDM_PAM) << "[PAM] Conversation with" << n << "messages";
 
         bool newRequest = false;
 
@@ -318,16 +344,16 @@ namespace SDDM {
         }
 
         if (newRequest) {
-            Request sent = m_data->getRequest();
-            Request received;
-
-            if (sent.valid()) {
-                received = m_app->request(sent);
+            // credentials sent ahead save a round trip to the greeter
+            if (m_data->getRequest().valid() && !m_data->answerLocally()) {
+                QList<QByteArray> credentials;
+                Request received = m_app->request(m_data->getRequest(), &credentials);
 
                 if (!received.valid())
                     return PAM_CONV_ERR;
 
-                m_data->completeRequest(received);
+                m_data->completeRequest(std::move(received));
+                m_data->addCredentials(credentials);
             }
         }
 
@@ -353,6 +379,8 @@ namespace SDDM {
 
             memcpy(resp[i]->resp, response.constData(), response.length());
             resp[i]->resp[response.length()] = '\0';
+            // PAM owns the only copy from here on
+            memset(response.data(), 0, response.length());
         }
 
         return PAM_SUCCESS;
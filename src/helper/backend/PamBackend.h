@@ -35,15 +35,21 @@ namespace SDDM {
     class PamData {
     public:
         PamData();
+        ~PamData();
 
         bool insertPrompt(const struct pam_message *msg, bool predict = true);
         Auth::Info handleInfo(const struct pam_message *msg, bool predict);
 
         const Request& getRequest() const;
-        void completeRequest(const Request& request);
+        void completeRequest(Request request);
 
         QByteArray getResponse(const struct pam_message *msg);
 
+        // secrets sent ahead by the daemon, for the hidden prompts still to come
+        void addCredentials(const QList<QByteArray> &credentials);
+        // fills the current request from those secrets, false if it still needs an answer
+        bool answerLocally();
+
     private:
         AuthPrompt::Type detectPrompt(const struct pam_message *msg) const;
 
@@ -52,6 +58,7 @@ namespace SDDM {
 
         bool m_sent { false };
         Request m_currentRequest { };
+        QList<QByteArray> m_credentials { };
     };
 
     class PamBackend : public Backend
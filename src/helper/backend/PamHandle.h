@@ -23,6 +23,7 @@
 
 #include <QtCore/QObject>
 #include <QtCore/QProcessEnvironment>
+#include <QtCore/QStringList>
 #include <security/pam_appl.h>
 
 namespace SDDM {
@@ -144,7 +145,7 @@ namespace SDDM {
         *
         * \return true on success
         */
-        bool putEnv(const QProcessEnvironment& env);
+        bool putEnv(const QStringList &env);
 
         /**
         * pam_end - termination of PAM transaction
@@ -0,0 +1,67 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "PromptClassifier.h"
+
+#include <QtCore/QRegularExpression>
+
+namespace SDDM {
+    namespace PromptClassifier {
+        static QRegularExpression compile(const char *pattern) {
+            QRegularExpression re(QLatin1String(pattern), QRegularExpression::CaseInsensitiveOption);
+            re.optimize();
+            return re;
+        }
+
+        AuthPrompt::Type classify(const QString &message, bool echoOff) {
+            if (!echoOff)
+                return AuthPrompt::LOGIN_USER;
+
+            static const QRegularExpression password = compile("\\bpassword\\b");
+            static const QRegularExpression repeat = compile("\\b(re-?(enter|type)|again|confirm|repeat)\\b");
+            static const QRegularExpression fresh = compile("\\bnew\\b");
+            static const QRegularExpression current = compile("\\b(old|current)\\b");
+
+            // nearly every prompt fails this already, skip the regular expressions then
+            if (!message.contains(QLatin1String("password"), Qt::CaseInsensitive))
+                return AuthPrompt::UNKNOWN;
+            if (!password.match(message).hasMatch())
+                return AuthPrompt::UNKNOWN;
+
+            if (repeat.match(message).hasMatch())
+                return AuthPrompt::CHANGE_REPEAT;
+            if (fresh.match(message).hasMatch())
+                return AuthPrompt::CHANGE_NEW;
+            if (current.match(message).hasMatch())
+                return AuthPrompt::CHANGE_CURRENT;
+            return AuthPrompt::LOGIN_PASSWORD;
+        }
+
+        bool isPasswordChange(const QString &message) {
+            static const QLatin1String prefix("Changing password for ");
+            if (!message.startsWith(prefix) || message.length() == prefix.size())
+                return false;
+            for (int i = prefix.size(); i < message.length(); ++i) {
+                if (message.at(i) == QLatin1Char(' '))
+                    return false;
+            }
+            return true;
+        }
+    }
+}
@@ -0,0 +1,49 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef PROMPTCLASSIFIER_H
+#define PROMPTCLASSIFIER_H
+
+#include <QtCore/QString>
+
+#include "AuthPrompt.h"
+
+namespace SDDM {
+    /**
+    * Recognizes the conversation messages of the PAM stack
+    *
+    * The patterns are compiled once per process, chatty modules don't pay
+    * for building them again on every message.
+    */
+    namespace PromptClassifier {
+        /**
+        * @param message text of the prompt
+        * @param echoOff true for PAM_PROMPT_ECHO_OFF prompts
+        * @return what the prompt asks for
+        */
+        AuthPrompt::Type classify(const QString &message, bool echoOff);
+        /**
+        * @return true if the info message announces a password change,
+        * which is "Changing password for <user>" in pam_unix
+        */
+        bool isPasswordChange(const QString &message);
+    }
+}
+
+#endif // PROMPTCLASSIFIER_H
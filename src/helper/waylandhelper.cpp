@@ -18,20 +18,29 @@
 ***************************************************************************/
 
 #include <QCoreApplication>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QFileInfo>
 #include <QStandardPaths>
 
 #include "Configuration.h"
+#include "ProcessSupervisor.h"
 
 #include "waylandhelper.h"
 #include "waylandsocketwatcher.h"
 #include "VirtualTerminal.h"
 
+#include <initializer_list>
+
 #include <fcntl.h>
+#include <signal.h>
 #include <unistd.h>
 
 namespace SDDM {
 
+// greeter failures hosted by one compositor before giving up on both
+static const int MaxGreeterRestarts = 3;
+
 WaylandHelper::WaylandHelper(QObject *parent)
     : QObject(parent)
     , m_environment(QProcessEnvironment::systemEnvironment())
@@ -52,34 +61,54 @@ void WaylandHelper::setEnvironment(const QProcessEnvironment &env)
 bool WaylandHelper::startCompositor(const QString &cmd)
 {
     m_watcher->start();
-    return startProcess(cmd, &m_serverProcess);
+
+    // let compositors with sd_notify support report readiness directly
+    auto env = m_environment;
+    if (!m_watcher->notifySocketPath().isEmpty())
+        env.insert(QStringLiteral("NOTIFY_SOCKET"), m_watcher->notifySocketPath());
+
+    const bool success = startProcess(cmd, env, &m_serverProcess);
+
+    // stop waiting as soon as the compositor is gone
+    m_watcher->watchProcess(success ? m_serverProcess : nullptr);
+    return success;
 }
 
-void stopProcess(QProcess *process)
+static void stopProcesses(std::initializer_list<QProcess *> processes)
 {
-    if (process && process->state() != QProcess::NotRunning) {
-        qInfo() << "Stopping..." << process->program();
-        process->terminate();
-        if (!process->waitForFinished(5000)) {
-            process->kill();
-            process->waitForFinished(25000);
+    // terminate everything first so that the grace periods overlap
+    QElapsedTimer elapsed;
+    elapsed.start();
+    for (QProcess *process : processes) {
+        if (process && process->state() != QProcess::NotRunning) {
+            qInfo() << "Stopping..." << process->program();
+            ProcessSupervisor::of(process)->sendSignal(SIGTERM);
         }
+    }
+
+    // called once the event loop is done, nothing else would wait
+    for (QProcess *process : processes) {
+        if (!process)
+            continue;
+        ProcessSupervisor::of(process)->stopAndWait(int(qMax<qint64>(0, 5000 - elapsed.elapsed())));
         process->deleteLater();
-        process = nullptr;
     }
 }
 
 void WaylandHelper::stop()
 {
+    m_stopping = true;
     m_watcher->stop();
-    stopProcess(m_greeterProcess);
-    stopProcess(m_serverProcess);
+    m_compositorReady = false;
+    stopProcesses({ m_greeterProcess, m_serverProcess });
+    m_greeterProcess = nullptr;
+    m_serverProcess = nullptr;
 }
 
-bool WaylandHelper::startProcess(const QString &cmd, QProcess **p)
+bool WaylandHelper::startProcess(const QString &cmd, const QProcessEnvironment &env, QProcess **p)
 {
     auto *process = new QProcess(this);
-    process->setProcessEnvironment(m_environment);
+    process->setProcessEnvironment(env);
     process->setInputChannelMode(QProcess::ForwardedInputChannel);
     connect(process, &QProcess::readyReadStandardError, this, [process] {
         qWarning() << process->readAllStandardError();
@@ -95,13 +124,18 @@ bool WaylandHelper::startProcess(const QString &cmd, QProcess **p)
             QCoreApplication::instance()->quit();
     });
 
+    connect(ProcessSupervisor::of(process), &ProcessSupervisor::failedToStart,
+            process, [cmd](const QString &error) {
+        qWarning("Failed to start \"%s\": %s", qPrintable(cmd), qPrintable(error));
+        QCoreApplication::instance()->quit();
+    });
+
+    // a failing fork is reported right away, a failing exec later on
     auto args = QProcess::splitCommand(cmd);
     const auto program = args.takeFirst();
     process->start(program, args);
-    if (!process->waitForStarted(10000)) {
-        qWarning("Failed to start \"%s\": %s",
-                 qPrintable(cmd),
-                 qPrintable(process->errorString()));
+    if (process->state() == QProcess::NotRunning) {
+        process->deleteLater();
         return false;
     }
 
@@ -114,34 +148,85 @@ bool WaylandHelper::startProcess(const QString &cmd, QProcess **p)
 
 void WaylandHelper::startGreeter(const QString &cmd)
 {
-    auto args = QProcess::splitCommand(cmd);
+    m_greeterCommand = cmd;
 
-    m_greeterProcess = new QProcess(this);
-    m_greeterProcess->setProgram(args.takeFirst());
-    m_greeterProcess->setArguments(args);
-    m_greeterProcess->setProcessEnvironment(m_environment);
-    connect(m_greeterProcess, &QProcess::readyReadStandardError, this, [this] {
-        qWarning() << m_greeterProcess->readAllStandardError();
-    });
-    connect(m_greeterProcess, &QProcess::readyReadStandardOutput, this, [this] {
-        qInfo() << m_greeterProcess->readAllStandardOutput();
-    });
-    connect(m_greeterProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            m_greeterProcess, [](int exitCode, QProcess::ExitStatus exitStatus) {
-        qDebug() << "wayland greeter finished" << exitCode << exitStatus;
-        QCoreApplication::instance()->quit();
-    });
-    if (m_watcher->status() == WaylandSocketWatcher::Started) {
-        m_greeterProcess->start();
+    if (m_compositorReady || m_watcher->status() == WaylandSocketWatcher::Started) {
+        compositorStarted();
     } else if (m_watcher->status() == WaylandSocketWatcher::Failed) {
         Q_EMIT failed();
     } else {
         connect(m_watcher, &WaylandSocketWatcher::failed, this, &WaylandHelper::failed);
-        connect(m_watcher, &WaylandSocketWatcher::started, this, [this] {
-            m_watcher->stop();
-            m_greeterProcess->start();
-        });
+        connect(m_watcher, &WaylandSocketWatcher::started, this, &WaylandHelper::compositorStarted);
+    }
+}
+
+void WaylandHelper::setPersistent(bool persistent)
+{
+    m_persistent = persistent;
+}
+
+void WaylandHelper::compositorStarted()
+{
+    if (!m_compositorReady) {
+        m_compositorReady = true;
+        m_socketName = QFileInfo(m_watcher->socketPath()).fileName();
+        m_watcher->stop();
     }
+
+    startGreeterProcess();
+}
+
+void WaylandHelper::startGreeterProcess()
+{
+    auto args = QProcess::splitCommand(m_greeterCommand);
+
+    auto *process = new QProcess(this);
+    m_greeterProcess = process;
+    process->setProgram(args.takeFirst());
+    process->setArguments(args);
+
+    // the compositor may not have picked wayland-0
+    auto env = m_environment;
+    env.insert(QStringLiteral("WAYLAND_DISPLAY"), m_socketName);
+    process->setProcessEnvironment(env);
+
+    connect(process, &QProcess::readyReadStandardError, this, [process] {
+        qWarning() << process->readAllStandardError();
+    });
+    connect(process, &QProcess::readyReadStandardOutput, this, [process] {
+        qInfo() << process->readAllStandardOutput();
+    });
+    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, [this, process](int exitCode, QProcess::ExitStatus exitStatus) {
+        qDebug() << "wayland greeter finished" << exitCode << exitStatus;
+        // stop() takes care of it
+        if (process != m_greeterProcess || m_stopping)
+            return;
+        m_greeterProcess = nullptr;
+        process->deleteLater();
+
+        // a greeter which failed gets another go in the same compositor,
+        // sparing the compositor start and the modeset
+        const bool failed = exitCode != 0 || exitStatus != QProcess::NormalExit;
+        if (failed && m_persistent && m_serverProcess
+                && m_serverProcess->state() == QProcess::Running && m_greeterRestarts < MaxGreeterRestarts) {
+            ++m_greeterRestarts;
+            qWarning() << "Starting the greeter again in the running compositor," << m_greeterRestarts << "of" << MaxGreeterRestarts;
+            startGreeterProcess();
+            return;
+        }
+
+        QCoreApplication::instance()->quit();
+    });
+    connect(ProcessSupervisor::of(process), &ProcessSupervisor::failedToStart,
+            this, [this, process](const QString &error) {
+        qWarning() << "Failed to start the greeter:" << error;
+        if (process != m_greeterProcess || m_stopping)
+            return;
+        QCoreApplication::instance()->quit();
+    });
+
+    process->start();
 }
 
 } // namespace SDDM
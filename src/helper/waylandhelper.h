@@ -35,9 +35,13 @@ public:
     void setEnvironment(const QProcessEnvironment &env);
 
     bool startCompositor(const QString &cmd);
+    // runs the greeter once the compositor is ready
     void startGreeter(const QString &cmd);
     void stop();
 
+    // a greeter which fails is started again in the same compositor
+    void setPersistent(bool persistent);
+
 Q_SIGNALS:
     void failed();
 
@@ -46,8 +50,16 @@ private:
     QProcess *m_serverProcess = nullptr;
     QProcess *m_greeterProcess = nullptr;
     WaylandSocketWatcher * const m_watcher;
+    QString m_greeterCommand;
+    QString m_socketName;
+    bool m_compositorReady = false;
+    bool m_persistent = false;
+    bool m_stopping = false;
+    int m_greeterRestarts = 0;
 
-    bool startProcess(const QString &cmd, QProcess **p = nullptr);
+    bool startProcess(const QString &cmd, const QProcessEnvironment &env, QProcess **p = nullptr);
+    void compositorStarted();
+    void startGreeterProcess();
 };
 
 } // namespace SDDM
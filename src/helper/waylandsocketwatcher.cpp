@@ -19,17 +19,59 @@
 ***************************************************************************/
 
 #include <QDebug>
+#include <QFile>
+#include <QProcess>
+#include <QSocketNotifier>
 #include <QStandardPaths>
 
 #include "waylandsocketwatcher.h"
 
+#include <fcntl.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#endif
+
 namespace SDDM {
 
+// Time the compositor is given to start
+static const int StartTimeout = 15000;
+
+static bool isWaylandSocketName(const QString &name)
+{
+    // wayland-N, but not wayland-N.lock
+    if (!name.startsWith(QLatin1String("wayland-")) || name.size() == 8)
+        return false;
+    for (int i = 8; i < name.size(); ++i) {
+        if (!name.at(i).isDigit())
+            return false;
+    }
+    return true;
+}
+
 WaylandSocketWatcher::WaylandSocketWatcher(QObject *parent )
     : QObject(parent)
     , m_runtimeDir(QDir(QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation)))
     , m_socketPath(m_runtimeDir.absoluteFilePath(QLatin1String("wayland-0")))
 {
+    // Give the compositor some time to start
+    m_timer.setSingleShot(true);
+    m_timer.setInterval(StartTimeout);
+    connect(&m_timer, &QTimer::timeout, this, [this] {
+        // Time is up and a socket was not found
+        qWarning("Wayland socket watcher for \"%s\" timed out",
+                 qPrintable(m_socketPath));
+        fail();
+    });
+}
+
+WaylandSocketWatcher::~WaylandSocketWatcher()
+{
+    cleanup();
 }
 
 WaylandSocketWatcher::Status WaylandSocketWatcher::status() const
@@ -42,57 +84,206 @@ QString WaylandSocketWatcher::socketPath() const
     return m_socketPath;
 }
 
+QString WaylandSocketWatcher::notifySocketPath() const
+{
+    return m_notifySocketPath;
+}
+
 void WaylandSocketWatcher::start()
 {
-    m_watcher = new QFileSystemWatcher(this);
+    m_status = Waiting;
 
-    // Give the compositor some time to start
-    m_timer.setSingleShot(true);
-    m_timer.setInterval(15000);
-    connect(&m_timer, &QTimer::timeout, this, [this] {
-        // Time is up and a socket was not found
-        if (!m_watcher.isNull())
-            m_watcher->deleteLater();
-        qWarning("Wayland socket watcher for \"%s\" timed out",
+    // Offer a notification socket, compositors with sd_notify support
+    // report READY=1 there
+    m_notifyFd = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (m_notifyFd != -1) {
+        const QString path = m_runtimeDir.absoluteFilePath(QStringLiteral("sddm-notify-%1").arg(::getpid()));
+        const QByteArray encodedPath = QFile::encodeName(path);
+        struct sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        ::unlink(encodedPath.constData());
+        if (size_t(encodedPath.size()) < sizeof(addr.sun_path)) {
+            memcpy(addr.sun_path, encodedPath.constData(), encodedPath.size());
+            if (::bind(m_notifyFd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) == 0) {
+                m_notifySocketPath = path;
+                m_notifyNotifier = new QSocketNotifier(m_notifyFd, QSocketNotifier::Read, this);
+                connect(m_notifyNotifier, &QSocketNotifier::activated, this, &WaylandSocketWatcher::readNotify);
+            }
+        }
+        if (m_notifySocketPath.isEmpty()) {
+            ::close(m_notifyFd);
+            m_notifyFd = -1;
+        }
+    }
+
+    // Watch for the socket to be created
+    if (!m_runtimeDir.exists() || !watchDirectory()) {
+        qWarning("Cannot watch directory \"%s\" for Wayland socket \"%s\"",
+                 qPrintable(m_runtimeDir.absolutePath()),
                  qPrintable(m_socketPath));
-        m_status = Failed;
-        Q_EMIT failed();
-    });
+        fail();
+        return;
+    }
+
+    // Start
+    m_timer.start();
+}
+
+bool WaylandSocketWatcher::watchDirectory()
+{
+#ifdef Q_OS_LINUX
+    // Only creations are interesting, not every change to the directory
+    m_inotifyFd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (m_inotifyFd != -1) {
+        if (inotify_add_watch(m_inotifyFd, QFile::encodeName(m_runtimeDir.absolutePath()).constData(),
+                              IN_CREATE | IN_MOVED_TO) != -1) {
+            m_inotifyNotifier = new QSocketNotifier(m_inotifyFd, QSocketNotifier::Read, this);
+            connect(m_inotifyNotifier, &QSocketNotifier::activated, this, &WaylandSocketWatcher::readInotify);
+            return true;
+        }
+        ::close(m_inotifyFd);
+        m_inotifyFd = -1;
+    }
+#endif
+
+    m_watcher = new QFileSystemWatcher(this);
 
     // Check if the socket exists
     connect(m_watcher, &QFileSystemWatcher::directoryChanged, this,
             [this](const QString &path) {
         qDebug() << "Directory" << path << "has changed, checking for" << m_socketPath;
 
-        if (QFile::exists(m_socketPath)) {
-            m_timer.stop();
-            if (!m_watcher.isNull())
-                m_watcher->deleteLater();
-            m_status = Started;
-            Q_EMIT started();
-        }
+        if (QFile::exists(m_socketPath))
+            succeed();
     });
 
-    // Watch for runtime directory changes
-    if (!m_runtimeDir.exists() || !m_watcher->addPath(m_runtimeDir.absolutePath())) {
-        qWarning("Cannot watch directory \"%s\" for Wayland socket \"%s\"",
-                 qPrintable(m_runtimeDir.absolutePath()),
+    return m_watcher->addPath(m_runtimeDir.absolutePath());
+}
+
+void WaylandSocketWatcher::readInotify()
+{
+#ifdef Q_OS_LINUX
+    alignas(struct inotify_event) char buffer[4096];
+    for (;;) {
+        const ssize_t size = ::read(m_inotifyFd, buffer, sizeof(buffer));
+        if (size <= 0)
+            return;
+
+        for (ssize_t offset = 0; offset < size; ) {
+            const auto *event = reinterpret_cast<const struct inotify_event *>(buffer + offset);
+            offset += sizeof(struct inotify_event) + event->len;
+            if (event->len > 0)
+                checkSocket(QFile::decodeName(event->name));
+            if (m_status != Waiting)
+                return;
+        }
+    }
+#endif
+}
+
+void WaylandSocketWatcher::readNotify()
+{
+    char buffer[4096];
+    for (;;) {
+        const ssize_t size = ::recv(m_notifyFd, buffer, sizeof(buffer) - 1, 0);
+        if (size <= 0)
+            return;
+
+        const QByteArray message = QByteArray::fromRawData(buffer, int(size));
+        for (const QByteArray &line : message.split('\n')) {
+            if (line == "READY=1") {
+                qDebug() << "Compositor reported readiness";
+                succeed();
+                return;
+            }
+        }
+    }
+}
+
+void WaylandSocketWatcher::checkSocket(const QString &name)
+{
+    if (!isWaylandSocketName(name))
+        return;
+
+    // The greeter will be pointed at whatever name the compositor picked
+    m_socketPath = m_runtimeDir.absoluteFilePath(name);
+    qDebug() << "Wayland socket" << m_socketPath << "was created";
+    succeed();
+}
+
+void WaylandSocketWatcher::watchProcess(QProcess *process)
+{
+    if (m_status != Waiting)
+        return;
+
+    if (!process || process->state() == QProcess::NotRunning) {
+        qWarning("Compositor is not running, not waiting for \"%s\"",
                  qPrintable(m_socketPath));
-        m_watcher->deleteLater();
-        m_status = Failed;
-        Q_EMIT failed();
+        fail();
+        return;
     }
 
-    // Start
-    m_timer.start();
+    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, [this] {
+        if (m_status != Waiting)
+            return;
+        qWarning("Compositor exited before creating \"%s\"",
+                 qPrintable(m_socketPath));
+        fail();
+    });
 }
 
-void WaylandSocketWatcher::stop()
+void WaylandSocketWatcher::succeed()
+{
+    if (m_status != Waiting)
+        return;
+    cleanup();
+    m_status = Started;
+    Q_EMIT started();
+}
+
+void WaylandSocketWatcher::fail()
+{
+    cleanup();
+    m_status = Failed;
+    Q_EMIT failed();
+}
+
+void WaylandSocketWatcher::cleanup()
 {
     m_timer.stop();
     if (!m_watcher.isNull())
         m_watcher->deleteLater();
     m_watcher.clear();
+
+    // may be called from the notifiers' own signals
+    if (m_inotifyNotifier) {
+        m_inotifyNotifier->setEnabled(false);
+        m_inotifyNotifier->deleteLater();
+        m_inotifyNotifier = nullptr;
+    }
+    if (m_inotifyFd != -1) {
+        ::close(m_inotifyFd);
+        m_inotifyFd = -1;
+    }
+
+    if (m_notifyNotifier) {
+        m_notifyNotifier->setEnabled(false);
+        m_notifyNotifier->deleteLater();
+        m_notifyNotifier = nullptr;
+    }
+    if (m_notifyFd != -1) {
+        ::close(m_notifyFd);
+        m_notifyFd = -1;
+    }
+    if (!m_notifySocketPath.isEmpty()) {
+        QFile::remove(m_notifySocketPath);
+        m_notifySocketPath.clear();
+    }
+}
+
+void WaylandSocketWatcher::stop()
+{
+    cleanup();
     m_status = Stopped;
     Q_EMIT stopped();
 }
@@ -25,8 +25,19 @@
 #include <QPointer>
 #include <QTimer>
 
+class QProcess;
+class QSocketNotifier;
+
 namespace SDDM {
 
+/**
+ * Waits for a compositor to become ready.
+ *
+ * Readiness is either a wayland-N socket showing up in the runtime
+ * directory, or READY=1 sent to the sd_notify(3) style socket returned by
+ * notifySocketPath(). The wait fails early if the process given to
+ * watchProcess() exits first.
+ */
 class WaylandSocketWatcher : public QObject
 {
     Q_OBJECT
@@ -34,17 +45,21 @@ public:
     enum Status {
         Started,
         Stopped,
-        Failed
+        Failed,
+        Waiting
     };
     Q_ENUM(Status)
 
     explicit WaylandSocketWatcher(QObject *parent = nullptr);
+    ~WaylandSocketWatcher();
 
     Status status() const;
     QString socketPath() const;
+    QString notifySocketPath() const;
 
     void start();
     void stop();
+    void watchProcess(QProcess *process);
 
 Q_SIGNALS:
     void started();
@@ -57,6 +72,20 @@ private:
     QString m_socketPath;
     QTimer m_timer;
     QPointer<QFileSystemWatcher> m_watcher;
+
+    int m_inotifyFd = -1;
+    QSocketNotifier *m_inotifyNotifier = nullptr;
+    int m_notifyFd = -1;
+    QSocketNotifier *m_notifyNotifier = nullptr;
+    QString m_notifySocketPath;
+
+    bool watchDirectory();
+    void readInotify();
+    void readNotify();
+    void checkSocket(const QString &name);
+    void succeed();
+    void fail();
+    void cleanup();
 };
 
 } // namespace SDDM
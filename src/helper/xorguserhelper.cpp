@@ -22,6 +22,8 @@
 #include <QStandardPaths>
 
 #include "Configuration.h"
+#include "ProcessSupervisor.h"
+#include "XcbCursor.h"
 
 #include "xorguserhelper.h"
 
@@ -30,6 +32,16 @@
 
 namespace SDDM {
 
+// nothing waits for @p process, it is killed past @p deadline
+static void runInBackground(QProcess *process, int deadline)
+{
+    ProcessSupervisor *supervisor = ProcessSupervisor::of(process);
+    supervisor->setDeadline(deadline);
+    QObject::connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+                     process, &QObject::deleteLater);
+    QObject::connect(supervisor, &ProcessSupervisor::failedToStart, process, &QObject::deleteLater);
+}
+
 XOrgUserHelper::XOrgUserHelper(QObject *parent)
     : QObject(parent)
     , m_environment(QProcessEnvironment::systemEnvironment())
@@ -85,11 +97,8 @@ void XOrgUserHelper::stop()
 {
     if (m_serverProcess) {
         qInfo("Stopping server...");
-        m_serverProcess->terminate();
-        if (!m_serverProcess->waitForFinished(5000)) {
-            m_serverProcess->kill();
-            m_serverProcess->waitForFinished(25000);
-        }
+        // called once the event loop is done, nothing else would wait
+        ProcessSupervisor::of(m_serverProcess)->stopAndWait(5000);
         m_serverProcess->deleteLater();
         m_serverProcess = nullptr;
 
@@ -115,17 +124,15 @@ bool XOrgUserHelper::startProcess(const QString &cmd,
     connect(process, &QProcess::readyReadStandardOutput, this, [process] {
         qInfo() << process->readAllStandardOutput();
     });
-    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            process, [](int exitCode, QProcess::ExitStatus exitStatus) {
-        if (exitCode != 0 || exitStatus != QProcess::NormalExit)
-            QCoreApplication::instance()->quit();
+    connect(ProcessSupervisor::of(process), &ProcessSupervisor::failedToStart,
+            process, [cmd](const QString &error) {
+        qWarning("Failed to start \"%s\": %s", qPrintable(cmd), qPrintable(error));
     });
 
+    // a failing fork is reported right away, a failing exec later on
     process->start(program, args);
-    if (!process->waitForStarted(10000)) {
-        qWarning("Failed to start \"%s\": %s",
-                 qPrintable(cmd),
-                 qPrintable(process->errorString()));
+    if (process->state() == QProcess::NotRunning) {
+        process->deleteLater();
         return false;
     }
 
@@ -176,6 +183,15 @@ bool XOrgUserHelper::startServer(const QString &cmd)
         return false;
     }
 
+    // there is no session without its server
+    connect(m_serverProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, [](int exitCode, QProcess::ExitStatus exitStatus) {
+        if (exitCode != 0 || exitStatus != QProcess::NormalExit)
+            QCoreApplication::instance()->quit();
+    });
+    connect(ProcessSupervisor::of(m_serverProcess), &ProcessSupervisor::failedToStart,
+            QCoreApplication::instance(), &QCoreApplication::quit);
+
     // Close the other side of pipe in our process, otherwise reading
     // from it may stuck even X server exit
     ::close(pipeFds[1]);
@@ -220,37 +236,38 @@ void XOrgUserHelper::startDisplayCommand()
     env.insert(QStringLiteral("DISPLAY"), m_display);
     env.insert(QStringLiteral("XAUTHORITY"), m_xauth.authPath());
 
-    // Set cursor
+    // Set cursor, falling back to xsetroot
     qInfo("Setting default cursor...");
-    QProcess *setCursor = nullptr;
-    if (startProcess(QStringLiteral("xsetroot -cursor_name left_ptr"), env, &setCursor)) {
-        if (!setCursor->waitForFinished(1000)) {
-            qWarning() << "Could not setup default cursor";
-            setCursor->kill();
-        }
-        setCursor->deleteLater();
-    }
+    XcbCursor::setRootCursor(m_display, m_xauth.cookie(),
+                             mainConfig.Theme.CursorTheme.get(), mainConfig.Theme.CursorSize.get(),
+                             this, [this, env] (bool success) {
+        QProcess *setCursor = nullptr;
+        if (!success && startProcess(QStringLiteral("xsetroot -cursor_name left_ptr"), env, &setCursor))
+            runInBackground(setCursor, 1000);
+    });
 
     // Display setup script
     auto cmd = mainConfig.X11.DisplayCommand.get();
     qInfo("Running display setup script: %s", qPrintable(cmd));
     QProcess *displayScript = nullptr;
-    if (startProcess(cmd, env, &displayScript)) {
-        if (!displayScript->waitForFinished(30000))
-            displayScript->kill();
-        displayScript->deleteLater();
-    }
+    if (startProcess(cmd, env, &displayScript))
+        runInBackground(displayScript, 30000);
 }
 
 void XOrgUserHelper::displayFinished()
 {
     auto cmd = mainConfig.X11.DisplayStopCommand.get();
     qInfo("Running display stop script: %s", qPrintable(cmd));
-    QProcess *displayStopScript = nullptr;
-    if (startProcess(cmd, sessionEnvironment(), &displayStopScript)) {
-        if (!displayStopScript->waitForFinished(5000))
-            displayStopScript->kill();
-        displayStopScript->deleteLater();
+
+    // the helper is about to exit, don't wait for the script
+    auto args = QProcess::splitCommand(cmd);
+    if (!args.isEmpty()) {
+        QProcess displayStopScript;
+        displayStopScript.setProgram(args.takeFirst());
+        displayStopScript.setArguments(args);
+        displayStopScript.setProcessEnvironment(sessionEnvironment());
+        if (!displayStopScript.startDetached())
+            qWarning("Failed to start \"%s\"", qPrintable(cmd));
     }
 
     // Remove xauthority file
@@ -0,0 +1,320 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "Benchmarks.h"
+
+#include "AuthMessages.h"
+#include "Configuration.h"
+#include "SafeDataStream.h"
+#include "Session.h"
+#include "SessionModel.h"
+#include "UserModel.h"
+
+#include <QtTest/QtTest>
+#include <QtCore/QBuffer>
+#include <QtCore/QDir>
+#include <QtCore/QEventLoop>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QProcess>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace SDDM;
+
+QTEST_MAIN(Benchmarks);
+
+static const int s_sessionCount = 50;
+static const int s_userCount = 2000;
+
+static bool writeFile(const QString &path, const QByteArray &contents) {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    return file.write(contents) == contents.length();
+}
+
+static Request sampleRequest() {
+    Request request;
+    request.prompts << Prompt(AuthPrompt::LOGIN_USER, QStringLiteral("login:"), false);
+    request.prompts << Prompt(AuthPrompt::LOGIN_PASSWORD, QStringLiteral("Password: "), true);
+    request.prompts[0].response = QByteArrayLiteral("alice");
+    request.prompts[1].response = QByteArrayLiteral("correct horse battery staple");
+    return request;
+}
+
+void Benchmarks::initTestCase() {
+    QVERIFY(m_dir.isValid());
+
+    // configuration with a drop-in directory, as distributions ship it
+    QByteArray conf;
+    conf += "[General]\nHaltCommand=/usr/bin/systemctl poweroff\nRebootCommand=/usr/bin/systemctl reboot\n"
+            "Numlock=on\nLogRules=sddm.pam.debug=false,sddm.trace.info=true\n\n";
+    conf += "[Theme]\nThemeDir=/usr/share/sddm/themes\nCurrent=breeze\nCursorTheme=breeze_cursors\n\n";
+    conf += "[X11]\nServerPath=/usr/bin/X\nServerArguments=-nolisten tcp\nSessionDir=/usr/share/xsessions\n\n";
+    conf += "[Users]\nMinimumUid=1000\nMaximumUid=60000\nHideShells=/sbin/nologin,/bin/false\n";
+    QVERIFY(writeFile(BENCH_CONF_FILE, conf));
+    QDir(BENCH_CONF_DIR).removeRecursively();
+    QVERIFY(QDir().mkdir(BENCH_CONF_DIR));
+    QDir(BENCH_SYS_CONF_DIR).removeRecursively();
+    QVERIFY(QDir().mkdir(BENCH_SYS_CONF_DIR));
+    QVERIFY(writeFile(BENCH_SYS_CONF_DIR + QStringLiteral("/10-theme.conf"), "[Theme]\nCurrent=maui\n"));
+    QVERIFY(writeFile(BENCH_CONF_DIR + QStringLiteral("/20-users.conf"), "[Users]\nHideUsers=guest\n"));
+
+    // session files, read through the main configuration's session directories
+    const QString x11Dir = m_dir.filePath(QStringLiteral("xsessions"));
+    const QString waylandDir = m_dir.filePath(QStringLiteral("wayland-sessions"));
+    QVERIFY(QDir().mkpath(x11Dir));
+    QVERIFY(QDir().mkpath(waylandDir));
+    for (int i = 0; i < s_sessionCount; ++i) {
+        const QByteArray name = "session" + QByteArray::number(i);
+        const QByteArray entry = "[Desktop Entry]\nName=Session " + QByteArray::number(i) +
+                "\nComment=Synthetic session\nExec=/usr/bin/" + name +
+                "\nDesktopNames=" + name + "\nType=Application\n";
+        QVERIFY(writeFile(x11Dir + QLatin1Char('/') + QString::fromLatin1(name) + QStringLiteral(".desktop"), entry));
+        QVERIFY(writeFile(waylandDir + QLatin1Char('/') + QString::fromLatin1(name) + QStringLiteral(".desktop"), entry));
+    }
+    mainConfig.X11.SessionDir.set(x11Dir);
+    mainConfig.Wayland.SessionDir.set(waylandDir);
+
+    // synthetic passwd database, served by nss_wrapper when it is preloaded
+    QByteArray passwd, group;
+    passwd += "root:x:0:0:root:/root:/bin/bash\n";
+    for (int i = 0; i < s_userCount; ++i) {
+        const QByteArray uid = QByteArray::number(1000 + i);
+        passwd += "user" + uid + ":x:" + uid + ":100:User " + uid + ":/home/user" + uid + ":/bin/bash\n";
+    }
+    group += "root:x:0:\nusers:x:100:\n";
+    QVERIFY(writeFile(m_dir.filePath(QStringLiteral("passwd")), passwd));
+    QVERIFY(writeFile(m_dir.filePath(QStringLiteral("group")), group));
+    qputenv("NSS_WRAPPER_PASSWD", QFile::encodeName(m_dir.filePath(QStringLiteral("passwd"))));
+    qputenv("NSS_WRAPPER_GROUP", QFile::encodeName(m_dir.filePath(QStringLiteral("group"))));
+    mainConfig.Theme.EnableAvatars.set(false);
+}
+
+void Benchmarks::cleanupTestCase() {
+    QFile::remove(BENCH_CONF_FILE);
+    QDir(BENCH_CONF_DIR).removeRecursively();
+    QDir(BENCH_SYS_CONF_DIR).removeRecursively();
+}
+
+void Benchmarks::ConfigLoad() {
+    BenchmarkConfig config;
+    QBENCHMARK {
+        config.load();
+    }
+    QCOMPARE(config.Theme.Current.get(), QStringLiteral("maui"));
+    QCOMPARE(config.Users.HideUsers.get(), QStringList() << QStringLiteral("guest"));
+}
+
+void Benchmarks::SessionSetTo() {
+    Session session;
+    QBENCHMARK {
+        for (int i = 0; i < s_sessionCount; ++i)
+            session.setTo(Session::X11Session, QStringLiteral("session%1").arg(i));
+    }
+    QVERIFY(session.isValid());
+}
+
+void Benchmarks::SessionModelPopulate() {
+    QBENCHMARK {
+        SessionModel model;
+        Q_UNUSED(model);
+    }
+}
+
+void Benchmarks::UserModelConstruction() {
+    if (!qgetenv("LD_PRELOAD").contains("nss_wrapper"))
+        QSKIP("needs libnss_wrapper.so in LD_PRELOAD to read the synthetic passwd file");
+
+    int count = 0;
+    QBENCHMARK {
+        UserModel model(true);
+        if (model.loading()) {
+            QEventLoop loop;
+            connect(&model, &UserModel::loadingChanged, &loop, &QEventLoop::quit);
+            loop.exec();
+        }
+        count = model.rowCount();
+    }
+    QCOMPARE(count, s_userCount);
+}
+
+void Benchmarks::SafeDataStreamRoundTrip() {
+    const Request request = sampleRequest();
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::ReadWrite));
+    SafeDataStream out(&buffer);
+    SafeDataStream in(&buffer);
+
+    QBENCHMARK {
+        buffer.seek(0);
+        out << quint32(REQUEST) << request;
+        out.send();
+
+        buffer.seek(0);
+        in.receive();
+        quint32 msg = 0;
+        Request received;
+        in >> msg >> received;
+        QCOMPARE(msg, quint32(REQUEST));
+        QVERIFY(received == request);
+    }
+}
+
+void Benchmarks::RequestSerialization() {
+    const Request request = sampleRequest();
+    QBENCHMARK {
+        QByteArray data;
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out << request;
+
+        QDataStream in(data);
+        Request received;
+        in >> received;
+        QVERIFY(received == request);
+    }
+}
+
+void Benchmarks::PromptSerialization() {
+    const Prompt prompt = sampleRequest().prompts.at(1);
+    QBENCHMARK {
+        QByteArray data;
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out << prompt;
+
+        QDataStream in(data);
+        Prompt received;
+        in >> received;
+        QVERIFY(received == prompt);
+    }
+}
+
+void Benchmarks::EnvironmentDeltaRoundTrip() {
+    // what the daemon sends back after authentication, most of it is
+    // already in the environment sddm-helper was started with
+    const QProcessEnvironment base = QProcessEnvironment::systemEnvironment();
+    QProcessEnvironment env = base;
+    env.insert(QStringLiteral("XDG_SEAT"), QStringLiteral("seat0"));
+    env.insert(QStringLiteral("XDG_VTNR"), QStringLiteral("1"));
+    env.insert(QStringLiteral("XDG_SESSION_CLASS"), QStringLiteral("user"));
+    env.insert(QStringLiteral("XDG_SESSION_TYPE"), QStringLiteral("x11"));
+    env.insert(QStringLiteral("XDG_SESSION_DESKTOP"), QStringLiteral("KDE"));
+    env.insert(QStringLiteral("DESKTOP_SESSION"), QStringLiteral("plasma"));
+    env.insert(QStringLiteral("DISPLAY"), QStringLiteral(":0"));
+
+    QBENCHMARK {
+        QByteArray data;
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out << EnvironmentDelta(env, base);
+
+        QDataStream in(data);
+        EnvironmentDelta received;
+        in >> received;
+        QVERIFY(received.apply(base) == env);
+    }
+}
+
+// reads the next frame from the helper, false once it didn't come in time
+static bool readFrame(int fd, QByteArray &payload) {
+    QByteArray data;
+    QElapsedTimer timer;
+    timer.start();
+    qint64 length = -1;
+    while (timer.elapsed() < 5000) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (::poll(&pfd, 1, 100) <= 0)
+            continue;
+        char buffer[256];
+        const ssize_t count = ::read(fd, buffer, sizeof(buffer));
+        if (count <= 0)
+            return false;
+        data.append(buffer, int(count));
+        if (length < 0 && data.size() >= int(sizeof(length)))
+            memcpy(&length, data.constData(), sizeof(length));
+        if (length >= 0 && data.size() >= int(sizeof(length) + length)) {
+            payload = data.mid(sizeof(length), int(length));
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool writeFrame(int fd, const QByteArray &payload) {
+    const qint64 length = payload.size();
+    QByteArray data(reinterpret_cast<const char *>(&length), sizeof(length));
+    data.append(payload);
+    return ::write(fd, data.constData(), size_t(data.size())) == data.size();
+}
+
+void Benchmarks::HelperFirstRequest() {
+    // from the exec of a pooled sddm-helper until it asks for the
+    // credentials of the login it was assigned, the part of every
+    // login the daemon waits for
+    const QString helper = QStringLiteral(HELPER_PATH);
+    if (!QFile::exists(helper))
+        QSKIP("sddm-helper-mock wasn't built");
+
+    QByteArray assign;
+    {
+        QDataStream out(&assign, QIODevice::WriteOnly);
+        out << Msg::ASSIGN << QString() << QString() << false << QString() << false << QString() << QString();
+    }
+
+    static const int rounds = 20;
+    qint64 total = 0;
+    for (int i = 0; i < rounds; ++i) {
+        int fds[2];
+        QVERIFY(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        ::fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+
+        QProcess process;
+        process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        QElapsedTimer timer;
+        timer.start();
+        process.start(helper, { QStringLiteral("--fd"), QString::number(fds[1]), QStringLiteral("--pool") });
+        ::close(fds[1]);
+
+        QByteArray hello, request;
+        const bool received = readFrame(fds[0], hello) && writeFrame(fds[0], assign)
+                && readFrame(fds[0], request);
+        total += timer.nsecsElapsed();
+
+        process.kill();
+        process.waitForFinished();
+        ::close(fds[0]);
+        QVERIFY(received);
+
+        QDataStream helloIn(hello);
+        Msg m = Msg::MSG_UNKNOWN;
+        quint32 version = 0;
+        helloIn >> m >> version;
+        QCOMPARE(m, Msg::HELLO);
+        QCOMPARE(version, HelperProtocolVersion);
+
+        QDataStream requestIn(request);
+        requestIn >> m;
+        QCOMPARE(m, Msg::REQUEST);
+    }
+
+    QTest::setBenchmarkResult(qreal(total) / rounds / 1000000, QTest::WalltimeMilliseconds);
+}
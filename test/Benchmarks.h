@@ -0,0 +1,80 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <QObject>
+#include <QTemporaryDir>
+
+#include "ConfigReader.h"
+
+#define BENCH_CONF_FILE QStringLiteral("bench.conf")
+#define BENCH_CONF_DIR QStringLiteral("benchconfdir")
+#define BENCH_SYS_CONF_DIR QStringLiteral("benchconfdir2")
+
+// shaped like the main configuration, so loading it costs about the same
+Config (BenchmarkConfig, BENCH_CONF_FILE, BENCH_CONF_DIR, BENCH_SYS_CONF_DIR,
+    Entry(    HaltCommand,         QString,     QString(),     _S("Halt command"));
+    Entry(    RebootCommand,       QString,     QString(),     _S("Reboot command"));
+    Entry(    Numlock,             QString,     QString(),     _S("Initial NumLock state"));
+    Entry(    DisplayStartLimit,   int,         0,             _S("Concurrent display starts"));
+    Entry(    LogRules,            QStringList, QStringList(), _S("Logging rules"));
+    Section(Theme,
+        Entry(ThemeDir,            QString,     QString(),     _S("Theme directory path"));
+        Entry(Current,             QString,     QString(),     _S("Current theme name"));
+        Entry(CursorTheme,         QString,     QString(),     _S("Cursor theme"));
+        Entry(EnableAvatars,       bool,        true,          _S("Enable avatars"));
+    );
+    Section(X11,
+        Entry(ServerPath,          QString,     QString(),     _S("X server path"));
+        Entry(ServerArguments,     QString,     QString(),     _S("X server arguments"));
+        Entry(SessionDir,          QString,     QString(),     _S("X session directory"));
+        Entry(MinimumVT,           int,         1,             _S("Minimum VT"));
+    );
+    Section(Users,
+        Entry(MinimumUid,          int,         1000,          _S("Minimum user id"));
+        Entry(MaximumUid,          int,         60000,         _S("Maximum user id"));
+        Entry(HideUsers,           QStringList, QStringList(), _S("Hidden users"));
+        Entry(HideShells,          QStringList, QStringList(), _S("Hidden shells"));
+    );
+);
+
+class Benchmarks : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void ConfigLoad();
+    void SessionSetTo();
+    void SessionModelPopulate();
+    void UserModelConstruction();
+    void SafeDataStreamRoundTrip();
+    void RequestSerialization();
+    void PromptSerialization();
+    void EnvironmentDeltaRoundTrip();
+    void HelperFirstRequest();
+
+private:
+    QTemporaryDir m_dir;
+};
+
+#endif // BENCHMARKS_H
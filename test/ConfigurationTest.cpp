@@ -244,4 +244,146 @@ void ConfigurationTest::FileChanged()
     QVERIFY(config->Int.get() == 222222);
 }
 
+void ConfigurationTest::Watched()
+{
+    config->setWatched(true);
+    quint64 generation = config->generation();
+
+    // nothing changed, load() must not touch anything
+    config->load();
+    QVERIFY(config->generation() == generation);
+
+    QFile confFile(CONF_FILE);
+    confFile.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    confFile.write("String=a\n");
+    confFile.write("Int=1234\n");
+    confFile.close();
+
+    QTRY_VERIFY(config->generation() != generation);
+    config->load();
+    QVERIFY(config->String.get() == QStringLiteral("a"));
+    QVERIFY(config->Int.get() == 1234);
+
+    // entries removed from the file go back to their defaults
+    generation = config->generation();
+    confFile.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    confFile.write("String=b\n");
+    confFile.close();
+
+    QTRY_VERIFY(config->generation() != generation);
+    config->load();
+    QVERIFY(config->String.get() == QStringLiteral("b"));
+    QVERIFY(config->Int.get() == TEST_INT_1);
+}
+
+void ConfigurationTest::EntrySave()
+{
+    QFile confFile(CONF_FILE);
+    confFile.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    confFile.write("[Section]\n");
+    confFile.write("String=a # keep me\n");
+    confFile.write("Int=1\n");
+    confFile.close();
+    config->load();
+
+    {
+        SDDM::ConfigBatch batch(*config);
+        config->Section.String.set(QStringLiteral("b"));
+        config->Section.String.save();
+        config->Section.Int.set(2);
+        config->Section.Int.save();
+        // nothing is written before the batch ends
+        QVERIFY(confFile.open(QIODevice::ReadOnly));
+        QVERIFY(confFile.readAll().contains("String=a"));
+        confFile.close();
+    }
+
+    QVERIFY(confFile.open(QIODevice::ReadOnly));
+    QByteArray contents = confFile.readAll();
+    confFile.close();
+    QVERIFY(contents.contains("String=b # keep me\n"));
+    QVERIFY(contents.contains("Int=2\n"));
+    QVERIFY(!contents.contains("String=a"));
+
+    // entries missing from the file are added by the full save
+    config->Section.Boolean.set(false);
+    config->Section.Boolean.save();
+    QVERIFY(confFile.open(QIODevice::ReadOnly));
+    contents = confFile.readAll();
+    QVERIFY(contents.contains("Boolean=false"));
+    QVERIFY(contents.contains("String=b"));
+}
+
+void ConfigurationTest::EntrySaveDuplicate()
+{
+    QFile confFile(CONF_FILE);
+    confFile.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    confFile.write("[Section]\n");
+    confFile.write("String=a\n");
+    confFile.write("String=c\n");
+    confFile.close();
+    config->load();
+    QCOMPARE(config->Section.String.get(), QStringLiteral("c"));
+
+    // the last one is loaded, all of them are written
+    config->Section.String.set(QStringLiteral("b"));
+    config->Section.String.save();
+    QVERIFY(confFile.open(QIODevice::ReadOnly));
+    const QByteArray contents = confFile.readAll();
+    confFile.close();
+    QVERIFY(!contents.contains("String=a"));
+    QVERIFY(!contents.contains("String=c"));
+    QVERIFY(contents.contains("String=b"));
+}
+
+void ConfigurationTest::EntrySaveChangedOnDisk()
+{
+    QFile confFile(CONF_FILE);
+    confFile.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    confFile.write("[Section]\n");
+    confFile.write("String=a\n");
+    confFile.write("Int=1\n");
+    confFile.close();
+    config->load();
+
+    {
+        SDDM::ConfigBatch batch(*config);
+        config->Section.String.set(QStringLiteral("b"));
+        config->Section.String.save();
+
+        // edited by someone else while the batch is pending
+        confFile.open(QIODevice::WriteOnly | QIODevice::Truncate);
+        confFile.write("[Section]\n");
+        confFile.write("String=a\n");
+        confFile.write("Int=3 # edited\n");
+        confFile.close();
+    }
+
+    QVERIFY(confFile.open(QIODevice::ReadOnly));
+    const QByteArray contents = confFile.readAll();
+    confFile.close();
+    QVERIFY(contents.contains("String=b\n"));
+    QVERIFY(contents.contains("Int=3 # edited\n"));
+}
+
+void ConfigurationTest::Unload() {
+    delete config;
+    QFile confFile(CONF_FILE);
+    QVERIFY(confFile.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    confFile.write("String=a\n");
+    confFile.write("Int=99999\n");
+    confFile.close();
+    config = new TestConfig;
+    QCOMPARE(config->String.get(), QStringLiteral("a"));
+
+    config->unload();
+    QCOMPARE(config->String.get(), TEST_STRING_1);
+    QCOMPARE(config->Int.get(), TEST_INT_1);
+
+    // the unchanged files are read again
+    config->load();
+    QCOMPARE(config->String.get(), QStringLiteral("a"));
+    QCOMPARE(config->Int.get(), 99999);
+}
+
 #include "moc_ConfigurationTest.cpp"
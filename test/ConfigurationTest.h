@@ -95,6 +95,11 @@ private slots:
     void RightOnInit();
     void RightOnInitDir();
     void FileChanged();
+    void Watched();
+    void EntrySave();
+    void EntrySaveDuplicate();
+    void EntrySaveChangedOnDisk();
+    void Unload();
 
 private:
     TestConfig *config;
@@ -0,0 +1,137 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "DesktopEntryTest.h"
+
+#include <QtTest/QtTest>
+#include <QtCore/QFile>
+#include <QtCore/QTextStream>
+
+QTEST_MAIN(DesktopEntryTest);
+
+static const char s_entry[] =
+    "# a typical session file\n"
+    "[Desktop Entry]\n"
+    "Name=Plasma (Wayland)\n"
+    "Name[de]=Plasma (Wayland) de\n"
+    "Comment = Plasma by KDE \n"
+    "Exec=/usr/bin/startplasma-wayland\n"
+    "TryExec=/usr/bin/startplasma-wayland\n"
+    "DesktopNames=KDE;Plasma\n"
+    "Hidden=TRUE\n"
+    "X-SDDM-Env=FOO=bar,BAZ=1\n"
+    "\n"
+    "[Desktop Action Other] # comment\n"
+    "Name=Other\n"
+    "NoDisplay=true\n";
+
+void DesktopEntryTest::init() {
+    QFile file(ENTRY_FILE);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(s_entry);
+}
+
+void DesktopEntryTest::cleanup() {
+    QFile::remove(ENTRY_FILE);
+}
+
+void DesktopEntryTest::Basic() {
+    SDDM::DesktopEntry entry(ENTRY_FILE);
+    QVERIFY(entry.isValid());
+    QVERIFY(entry.hasGroup());
+    QCOMPARE(entry.value("Name"), QStringLiteral("Plasma (Wayland)"));
+    QCOMPARE(entry.value("Name[de]"), QStringLiteral("Plasma (Wayland) de"));
+    QCOMPARE(entry.value("Comment"), QStringLiteral("Plasma by KDE"));
+    QCOMPARE(entry.value("Exec"), QStringLiteral("/usr/bin/startplasma-wayland"));
+    QCOMPARE(entry.value("DesktopNames"), QStringLiteral("KDE;Plasma"));
+    QCOMPARE(entry.value("X-SDDM-Env"), QStringLiteral("FOO=bar,BAZ=1"));
+    QVERIFY(entry.boolValue("Hidden"));
+    QCOMPARE(entry.value("Unknown", QStringLiteral("default")), QStringLiteral("default"));
+}
+
+void DesktopEntryTest::Groups() {
+    // keys of the following groups must not leak into the requested one
+    SDDM::DesktopEntry entry(ENTRY_FILE);
+    QVERIFY(!entry.contains("NoDisplay"));
+    QVERIFY(!entry.boolValue("NoDisplay"));
+
+    SDDM::DesktopEntry other(ENTRY_FILE, QByteArrayLiteral("Desktop Action Other"));
+    QVERIFY(other.hasGroup());
+    QCOMPARE(other.value("Name"), QStringLiteral("Other"));
+    QVERIFY(other.boolValue("NoDisplay"));
+    QVERIFY(!other.contains("Exec"));
+
+    SDDM::DesktopEntry none(ENTRY_FILE, QByteArrayLiteral("SddmGreeterTheme"));
+    QVERIFY(none.isValid());
+    QVERIFY(!none.hasGroup());
+}
+
+void DesktopEntryTest::Missing() {
+    SDDM::DesktopEntry entry(QStringLiteral("does-not-exist.desktop"));
+    QVERIFY(!entry.isValid());
+    QVERIFY(!entry.hasGroup());
+    QVERIFY(entry.value("Name").isNull());
+}
+
+void DesktopEntryTest::BenchmarkParse() {
+    QBENCHMARK {
+        SDDM::DesktopEntry entry(ENTRY_FILE);
+        QVERIFY(!entry.value("Exec").isEmpty());
+    }
+}
+
+void DesktopEntryTest::BenchmarkLineByLine() {
+    // the QTextStream based approach the parser replaced, for comparison
+    QBENCHMARK {
+        QFile file(ENTRY_FILE);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QTextStream in(&file);
+        QString section, name, comment, exec, tryExec, desktopNames, env;
+        bool hidden = false, noDisplay = false;
+        while (!in.atEnd()) {
+            QString line = in.readLine();
+            if (line.startsWith(QLatin1String("["))) {
+                int end = line.lastIndexOf(QLatin1Char(']'), line.indexOf(QLatin1Char('#')));
+                if (end != -1)
+                    section = line.mid(1, end - 1);
+            }
+            if (section != QLatin1String("Desktop Entry"))
+                continue;
+            if (line.startsWith(QLatin1String("Name=")))
+                name = line.mid(5);
+            if (line.startsWith(QLatin1String("Comment=")))
+                comment = line.mid(8);
+            if (line.startsWith(QLatin1String("Exec=")))
+                exec = line.mid(5);
+            if (line.startsWith(QLatin1String("TryExec=")))
+                tryExec = line.mid(8);
+            if (line.startsWith(QLatin1String("DesktopNames=")))
+                desktopNames = line.mid(13);
+            if (line.startsWith(QLatin1String("Hidden=")))
+                hidden = line.mid(7).toLower() == QLatin1String("true");
+            if (line.startsWith(QLatin1String("NoDisplay=")))
+                noDisplay = line.mid(10).toLower() == QLatin1String("true");
+            if (line.startsWith(QLatin1String("X-SDDM-Env=")))
+                env = line.mid(11);
+        }
+        QVERIFY(!exec.isEmpty());
+        Q_UNUSED(hidden);
+        Q_UNUSED(noDisplay);
+    }
+}
@@ -0,0 +1,175 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "HelperProtocolTest.h"
+
+#include "AuthMessages.h"
+#include "SafeDataStream.h"
+
+#include <QtTest/QtTest>
+
+using namespace SDDM;
+
+QTEST_MAIN(HelperProtocolTest);
+
+static QProcessEnvironment baseEnvironment() {
+    QProcessEnvironment base;
+    base.insert(QStringLiteral("LANG"), QStringLiteral("de_DE.UTF-8"));
+    base.insert(QStringLiteral("LC_TIME"), QStringLiteral("C"));
+    base.insert(QStringLiteral("SDDM_CONFIG_SNAPSHOT"), QStringLiteral("/run/sddm/config"));
+    return base;
+}
+
+static QProcessEnvironment sessionEnvironment() {
+    QProcessEnvironment env;
+    env.insert(QStringLiteral("LANG"), QStringLiteral("de_DE.UTF-8"));
+    env.insert(QStringLiteral("LC_TIME"), QStringLiteral("en_GB.UTF-8"));
+    env.insert(QStringLiteral("PATH"), QStringLiteral("/usr/local/bin:/usr/bin:/bin"));
+    env.insert(QStringLiteral("XDG_SEAT"), QStringLiteral("seat0"));
+    env.insert(QStringLiteral("XDG_SESSION_DESKTOP"), QStringLiteral("KDE"));
+    env.insert(QStringLiteral("DESKTOP_SESSION"), QStringLiteral("Plasma (X11) ä"));
+    env.insert(QStringLiteral("EMPTY"), QString());
+    return env;
+}
+
+static QByteArray serialized(const SDDM::EnvironmentDelta &delta) {
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out << delta;
+    return data;
+}
+
+void HelperProtocolTest::EnvironmentDelta() {
+    const QProcessEnvironment base = baseEnvironment();
+    const QProcessEnvironment env = sessionEnvironment();
+    const QByteArray data = serialized(SDDM::EnvironmentDelta(env, base));
+
+    QDataStream in(data);
+    SDDM::EnvironmentDelta delta;
+    in >> delta;
+    QCOMPARE(in.status(), QDataStream::Ok);
+    QVERIFY(in.atEnd());
+    QCOMPARE(delta.apply(base), env);
+}
+
+void HelperProtocolTest::EnvironmentDeltaOnlyChanges() {
+    const SDDM::EnvironmentDelta delta(sessionEnvironment(), baseEnvironment());
+
+    // LANG is the same on both sides
+    QCOMPARE(delta.set.size(), 6);
+    for (const auto &entry : delta.set)
+        QVERIFY(entry.first != QLatin1String("LANG"));
+    QCOMPARE(delta.unset, QStringList() << QStringLiteral("SDDM_CONFIG_SNAPSHOT"));
+
+    const SDDM::EnvironmentDelta none(baseEnvironment(), baseEnvironment());
+    QVERIFY(none.set.isEmpty());
+    QVERIFY(none.unset.isEmpty());
+}
+
+void HelperProtocolTest::EnvironmentDeltaTruncated() {
+    const QByteArray data = serialized(SDDM::EnvironmentDelta(sessionEnvironment(), baseEnvironment()));
+
+    // every prefix is rejected and leaves the target alone
+    for (int length = 0; length < data.size(); ++length) {
+        QDataStream in(data.left(length));
+        SDDM::EnvironmentDelta delta;
+        delta.unset << QStringLiteral("UNTOUCHED");
+        in >> delta;
+        QVERIFY2(in.status() != QDataStream::Ok, qPrintable(QString::number(length)));
+        QCOMPARE(delta.unset, QStringList() << QStringLiteral("UNTOUCHED"));
+        QVERIFY(delta.set.isEmpty());
+    }
+}
+
+void HelperProtocolTest::EnvironmentDeltaCorrupt() {
+    // a count far beyond the data must not allocate or loop
+    {
+        QByteArray data;
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out << quint32(0x7fffffff) << QByteArrayLiteral("KEY") << QByteArrayLiteral("VALUE");
+        QDataStream in(data);
+        SDDM::EnvironmentDelta delta;
+        in >> delta;
+        QCOMPARE(in.status(), QDataStream::ReadCorruptData);
+    }
+
+    // keys can't be empty or contain '='
+    const QByteArray keys[] = { QByteArray(), QByteArrayLiteral("A=B") };
+    for (const QByteArray &key : keys) {
+        QByteArray data;
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out << quint32(1) << key << QByteArrayLiteral("VALUE") << quint32(0);
+        QDataStream in(data);
+        SDDM::EnvironmentDelta delta;
+        in >> delta;
+        QCOMPARE(in.status(), QDataStream::ReadCorruptData);
+    }
+}
+
+void HelperProtocolTest::RequestTruncated() {
+    Request request;
+    request.prompts << Prompt(AuthPrompt::LOGIN_USER, QStringLiteral("login:"), false);
+    request.prompts << Prompt(AuthPrompt::LOGIN_PASSWORD, QStringLiteral("Password: "), true);
+    request.prompts[1].response = QByteArrayLiteral("secret");
+
+    QByteArray data;
+    {
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out << request;
+    }
+
+    for (int length = 0; length < data.size(); ++length) {
+        QDataStream in(data.left(length));
+        Request received;
+        in >> received;
+        QVERIFY(in.status() != QDataStream::Ok);
+        QVERIFY(!received.valid());
+    }
+
+    QDataStream in(data);
+    Request received;
+    in >> received;
+    QCOMPARE(in.status(), QDataStream::Ok);
+    QVERIFY(received == request);
+}
+
+void HelperProtocolTest::ChannelInvalidFrameLength() {
+    // a valid frame right after a bad length must not be taken for one
+    QByteArray data;
+    const qint64 badLength = -1;
+    data.append(reinterpret_cast<const char *>(&badLength), sizeof(badLength));
+    data.append("garbage");
+    {
+        QByteArray payload;
+        QDataStream out(&payload, QIODevice::WriteOnly);
+        out << QStringLiteral("valid");
+        const qint64 length = payload.size();
+        data.append(reinterpret_cast<const char *>(&length), sizeof(length));
+        data.append(payload);
+    }
+
+    QBuffer device(&data);
+    QVERIFY(device.open(QIODevice::ReadOnly));
+    SafeDataChannel channel(&device);
+    SafeDataStream stream(&device);
+    QVERIFY(!channel.receive(stream));
+    QVERIFY(!device.isOpen());
+    QVERIFY(!channel.receive(stream));
+    QVERIFY(!channel.hasPendingData());
+}
@@ -0,0 +1,335 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+// Puts many greeters' worth of traffic on a daemon in test mode.
+//
+// Each client connects to one of the given greeter sockets and goes
+// through Connect, optionally ListUsers, and then Login attempts with a
+// wrong password, each of which makes the daemon run a helper through
+// its PAM request rounds. Clients reconnect now and then, like greeters
+// coming back after a logout. At the end it prints the throughput, the
+// reply latencies and, from the daemon's metrics, how long its event
+// loop stalled.
+//
+// Only point it at sddm --test-mode: a real daemon acts on PowerOff.
+// The user has to be given, preferably one nobody logs in as or a daemon
+// running sddm-helper-mock: each attempt is a failed login for PAM.
+
+#include "Messages.h"
+#include "SecureBuffer.h"
+#include "Session.h"
+#include "SocketReader.h"
+#include "SocketWriter.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDBusArgument>
+#include <QDBusConnection>
+#include <QDBusInterface>
+#include <QDBusMetaType>
+#include <QElapsedTimer>
+#include <QLocalSocket>
+#include <QRandomGenerator>
+#include <QTimer>
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+
+using namespace SDDM;
+
+// a lost reply counts as an error after that long
+static const int ReplyTimeout = 10000;
+
+struct Options {
+    QStringList sockets;
+    QString user;
+    QString session;
+    int actionsPerConnection = 20;
+    bool listUsers = false;
+    bool power = false;
+};
+
+struct Results {
+    QVector<double> connect;
+    QVector<double> login;
+    QVector<double> listUsers;
+    quint64 messages = 0;
+    quint64 timeouts = 0;
+    quint64 connections = 0;
+};
+
+class Client : public QObject {
+    Q_OBJECT
+public:
+    enum Waiting {
+        Nothing,
+        Capabilities,
+        UsersListed,
+        LoginReply
+    };
+
+    Client(const QString &socketName, const Options &options, Results &results, QObject *parent = nullptr)
+        : QObject(parent), m_socketName(socketName), m_options(options), m_results(results) {
+        m_socket = new QLocalSocket(this);
+        connect(m_socket, &QLocalSocket::connected, this, &Client::connected);
+        connect(m_socket, &QLocalSocket::readyRead, this, &Client::readyRead);
+        connect(m_socket, &QLocalSocket::disconnected, this, &Client::reconnect, Qt::QueuedConnection);
+
+        m_timeout.setSingleShot(true);
+        m_timeout.setInterval(ReplyTimeout);
+        connect(&m_timeout, &QTimer::timeout, this, [this] {
+            ++m_results.timeouts;
+            m_waiting = Nothing;
+            m_socket->disconnectFromServer();
+        });
+    }
+
+    void start() {
+        ++m_results.connections;
+        m_actions = 0;
+        m_socket->connectToServer(m_socketName);
+    }
+
+    void stop() {
+        m_stopped = true;
+        m_timeout.stop();
+        m_socket->disconnectFromServer();
+    }
+
+private:
+    void connected() {
+        SocketWriter(m_socket) << quint32(GreeterMessages::Connect) << ProtocolVersion;
+        // like a greeter that has come on screen
+        SocketWriter(m_socket) << quint32(GreeterMessages::Ready);
+        wait(Capabilities);
+    }
+
+    void reconnect() {
+        if (!m_stopped)
+            start();
+    }
+
+    void wait(Waiting waiting) {
+        ++m_results.messages;
+        m_waiting = waiting;
+        m_clock.start();
+        m_timeout.start();
+    }
+
+    void answered(QVector<double> &latencies) {
+        m_timeout.stop();
+        m_waiting = Nothing;
+        latencies << m_clock.nsecsElapsed() / 1000000.0;
+        QTimer::singleShot(0, this, &Client::next);
+    }
+
+    void next() {
+        if (m_stopped)
+            return;
+
+        // like a greeter going away at logout
+        if (++m_actions > m_options.actionsPerConnection) {
+            m_socket->disconnectFromServer();
+            return;
+        }
+
+        const int dice = QRandomGenerator::global()->bounded(100);
+        if (m_options.listUsers && m_actions == 1) {
+            SocketWriter(m_socket) << quint32(GreeterMessages::ListUsers);
+            wait(UsersListed);
+        } else if (m_options.power && dice < 10) {
+            // test mode only logs these, there is no reply
+            SocketWriter(m_socket) << quint32(GreeterMessages::PowerOff);
+            ++m_results.messages;
+            QTimer::singleShot(0, this, &Client::next);
+        } else {
+            SocketWriter writer(m_socket);
+            writer << quint32(GreeterMessages::Login) << m_options.user
+                   << SecureBuffer::fromString(QStringLiteral("sddm-load-generator"))
+                   << Session(Session::X11Session, m_options.session) << quint32(0);
+            wait(LoginReply);
+        }
+    }
+
+    void readyRead() {
+        SocketReader *reader = SocketReader::get(m_socket);
+        QByteArray frame;
+        while (reader->next(frame)) {
+            QDataStream input(frame);
+            quint32 message = 0;
+            input >> message;
+            switch (DaemonMessages(message)) {
+            case DaemonMessages::Capabilities:
+                if (m_waiting == Capabilities)
+                    answered(m_results.connect);
+                break;
+            case DaemonMessages::UsersListed:
+                if (m_waiting == UsersListed)
+                    answered(m_results.listUsers);
+                break;
+            case DaemonMessages::LoginFailed:
+            case DaemonMessages::LoginSucceeded:
+                if (m_waiting == LoginReply)
+                    answered(m_results.login);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    QString m_socketName;
+    const Options &m_options;
+    Results &m_results;
+    QLocalSocket *m_socket { nullptr };
+    QElapsedTimer m_clock;
+    QTimer m_timeout;
+    Waiting m_waiting { Nothing };
+    int m_actions { 0 };
+    bool m_stopped { false };
+};
+
+// the daemon's metrics in test mode are on the session bus
+static QVariant metricsProperty(const char *name) {
+    QDBusInterface metrics(QStringLiteral("org.freedesktop.DisplayManager"), QStringLiteral("/org/freedesktop/DisplayManager/Metrics"),
+                           QStringLiteral("org.freedesktop.DisplayManager.Metrics"), QDBusConnection::sessionBus());
+    return metrics.property(name);
+}
+
+static QVariantMap stallHistogram() {
+    const QVariantMap histograms = metricsProperty("Histograms").toMap();
+    const QVariant stall = histograms.value(QStringLiteral("event_loop_stall_ms"));
+    if (stall.canConvert<QDBusArgument>())
+        return qdbus_cast<QVariantMap>(stall.value<QDBusArgument>());
+    return stall.toMap();
+}
+
+static QList<quint64> buckets(const QVariantMap &histogram) {
+    const QVariant value = histogram.value(QStringLiteral("buckets"));
+    if (value.canConvert<QDBusArgument>())
+        return qdbus_cast<QList<quint64>>(value.value<QDBusArgument>());
+    return value.value<QList<quint64>>();
+}
+
+static void printLatencies(const char *name, QVector<double> values) {
+    if (values.isEmpty()) {
+        printf("%-12s %8s\n", name, "-");
+        return;
+    }
+    std::sort(values.begin(), values.end());
+    auto percentile = [&](double p) {
+        return values.at(qMax(1, int(std::ceil(p / 100.0 * values.count()))) - 1);
+    };
+    printf("%-12s %8d %10.2f %10.2f %10.2f %10.2f\n", name, values.count(),
+           percentile(50), percentile(90), percentile(99), values.last());
+}
+
+int main(int argc, char **argv) {
+    QCoreApplication app(argc, argv);
+    qDBusRegisterMetaType<QList<quint64>>();
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Load generator for the greeter sockets of sddm --test-mode"));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("sockets"), QStringLiteral("Greeter sockets of the daemon, see the --socket of its greeters"));
+    QCommandLineOption clientsOption(QStringLiteral("clients"), QStringLiteral("Concurrent connections"), QStringLiteral("count"), QStringLiteral("50"));
+    QCommandLineOption durationOption(QStringLiteral("duration"), QStringLiteral("Seconds to run"), QStringLiteral("seconds"), QStringLiteral("30"));
+    QCommandLineOption actionsOption(QStringLiteral("actions"), QStringLiteral("Messages per connection before reconnecting"), QStringLiteral("count"), QStringLiteral("20"));
+    QCommandLineOption userOption(QStringLiteral("user"), QStringLiteral("User the logins are attempted for, required"), QStringLiteral("name"));
+    QCommandLineOption sessionOption(QStringLiteral("session"), QStringLiteral("X session file sent with the logins"), QStringLiteral("file"), QStringLiteral("plasma.desktop"));
+    QCommandLineOption listUsersOption(QStringLiteral("list-users"), QStringLiteral("Ask for the user directory on each connection"));
+    QCommandLineOption powerOption(QStringLiteral("power"), QStringLiteral("Mix in PowerOff messages, the daemon must be in test mode"));
+    parser.addOptions({ clientsOption, durationOption, actionsOption, userOption, sessionOption, listUsersOption, powerOption });
+    parser.process(app);
+
+    Options options;
+    options.sockets = parser.positionalArguments();
+    options.user = parser.value(userOption);
+    options.session = parser.value(sessionOption);
+    options.actionsPerConnection = qMax(1, parser.value(actionsOption).toInt());
+    options.listUsers = parser.isSet(listUsersOption);
+    options.power = parser.isSet(powerOption);
+    if (options.sockets.isEmpty()) {
+        fprintf(stderr, "No greeter socket given\n");
+        return EXIT_FAILURE;
+    }
+    // failed logins may lock the account, don't pick one by default
+    if (options.user.isEmpty()) {
+        fprintf(stderr, "No user given, see --user\n");
+        return EXIT_FAILURE;
+    }
+
+    const QVariantMap stallBefore = stallHistogram();
+
+    Results results;
+    QVector<Client *> clients;
+    const int count = qMax(1, parser.value(clientsOption).toInt());
+    for (int i = 0; i < count; ++i) {
+        clients << new Client(options.sockets.at(i % options.sockets.count()), options, results, &app);
+        clients.last()->start();
+    }
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+    QTimer::singleShot(qMax(1, parser.value(durationOption).toInt()) * 1000, &app, [&] {
+        for (Client *client : qAsConst(clients))
+            client->stop();
+        app.quit();
+    });
+    app.exec();
+
+    const double seconds = elapsed.nsecsElapsed() / 1000000000.0;
+    printf("%d clients on %d sockets for %.1f s\n", count, int(options.sockets.count()), seconds);
+    printf("%llu connections, %llu messages, %.1f messages/s, %llu replies timed out\n\n",
+           results.connections, results.messages, results.messages / seconds, results.timeouts);
+    printf("%-12s %8s %10s %10s %10s %10s\n", "reply ms", "count", "p50", "p90", "p99", "max");
+    printLatencies("connect", results.connect);
+    printLatencies("list-users", results.listUsers);
+    printLatencies("login", results.login);
+
+    const QVariantMap stallAfter = stallHistogram();
+    if (stallAfter.isEmpty()) {
+        printf("\nNo event loop stalls known, is the daemon in test mode on this session bus?\n");
+        return EXIT_SUCCESS;
+    }
+
+    // the worst bucket that got samples during the run
+    const QList<quint64> before = buckets(stallBefore);
+    const QList<quint64> after = buckets(stallAfter);
+    const QList<quint64> bounds = metricsProperty("BucketBounds").value<QList<quint64>>();
+    QString worst = QStringLiteral("none");
+    for (int i = after.count() - 1; i >= 0; --i) {
+        if (after.at(i) > (i < before.count() ? before.at(i) : 0)) {
+            if (i < bounds.count())
+                worst = QStringLiteral("<= %1 ms").arg(bounds.at(i));
+            else if (!bounds.isEmpty())
+                worst = QStringLiteral("> %1 ms").arg(bounds.last());
+            break;
+        }
+    }
+    const quint64 samples = stallAfter.value(QStringLiteral("count")).toULongLong() - stallBefore.value(QStringLiteral("count")).toULongLong();
+    const quint64 sum = stallAfter.value(QStringLiteral("sum")).toULongLong() - stallBefore.value(QStringLiteral("sum")).toULongLong();
+    printf("\ndaemon event loop: %llu ms stalled over %llu checks, worst %s\n", sum, samples, qPrintable(worst));
+    return EXIT_SUCCESS;
+}
+
+#include "LoadGenerator.moc"
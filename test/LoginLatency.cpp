@@ -0,0 +1,236 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+// Times logins through the whole daemon and helper pipeline.
+//
+// Run as root, like the daemon, with "make login-latency". It starts
+// sddm --test-mode with sddm-helper-mock, and itself in place of the
+// greeter. Each greeter run logs in and notes when LoginSucceeded came
+// in and when the daemon stopped it. The session has to end right away
+// for the daemon to start the next greeter.
+
+#include "Configuration.h"
+#include "Messages.h"
+#include "SecureBuffer.h"
+#include "Session.h"
+#include "SignalHandler.h"
+#include "SocketReader.h"
+#include "SocketWriter.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QLocalSocket>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+#include <pwd.h>
+#include <signal.h>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace SDDM;
+
+static const char ResultsVariable[] = "SDDM_LATENCY_RESULTS";
+static const char RunsVariable[] = "SDDM_LATENCY_RUNS";
+static const char UserVariable[] = "SDDM_LATENCY_USER";
+static const char SessionVariable[] = "SDDM_LATENCY_SESSION";
+
+static int countLines(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return 0;
+    return file.readAll().count('\n');
+}
+
+static void appendLine(const QString &path, const QByteArray &line) {
+    QFile file(path);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Append))
+        file.write(line + '\n');
+}
+
+// started by the daemon with --socket, one login per run
+static int runGreeter(QCoreApplication &app, const QString &socketName) {
+    const QString results = qEnvironmentVariable(ResultsVariable);
+    const int runs = qEnvironmentVariableIntValue(RunsVariable);
+    const QString user = qEnvironmentVariable(UserVariable);
+    const QString sessionFile = qEnvironmentVariable(SessionVariable);
+
+    QLocalSocket socket;
+    QElapsedTimer sinceLogin;
+    qint64 succeeded = -1;
+
+    QObject::connect(&socket, &QLocalSocket::connected, &app, [&] {
+        SocketWriter(&socket) << quint32(GreeterMessages::Connect) << ProtocolVersion;
+        // there is nothing to put on screen, a real greeter sends this
+        // after its first frame
+        SocketWriter(&socket) << quint32(GreeterMessages::Ready);
+
+        SocketWriter writer(&socket);
+        writer << quint32(GreeterMessages::Login) << user << SecureBuffer::fromString(QStringLiteral("mock"))
+               << Session(Session::X11Session, sessionFile) << quint32(0);
+        sinceLogin.start();
+    });
+    QObject::connect(&socket, &QLocalSocket::readyRead, &app, [&] {
+        SocketReader *reader = SocketReader::get(&socket);
+        QByteArray frame;
+        while (reader->next(frame)) {
+            QDataStream input(frame);
+            quint32 message = 0;
+            input >> message;
+            if (DaemonMessages(message) == DaemonMessages::LoginSucceeded) {
+                succeeded = sinceLogin.nsecsElapsed();
+            } else if (DaemonMessages(message) == DaemonMessages::LoginFailed) {
+                // another run would fail the same way
+                appendLine(results, "failed");
+                ::kill(getppid(), SIGTERM);
+                app.exit(EXIT_FAILURE);
+            }
+        }
+    });
+
+    // the daemon stops the greeter once the session started
+    SignalHandler signalHandler;
+    QObject::connect(&signalHandler, &SignalHandler::sigtermReceived, &app, [&] {
+        if (succeeded >= 0) {
+            appendLine(results, QByteArray::number(succeeded / 1000000.0, 'f', 3) + ' ' +
+                                QByteArray::number(sinceLogin.nsecsElapsed() / 1000000.0, 'f', 3));
+        }
+        if (countLines(results) >= runs)
+            ::kill(getppid(), SIGTERM);
+        app.exit(EXIT_SUCCESS);
+    });
+
+    socket.connectToServer(socketName);
+    return app.exec();
+}
+
+static double percentile(const QVector<double> &sorted, double p) {
+    const int rank = qMax(1, int(std::ceil(p / 100.0 * sorted.count())));
+    return sorted.at(rank - 1);
+}
+
+static void printRow(const char *name, QVector<double> values) {
+    std::sort(values.begin(), values.end());
+    printf("%-18s %10.2f %10.2f %10.2f %10.2f\n", name,
+           percentile(values, 50), percentile(values, 90), percentile(values, 99), values.last());
+}
+
+static int runDriver(QCoreApplication &app) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Times logins through sddm --test-mode"));
+    parser.addHelpOption();
+    QCommandLineOption daemonOption(QStringLiteral("daemon"), QStringLiteral("sddm executable"), QStringLiteral("path"));
+    QCommandLineOption helperOption(QStringLiteral("helper"), QStringLiteral("sddm-helper-mock executable"), QStringLiteral("path"));
+    QCommandLineOption runsOption(QStringLiteral("runs"), QStringLiteral("Number of logins"), QStringLiteral("count"), QStringLiteral("20"));
+    QCommandLineOption userOption(QStringLiteral("user"), QStringLiteral("User to log in, the current one by default"), QStringLiteral("name"));
+    QCommandLineOption sessionOption(QStringLiteral("session"), QStringLiteral("X session file, its Exec should exit right away"),
+                                     QStringLiteral("file"), QStringLiteral("sddm-latency.desktop"));
+    parser.addOptions({ daemonOption, helperOption, runsOption, userOption, sessionOption });
+    parser.process(app);
+
+    if (!parser.isSet(daemonOption) || !parser.isSet(helperOption)) {
+        fprintf(stderr, "Both --daemon and --helper are needed\n");
+        return EXIT_FAILURE;
+    }
+
+    const int runs = qMax(1, parser.value(runsOption).toInt());
+    QString user = parser.value(userOption);
+    if (user.isEmpty()) {
+        if (struct passwd *pw = getpwuid(getuid()))
+            user = QString::fromLocal8Bit(pw->pw_name);
+    }
+
+    const QString sessionPath = QStringLiteral("%1/%2").arg(mainConfig.X11.SessionDir.get(), parser.value(sessionOption));
+    if (!QFileInfo::exists(sessionPath)) {
+        fprintf(stderr, "Install a session that exits right away as %s, for example with Exec=true\n", qPrintable(sessionPath));
+        return EXIT_FAILURE;
+    }
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        fprintf(stderr, "Cannot create a temporary directory\n");
+        return EXIT_FAILURE;
+    }
+    const QString results = dir.filePath(QStringLiteral("results"));
+
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    env.insert(QLatin1String(ResultsVariable), results);
+    env.insert(QLatin1String(RunsVariable), QString::number(runs));
+    env.insert(QLatin1String(UserVariable), user);
+    env.insert(QLatin1String(SessionVariable), parser.value(sessionOption));
+
+    QProcess daemon;
+    daemon.setProcessEnvironment(env);
+    daemon.setProcessChannelMode(QProcess::ForwardedChannels);
+    daemon.start(parser.value(daemonOption), { QStringLiteral("--test-mode"),
+                                               QStringLiteral("--greeter"), QCoreApplication::applicationFilePath(),
+                                               QStringLiteral("--helper"), parser.value(helperOption) });
+    // a minute per login is plenty even for a slow CI machine
+    if (!daemon.waitForFinished(runs * 60000)) {
+        daemon.kill();
+        daemon.waitForFinished();
+        fprintf(stderr, "Timed out after %d of %d logins\n", countLines(results), runs);
+        return EXIT_FAILURE;
+    }
+
+    QFile file(results);
+    if (!file.open(QIODevice::ReadOnly)) {
+        fprintf(stderr, "No login finished\n");
+        return EXIT_FAILURE;
+    }
+    QVector<double> succeeded, stopped;
+    while (!file.atEnd()) {
+        const QList<QByteArray> fields = file.readLine().trimmed().split(' ');
+        if (fields.count() != 2) {
+            fprintf(stderr, "A login failed, is %s allowed to log in?\n", qPrintable(user));
+            return EXIT_FAILURE;
+        }
+        succeeded << fields.at(0).toDouble();
+        stopped << fields.at(1).toDouble();
+    }
+    if (succeeded.isEmpty()) {
+        fprintf(stderr, "No login finished\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("%d logins of %s, in ms from Login\n", succeeded.count(), qPrintable(user));
+    printf("%-18s %10s %10s %10s %10s\n", "", "p50", "p90", "p99", "max");
+    printRow("login-succeeded", succeeded);
+    printRow("greeter-stopped", stopped);
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv) {
+    QCoreApplication app(argc, argv);
+
+    const QStringList args = app.arguments();
+    const int pos = args.indexOf(QStringLiteral("--socket"));
+    if (pos >= 0 && pos < args.count() - 1)
+        return runGreeter(app, args.at(pos + 1));
+
+    return runDriver(app);
+}
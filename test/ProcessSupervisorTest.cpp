@@ -0,0 +1,109 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "ProcessSupervisorTest.h"
+
+#include "ProcessSupervisor.h"
+
+#include <QtTest/QtTest>
+
+using namespace SDDM;
+
+QTEST_MAIN(ProcessSupervisorTest);
+
+// a shell which ignores SIGTERM when @p ignoreTerm is set
+static void startShell(QProcess &process, bool ignoreTerm) {
+    const QString script = ignoreTerm ? QStringLiteral("trap '' TERM; while :; do sleep 1; done")
+                                      : QStringLiteral("while :; do sleep 1; done");
+    process.start(QStringLiteral("/bin/sh"), { QStringLiteral("-c"), script });
+    QVERIFY(process.waitForStarted());
+}
+
+void ProcessSupervisorTest::Stop() {
+    QProcess process;
+    ProcessSupervisor *supervisor = ProcessSupervisor::of(&process);
+    QCOMPARE(ProcessSupervisor::of(&process), supervisor);
+
+    startShell(process, false);
+    QSignalSpy exited(supervisor, &ProcessSupervisor::exited);
+    QSignalSpy finished(&process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished));
+
+    supervisor->stop(5000);
+    QVERIFY(supervisor->isStopping());
+    QVERIFY(finished.wait(3000));
+    QCOMPARE(exited.count(), 1);
+    QVERIFY(!supervisor->isStopping());
+    QCOMPARE(process.exitStatus(), QProcess::CrashExit);
+}
+
+void ProcessSupervisorTest::StopEscalates() {
+    QProcess process;
+    ProcessSupervisor *supervisor = ProcessSupervisor::of(&process);
+    startShell(process, true);
+    QSignalSpy finished(&process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished));
+    QSignalSpy stopFailed(supervisor, &ProcessSupervisor::stopFailed);
+
+    // the shell has to get to its trap first
+    QTest::qWait(200);
+    QElapsedTimer elapsed;
+    elapsed.start();
+    supervisor->stop(300);
+    QVERIFY(finished.wait(3000));
+    QVERIFY(elapsed.elapsed() >= 300);
+    QVERIFY(stopFailed.isEmpty());
+}
+
+void ProcessSupervisorTest::StopAndWait() {
+    QProcess process;
+    ProcessSupervisor *supervisor = ProcessSupervisor::of(&process);
+    startShell(process, true);
+    QTest::qWait(200);
+
+    QVERIFY(supervisor->stopAndWait(300));
+    QCOMPARE(process.state(), QProcess::NotRunning);
+
+    // nothing left to stop
+    QVERIFY(supervisor->stopAndWait(300));
+}
+
+void ProcessSupervisorTest::Deadline() {
+    QProcess process;
+    ProcessSupervisor *supervisor = ProcessSupervisor::of(&process);
+    supervisor->setDeadline(300);
+    QSignalSpy finished(&process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished));
+
+    startShell(process, true);
+    QVERIFY(finished.wait(3000));
+    QCOMPARE(process.exitStatus(), QProcess::CrashExit);
+}
+
+void ProcessSupervisorTest::FailedToStart() {
+    QProcess process;
+    ProcessSupervisor *supervisor = ProcessSupervisor::of(&process);
+    QSignalSpy failed(supervisor, &ProcessSupervisor::failedToStart);
+    QSignalSpy started(supervisor, &ProcessSupervisor::started);
+
+    process.start(QStringLiteral("/nonexistent/sddm-test-program"), QStringList());
+    QTRY_COMPARE(failed.count(), 1);
+    QVERIFY(started.isEmpty());
+
+    // stopping what never ran is a no-op
+    supervisor->stop(100);
+    QVERIFY(!supervisor->isStopping());
+}
@@ -0,0 +1,83 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "PromptClassifierTest.h"
+
+#include "PromptClassifier.h"
+
+#include <QtTest/QtTest>
+
+using namespace SDDM;
+
+QTEST_MAIN(PromptClassifierTest);
+
+void PromptClassifierTest::Classify_data() {
+    QTest::addColumn<QString>("message");
+    QTest::addColumn<bool>("echoOff");
+    QTest::addColumn<int>("type");
+
+    QTest::newRow("login") << QStringLiteral("login:") << false << int(AuthPrompt::LOGIN_USER);
+    QTest::newRow("password") << QStringLiteral("Password: ") << true << int(AuthPrompt::LOGIN_PASSWORD);
+    QTest::newRow("current") << QStringLiteral("(current) UNIX password: ") << true << int(AuthPrompt::CHANGE_CURRENT);
+    QTest::newRow("new") << QStringLiteral("New password: ") << true << int(AuthPrompt::CHANGE_NEW);
+    QTest::newRow("retype") << QStringLiteral("Retype new password: ") << true << int(AuthPrompt::CHANGE_REPEAT);
+    QTest::newRow("re-enter") << QStringLiteral("Re-enter new PASSWORD: ") << true << int(AuthPrompt::CHANGE_REPEAT);
+    QTest::newRow("word boundary") << QStringLiteral("Passwords: ") << true << int(AuthPrompt::UNKNOWN);
+    QTest::newRow("pin") << QStringLiteral("Enter PIN for token: ") << true << int(AuthPrompt::UNKNOWN);
+}
+
+void PromptClassifierTest::Classify() {
+    QFETCH(QString, message);
+    QFETCH(bool, echoOff);
+    QFETCH(int, type);
+    QCOMPARE(int(PromptClassifier::classify(message, echoOff)), type);
+}
+
+void PromptClassifierTest::PasswordChange_data() {
+    QTest::addColumn<QString>("message");
+    QTest::addColumn<bool>("result");
+
+    QTest::newRow("pam_unix") << QStringLiteral("Changing password for alice") << true;
+    QTest::newRow("no user") << QStringLiteral("Changing password for ") << false;
+    QTest::newRow("trailing text") << QStringLiteral("Changing password for alice now") << false;
+    QTest::newRow("other") << QStringLiteral("Please touch the device.") << false;
+}
+
+void PromptClassifierTest::PasswordChange() {
+    QFETCH(QString, message);
+    QFETCH(bool, result);
+    QCOMPARE(PromptClassifier::isPasswordChange(message), result);
+}
+
+void PromptClassifierTest::BenchmarkClassify() {
+    // what a pam_sss + pam_u2f stack sends during a single login
+    const QStringList messages {
+        QStringLiteral("Please touch the device."),
+        QStringLiteral("Enter PIN for token: "),
+        QStringLiteral("Password: "),
+        QStringLiteral("(current) UNIX password: "),
+        QStringLiteral("Retype new password: ")
+    };
+    QBENCHMARK {
+        for (const QString &message : messages) {
+            PromptClassifier::isPasswordChange(message);
+            PromptClassifier::classify(message, true);
+        }
+    }
+}
@@ -0,0 +1,108 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "SecureBufferTest.h"
+
+#include "SecureBuffer.h"
+
+#include <QtTest/QtTest>
+
+#include <utility>
+
+using namespace SDDM;
+
+QTEST_MAIN(SecureBufferTest);
+
+void SecureBufferTest::Basic() {
+    SecureBuffer empty;
+    QVERIFY(empty.isNull());
+    QVERIFY(empty.isEmpty());
+    QCOMPARE(empty.constData(), "");
+
+    SecureBuffer buffer = SecureBuffer::fromString(QStringLiteral("secret"));
+    QVERIFY(!buffer.isNull());
+    QCOMPARE(buffer.size(), 6);
+    QCOMPARE(buffer.constData(), "secret");
+    QCOMPARE(buffer.toByteArray(), QByteArrayLiteral("secret"));
+
+    buffer.clear();
+    QVERIFY(buffer.isNull());
+    QCOMPARE(buffer.size(), 0);
+}
+
+void SecureBufferTest::Move() {
+    SecureBuffer buffer("secret", 6);
+    const char *data = buffer.constData();
+
+    SecureBuffer moved(std::move(buffer));
+    QVERIFY(buffer.isNull());
+    QVERIFY(moved.constData() == data);
+
+    SecureBuffer assigned;
+    assigned = std::move(moved);
+    QVERIFY(moved.isNull());
+    QVERIFY(assigned.constData() == data);
+
+    SecureBuffer copy = assigned.copy();
+    QVERIFY(copy.constData() != data);
+    QCOMPARE(copy.toByteArray(), assigned.toByteArray());
+}
+
+void SecureBufferTest::Stream() {
+    QByteArray data;
+    {
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out << SecureBuffer("secret", 6) << SecureBuffer() << SecureBuffer(0);
+    }
+
+    // readable as a plain QByteArray as well
+    {
+        QDataStream in(data);
+        QByteArray plain, null, empty;
+        in >> plain >> null >> empty;
+        QCOMPARE(plain, QByteArrayLiteral("secret"));
+        QVERIFY(null.isNull());
+        QVERIFY(!empty.isNull());
+        QVERIFY(empty.isEmpty());
+    }
+
+    QDataStream in(data);
+    SecureBuffer secret, null, empty;
+    in >> secret >> null >> empty;
+    QCOMPARE(in.status(), QDataStream::Ok);
+    QCOMPARE(secret.constData(), "secret");
+    QVERIFY(null.isNull());
+    QVERIFY(!empty.isNull());
+    QVERIFY(empty.isEmpty());
+}
+
+void SecureBufferTest::StreamTruncated() {
+    QByteArray data;
+    {
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out << SecureBuffer("secret", 6);
+    }
+    data.chop(2);
+
+    QDataStream in(data);
+    SecureBuffer buffer;
+    in >> buffer;
+    QCOMPARE(in.status(), QDataStream::ReadPastEnd);
+    QVERIFY(buffer.isNull());
+}
@@ -0,0 +1,119 @@
+/***************************************************************************
+* Copyright (c) 2026 SDDM contributors
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "ThemeConfigTest.h"
+
+#include "ThemeConfig.h"
+
+#include <QtTest/QtTest>
+#include <QSettings>
+
+using namespace SDDM;
+
+QTEST_MAIN(ThemeConfigTest);
+
+static void writeFile(const QString &path, const QByteArray &contents) {
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(contents);
+}
+
+// what ThemeConfig used to read through QSettings
+static QVariantMap readWithQSettings(const QString &path) {
+    QVariantMap map;
+    QSettings settings(path, QSettings::IniFormat);
+    QSettings userSettings(path + QStringLiteral(".user"), QSettings::IniFormat);
+    settings.setIniCodec("UTF-8");
+    userSettings.setIniCodec("UTF-8");
+    for (const QString &key: settings.allKeys())
+        map.insert(key, settings.value(key));
+    for (const QString &key: userSettings.allKeys()) {
+        if (!userSettings.value(key).toString().isEmpty())
+            map.insert(key, userSettings.value(key));
+    }
+    if (settings.contains(QStringLiteral("background")))
+        map.insert(QStringLiteral("defaultBackground"), settings.value(QStringLiteral("background")));
+    return map;
+}
+
+void ThemeConfigTest::init() {
+    m_dir = new QTemporaryDir();
+    QVERIFY(m_dir->isValid());
+    m_path = m_dir->filePath(QStringLiteral("theme.conf"));
+    qunsetenv(THEME_CONFIG_SNAPSHOT_VARIABLE);
+
+    writeFile(m_path, QByteArrayLiteral(
+        "; a comment\n"
+        "# another one\n"
+        "[General]\n"
+        "background=background.png\n"
+        "color = #1d99f3\n"
+        "type=image ; trailing comment\n"
+        "greeting=\"Hello, world\"\n"
+        "padded=\"  spaced  \"\n"
+        "escaped=\"say \\\"hi\\\"\"\n"
+        "needsFullUserModel=false\n"
+        "font=Noto Sans\n"
+        "title=Schöne Grüße\n"
+        "\n"
+        "[Colors]\n"
+        "accent=#ff0000\n"));
+    writeFile(m_path + QStringLiteral(".user"), QByteArrayLiteral(
+        "[General]\n"
+        "background=/usr/share/wallpapers/user.jpg\n"
+        "font=\n"));
+}
+
+void ThemeConfigTest::cleanup() {
+    qunsetenv(THEME_CONFIG_SNAPSHOT_VARIABLE);
+    delete m_dir;
+    m_dir = nullptr;
+}
+
+void ThemeConfigTest::SameAsQSettings() {
+    const ThemeConfig config(m_path);
+    const QVariantMap expected = readWithQSettings(m_path);
+
+    QCOMPARE(config.keys(), expected.keys());
+    for (auto it = expected.constBegin(); it != expected.constEnd(); ++it)
+        QCOMPARE(config.value(it.key()), it.value());
+
+    QCOMPARE(config.value(QStringLiteral("background")).toString(), QStringLiteral("/usr/share/wallpapers/user.jpg"));
+    QCOMPARE(config.value(QStringLiteral("defaultBackground")).toString(), QStringLiteral("background.png"));
+    QCOMPARE(config.value(QStringLiteral("Colors/accent")).toString(), QStringLiteral("#ff0000"));
+}
+
+void ThemeConfigTest::Snapshot() {
+    const QString snapshot = m_dir->filePath(QStringLiteral("theme.conf.snapshot"));
+    const ThemeConfig config(m_path);
+    QVERIFY(config.saveSnapshot(snapshot));
+
+    qputenv(THEME_CONFIG_SNAPSHOT_VARIABLE, QFile::encodeName(snapshot));
+
+    const ThemeConfig fromSnapshot(m_path);
+    QCOMPARE(static_cast<const QVariantMap &>(fromSnapshot), static_cast<const QVariantMap &>(config));
+
+    // the files are read over again once they don't match the snapshot
+    writeFile(m_path + QStringLiteral(".user"), QByteArrayLiteral("[General]\ntype=color\n"));
+    const ThemeConfig changed(m_path);
+    QCOMPARE(changed.value(QStringLiteral("type")).toString(), QStringLiteral("color"));
+
+    const ThemeConfig other(m_dir->filePath(QStringLiteral("missing.conf")));
+    QVERIFY(other.isEmpty());
+}